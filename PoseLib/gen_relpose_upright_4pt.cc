@@ -27,10 +27,13 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gen_relpose_upright_4pt.h"
+#include "ugp4pl.h"
 #include "misc/qep.h"
+#include "misc/dispatch.h"
 
-int pose_lib::gen_relpose_upright_4pt(const std::vector<Eigen::Vector3d> &p1, const std::vector<Eigen::Vector3d> &x1,
-                                      const std::vector<Eigen::Vector3d> &p2, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output) {
+int pose_lib::gen_relpose_upright_4pt(const Vector3View &p1, const Vector3View &x1,
+                                      const Vector3View &p2, const Vector3View &x2, CameraPoseVector *output) {
+    POSELIB_DISPATCH(gen_relpose_upright_4pt, (p1, x1, p2, x2, output))
 
     Eigen::Matrix<double, 4, 4> M, C, K;
     Eigen::Matrix<double, 3, 4> VX;
@@ -121,3 +124,18 @@ int pose_lib::gen_relpose_upright_4pt(const std::vector<Eigen::Vector3d> &p1, co
     }
     return n_roots;
 }
+
+int pose_lib::gen_relpose_upright_4pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &p1, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x1,
+                                            const Eigen::Matrix<double, Eigen::Dynamic, 12> &p2, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x2,
+                                            CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(gen_relpose_upright_4pt_batch, (p1, x1, p2, x2, output, num_solutions))
+    // The constraints R * (p1 + lambda1 * x1) + t = p2 + lambda2 * x2 are the same as for ugp4pl, with the points
+    // p1 on the lines with directions x1 in the first rig, and p2 + lambda2 * x2 as the camera rays.
+    return ugp4pl_batch(p2, x2, p1, x1, output, num_solutions);
+}
+
+int pose_lib::gen_relpose_upright_4pt_batch(const BatchView<12> &p1, const BatchView<12> &x1, const BatchView<12> &p2,
+                                            const BatchView<12> &x2, CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(gen_relpose_upright_4pt_batch_view, (p1, x1, p2, x2, output, num_solutions))
+    return ugp4pl_batch(p2, x2, p1, x1, output, num_solutions);
+}
@@ -29,12 +29,22 @@
 #pragma once
 #include "types.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace pose_lib {
 
 // Upright generalized relative pose from four point correspondences, i.e.
 //   R * (p1 + lambda1 * x1) + t = p2 + lambda2 * x2
 //    Sweeney et al., Solving for Relative Pose with a Partially Known Rotation is a Quadratic Eigenvalue Problem, 3DV 2014
-int gen_relpose_upright_4pt(const std::vector<Eigen::Vector3d> &p1, const std::vector<Eigen::Vector3d> &x1,
-                            const std::vector<Eigen::Vector3d> &p2, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output);
+int gen_relpose_upright_4pt(const Vector3View &p1, const Vector3View &x1,
+                            const Vector3View &p2, const Vector3View &x2, CameraPoseVector *output);
+
+// Batched version of gen_relpose_upright_4pt, see ugp4pl_batch. Row i holds instance i, i.e.
+// p1.row(i) = [p1[0]' p1[1]' p1[2]' p1[3]'] and similarly for x1, p2 and x2.
+int gen_relpose_upright_4pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &p1, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x1,
+                                  const Eigen::Matrix<double, Eigen::Dynamic, 12> &p2, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x2,
+                                  CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int gen_relpose_upright_4pt_batch(const BatchView<12> &p1, const BatchView<12> &x1, const BatchView<12> &p2,
+                                  const BatchView<12> &x2, CameraPoseVector *output, std::vector<int> *num_solutions);
 }; // namespace pose_lib
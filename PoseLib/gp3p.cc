@@ -27,15 +27,19 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gp3p.h"
+#include "residuals.h"
 #include "misc/re3q3.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-// Solves for camera pose such that: p+lambda*x = R*X+t
-int gp3p(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output) {
-
-    Eigen::Matrix<double, 6, 13> A;
+namespace {
 
+// Sets up the linear system A * [t; vec(R); 1] = 0 and solves for the rotations (as quaternions).
+// The translation for rotation R is then given by -B * (A.block<3, 9>(0, 3) * vec(R) + A.block<3, 1>(0, 12)).
+int gp3p_rotations(const Vector3View &p, const Vector3View &x, const Vector3View &X,
+                   Eigen::Matrix<double, 6, 13> &A, Eigen::Matrix3d &B, Eigen::Matrix<double, 4, 8> &solutions) {
     for (int i = 0; i < 3; ++i) {
         // xx = [x3 0 -x1; 0 x3 -x2]
         // eqs = [xx kron(X',xx), -xx*p] * [t; vec(R); 1]
@@ -44,21 +48,127 @@ int gp3p(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3
         A.row(2 * i + 1) << 0.0, x[i](2), -x[i](1), 0.0, X[i](0) * x[i](2), -X[i](0) * x[i](1), 0.0, X[i](1) * x[i](2), -X[i](1) * x[i](1), 0.0, X[i](2) * x[i](2), -X[i](2) * x[i](1), -p[i](1) * x[i](2) + p[i](2) * x[i](1);
     }
 
-    Eigen::Matrix3d B = A.block<3, 3>(0, 0).inverse();
+    B = A.block<3, 3>(0, 0).inverse();
 
     Eigen::Matrix<double, 3, 10> AR = A.block<3, 10>(3, 3) - A.block<3, 3>(3, 0) * B * A.block<3, 10>(0, 3);
+    return re3q3::re3q3_rotation(AR, &solutions);
+}
+
+inline void gp3p_pose(const Eigen::Matrix<double, 6, 13> &A, const Eigen::Matrix3d &B, const Eigen::Vector4d &q, CameraPose *pose) {
+    pose->R = Eigen::Quaterniond(q).toRotationMatrix();
+    pose->t = -B * (A.block<3, 9>(0, 3) * Eigen::Map<const Eigen::Matrix<double, 9, 1>>(pose->R.data()) + A.block<3, 1>(0, 12));
+}
+
+// The entries of R are quadratic in the (unit) quaternion q = (x, y, z, w), i.e. vec(R) = M * m(q) for the monomials
+//   m(q) = [w^2, x^2, y^2, z^2, xy, wz, xz, wy, yz, wx]
+// Computes T = A.block<3, 9>(0, 3) * M such that the translation is -B * (T * m(q) + A.block<3, 1>(0, 12)).
+inline void gp3p_translation_basis(const Eigen::Matrix<double, 6, 13> &A, Eigen::Matrix<double, 3, 10> *T) {
+    // Columns of A for the entries of vec(R) (column-major)
+    const auto R00 = A.block<3, 1>(0, 3), R10 = A.block<3, 1>(0, 4), R20 = A.block<3, 1>(0, 5);
+    const auto R01 = A.block<3, 1>(0, 6), R11 = A.block<3, 1>(0, 7), R21 = A.block<3, 1>(0, 8);
+    const auto R02 = A.block<3, 1>(0, 9), R12 = A.block<3, 1>(0, 10), R22 = A.block<3, 1>(0, 11);
+
+    T->col(0) = R00 + R11 + R22;
+    T->col(1) = R00 - R11 - R22;
+    T->col(2) = R11 - R00 - R22;
+    T->col(3) = R22 - R00 - R11;
+    T->col(4) = 2.0 * (R10 + R01);
+    T->col(5) = 2.0 * (R10 - R01);
+    T->col(6) = 2.0 * (R20 + R02);
+    T->col(7) = 2.0 * (R02 - R20);
+    T->col(8) = 2.0 * (R21 + R12);
+    T->col(9) = 2.0 * (R21 - R12);
+}
+
+inline void gp3p_pose(const Eigen::Matrix<double, 6, 13> &A, const Eigen::Matrix3d &B, const Eigen::Matrix<double, 3, 10> &T,
+                      const Eigen::Vector4d &q, CompactPose *pose) {
+    // The translation is computed directly from the quaternion, the rotation matrix is never formed.
+    const double x = q(0), y = q(1), z = q(2), w = q(3);
+    Eigen::Matrix<double, 10, 1> m;
+    m << w * w, x * x, y * y, z * z, x * y, w * z, x * z, w * y, y * z, w * x;
+    pose->q = q;
+    pose->t = -B * (T * m + A.block<3, 1>(0, 12));
+}
+
+int gp3p_impl(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CameraPose> *output,
+              bool filter_invalid) {
+    Eigen::Matrix<double, 6, 13> A;
+    Eigen::Matrix3d B;
     Eigen::Matrix<double, 4, 8> solutions;
-    int n_sols = re3q3::re3q3_rotation(AR, &solutions);
+    int n_sols = gp3p_rotations(p, x, X, A, B, solutions);
 
     output->clear();
     for (int i = 0; i < n_sols; ++i) {
         CameraPose pose;
-        pose.R = Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
-        pose.t = -B * (A.block<3, 9>(0, 3) * Eigen::Map<Eigen::Matrix<double, 9, 1>>(pose.R.data()) + A.block<3, 1>(0, 12));
+        gp3p_pose(A, B, solutions.col(i), &pose);
+        if (filter_invalid && !validity::check_points_generalized(pose, 1.0, p, x, X))
+            continue;
         output->push_back(pose);
     }
 
-    return n_sols;
+    return output->size();
+}
+
+int gp3p_impl(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CompactPose> *output,
+              bool filter_invalid) {
+    Eigen::Matrix<double, 6, 13> A;
+    Eigen::Matrix3d B;
+    Eigen::Matrix<double, 4, 8> solutions;
+    int n_sols = gp3p_rotations(p, x, X, A, B, solutions);
+
+    Eigen::Matrix<double, 3, 10> T;
+    gp3p_translation_basis(A, &T);
+
+    output->clear();
+    for (int i = 0; i < n_sols; ++i) {
+        CompactPose pose;
+        gp3p_pose(A, B, T, solutions.col(i), &pose);
+        if (filter_invalid && !validity::check_points_generalized(pose, 1.0, p, x, X))
+            continue;
+        output->push_back(pose);
+    }
+
+    return output->size();
+}
+
+} // namespace
+
+// Solves for camera pose such that: p+lambda*x = R*X+t
+int gp3p(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CameraPose> *output,
+         bool filter_invalid) {
+    POSELIB_DISPATCH(gp3p, (p, x, X, output, filter_invalid))
+    return gp3p_impl(p, x, X, output, filter_invalid);
+}
+
+int gp3p(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CompactPose> *output,
+         bool filter_invalid) {
+    POSELIB_DISPATCH(gp3p_compact, (p, x, X, output, filter_invalid))
+    return gp3p_impl(p, x, X, output, filter_invalid);
+}
+
+bool gp3p_best(const Vector3View &p, const Vector3View &x, const Vector3View &X,
+               const Eigen::Matrix<double, Eigen::Dynamic, 3> &p_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &x_all,
+               const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all, double threshold, CameraPose *best_pose, double *best_score) {
+    POSELIB_DISPATCH(gp3p_best, (p, x, X, p_all, x_all, X_all, threshold, best_pose, best_score))
+
+    Eigen::Matrix<double, 6, 13> A;
+    Eigen::Matrix3d B;
+    Eigen::Matrix<double, 4, 8> solutions;
+    int n_sols = gp3p_rotations(p, x, X, A, B, solutions);
+
+    CameraPose pose;
+    bool updated = false;
+    for (int i = 0; i < n_sols; ++i) {
+        gp3p_pose(A, B, solutions.col(i), &pose);
+
+        const double score = compute_generalized_angular_score(pose, p_all, x_all, X_all, threshold, *best_score);
+        if (score < *best_score) {
+            *best_score = score;
+            *best_pose = pose;
+            updated = true;
+        }
+    }
+    return updated;
 }
 
 } // namespace pose_lib
@@ -37,6 +37,17 @@ namespace pose_lib {
 // Solves for camera pose such that: p+lambda*x = R*X+t
 // Re-implementation of the gP3P solver from
 //    Kukelova et al., Efficient Intersection of Three Quadrics and Applications in Computer Vision, CVPR 2016
-int gp3p(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+int gp3p(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CameraPose> *output,
+         bool filter_invalid = false);
+// Same as above but returns compact poses, see CompactPoseT in types.h.
+int gp3p(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CompactPose> *output,
+         bool filter_invalid = false);
+
+// Fused solve-and-score version of gp3p (see p3p_best in p3p.h) using compute_generalized_angular_score, where
+// threshold is the maximum angle (in radians) between x_all and the ray to the point for an inlier.
+bool gp3p_best(const Vector3View &p, const Vector3View &x, const Vector3View &X,
+               const Eigen::Matrix<double, Eigen::Dynamic, 3> &p_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &x_all,
+               const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all, double threshold, CameraPose *best_pose, double *best_score);
 
 } // namespace pose_lib
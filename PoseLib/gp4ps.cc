@@ -27,44 +27,81 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gp4ps.h"
+#include "point_map.h"
 #include "misc/univariate.h"
 #include <iostream>
 #include "misc/re3q3.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 namespace pose_lib {
 
+namespace {
+
+// X[i] and X[j] are the same 3D point, move it to the front (gathered on the stack to avoid any allocations)
+int gp4ps_duplicated(const Vector3View &p, const Vector3View &x, const Vector3View &X, int i, int j,
+                     std::vector<CameraPose> *output, bool filter_invalid) {
+    int order[4] = {0, 1, 2, 3};
+    std::swap(order[0], order[i]);
+    std::swap(order[1], order[j]);
+
+    Eigen::Vector3d pp[4], xp[4], Xp[4];
+    for (int k = 0; k < 4; ++k) {
+        pp[k] = p[order[k]];
+        xp[k] = x[order[k]];
+        Xp[k] = X[order[k]];
+    }
+
+    return gp4ps_camposeco(Vector3View(pp, 4), Vector3View(xp, 4), Vector3View(Xp, 4), output, filter_invalid);
+}
+
+} // namespace
+
 // Solves for camera pose such that: p+lambda*x = R*X+t
 // Note: This function assumes that the bearing vectors (x) are normalized!
-int gp4ps(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output, bool filter_solutions) {
+int gp4ps(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CameraPose> *output, bool filter_solutions, bool filter_invalid) {
+    POSELIB_DISPATCH(gp4ps, (p, x, X, output, filter_solutions, filter_invalid))
 
     for (int i = 0; i < 4; ++i) {
         for (int j = i + 1; j < 4; ++j) {
             if ((X[i] - X[j]).squaredNorm() < 1e-10) {
-
                 // we have a duplicated 3d point
-                std::vector<Eigen::Vector3d> pp = p;
-                std::vector<Eigen::Vector3d> xp = x;
-                std::vector<Eigen::Vector3d> Xp = X;
+                return gp4ps_duplicated(p, x, X, i, j, output, filter_invalid);
+            }
+        }
+    }
 
-                std::swap(pp[0], pp[i]);
-                std::swap(xp[0], xp[i]);
-                std::swap(Xp[0], Xp[i]);
+    return gp4ps_kukelova(p, x, X, output, filter_solutions, filter_invalid);
+}
 
-                std::swap(pp[1], pp[j]);
-                std::swap(xp[1], xp[j]);
-                std::swap(Xp[1], Xp[j]);
+int gp4ps(const Vector3View &p, const Vector3View &x, const PointMap &map, const int *indices,
+          std::vector<CameraPose> *output, bool filter_solutions, bool filter_invalid) {
+    const Vector3View X = map.view(indices, 4);
 
-                return gp4ps_camposeco(pp, xp, Xp, output);
+    int n_sols = -1;
+    for (int i = 0; i < 4 && n_sols < 0; ++i) {
+        for (int j = i + 1; j < 4; ++j) {
+            if (map.point_id(indices[i]) == map.point_id(indices[j])) {
+                n_sols = gp4ps_duplicated(p, x, X, i, j, output, filter_invalid);
+                break;
             }
         }
     }
+    if (n_sols < 0) {
+        n_sols = gp4ps_kukelova(p, x, X, output, filter_solutions, filter_invalid);
+    }
 
-    return gp4ps_kukelova(p, x, X, output, filter_solutions);
+    for (CameraPose &pose : *output) {
+        map.denormalize(&pose);
+        pose.alpha *= map.scale();
+    }
+    return n_sols;
 }
 
 // Solves for camera pose such that: scale*p+lambda*x = R*X+t
-int gp4ps_kukelova(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                   const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output,
-                   bool filter_solutions) {
+int gp4ps_kukelova(const Vector3View &p, const Vector3View &x,
+                   const Vector3View &X, std::vector<CameraPose> *output,
+                   bool filter_solutions, bool filter_invalid) {
+    POSELIB_DISPATCH(gp4ps_kukelova, (p, x, X, output, filter_solutions, filter_invalid))
 
     Eigen::Matrix<double, 8, 13> A;
 
@@ -76,7 +113,8 @@ int gp4ps_kukelova(const std::vector<Eigen::Vector3d> &p, const std::vector<Eige
         A.row(2 * i + 1) << 0.0, x[i](2), -x[i](1), -p[i](1) * x[i](2) + p[i](2) * x[i](1), 0.0, X[i](0) * x[i](2), -X[i](0) * x[i](1), 0.0, X[i](1) * x[i](2), -X[i](1) * x[i](1), 0.0, X[i](2) * x[i](2), -X[i](2) * x[i](1);
     }
 
-    Eigen::Matrix4d B = A.block<4, 4>(0, 0).inverse();
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    Eigen::Matrix4d B = A.block<4, 4>(0, 0).partialPivLu().inverse();
 
     Eigen::Matrix<double, 3, 9> AR = A.block<3, 9>(4, 4) - A.block<3, 4>(4, 0) * B * A.block<4, 9>(0, 4);
 
@@ -95,6 +133,9 @@ int gp4ps_kukelova(const std::vector<Eigen::Vector3d> &p, const std::vector<Eige
         pose.t = ts.block<3, 1>(0, 0);
         pose.alpha = ts(3);
 
+        if (filter_invalid && !validity::check_points_generalized(pose, pose.alpha, p, x, X))
+            continue;
+
         if (filter_solutions) {
             double res = std::abs(x[3].dot((pose.R * X[3] + pose.t - pose.alpha * p[3]).normalized()));
             if (res > best_res) {
@@ -114,8 +155,9 @@ int gp4ps_kukelova(const std::vector<Eigen::Vector3d> &p, const std::vector<Eige
 
 // Solves for camera pose such that: scale*p+lambda*x = R*X+t
 // Assumes that X[0] == X[1] !
-int gp4ps_camposeco(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                    const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output) {
+int gp4ps_camposeco(const Vector3View &p, const Vector3View &x,
+                    const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(gp4ps_camposeco, (p, x, X, output, filter_invalid))
     // Locally triangulate the 3D point
     const double a = x[0].dot(x[1]);
     const double b1 = x[0].dot(p[1] - p[0]);
@@ -182,6 +224,8 @@ int gp4ps_camposeco(const std::vector<Eigen::Vector3d> &p, const std::vector<Eig
         pose.R = XX * YY;
         pose.t = pose.alpha * Xc - pose.R * X[0];
 
+        if (filter_invalid && !validity::check_points_generalized(pose, pose.alpha, p, x, X))
+            continue;
         output->push_back(pose);
     }
     return output->size();
@@ -34,27 +34,37 @@
 
 namespace pose_lib {
 
+class PointMap;
+
 // Solver the generalized absolute pose and scale problem.
 // The solver automagically identifies the quasi-degenerate case where two 3D points coincides,
 // and then either calls gp4ps_kukelova or gp4ps_camposeco.
 // If you know that you never have duplicate observations (e.g. non-overlapping FoV) you can directly call gp4ps_kukelova
-int gp4ps(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output,
-          bool filter_solutions = true);
+// If filter_invalid is true, solutions with non-finite values, non-positive scale or with any of the points behind
+// the camera are discarded.
+int gp4ps(const Vector3View &p, const Vector3View &x, const Vector3View &X, std::vector<CameraPose> *output,
+          bool filter_solutions = true, bool filter_invalid = false);
+
+// Same as above, but for the 3D points indices[0], ..., indices[3] of a preprocessed map (see point_map.h).
+// Duplicated 3D points are identified by their point_id in the map instead of comparing the points pairwise.
+// The solver works with the normalized points of the map and the poses are returned in the coordinates of the map.
+int gp4ps(const Vector3View &p, const Vector3View &x, const PointMap &map, const int *indices,
+          std::vector<CameraPose> *output, bool filter_solutions = true, bool filter_invalid = false);
 
 // Solves for camera pose such that: scale*p+lambda*x = R*X+t
 // Re-implementation of the gP4P solver from
 //    Kukelova et al., Efficient Intersection of Three Quadrics and Applications in Computer Vision, CVPR 2016
 // Note: this impl. assumes that x has been normalized and that the 3D points are distinct!
-int gp4ps_kukelova(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                   const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output,
-                   bool filter_solutions = true);
+int gp4ps_kukelova(const Vector3View &p, const Vector3View &x,
+                   const Vector3View &X, std::vector<CameraPose> *output,
+                   bool filter_solutions = true, bool filter_invalid = false);
 
 // Solves for camera pose such that: scale*p+lambda*x = R*X+t
 // Re-implementation of the gP4P solver from
 //    Camposeco et al., Minimal solvers for generalized pose and scale estimation from two rays and one point, ECCV 2016
 // Note: This solver assumes that the first two points correspond to the same 3D point!
 // This is a minimal problem and it is not possible to filter solutions!
-int gp4ps_camposeco(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                    const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output);
+int gp4ps_camposeco(const Vector3View &p, const Vector3View &x,
+                    const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid = false);
 
 } // namespace pose_lib
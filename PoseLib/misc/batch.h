@@ -0,0 +1,348 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace pose_lib {
+namespace batch {
+
+// Helpers for the batched solvers. These process several independent problem instances at once,
+// with one instance per lane. All lane-wise arithmetic is expressed as fixed-size Eigen arrays,
+// which are vectorized using whichever SIMD instructions Eigen is compiled for.
+// Branches in the scalar solvers are replaced by masks and select().
+
+// Number of instances processed together. Eight doubles fill one AVX-512 register (or two AVX2 registers).
+static const int LANES = 8;
+
+typedef Eigen::Array<double, LANES, 1> Lanes;
+
+// Single precision lanes. A SIMD register holds twice as many floats as doubles, so these hold 2 * LANES instances.
+static const int LANES_F = 2 * LANES;
+typedef Eigen::Array<float, LANES_F, 1> Lanesf;
+
+// Masks are stored as lanes with all bits set (true) or cleared (false), matching the SIMD compare instructions.
+// Comparisons on Eigen arrays produce bool arrays which are not vectorized, so we go through the packet functions.
+typedef Lanes Mask;
+typedef Lanesf Maskf;
+
+typedef Eigen::internal::packet_traits<double>::type Packet;
+static const int PACKET_SIZE = Eigen::internal::packet_traits<double>::size;
+
+namespace detail {
+// Applies op packet by packet to lanes of either precision.
+template <typename Scalar, int N, typename Op>
+inline Eigen::Array<Scalar, N, 1> compare(const Eigen::Array<Scalar, N, 1> &a, const Eigen::Array<Scalar, N, 1> &b, Op op) {
+    typedef typename Eigen::internal::packet_traits<Scalar>::type P;
+    const int size = Eigen::internal::packet_traits<Scalar>::size;
+    Eigen::Array<Scalar, N, 1> m;
+    for (int k = 0; k < N; k += size) {
+        Eigen::internal::pstoreu(m.data() + k, op(Eigen::internal::ploadu<P>(a.data() + k), Eigen::internal::ploadu<P>(b.data() + k)));
+    }
+    return m;
+}
+
+struct LessOp {
+    template <typename P> P operator()(const P &x, const P &y) const { return Eigen::internal::pcmp_lt(x, y); }
+};
+struct EqualOp {
+    template <typename P> P operator()(const P &x, const P &y) const { return Eigen::internal::pcmp_eq(x, y); }
+};
+struct AndOp {
+    template <typename P> P operator()(const P &x, const P &y) const { return Eigen::internal::pand(x, y); }
+};
+struct OrOp {
+    template <typename P> P operator()(const P &x, const P &y) const { return Eigen::internal::por(x, y); }
+};
+struct XorOp {
+    template <typename P> P operator()(const P &x, const P &y) const { return Eigen::internal::pxor(x, y); }
+};
+struct NotOp {
+    template <typename P> P operator()(const P &x, const P &) const { return Eigen::internal::pandnot(Eigen::internal::ptrue(x), x); }
+};
+
+template <typename Scalar, int N>
+inline Eigen::Array<Scalar, N, 1> select(const Eigen::Array<Scalar, N, 1> &m, const Eigen::Array<Scalar, N, 1> &a,
+                                         const Eigen::Array<Scalar, N, 1> &b) {
+    typedef typename Eigen::internal::packet_traits<Scalar>::type P;
+    const int size = Eigen::internal::packet_traits<Scalar>::size;
+    Eigen::Array<Scalar, N, 1> r;
+    for (int k = 0; k < N; k += size) {
+        Eigen::internal::pstoreu(r.data() + k, Eigen::internal::pselect(Eigen::internal::ploadu<P>(m.data() + k),
+                                                                        Eigen::internal::ploadu<P>(a.data() + k),
+                                                                        Eigen::internal::ploadu<P>(b.data() + k)));
+    }
+    return r;
+}
+
+inline uint64_t bits(const Mask &m, int lane) {
+    uint64_t b;
+    std::memcpy(&b, m.data() + lane, sizeof(b));
+    return b;
+}
+inline uint32_t bits(const Maskf &m, int lane) {
+    uint32_t b;
+    std::memcpy(&b, m.data() + lane, sizeof(b));
+    return b;
+}
+} // namespace detail
+
+// The functions below take lanes of either precision, or Eigen expressions evaluating to them.
+// a < b
+template <typename DA, typename DB>
+inline typename DA::PlainObject less(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::compare(a.eval(), b.eval(), detail::LessOp());
+}
+// a > b
+template <typename DA, typename DB>
+inline typename DA::PlainObject greater(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return less(b, a);
+}
+// a == b
+template <typename DA, typename DB>
+inline typename DA::PlainObject equal(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::compare(a.eval(), b.eval(), detail::EqualOp());
+}
+
+template <typename DA, typename DB>
+inline typename DA::PlainObject logical_and(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::compare(a.eval(), b.eval(), detail::AndOp());
+}
+template <typename DA, typename DB>
+inline typename DA::PlainObject logical_or(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::compare(a.eval(), b.eval(), detail::OrOp());
+}
+template <typename DA, typename DB>
+inline typename DA::PlainObject logical_xor(const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::compare(a.eval(), b.eval(), detail::XorOp());
+}
+template <typename DA>
+inline typename DA::PlainObject logical_not(const Eigen::ArrayBase<DA> &a) {
+    const typename DA::PlainObject &x = a.eval();
+    return detail::compare(x, x, detail::NotOp());
+}
+
+// Returns a where the mask is set and b otherwise.
+template <typename DM, typename DA, typename DB>
+inline typename DA::PlainObject select(const Eigen::ArrayBase<DM> &m, const Eigen::ArrayBase<DA> &a, const Eigen::ArrayBase<DB> &b) {
+    return detail::select(m.eval(), a.eval(), b.eval());
+}
+
+inline bool test(const Mask &m, int lane) { return detail::bits(m, lane) != 0; }
+inline bool test(const Maskf &m, int lane) { return detail::bits(m, lane) != 0; }
+
+template <typename MaskT>
+inline bool any(const MaskT &m) {
+    for (int k = 0; k < MaskT::SizeAtCompileTime; ++k) {
+        if (detail::bits(m, k) != 0)
+            return true;
+    }
+    return false;
+}
+
+template <typename MaskT>
+inline bool all(const MaskT &m) {
+    for (int k = 0; k < MaskT::SizeAtCompileTime; ++k) {
+        if (detail::bits(m, k) == 0)
+            return false;
+    }
+    return true;
+}
+
+// Loads entries [start, start + N) from column col of M, where N is the number of lanes of L (Lanes or Lanesf).
+// Lanes past the last row are padded with the last row, so that all lanes hold a valid instance.
+template <typename L = Lanes, typename Derived>
+inline L load(const Eigen::MatrixBase<Derived> &M, int col, int start) {
+    typedef typename L::Scalar Scalar;
+    const int N = L::SizeAtCompileTime;
+    const int n = std::min(N, static_cast<int>(M.rows()) - start);
+    L v;
+    if (n == N) {
+        v = M.col(col).template segment<N>(start).array().template cast<Scalar>();
+    } else {
+        v.head(n) = M.col(col).segment(start, n).array().template cast<Scalar>();
+        v.tail(N - n).setConstant(static_cast<Scalar>(M(M.rows() - 1, col)));
+    }
+    return v;
+}
+
+// Loads a 3-vector stored in columns [col, col + 3) of M.
+template <typename Derived, typename L>
+inline void load3(const Eigen::MatrixBase<Derived> &M, int col, int start, L v[3]) {
+    v[0] = load<L>(M, col, start);
+    v[1] = load<L>(M, col + 1, start);
+    v[2] = load<L>(M, col + 2, start);
+}
+
+// Note that the helpers below accumulate term by term. Longer expressions are not always inlined by the
+// compiler, and the resulting calls into Eigen's assignment loops dominate the runtime.
+// They are templated on the lanes (Lanes or Lanesf).
+template <typename L>
+inline void cross(const L a[3], const L b[3], L c[3]) {
+    c[0] = a[1] * b[2];
+    c[0] -= a[2] * b[1];
+    c[1] = a[2] * b[0];
+    c[1] -= a[0] * b[2];
+    c[2] = a[0] * b[1];
+    c[2] -= a[1] * b[0];
+}
+
+template <typename L>
+inline L dot(const L a[3], const L b[3]) {
+    L r = a[0] * b[0];
+    r += a[1] * b[1];
+    r += a[2] * b[2];
+    return r;
+}
+
+// Computes the inverse of the 3x3 matrix A (indexed as A[row][col]) using the adjugate.
+template <typename L>
+inline void inverse3x3(const L A[3][3], L Ainv[3][3]) {
+    Ainv[0][0] = A[1][1] * A[2][2] - A[1][2] * A[2][1];
+    Ainv[0][1] = A[0][2] * A[2][1] - A[0][1] * A[2][2];
+    Ainv[0][2] = A[0][1] * A[1][2] - A[0][2] * A[1][1];
+    Ainv[1][0] = A[1][2] * A[2][0] - A[1][0] * A[2][2];
+    Ainv[1][1] = A[0][0] * A[2][2] - A[0][2] * A[2][0];
+    Ainv[1][2] = A[0][2] * A[1][0] - A[0][0] * A[1][2];
+    Ainv[2][0] = A[1][0] * A[2][1] - A[1][1] * A[2][0];
+    Ainv[2][1] = A[0][1] * A[2][0] - A[0][0] * A[2][1];
+    Ainv[2][2] = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+
+    const L inv_det = (A[0][0] * Ainv[0][0] + A[0][1] * Ainv[1][0] + A[0][2] * Ainv[2][0]).inverse();
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Ainv[i][j] *= inv_det;
+        }
+    }
+}
+
+// Computes the inverse of the 4x4 matrix A (indexed as A[row][col]) by expanding in 2x2 minors.
+inline void inverse4x4(const Lanes A[4][4], Lanes Ainv[4][4]) {
+    // Minors from the top two and bottom two rows
+    const Lanes s0 = A[0][0] * A[1][1] - A[1][0] * A[0][1];
+    const Lanes s1 = A[0][0] * A[1][2] - A[1][0] * A[0][2];
+    const Lanes s2 = A[0][0] * A[1][3] - A[1][0] * A[0][3];
+    const Lanes s3 = A[0][1] * A[1][2] - A[1][1] * A[0][2];
+    const Lanes s4 = A[0][1] * A[1][3] - A[1][1] * A[0][3];
+    const Lanes s5 = A[0][2] * A[1][3] - A[1][2] * A[0][3];
+    const Lanes c0 = A[2][0] * A[3][1] - A[3][0] * A[2][1];
+    const Lanes c1 = A[2][0] * A[3][2] - A[3][0] * A[2][2];
+    const Lanes c2 = A[2][0] * A[3][3] - A[3][0] * A[2][3];
+    const Lanes c3 = A[2][1] * A[3][2] - A[3][1] * A[2][2];
+    const Lanes c4 = A[2][1] * A[3][3] - A[3][1] * A[2][3];
+    const Lanes c5 = A[2][2] * A[3][3] - A[3][2] * A[2][3];
+
+    Ainv[0][0] = A[1][1] * c5 - A[1][2] * c4 + A[1][3] * c3;
+    Ainv[0][1] = A[0][2] * c4 - A[0][1] * c5 - A[0][3] * c3;
+    Ainv[0][2] = A[3][1] * s5 - A[3][2] * s4 + A[3][3] * s3;
+    Ainv[0][3] = A[2][2] * s4 - A[2][1] * s5 - A[2][3] * s3;
+    Ainv[1][0] = A[1][2] * c2 - A[1][0] * c5 - A[1][3] * c1;
+    Ainv[1][1] = A[0][0] * c5 - A[0][2] * c2 + A[0][3] * c1;
+    Ainv[1][2] = A[3][2] * s2 - A[3][0] * s5 - A[3][3] * s1;
+    Ainv[1][3] = A[2][0] * s5 - A[2][2] * s2 + A[2][3] * s1;
+    Ainv[2][0] = A[1][0] * c4 - A[1][1] * c2 + A[1][3] * c0;
+    Ainv[2][1] = A[0][1] * c2 - A[0][0] * c4 - A[0][3] * c0;
+    Ainv[2][2] = A[3][0] * s4 - A[3][1] * s2 + A[3][3] * s0;
+    Ainv[2][3] = A[2][1] * s2 - A[2][0] * s4 - A[2][3] * s0;
+    Ainv[3][0] = A[1][1] * c1 - A[1][0] * c3 - A[1][2] * c0;
+    Ainv[3][1] = A[0][0] * c3 - A[0][1] * c1 + A[0][2] * c0;
+    Ainv[3][2] = A[3][1] * s1 - A[3][0] * s3 - A[3][2] * s0;
+    Ainv[3][3] = A[2][0] * s3 - A[2][1] * s1 + A[2][2] * s0;
+
+    const Lanes inv_det = (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0).inverse();
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            Ainv[i][j] *= inv_det;
+        }
+    }
+}
+
+// Lanes with eagerly evaluated arithmetic. Long (generated) expressions on Lanes produce very deep expression
+// templates which the compiler does not inline, Value instead evaluates each operation directly.
+// Used for instantiating code templated on the scalar type.
+struct Value {
+    Lanes v;
+    Value() {}
+    template <typename Derived>
+    Value(const Eigen::ArrayBase<Derived> &x) : v(x) {}
+    operator const Lanes &() const { return v; }
+};
+
+inline Value operator+(const Value &a, const Value &b) { return Value(a.v + b.v); }
+inline Value operator-(const Value &a, const Value &b) { return Value(a.v - b.v); }
+inline Value operator*(const Value &a, const Value &b) { return Value(a.v * b.v); }
+inline Value operator-(const Value &a) { return Value(-a.v); }
+inline Value operator*(double a, const Value &b) { return Value(a * b.v); }
+inline Value operator*(const Value &a, double b) { return Value(a.v * b); }
+inline Value operator+(const Value &a, double b) { return Value(a.v + b); }
+inline Value operator-(const Value &a, double b) { return Value(a.v - b); }
+
+// Wraps a batch of matrices stored as M[row][col] such that the entries can be accessed as M(row, col).
+// This allows code templated on the matrix type to be shared between the scalar and the lane-wise versions.
+template <int Cols, typename T = Lanes>
+struct MatrixView {
+    const T (*M)[Cols];
+    const T &operator()(int i, int j) const { return M[i][j]; }
+};
+
+// Lane-wise version of univariate::solve_quadratic_real. Returns the mask of the lanes with real roots.
+// For the other lanes the roots are undefined.
+inline Mask solve_quadratic_real(const Lanes &a, const Lanes &b, const Lanes &c, Lanes roots[2]) {
+    const Lanes b2m4ac = b * b - 4.0 * a * c;
+    const Lanes sq = b2m4ac.max(0.0).sqrt();
+
+    // Choose sign to avoid cancellations
+    roots[0] = (2.0 * c) / (-b - select(greater(b, Lanes::Zero()), sq, -sq));
+    roots[1] = c / (a * roots[0]);
+
+    return logical_not(less(b2m4ac, Lanes::Zero()));
+}
+
+// Applies a scalar function lane by lane. Used for functions which Eigen does not vectorize (e.g. cbrt).
+template <typename Func>
+inline Lanes apply(const Lanes &x, Func f) {
+    Lanes y;
+    for (int k = 0; k < LANES; ++k) {
+        y(k) = f(x(k));
+    }
+    return y;
+}
+template <typename Func>
+inline Lanesf apply(const Lanesf &x, Func f) {
+    Lanesf y;
+    for (int k = 0; k < LANES_F; ++k) {
+        y(k) = f(x(k));
+    }
+    return y;
+}
+
+} // namespace batch
+} // namespace pose_lib
@@ -0,0 +1,80 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "dispatch.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace pose_lib {
+namespace dispatch {
+
+namespace {
+ISA detect_isa() {
+    ISA isa = ISA::BASELINE;
+#if defined(POSELIB_CPU_DISPATCH) && !defined(POSELIB_DISPATCH_VARIANT)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        isa = ISA::AVX2;
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+            __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw")) {
+            isa = ISA::AVX512;
+        }
+    }
+
+    const char *limit = std::getenv("POSELIB_ISA");
+    if (limit != nullptr) {
+        if (std::strcmp(limit, "sse4.2") == 0) {
+            isa = ISA::BASELINE;
+        } else if (std::strcmp(limit, "avx2") == 0 && isa == ISA::AVX512) {
+            isa = ISA::AVX2;
+        }
+    }
+#endif
+    return isa;
+}
+} // namespace
+
+ISA cpu_isa() {
+    // Detected once, thread-safe since C++11.
+    static const ISA isa = detect_isa();
+    return isa;
+}
+
+const char *isa_name(ISA isa) {
+    switch (isa) {
+    case ISA::AVX512:
+        return "avx512";
+    case ISA::AVX2:
+        return "avx2";
+    default:
+        return "sse4.2";
+    }
+}
+
+} // namespace dispatch
+} // namespace pose_lib
@@ -0,0 +1,430 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "../gen_relpose_upright_4pt.h"
+#include "../gp3p.h"
+#include "../gp4ps.h"
+#include "../p1p2ll.h"
+#include "../p2p1ll.h"
+#include "../p2p2pl.h"
+#include "../p3ll.h"
+#include "../p3p.h"
+#include "../p4pf.h"
+#include "../p5lp_radial.h"
+#include "../p6lp.h"
+#include "../relpose_5pt.h"
+#include "../relpose_8pt.h"
+#include "../relpose_upright_3pt.h"
+#include "../relpose_upright_planar_2pt.h"
+#include "../relpose_upright_planar_3pt.h"
+#include "../residuals.h"
+#include "../ugp2p.h"
+#include "../ugp3ps.h"
+#include "../ugp4pl.h"
+#include "../up1p2pl.h"
+#include "../up2p.h"
+#include "../up4pl.h"
+#include "re3q3.h"
+
+// Runtime CPU dispatch of the hot kernels (enabled with the CMake option POSELIB_CPU_DISPATCH).
+//
+// The library itself is then compiled for a portable baseline (SSE4.2), and the translation units holding the
+// kernels below (together with sturm, univariate, qep, re3q3, etc. which they call) are compiled once more for each of
+// AVX2 and AVX-512. Each such variant is partially linked into a single object in which every symbol except the
+// entry points poselib_<isa>_<tag> is made local (see cmake/CpuDispatch.cmake). This way the Eigen and standard
+// library code instantiated with the wider instruction sets can never be picked by the linker for the baseline code.
+// The public functions start with POSELIB_DISPATCH(tag, args), which forwards the call to the best variant
+// supported by the CPU.
+
+namespace pose_lib {
+namespace dispatch {
+
+enum class ISA { BASELINE = 0, AVX2 = 1, AVX512 = 2 };
+
+// Returns the best instruction set that is both supported by the CPU and compiled into the library.
+// The environment variable POSELIB_ISA (sse4.2, avx2 or avx512) can be used to restrict this further.
+ISA cpu_isa();
+
+// Human readable name of the instruction set, e.g. for logging.
+const char *isa_name(ISA isa);
+
+} // namespace dispatch
+} // namespace pose_lib
+
+// List of the dispatched kernels as POSELIB_KERNEL(return type, function, tag, (parameters), (arguments)).
+// The tag is used for the name of the entry points and must be unique (the functions may be overloaded).
+// Only the double precision versions of the templated solvers are dispatched. The closed-form solvers up2p, ugp2p and
+// relpose_upright_planar_2pt are not dispatched since they are no faster with AVX2 or AVX-512 (see README.md).
+#define POSELIB_DISPATCH_KERNELS(POSELIB_KERNEL)                                                                      \
+    POSELIB_KERNEL(int, p3p<double>, p3p,                                                                             \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X, pose_lib::CameraPoseVector *output), \
+                   (x, X, output))                                                                                    \
+    POSELIB_KERNEL(int, p3p<double>, p3p_fixed,                                                                       \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,                                   \
+                    pose_lib::FixedVector<pose_lib::CameraPose, 4> *output),                                          \
+                   (x, X, output))                                                                                    \
+    POSELIB_KERNEL(int, gp3p, gp3p,                                                                                   \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (p, x, X, output, filter_invalid))                                                                 \
+    POSELIB_KERNEL(int, gp3p, gp3p_compact,                                                                           \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    std::vector<pose_lib::CompactPose> *output, bool filter_invalid),                                 \
+                   (p, x, X, output, filter_invalid))                                                                 \
+    POSELIB_KERNEL(int, gp4ps, gp4ps,                                                                                 \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_solutions, bool filter_invalid),           \
+                   (p, x, X, output, filter_solutions, filter_invalid))                                               \
+    POSELIB_KERNEL(int, gp4ps_kukelova, gp4ps_kukelova,                                                               \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_solutions, bool filter_invalid),           \
+                   (p, x, X, output, filter_solutions, filter_invalid))                                               \
+    POSELIB_KERNEL(int, gp4ps_camposeco, gp4ps_camposeco,                                                             \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (p, x, X, output, filter_invalid))                                                                 \
+    POSELIB_KERNEL(int, p4pf, p4pf,                                                                                   \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,                                   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_solutions, bool filter_invalid),           \
+                   (x, X, output, filter_solutions, filter_invalid))                                                  \
+    POSELIB_KERNEL(int, p2p2pl, p2p2pl,                                                                               \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &x, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V, pose_lib::CameraPoseVector *output, \
+                    bool filter_invalid, pose_lib::P2P2PLWorkspace *workspace),                                       \
+                   (xp, Xp, x, X, V, output, filter_invalid, workspace))                                              \
+    POSELIB_KERNEL(int, p2p2pl, p2p2pl_fixed,                                                                         \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &x, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,                                   \
+                    pose_lib::FixedVector<pose_lib::CameraPose, 16> *output, bool filter_invalid,                     \
+                    pose_lib::P2P2PLWorkspace *workspace),                                                            \
+                   (xp, Xp, x, X, V, output, filter_invalid, workspace))                                              \
+    POSELIB_KERNEL(int, p6lp, p6lp,                                                                                   \
+                   (const pose_lib::Vector3View &l, const pose_lib::Vector3View &X,                                   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (l, X, output, filter_invalid))                                                                    \
+    POSELIB_KERNEL(int, p5lp_radial, p5lp_radial,                                                                     \
+                   (const pose_lib::Vector3View &l, const pose_lib::Vector3View &X,                                   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (l, X, output, filter_invalid))                                                                    \
+    POSELIB_KERNEL(int, p1p2ll, p1p2ll,                                                                               \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &l, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,                                   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (xp, Xp, l, X, V, output, filter_invalid))                                                         \
+    POSELIB_KERNEL(int, p1p2ll, p1p2ll_compact,                                                                       \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &l, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,                                   \
+                    std::vector<pose_lib::CompactPose> *output, bool filter_invalid),                                 \
+                   (xp, Xp, l, X, V, output, filter_invalid))                                                         \
+    POSELIB_KERNEL(int, p2p1ll, p2p1ll,                                                                               \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &l, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,                                   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (xp, Xp, l, X, V, output, filter_invalid))                                                         \
+    POSELIB_KERNEL(int, p2p1ll, p2p1ll_compact,                                                                       \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &l, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,                                   \
+                    std::vector<pose_lib::CompactPose> *output, bool filter_invalid),                                 \
+                   (xp, Xp, l, X, V, output, filter_invalid))                                                         \
+    POSELIB_KERNEL(int, p3ll, p3ll,                                                                                   \
+                   (const pose_lib::Vector3View &l, const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,   \
+                    std::vector<pose_lib::CameraPose> *output, bool filter_invalid),                                  \
+                   (l, X, V, output, filter_invalid))                                                                 \
+    POSELIB_KERNEL(int, up1p2pl, up1p2pl,                                                                             \
+                   (const pose_lib::Vector3View &xp, const pose_lib::Vector3View &Xp, const pose_lib::Vector3View &x, \
+                    const pose_lib::Vector3View &X, const pose_lib::Vector3View &V, pose_lib::CameraPoseVector *output, \
+                    bool filter_invalid),                                                                             \
+                   (xp, Xp, x, X, V, output, filter_invalid))                                                         \
+    POSELIB_KERNEL(int, up4pl, up4pl,                                                                                 \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X, const pose_lib::Vector3View &V,   \
+                    pose_lib::CameraPoseVector *output, bool filter_invalid),                                         \
+                   (x, X, V, output, filter_invalid))                                                                 \
+    POSELIB_KERNEL(int, ugp3ps, ugp3ps,                                                                               \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    pose_lib::CameraPoseVector *output, bool filter_solutions, bool filter_invalid),                  \
+                   (p, x, X, output, filter_solutions, filter_invalid))                                               \
+    POSELIB_KERNEL(int, ugp4pl, ugp4pl,                                                                               \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,   \
+                    const pose_lib::Vector3View &V, pose_lib::CameraPoseVector *output, bool filter_invalid),         \
+                   (p, x, X, V, output, filter_invalid))                                                              \
+    POSELIB_KERNEL(int, relpose_5pt<double>, relpose_5pt_essential,                                                   \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    std::vector<Eigen::Matrix3d> *essential_matrices, pose_lib::Relpose5ptWorkspace *workspace),      \
+                   (x1, x2, essential_matrices, workspace))                                                           \
+    POSELIB_KERNEL(int, relpose_5pt<double>, relpose_5pt_essential_fixed,                                             \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::FixedVector<Eigen::Matrix3d, 10> *essential_matrices,                                   \
+                    pose_lib::Relpose5ptWorkspace *workspace),                                                        \
+                   (x1, x2, essential_matrices, workspace))                                                           \
+    POSELIB_KERNEL(int, relpose_5pt<double>, relpose_5pt,                                                             \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::CameraPoseVector *output, pose_lib::Relpose5ptWorkspace *workspace),                    \
+                   (x1, x2, output, workspace))                                                                       \
+    POSELIB_KERNEL(int, relpose_5pt<double>, relpose_5pt_fixed,                                                       \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::FixedVector<pose_lib::CameraPose, 10> *output, pose_lib::Relpose5ptWorkspace *workspace), \
+                   (x1, x2, output, workspace))                                                                       \
+    POSELIB_KERNEL(int, relpose_8pt, relpose_8pt,                                                                     \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::CameraPoseVector *output),                                                              \
+                   (x1, x2, output))                                                                                  \
+    POSELIB_KERNEL(int, relpose_upright_3pt<double>, relpose_upright_3pt,                                             \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::CameraPoseVector *output),                                                              \
+                   (x1, x2, output))                                                                                  \
+    POSELIB_KERNEL(int, relpose_upright_planar_3pt, relpose_upright_planar_3pt,                                       \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    pose_lib::CameraPoseVector *output),                                                              \
+                   (x1, x2, output))                                                                                  \
+    POSELIB_KERNEL(int, gen_relpose_upright_4pt, gen_relpose_upright_4pt,                                             \
+                   (const pose_lib::Vector3View &p1, const pose_lib::Vector3View &x1, const pose_lib::Vector3View &p2, \
+                    const pose_lib::Vector3View &x2, pose_lib::CameraPoseVector *output),                             \
+                   (p1, x1, p2, x2, output))                                                                          \
+    POSELIB_KERNEL(int, re3q3::re3q3, re3q3,                                                                          \
+                   (const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions,               \
+                    const pose_lib::re3q3::Re3q3Options &options),                                                    \
+                   (coeffs, solutions, options))                                                                      \
+    POSELIB_KERNEL(int, p3p_batch, p3p_batch,                                                                         \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 9> &x,                                                \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 9> &X, std::vector<pose_lib::CameraPose> *output,     \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, output, num_solutions))                                                                     \
+    POSELIB_KERNEL(int, p3p_batch, p3p_batch_view,                                                                    \
+                   (const pose_lib::BatchView<9> &x,                                                                  \
+                    const pose_lib::BatchView<9> &X, std::vector<pose_lib::CameraPose> *output,                       \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, output, num_solutions))                                                                     \
+    POSELIB_KERNEL(int, p3p_batch, p3p_batch_float,                                                                   \
+                   (const Eigen::Matrix<float, Eigen::Dynamic, 9> &x,                                                 \
+                    const Eigen::Matrix<float, Eigen::Dynamic, 9> &X, std::vector<pose_lib::CameraPosef> *output,     \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, output, num_solutions))                                                                     \
+    POSELIB_KERNEL(int, up2p_batch, up2p_batch,                                                                       \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 6> &x,                                                \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 6> &X, pose_lib::CameraPoseVector *output,            \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, output, num_solutions))                                                                     \
+    POSELIB_KERNEL(int, up2p_batch, up2p_batch_view,                                                                  \
+                   (const pose_lib::BatchView<6> &x,                                                                  \
+                    const pose_lib::BatchView<6> &X, pose_lib::CameraPoseVector *output,                              \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, output, num_solutions))                                                                     \
+    POSELIB_KERNEL(int, ugp2p_batch, ugp2p_batch,                                                                     \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 6> &p,                                                \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 6> &x,                                                \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 6> &X, pose_lib::CameraPoseVector *output,            \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p, x, X, output, num_solutions))                                                                  \
+    POSELIB_KERNEL(int, ugp2p_batch, ugp2p_batch_view,                                                                \
+                   (const pose_lib::BatchView<6> &p,                                                                  \
+                    const pose_lib::BatchView<6> &x,                                                                  \
+                    const pose_lib::BatchView<6> &X, pose_lib::CameraPoseVector *output,                              \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p, x, X, output, num_solutions))                                                                  \
+    POSELIB_KERNEL(int, ugp4pl_batch, ugp4pl_batch,                                                                   \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 12> &p,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &x,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &X,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &V, pose_lib::CameraPoseVector *output,           \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p, x, X, V, output, num_solutions))                                                               \
+    POSELIB_KERNEL(int, ugp4pl_batch, ugp4pl_batch_view,                                                              \
+                   (const pose_lib::BatchView<12> &p,                                                                 \
+                    const pose_lib::BatchView<12> &x,                                                                 \
+                    const pose_lib::BatchView<12> &X,                                                                 \
+                    const pose_lib::BatchView<12> &V, pose_lib::CameraPoseVector *output,                             \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p, x, X, V, output, num_solutions))                                                               \
+    POSELIB_KERNEL(int, up4pl_batch, up4pl_batch,                                                                     \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 12> &x,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &X,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &V, pose_lib::CameraPoseVector *output,           \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, V, output, num_solutions))                                                                  \
+    POSELIB_KERNEL(int, up4pl_batch, up4pl_batch_view,                                                                \
+                   (const pose_lib::BatchView<12> &x,                                                                 \
+                    const pose_lib::BatchView<12> &X,                                                                 \
+                    const pose_lib::BatchView<12> &V, pose_lib::CameraPoseVector *output,                             \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x, X, V, output, num_solutions))                                                                  \
+    POSELIB_KERNEL(int, relpose_5pt_batch, relpose_5pt_batch_essential,                                                \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1,                                              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2,                                              \
+                    std::vector<Eigen::Matrix3d> *essential_matrices, std::vector<int> *num_solutions),               \
+                   (x1, x2, essential_matrices, num_solutions))                                                       \
+    POSELIB_KERNEL(int, relpose_5pt_batch, relpose_5pt_batch_essential_view,                                           \
+                   (const pose_lib::BatchView<15> &x1,                                                                 \
+                    const pose_lib::BatchView<15> &x2,                                                                 \
+                    std::vector<Eigen::Matrix3d> *essential_matrices, std::vector<int> *num_solutions),                \
+                   (x1, x2, essential_matrices, num_solutions))                                                        \
+    POSELIB_KERNEL(int, relpose_5pt_batch, relpose_5pt_batch,                                                          \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1,                                              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2, std::vector<pose_lib::CameraPose> *output,   \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x1, x2, output, num_solutions))                                                                   \
+    POSELIB_KERNEL(int, relpose_5pt_batch, relpose_5pt_batch_view,                                                     \
+                   (const pose_lib::BatchView<15> &x1,                                                                 \
+                    const pose_lib::BatchView<15> &x2, std::vector<pose_lib::CameraPose> *output,                      \
+                    std::vector<int> *num_solutions),                                                                  \
+                   (x1, x2, output, num_solutions))                                                                    \
+    POSELIB_KERNEL(int, relpose_upright_3pt_batch, relpose_upright_3pt_batch,                                         \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 9> &x1,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 9> &x2, pose_lib::CameraPoseVector *output,           \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x1, x2, output, num_solutions))                                                                   \
+    POSELIB_KERNEL(int, relpose_upright_3pt_batch, relpose_upright_3pt_batch_view,                                    \
+                   (const pose_lib::BatchView<9> &x1,                                                                 \
+                    const pose_lib::BatchView<9> &x2, pose_lib::CameraPoseVector *output,                             \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x1, x2, output, num_solutions))                                                                   \
+    POSELIB_KERNEL(int, relpose_upright_planar_2pt_batch, relpose_upright_planar_2pt_batch,                           \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 6> &x1,                                               \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 6> &x2, pose_lib::CameraPoseVector *output,           \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x1, x2, output, num_solutions))                                                                   \
+    POSELIB_KERNEL(int, relpose_upright_planar_2pt_batch, relpose_upright_planar_2pt_batch_view,                      \
+                   (const pose_lib::BatchView<6> &x1,                                                                 \
+                    const pose_lib::BatchView<6> &x2, pose_lib::CameraPoseVector *output,                             \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (x1, x2, output, num_solutions))                                                                   \
+    POSELIB_KERNEL(int, gen_relpose_upright_4pt_batch, gen_relpose_upright_4pt_batch,                                 \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 12> &p1,                                              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &x1,                                              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &p2,                                              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 12> &x2, pose_lib::CameraPoseVector *output,          \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p1, x1, p2, x2, output, num_solutions))                                                           \
+    POSELIB_KERNEL(int, gen_relpose_upright_4pt_batch, gen_relpose_upright_4pt_batch_view,                            \
+                   (const pose_lib::BatchView<12> &p1,                                                                \
+                    const pose_lib::BatchView<12> &x1,                                                                \
+                    const pose_lib::BatchView<12> &p2,                                                                \
+                    const pose_lib::BatchView<12> &x2, pose_lib::CameraPoseVector *output,                            \
+                    std::vector<int> *num_solutions),                                                                 \
+                   (p1, x1, p2, x2, output, num_solutions))                                                           \
+    POSELIB_KERNEL(void, re3q3::re3q3_batch, re3q3_batch,                                                             \
+                   (const Eigen::Matrix<double, Eigen::Dynamic, 30> &coeffs,                                          \
+                    Eigen::Matrix<double, Eigen::Dynamic, 24> *solutions, Eigen::VectorXi *num_solutions,             \
+                    const pose_lib::re3q3::Re3q3Options &options),                                                    \
+                   (coeffs, solutions, num_solutions, options))                                                       \
+    POSELIB_KERNEL(bool, p3p_best, p3p_best,                                                                           \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,                                   \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all,                                            \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all, double threshold,                          \
+                    pose_lib::CameraPose *best_pose, double *best_score),                                             \
+                   (x, X, x_all, X_all, threshold, best_pose, best_score))                                            \
+    POSELIB_KERNEL(bool, gp3p_best, gp3p_best,                                                                         \
+                   (const pose_lib::Vector3View &p, const pose_lib::Vector3View &x,                                   \
+                    const pose_lib::Vector3View &X, const Eigen::Matrix<double, Eigen::Dynamic, 3> &p_all,            \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &x_all,                                            \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all, double threshold,                          \
+                    pose_lib::CameraPose *best_pose, double *best_score),                                             \
+                   (p, x, X, p_all, x_all, X_all, threshold, best_pose, best_score))                                  \
+    POSELIB_KERNEL(bool, up2p_best, up2p_best,                                                                         \
+                   (const pose_lib::Vector3View &x, const pose_lib::Vector3View &X,                                   \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all,                                            \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all, double threshold,                          \
+                    pose_lib::CameraPose *best_pose, double *best_score),                                             \
+                   (x, X, x_all, X_all, threshold, best_pose, best_score))                                            \
+    POSELIB_KERNEL(bool, relpose_5pt_best, relpose_5pt_best,                                                           \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all,                                           \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all, double threshold,                         \
+                    pose_lib::CameraPose *best_pose, double *best_score),                                             \
+                   (x1, x2, x1_all, x2_all, threshold, best_pose, best_score))                                        \
+    POSELIB_KERNEL(bool, relpose_upright_3pt_best, relpose_upright_3pt_best,                                           \
+                   (const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2,                                 \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all,                                           \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all, double threshold,                         \
+                    pose_lib::CameraPose *best_pose, double *best_score),                                             \
+                   (x1, x2, x1_all, x2_all, threshold, best_pose, best_score))                                        \
+    POSELIB_KERNEL(void, compute_reprojection_residuals, compute_reprojection_residuals,                               \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X,                                                \
+                    Eigen::Matrix<double, Eigen::Dynamic, 2> *residuals,                                              \
+                    Eigen::Matrix<double, Eigen::Dynamic, 12> *jacobian),                                             \
+                   (pose, x, X, residuals, jacobian))                                                                 \
+    POSELIB_KERNEL(void, compute_angular_residuals, compute_angular_residuals,                                         \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, Eigen::VectorXd *residuals),                   \
+                   (pose, x, X, residuals))                                                                           \
+    POSELIB_KERNEL(void, compute_sampson_residuals, compute_sampson_residuals,                                         \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,             \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, Eigen::VectorXd *residuals,                   \
+                    Eigen::Matrix<double, Eigen::Dynamic, 6> *jacobian),                                              \
+                   (pose, x1, x2, residuals, jacobian))                                                               \
+    POSELIB_KERNEL(double, compute_reprojection_score, compute_reprojection_score,                                     \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold, double bound),               \
+                   (pose, x, X, threshold, bound))                                                                    \
+    POSELIB_KERNEL(double, compute_generalized_angular_score, compute_generalized_angular_score,                       \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &p,              \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,                                                \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold, double bound),               \
+                   (pose, p, x, X, threshold, bound))                                                                 \
+    POSELIB_KERNEL(double, compute_sampson_score, compute_sampson_score,                                               \
+                   (const pose_lib::CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,             \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold, double bound),              \
+                   (pose, x1, x2, threshold, bound))                                                                  \
+    POSELIB_KERNEL(double, compute_sampson_score, compute_sampson_score_essential,                                     \
+                   (const Eigen::Matrix3d &E, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,                     \
+                    const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold, double bound),              \
+                   (E, x1, x2, threshold, bound))
+
+#define POSELIB_DISPATCH_CONCAT_(a, b, c) a##b##c
+#define POSELIB_DISPATCH_CONCAT(a, b, c) POSELIB_DISPATCH_CONCAT_(a, b, c)
+#define POSELIB_DISPATCH_ENTRY(isa, tag) POSELIB_DISPATCH_CONCAT(poselib_, isa, _##tag)
+
+#if defined(POSELIB_CPU_DISPATCH) && !defined(POSELIB_DISPATCH_VARIANT)
+
+// Entry points of the variants, defined in misc/dispatch_kernels.cc.
+#define POSELIB_DISPATCH_DECLARE(ret, name, tag, params, args)                                                        \
+    ret POSELIB_DISPATCH_ENTRY(avx2, tag) params;                                                                      \
+    ret POSELIB_DISPATCH_ENTRY(avx512, tag) params;
+extern "C" {
+POSELIB_DISPATCH_KERNELS(POSELIB_DISPATCH_DECLARE)
+}
+#undef POSELIB_DISPATCH_DECLARE
+
+#define POSELIB_DISPATCH(tag, args)                                                                                   \
+    switch (::pose_lib::dispatch::cpu_isa()) {                                                                        \
+    case ::pose_lib::dispatch::ISA::AVX512:                                                                           \
+        return ::POSELIB_DISPATCH_ENTRY(avx512, tag) args;                                                             \
+    case ::pose_lib::dispatch::ISA::AVX2:                                                                             \
+        return ::POSELIB_DISPATCH_ENTRY(avx2, tag) args;                                                               \
+    default:                                                                                                          \
+        break;                                                                                                        \
+    }
+
+#else
+
+// Either dispatch is disabled, or this is one of the variants itself.
+#define POSELIB_DISPATCH(tag, args)
+
+#endif
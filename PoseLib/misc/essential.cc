@@ -27,6 +27,9 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "essential.h"
+#include "essential_inl.h"
+#include "batch.h"
+#include <algorithm>
 #include <array>
 
 namespace pose_lib {
@@ -39,36 +42,28 @@ void essential_from_motion(const CameraPose &pose, Eigen::Matrix3d *E) {
 }
 
 
-bool check_cheirality(const CameraPose& pose, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2) {
-    // This code assumes that x1 and x2 are unit vectors
-    const Eigen::Vector3d Rx1 = pose.R * x1;
+template bool check_cheirality<double>(const CameraPose&, const Eigen::Vector3d&, const Eigen::Vector3d&);
+template bool check_cheirality<float>(const CameraPosef&, const Eigen::Vector3f&, const Eigen::Vector3f&);
 
-    // [1 a; a 1] * [lambda1; lambda2] = [b1; b2]
-    // [lambda1; lambda2] = [1 -a; -a 1] * [b1; b2] / (1 - a*a)
 
-    const double a = -Rx1.dot(x2);
-    const double b1 = -Rx1.dot(pose.t);
-    const double b2 = x2.dot(pose.t);
+namespace {
 
-    // Note that we drop the factor 1.0/(1-a*a) since it is always positive.
-    const double lambda1 = b1 - a * b2;
-    const double lambda2 = -a * b1 + b2;
-
-    return lambda1 > 0 && lambda2 > 0;
-}
-
-
-void motion_from_essential(const Eigen::Matrix3d& E, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector* relative_poses) {
+// Closed-form factorization of the essential matrix (see motion_from_essential). The four possible motions are
+// given by (R1, t), (R1, -t), (R2, t) and (R2, -t).
+template <typename Real>
+void factorize_essential(const Eigen::Matrix<Real, 3, 3>& E, Eigen::Matrix<Real, 3, 3>* R1, Eigen::Matrix<Real, 3, 3>* R2, Eigen::Matrix<Real, 3, 1>* t) {
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+    typedef Eigen::Matrix<Real, 3, 1> Vector3;
 
     // Compute the necessary cross products 
-    Eigen::Vector3d u12 = E.col(0).cross(E.col(1));
-    Eigen::Vector3d u13 = E.col(0).cross(E.col(2));
-    Eigen::Vector3d u23 = E.col(1).cross(E.col(2));
-    const double n12 = u12.squaredNorm();
-    const double n13 = u13.squaredNorm();
-    const double n23 = u23.squaredNorm();
-    Eigen::Matrix3d UW;
-    Eigen::Matrix3d Vt;
+    Vector3 u12 = E.col(0).cross(E.col(1));
+    Vector3 u13 = E.col(0).cross(E.col(2));
+    Vector3 u23 = E.col(1).cross(E.col(2));
+    const Real n12 = u12.squaredNorm();
+    const Real n13 = u13.squaredNorm();
+    const Real n23 = u23.squaredNorm();
+    Matrix3 UW;
+    Matrix3 Vt;
 
     // Compute the U*W factor
     if (n12 > n13) {
@@ -105,9 +100,89 @@ void motion_from_essential(const Eigen::Matrix3d& E, const Eigen::Vector3d& x1,
     Vt.row(1).normalize();
     Vt.row(2) = Vt.row(0).cross(Vt.row(1));
 
-    pose_lib::CameraPose pose;
-    pose.R = UW * Vt;
-    pose.t = UW.col(2);
+    *R1 = UW * Vt;
+    *t = UW.col(2);
+
+    // U * W.transpose()
+    UW.template block<3, 2>(0, 0) = -UW.template block<3, 2>(0, 0);
+    *R2 = UW * Vt;
+}
+
+// Counts the number of point correspondences which are in front of both cameras for the motions (R1, t), (R1, -t),
+// (R2, t) and (R2, -t). Flipping the sign of t flips the sign of both depths, see check_cheirality.
+// The correspondences are processed LANES at a time in structure-of-arrays form (as in the residual kernels), where
+// the padding after the last correspondence has zero depths and is not counted for any motion.
+template <typename Real>
+void count_cheirality(const Eigen::Matrix<Real, 3, 3>& R1, const Eigen::Matrix<Real, 3, 3>& R2, const Eigen::Matrix<Real, 3, 1>& t,
+                      const Vector3ViewT<Real>& x1, const Vector3ViewT<Real>& x2, int votes[4]) {
+    typedef Eigen::Array<Real, batch::LANES, 1> RealLanes;
+    const Eigen::Matrix<Real, 3, 3>* R[2] = {&R1, &R2};
+    const int n = static_cast<int>(std::min(x1.size(), x2.size()));
+    std::fill(votes, votes + 4, 0);
+
+    RealLanes u[3], v[3], Ru[3];
+    for (int start = 0; start < n; start += batch::LANES) {
+        const int n_lanes = std::min(batch::LANES, n - start);
+        for (int d = 0; d < 3; ++d) {
+            u[d].setZero();
+            v[d].setZero();
+        }
+        for (int k = 0; k < n_lanes; ++k) {
+            for (int d = 0; d < 3; ++d) {
+                u[d](k) = x1[start + k](d);
+                v[d](k) = x2[start + k](d);
+            }
+        }
+        const RealLanes b2 = v[0] * t(0) + v[1] * t(1) + v[2] * t(2);
+
+        for (int j = 0; j < 2; ++j) {
+            for (int d = 0; d < 3; ++d) {
+                Ru[d] = (*R[j])(d, 0) * u[0] + (*R[j])(d, 1) * u[1] + (*R[j])(d, 2) * u[2];
+            }
+            const RealLanes a = -(Ru[0] * v[0] + Ru[1] * v[1] + Ru[2] * v[2]);
+            const RealLanes b1 = -(Ru[0] * t(0) + Ru[1] * t(1) + Ru[2] * t(2));
+            const RealLanes lambda1 = b1 - a * b2;
+            const RealLanes lambda2 = b2 - a * b1;
+            votes[2 * j] += static_cast<int>(((lambda1 > Real(0)) && (lambda2 > Real(0))).count());
+            votes[2 * j + 1] += static_cast<int>(((lambda1 < Real(0)) && (lambda2 < Real(0))).count());
+        }
+    }
+}
+
+// Finds the motion which has the most point correspondences in front of both cameras.
+// Ties are resolved in the order (R1, t), (R1, -t), (R2, t), (R2, -t). Returns false if no motion has any.
+template <typename Real>
+bool vote_cheirality(const Eigen::Matrix<Real, 3, 3>& R1, const Eigen::Matrix<Real, 3, 3>& R2, const Eigen::Matrix<Real, 3, 1>& t,
+                     const Vector3ViewT<Real>& x1, const Vector3ViewT<Real>& x2,
+                     CameraPoseT<Real>* pose) {
+    if (x1.empty() || x2.empty()) {
+        return false;
+    }
+    int votes[4];
+    count_cheirality(R1, R2, t, x1, x2, votes);
+
+    const int best = std::max_element(votes, votes + 4) - votes;
+    if (votes[best] == 0) {
+        return false;
+    }
+
+    pose->R = best < 2 ? R1 : R2;
+    pose->t = best % 2 == 0 ? t : Eigen::Matrix<Real, 3, 1>(-t);
+    return true;
+}
+
+} // namespace
+
+template <typename Real>
+void motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Eigen::Matrix<Real, 3, 1>& x1, const Eigen::Matrix<Real, 3, 1>& x2,
+                           std::vector<CameraPoseT<Real>>* relative_poses) {
+    Eigen::Matrix<Real, 3, 3> R1, R2;
+    Eigen::Matrix<Real, 3, 1> t;
+    factorize_essential(E, &R1, &R2, &t);
+
+    CameraPoseT<Real> pose;
+    pose.R = R1;
+    pose.t = t;
     if (check_cheirality(pose, x1, x2)) {
         relative_poses->emplace_back(pose);
     }
@@ -116,9 +191,7 @@ void motion_from_essential(const Eigen::Matrix3d& E, const Eigen::Vector3d& x1,
         relative_poses->emplace_back(pose);
     }
 
-    // U * W.transpose()
-    UW.block<3, 2>(0, 0) = -UW.block<3, 2>(0, 0);
-    pose.R = UW * Vt;
+    pose.R = R2;
     if (check_cheirality(pose, x1, x2)) {
         relative_poses->emplace_back(pose);
     }
@@ -126,44 +199,46 @@ void motion_from_essential(const Eigen::Matrix3d& E, const Eigen::Vector3d& x1,
     if (check_cheirality(pose, x1, x2)) {
         relative_poses->emplace_back(pose);
     }
-
 }
 
+template <typename Real>
+void motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Vector3ViewArgT<Real>& x1,
+                           const Vector3ViewArgT<Real>& x2, std::vector<CameraPoseT<Real>>* relative_poses) {
+    Eigen::Matrix<Real, 3, 3> R1, R2;
+    Eigen::Matrix<Real, 3, 1> t;
+    factorize_essential(E, &R1, &R2, &t);
+    CameraPoseT<Real> pose;
+    if (vote_cheirality(R1, R2, t, x1, x2, &pose)) {
+        relative_poses->emplace_back(pose);
+    }
+}
 
-void motion_from_essential_planar(double e01, double e21, double e10, double e12, const Eigen::Vector3d &x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector *relative_poses) {
+template <typename Real>
+bool motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Vector3ViewArgT<Real>& x1,
+                           const Vector3ViewArgT<Real>& x2, CameraPoseT<Real>* relative_pose) {
+    Eigen::Matrix<Real, 3, 3> R1, R2;
+    Eigen::Matrix<Real, 3, 1> t;
+    factorize_essential(E, &R1, &R2, &t);
+    return vote_cheirality(R1, R2, t, x1, x2, relative_pose);
+}
 
-    Eigen::Vector2d z;
-    z << -e01 * e10 - e21 * e12, -e21 * e10 + e01 * e12;
-    z.normalize();
+template void motion_from_essential<double>(const Eigen::Matrix3d&, const Eigen::Vector3d&, const Eigen::Vector3d&, CameraPoseVector*);
+template void motion_from_essential<float>(const Eigen::Matrix3f&, const Eigen::Vector3f&, const Eigen::Vector3f&, CameraPoseVectorf*);
+template void motion_from_essential<double>(const Eigen::Matrix3d&, const Vector3View&, const Vector3View&,
+                                            CameraPoseVector*);
+template void motion_from_essential<float>(const Eigen::Matrix3f&, const Vector3Viewf&, const Vector3Viewf&,
+                                           CameraPoseVectorf*);
+template bool motion_from_essential<double>(const Eigen::Matrix3d&, const Vector3View&, const Vector3View&,
+                                            CameraPose*);
+template bool motion_from_essential<float>(const Eigen::Matrix3f&, const Vector3Viewf&, const Vector3Viewf&,
+                                           CameraPosef*);
 
-    CameraPose pose;
-    pose.R << z(0), 0.0, -z(1), 0.0, 1.0, 0.0, z(1), 0.0, z(0);
-    pose.t << e21, 0.0, -e01;
-    pose.t.normalize();
 
-    if (check_cheirality(pose, x1, x2)) {
-        relative_poses->push_back(pose);
-    }
-    pose.t = -pose.t;
-    if (check_cheirality(pose, x1, x2)) {
-        relative_poses->push_back(pose);
-    }
+namespace {
 
-    // There are two more flipped solutions where
-    //    R = [a 0 b; 0 -1 0; b 0 -a]
-    // These are probably not interesting in the planar case
-
-    /*
-            z << e01 * e10 - e21 * e12, e21* e10 + e01 * e12;
-            z.normalize();
-            pose.R << z(0), 0.0, z(1), 0.0, -1.0, 0.0, z(1), 0.0, -z(0);        
-            relative_poses->push_back(pose);
-            pose.t = -pose.t;
-            relative_poses->push_back(pose);
-    */
-}
-
-void motion_from_essential_svd(const Eigen::Matrix3d &E, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector *relative_poses) {
+// Factorization of the essential matrix using the SVD (see motion_from_essential_svd). As in factorize_essential,
+// the four possible motions are given by (R1, t), (R1, -t), (R2, t) and (R2, -t).
+void factorize_essential_svd(const Eigen::Matrix3d& E, Eigen::Matrix3d* R1, Eigen::Matrix3d* R2, Eigen::Vector3d* t) {
     Eigen::JacobiSVD<Eigen::Matrix3d> USV(E, Eigen::ComputeFullU | Eigen::ComputeFullV);
     Eigen::Matrix3d U = USV.matrixU();
     Eigen::Matrix3d Vt = USV.matrixV().transpose();
@@ -182,11 +257,20 @@ void motion_from_essential_svd(const Eigen::Matrix3d &E, const Eigen::Vector3d&
         1, 0, 0,
         0, 0, 1;
 
-    const Eigen::Matrix3d U_W_Vt = U * W * Vt;
-    const Eigen::Matrix3d U_Wt_Vt = U * W.transpose() * Vt;
+    *R1 = U * W * Vt;
+    *R2 = U * W.transpose() * Vt;
+    *t = U.col(2);
+}
+
+} // namespace
+
+void motion_from_essential_svd(const Eigen::Matrix3d &E, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector *relative_poses) {
+    Eigen::Matrix3d U_W_Vt, U_Wt_Vt;
+    Eigen::Vector3d u3;
+    factorize_essential_svd(E, &U_W_Vt, &U_Wt_Vt, &u3);
 
     const std::array<Eigen::Matrix3d, 2> R{{U_W_Vt, U_Wt_Vt}};
-    const std::array<Eigen::Vector3d, 2> t{{U.col(2), -U.col(2)}};
+    const std::array<Eigen::Vector3d, 2> t{{u3, -u3}};
     if (relative_poses) {
         pose_lib::CameraPose pose;
         pose.R = R[0];
@@ -215,4 +299,15 @@ void motion_from_essential_svd(const Eigen::Matrix3d &E, const Eigen::Vector3d&
     }
 }
 
+void motion_from_essential_svd(const Eigen::Matrix3d& E, const Vector3View& x1, const Vector3View& x2,
+                               pose_lib::CameraPoseVector* relative_poses) {
+    Eigen::Matrix3d R1, R2;
+    Eigen::Vector3d t;
+    factorize_essential_svd(E, &R1, &R2, &t);
+    CameraPose pose;
+    if (vote_cheirality(R1, R2, t, x1, x2, &pose)) {
+        relative_poses->emplace_back(pose);
+    }
+}
+
 } // namespace pose_lib
\ No newline at end of file
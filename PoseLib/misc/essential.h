@@ -37,10 +37,13 @@ namespace pose_lib {
     // Computes the essential matrix from the camera motion
     void essential_from_motion(const CameraPose& pose, Eigen::Matrix3d* E);
 
+    POSELIB_BEGIN_HEADER_ONLY
     // Checks the cheirality of the point correspondences, i.e. that
     //    lambda_2 * x2 = R * ( lambda_1 * x1 ) + t
-    // with lambda_1 and lambda_2 positive
-    bool check_cheirality(const CameraPose& pose, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2);
+    // with lambda_1 and lambda_2 positive. Instantiated for Real = double and Real = float.
+    template <typename Real>
+    bool check_cheirality(const CameraPoseT<Real>& pose, const Eigen::Matrix<Real, 3, 1>& x1, const Eigen::Matrix<Real, 3, 1>& x2);
+    POSELIB_END_HEADER_ONLY
 
 
     /**
@@ -54,12 +57,38 @@ namespace pose_lib {
     */
     void motion_from_essential_svd(const Eigen::Matrix3d& E, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector* relative_poses);
 
+    /*
+    Same as above, but the cheirality is checked for all point correspondences and only the motion with the
+    most correspondences in front of both cameras is returned. This is more robust than relying on a single
+    (possibly noisy or outlier) correspondence. Ties are resolved in favor of the first decomposition.
+    */
+    void motion_from_essential_svd(const Eigen::Matrix3d& E, const Vector3View& x1, const Vector3View& x2, pose_lib::CameraPoseVector* relative_poses);
+
     /*
     Computes the factorization using the closed-form SVD suggested in 
        Nister, An Efficient Solution to the Five-Point Relative Pose Problem, PAMI 2004
     The method also takes one point correspondence that is used to filter for cheirality.
+    Instantiated for Real = double and Real = float.
+    */
+    template <typename Real>
+    void motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Eigen::Matrix<Real, 3, 1>& x1, const Eigen::Matrix<Real, 3, 1>& x2,
+                               std::vector<CameraPoseT<Real>>* relative_poses);
+
+    /*
+    Same as above, but votes on the cheirality over all the point correspondences and only returns the single
+    motion with the most correspondences in front of both cameras (see motion_from_essential_svd above).
     */
-    void motion_from_essential(const Eigen::Matrix3d& E, const Eigen::Vector3d &x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector* relative_poses);
+    template <typename Real>
+    void motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Vector3ViewArgT<Real>& x1,
+                               const Vector3ViewArgT<Real>& x2, std::vector<CameraPoseT<Real>>* relative_poses);
+
+    /*
+    Same as above, but stores the motion in relative_pose instead of appending it to a vector.
+    Returns false (leaving relative_pose unchanged) if no motion has any correspondence in front of both cameras.
+    */
+    template <typename Real>
+    bool motion_from_essential(const Eigen::Matrix<Real, 3, 3>& E, const Vector3ViewArgT<Real>& x1,
+                               const Vector3ViewArgT<Real>& x2, CameraPoseT<Real>* relative_pose);
 
     /* 
     Factorizes the essential matrix into the relative poses. Assumes that the essential matrix corresponds to 
@@ -80,6 +109,12 @@ namespace pose_lib {
 
     The method also takes one point correspondence that is used to filter for cheirality.
     */
+    POSELIB_BEGIN_HEADER_ONLY
     void motion_from_essential_planar(double e01, double e21, double e10, double e12, const Eigen::Vector3d& x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector* relative_poses);
+    POSELIB_END_HEADER_ONLY
+
+}
 
-}
\ No newline at end of file
+#ifdef POSELIB_HEADER_ONLY
+#include "essential_inl.h"
+#endif
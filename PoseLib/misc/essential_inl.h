@@ -0,0 +1,92 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Definitions of check_cheirality and motion_from_essential_planar, which are used by the header-only solvers.
+// In the header-only mode (see types.h) this file is included by essential.h, otherwise only by essential.cc.
+
+#pragma once
+
+#include "essential.h"
+
+namespace pose_lib {
+POSELIB_BEGIN_HEADER_ONLY
+
+template <typename Real>
+POSELIB_INLINE bool check_cheirality(const CameraPoseT<Real>& pose, const Eigen::Matrix<Real, 3, 1>& x1, const Eigen::Matrix<Real, 3, 1>& x2) {
+    // This code assumes that x1 and x2 are unit vectors
+    const Eigen::Matrix<Real, 3, 1> Rx1 = pose.R * x1;
+
+    // [1 a; a 1] * [lambda1; lambda2] = [b1; b2]
+    // [lambda1; lambda2] = [1 -a; -a 1] * [b1; b2] / (1 - a*a)
+
+    const Real a = -Rx1.dot(x2);
+    const Real b1 = -Rx1.dot(pose.t);
+    const Real b2 = x2.dot(pose.t);
+
+    // Note that we drop the factor 1.0/(1-a*a) since it is always positive.
+    const Real lambda1 = b1 - a * b2;
+    const Real lambda2 = -a * b1 + b2;
+
+    return lambda1 > 0 && lambda2 > 0;
+}
+
+POSELIB_INLINE void motion_from_essential_planar(double e01, double e21, double e10, double e12, const Eigen::Vector3d &x1, const Eigen::Vector3d& x2, pose_lib::CameraPoseVector *relative_poses) {
+
+    Eigen::Vector2d z;
+    z << -e01 * e10 - e21 * e12, -e21 * e10 + e01 * e12;
+    z.normalize();
+
+    CameraPose pose;
+    pose.R << z(0), 0.0, -z(1), 0.0, 1.0, 0.0, z(1), 0.0, z(0);
+    pose.t << e21, 0.0, -e01;
+    pose.t.normalize();
+
+    if (check_cheirality(pose, x1, x2)) {
+        relative_poses->push_back(pose);
+    }
+    pose.t = -pose.t;
+    if (check_cheirality(pose, x1, x2)) {
+        relative_poses->push_back(pose);
+    }
+
+    // There are two more flipped solutions where
+    //    R = [a 0 b; 0 -1 0; b 0 -a]
+    // These are probably not interesting in the planar case
+
+    /*
+            z << e01 * e10 - e21 * e12, e21* e10 + e01 * e12;
+            z.normalize();
+            pose.R << z(0), 0.0, z(1), 0.0, -1.0, 0.0, z(1), 0.0, -z(0);        
+            relative_poses->push_back(pose);
+            pose.t = -pose.t;
+            relative_poses->push_back(pose);
+    */
+}
+
+POSELIB_END_HEADER_ONLY
+} // namespace pose_lib
@@ -29,18 +29,27 @@
 #include "qep.h"
 #include "sturm.h"
 #include "univariate.h"
+#include <algorithm>
 
 namespace pose_lib {
 namespace qep {
 
-int qep_linearize(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double, 4, 4> &B, const Eigen::Matrix<double, 4, 4> &C, double eig_vals[8], Eigen::Matrix<double, 3, 8> *eig_vecs) {
+int qep_linearize(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double, 4, 4> &B, const Eigen::Matrix<double, 4, 4> &C, double eig_vals[8], Eigen::Matrix<double, 3, 8> *eig_vecs,
+                  LinearizeWorkspace *workspace) {
+    if (workspace == nullptr) {
+        LinearizeWorkspace temporary;
+        return qep_linearize(A, B, C, eig_vals, eig_vecs, &temporary);
+    }
+
     Eigen::Matrix<double, 8, 8> M;
     M.block<4, 4>(0, 0) = B;
     M.block<4, 4>(0, 4) = C;
     M.block<4, 4>(4, 0).setIdentity();
     M.block<4, 4>(4, 4).setZero();
-    M.block<4, 8>(0, 0) = -A.inverse() * M.block<4, 8>(0, 0);
-    Eigen::EigenSolver<Eigen::Matrix<double, 8, 8>> es(M, true);
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    M.block<4, 8>(0, 0) = -A.partialPivLu().inverse() * M.block<4, 8>(0, 0);
+    Eigen::EigenSolver<Eigen::Matrix<double, 8, 8>> &es = workspace->es;
+    es.compute(M, true);
 
     Eigen::Matrix<std::complex<double>, 8, 1> D = es.eigenvalues();
     Eigen::Matrix<std::complex<double>, 8, 8> V = es.eigenvectors();
@@ -69,14 +78,21 @@ void detpoly4(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double,
     coeffs[8] = 1;
 }
 
-// Computes polynomial p(x) = det(x^2*I + x * A + B)
-void detpoly3(const Eigen::Matrix<double, 3, 3> &A, const Eigen::Matrix<double, 3, 3> &B, double coeffs[7]) {
+// Computes the lower coefficients of p(x) = det(x^2*I + x * A + B), the leading coefficient is always one.
+// Templated on the matrix type such that it can also be used for batches of matrices (see batch::MatrixView).
+template <typename Matrix, typename Scalar>
+inline void detpoly3_impl(const Matrix &A, const Matrix &B, Scalar coeffs[6]) {
     coeffs[0] = B(0, 0) * B(1, 1) * B(2, 2) - B(0, 0) * B(1, 2) * B(2, 1) - B(0, 1) * B(1, 0) * B(2, 2) + B(0, 1) * B(1, 2) * B(2, 0) + B(0, 2) * B(1, 0) * B(2, 1) - B(0, 2) * B(1, 1) * B(2, 0);
     coeffs[1] = A(0, 0) * B(1, 1) * B(2, 2) - A(0, 0) * B(1, 2) * B(2, 1) - A(0, 1) * B(1, 0) * B(2, 2) + A(0, 1) * B(1, 2) * B(2, 0) + A(0, 2) * B(1, 0) * B(2, 1) - A(0, 2) * B(1, 1) * B(2, 0) - A(1, 0) * B(0, 1) * B(2, 2) + A(1, 0) * B(0, 2) * B(2, 1) + A(1, 1) * B(0, 0) * B(2, 2) - A(1, 1) * B(0, 2) * B(2, 0) - A(1, 2) * B(0, 0) * B(2, 1) + A(1, 2) * B(0, 1) * B(2, 0) + A(2, 0) * B(0, 1) * B(1, 2) - A(2, 0) * B(0, 2) * B(1, 1) - A(2, 1) * B(0, 0) * B(1, 2) + A(2, 1) * B(0, 2) * B(1, 0) + A(2, 2) * B(0, 0) * B(1, 1) - A(2, 2) * B(0, 1) * B(1, 0);
     coeffs[2] = B(0, 0) * B(1, 1) - B(0, 1) * B(1, 0) + B(0, 0) * B(2, 2) - B(0, 2) * B(2, 0) + B(1, 1) * B(2, 2) - B(1, 2) * B(2, 1) + A(0, 0) * A(1, 1) * B(2, 2) - A(0, 0) * A(1, 2) * B(2, 1) - A(0, 0) * A(2, 1) * B(1, 2) + A(0, 0) * A(2, 2) * B(1, 1) - A(0, 1) * A(1, 0) * B(2, 2) + A(0, 1) * A(1, 2) * B(2, 0) + A(0, 1) * A(2, 0) * B(1, 2) - A(0, 1) * A(2, 2) * B(1, 0) + A(0, 2) * A(1, 0) * B(2, 1) - A(0, 2) * A(1, 1) * B(2, 0) - A(0, 2) * A(2, 0) * B(1, 1) + A(0, 2) * A(2, 1) * B(1, 0) + A(1, 0) * A(2, 1) * B(0, 2) - A(1, 0) * A(2, 2) * B(0, 1) - A(1, 1) * A(2, 0) * B(0, 2) + A(1, 1) * A(2, 2) * B(0, 0) + A(1, 2) * A(2, 0) * B(0, 1) - A(1, 2) * A(2, 1) * B(0, 0);
     coeffs[3] = A(0, 0) * B(1, 1) - A(0, 1) * B(1, 0) - A(1, 0) * B(0, 1) + A(1, 1) * B(0, 0) + A(0, 0) * B(2, 2) - A(0, 2) * B(2, 0) - A(2, 0) * B(0, 2) + A(2, 2) * B(0, 0) + A(1, 1) * B(2, 2) - A(1, 2) * B(2, 1) - A(2, 1) * B(1, 2) + A(2, 2) * B(1, 1) + A(0, 0) * A(1, 1) * A(2, 2) - A(0, 0) * A(1, 2) * A(2, 1) - A(0, 1) * A(1, 0) * A(2, 2) + A(0, 1) * A(1, 2) * A(2, 0) + A(0, 2) * A(1, 0) * A(2, 1) - A(0, 2) * A(1, 1) * A(2, 0);
     coeffs[4] = B(0, 0) + B(1, 1) + B(2, 2) + A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0) + A(0, 0) * A(2, 2) - A(0, 2) * A(2, 0) + A(1, 1) * A(2, 2) - A(1, 2) * A(2, 1);
     coeffs[5] = A(0, 0) + A(1, 1) + A(2, 2);
+}
+
+// Computes polynomial p(x) = det(x^2*I + x * A + B)
+void detpoly3(const Eigen::Matrix<double, 3, 3> &A, const Eigen::Matrix<double, 3, 3> &B, double coeffs[7]) {
+    detpoly3_impl(A, B, coeffs);
     coeffs[6] = 1.0;
 }
 
@@ -84,7 +100,8 @@ int qep_sturm(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double,
 
     double coeffs[9];
 
-    Eigen::Matrix<double, 4, 4> Ainv = A.inverse();
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    Eigen::Matrix<double, 4, 4> Ainv = A.partialPivLu().inverse();
     detpoly4(Ainv * B, Ainv * C, coeffs);
 
     int n_roots = sturm::bisect_sturm<8>(coeffs, eig_vals);
@@ -111,7 +128,8 @@ int qep_sturm_div_1_q2(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix
 
     double coeffs[9];
 
-    Eigen::Matrix<double, 4, 4> Ainv = A.inverse();
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    Eigen::Matrix<double, 4, 4> Ainv = A.partialPivLu().inverse();
     detpoly4(Ainv * B, Ainv * C, coeffs);
 
     // We know that (1+q*q) is a factor. Dividing by this gives us a deg 6 poly.
@@ -170,25 +188,30 @@ int qep_sturm(const Eigen::Matrix<double, 3, 3> &A, const Eigen::Matrix<double,
     return n_roots;
 }
 
-int qep_div_1_q2(const Eigen::Matrix<double, 3, 3> &A, const Eigen::Matrix<double, 3, 3> &B, const Eigen::Matrix<double, 3, 3> &C, double eig_vals[4], Eigen::Matrix<double, 3, 4> *eig_vecs) {
+template <typename Real>
+int qep_div_1_q2(const Eigen::Matrix<Real, 3, 3> &A, const Eigen::Matrix<Real, 3, 3> &B, const Eigen::Matrix<Real, 3, 3> &C, Real eig_vals[4], Eigen::Matrix<Real, 3, 4> *eig_vecs) {
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
 
-    double coeffs[7];
+    Real coeffs[6];
 
-    Eigen::Matrix<double, 3, 3> Ainv = A.inverse();
-    detpoly3(Ainv * B, Ainv * C, coeffs);
+    const Matrix3 Ainv = A.inverse();
+    const Matrix3 AinvB = Ainv * B;
+    const Matrix3 AinvC = Ainv * C;
+    detpoly3_impl(AinvB, AinvC, coeffs);
 
     int n_roots = univariate::solve_quartic_real(coeffs[5], coeffs[2] - coeffs[0], coeffs[1], coeffs[0], eig_vals);
 
     // For computing the eigenvectors we first try to use the top 2x3 block only.
-    Eigen::Matrix<double, 3, 3> M;
-    bool invertible;
+    // The threshold for falling back to the other rows depends on the precision.
+    const Real tol = std::is_same<Real, float>::value ? Real(1e-4) : Real(1e-8);
+    Matrix3 M;
     for (int i = 0; i < n_roots; ++i) {
         M = (eig_vals[i] * eig_vals[i]) * A + eig_vals[i] * B + C;
 
-        Eigen::Vector3d t = M.row(0).cross(M.row(1)).normalized();
-        if (std::abs(M.row(2) * t) > 1e-8) {
+        Eigen::Matrix<Real, 3, 1> t = M.row(0).cross(M.row(1)).normalized();
+        if (std::abs(M.row(2) * t) > tol) {
             t = M.row(0).cross(M.row(2)).normalized();
-            if (std::abs(M.row(1) * t) > 1e-8) {
+            if (std::abs(M.row(1) * t) > tol) {
                 t = M.row(1).cross(M.row(2)).normalized();
             }
         }
@@ -199,5 +222,214 @@ int qep_div_1_q2(const Eigen::Matrix<double, 3, 3> &A, const Eigen::Matrix<doubl
     return n_roots;
 }
 
+template int qep_div_1_q2<double>(const Eigen::Matrix3d &, const Eigen::Matrix3d &, const Eigen::Matrix3d &, double[4], Eigen::Matrix<double, 3, 4> *);
+template int qep_div_1_q2<float>(const Eigen::Matrix3f &, const Eigen::Matrix3f &, const Eigen::Matrix3f &, float[4], Eigen::Matrix<float, 3, 4> *);
+
+namespace {
+
+using batch::Lanes;
+using batch::Mask;
+
+inline void matmul3x3(const Lanes A[3][3], const Lanes B[3][3], Lanes AB[3][3]) {
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            AB[i][j] = A[i][0] * B[0][j];
+            AB[i][j] += A[i][1] * B[1][j];
+            AB[i][j] += A[i][2] * B[2][j];
+        }
+    }
+}
+
+inline void matmul4x4(const Lanes A[4][4], const Lanes B[4][4], Lanes AB[4][4]) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            AB[i][j] = A[i][0] * B[0][j];
+            AB[i][j] += A[i][1] * B[1][j];
+            AB[i][j] += A[i][2] * B[2][j];
+            AB[i][j] += A[i][3] * B[3][j];
+        }
+    }
+}
+
+// Lane-wise version of detpoly4, computing the lower coefficients of det(x^2*I + x * A + B). Instead of the expanded
+// formula this uses the Laplace expansion along the first two rows, i.e. the products of the (polynomial) 2x2 minors
+// from the top two and the bottom two rows, which needs far fewer operations.
+void detpoly4(const Lanes A[4][4], const Lanes B[4][4], Lanes coeffs[8]) {
+    // Entry (i,j) is the polynomial P[i][j][0] + P[i][j][1] * x + P[i][j][2] * x^2
+    Lanes P[4][4][3];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            P[i][j][0] = B[i][j];
+            P[i][j][1] = A[i][j];
+            P[i][j][2] = (i == j) ? Lanes::Ones() : Lanes::Zero();
+        }
+    }
+
+    // Pairs of columns (a, b) with the complementary pairs at the same index in reverse order
+    static const int pairs[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    static const double signs[6] = {1.0, -1.0, 1.0, 1.0, -1.0, 1.0};
+
+    Lanes top[6][5], bottom[6][5];
+    for (int k = 0; k < 6; ++k) {
+        const int a = pairs[k][0], b = pairs[k][1];
+        for (int d = 0; d < 5; ++d) {
+            top[k][d].setZero();
+            bottom[k][d].setZero();
+        }
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                top[k][i + j] += P[0][a][i] * P[1][b][j];
+                top[k][i + j] -= P[0][b][i] * P[1][a][j];
+                bottom[k][i + j] += P[2][a][i] * P[3][b][j];
+                bottom[k][i + j] -= P[2][b][i] * P[3][a][j];
+            }
+        }
+    }
+
+    for (int d = 0; d < 8; ++d) {
+        coeffs[d].setZero();
+    }
+    for (int k = 0; k < 6; ++k) {
+        const Lanes *m = top[k];
+        const Lanes *n = bottom[5 - k];
+        for (int i = 0; i < 5; ++i) {
+            for (int j = 0; j < 5 && i + j < 8; ++j) {
+                coeffs[i + j] += signs[k] * (m[i] * n[j]);
+            }
+        }
+    }
+}
+
+inline void normalize3(Lanes v[3]) {
+    const Lanes inv_norm = batch::dot(v, v).rsqrt();
+    v[0] *= inv_norm;
+    v[1] *= inv_norm;
+    v[2] *= inv_norm;
+}
+
+} // namespace
+
+void qep_div_1_q2(const Lanes A[3][3], const Lanes B[3][3], const Lanes C[3][3], Lanes eig_vals[4], Mask valid[4], Lanes eig_vecs[4][3]) {
+    Lanes Ainv[3][3], AinvB[3][3], AinvC[3][3];
+    batch::inverse3x3(A, Ainv);
+    matmul3x3(Ainv, B, AinvB);
+    matmul3x3(Ainv, C, AinvC);
+
+    batch::Value AinvB_val[3][3], AinvC_val[3][3], coeffs_val[6];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            AinvB_val[i][j] = AinvB[i][j];
+            AinvC_val[i][j] = AinvC[i][j];
+        }
+    }
+    detpoly3_impl(batch::MatrixView<3, batch::Value>{AinvB_val}, batch::MatrixView<3, batch::Value>{AinvC_val}, coeffs_val);
+
+    Lanes coeffs[6];
+    for (int i = 0; i < 6; ++i) {
+        coeffs[i] = coeffs_val[i];
+    }
+
+    univariate::solve_quartic_real(coeffs[5], coeffs[2] - coeffs[0], coeffs[1], coeffs[0], eig_vals, valid);
+
+    // Same strategy as above, but all three candidates are computed and the result is selected per lane.
+    const Lanes tol = Lanes::Constant(1e-8);
+    Lanes M[3][3], t01[3], t02[3], t12[3];
+    for (int k = 0; k < 4; ++k) {
+        const Lanes q2 = eig_vals[k] * eig_vals[k];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                M[i][j] = q2 * A[i][j];
+                M[i][j] += eig_vals[k] * B[i][j];
+                M[i][j] += C[i][j];
+            }
+        }
+
+        batch::cross(M[0], M[1], t01);
+        batch::cross(M[0], M[2], t02);
+        batch::cross(M[1], M[2], t12);
+        normalize3(t01);
+        normalize3(t02);
+        normalize3(t12);
+
+        const Mask use_02 = batch::greater(batch::dot(M[2], t01).abs(), tol);
+        const Mask use_12 = batch::logical_and(use_02, batch::greater(batch::dot(M[1], t02).abs(), tol));
+        for (int i = 0; i < 3; ++i) {
+            eig_vecs[k][i] = batch::select(use_12, t12[i], batch::select(use_02, t02[i], t01[i]));
+        }
+    }
+}
+
+void qep_sturm_div_1_q2(const Lanes A[4][4], const Lanes B[4][4], const Lanes C[4][4], Lanes eig_vals[6], int n_roots[batch::LANES],
+                        Lanes eig_vecs[6][3]) {
+    Lanes Ainv[4][4], AinvB[4][4], AinvC[4][4];
+    batch::inverse4x4(A, Ainv);
+    matmul4x4(Ainv, B, AinvB);
+    matmul4x4(Ainv, C, AinvC);
+
+    Lanes coeffs[8];
+    detpoly4(AinvB, AinvC, coeffs);
+
+    // Divide by (1+q*q) as in the scalar version.
+    coeffs[2] -= coeffs[0];
+    coeffs[3] -= coeffs[1];
+    coeffs[4] -= coeffs[2];
+    coeffs[5] = coeffs[7];
+    coeffs[6].setOnes();
+
+    for (int k = 0; k < 6; ++k) {
+        eig_vals[k].setZero();
+    }
+    sturm::bisect_sturm_lanes<6>(coeffs, eig_vals, n_roots);
+    const int max_roots = *std::max_element(n_roots, n_roots + batch::LANES);
+
+    // Same strategy as above, the eigenvector is computed from the top 3x3 block, unless it is (close to) singular
+    // in which case we revert to QR on the 4x3 system for that lane.
+    const Lanes tol = Lanes::Constant(1e-8);
+    Lanes M[4][4], M3[3][3], M3inv[3][3], M12[3];
+    for (int k = 0; k < max_roots; ++k) {
+        const Lanes q2 = eig_vals[k] * eig_vals[k];
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                M[i][j] = q2 * A[i][j];
+                M[i][j] += eig_vals[k] * B[i][j];
+                M[i][j] += C[i][j];
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                M3[i][j] = M[i][j];
+            }
+        }
+        batch::inverse3x3(M3, M3inv);
+        for (int i = 0; i < 3; ++i) {
+            eig_vecs[k][i] = M3inv[i][0] * M[0][3];
+            eig_vecs[k][i] += M3inv[i][1] * M[1][3];
+            eig_vecs[k][i] += M3inv[i][2] * M[2][3];
+            eig_vecs[k][i] = -eig_vecs[k][i];
+        }
+
+        batch::cross(M3[1], M3[2], M12);
+        const Mask singular = batch::logical_not(batch::greater(batch::dot(M3[0], M12).abs(), tol));
+        if (!batch::any(singular)) {
+            continue;
+        }
+        for (int lane = 0; lane < batch::LANES; ++lane) {
+            if (k >= n_roots[lane] || !batch::test(singular, lane)) {
+                continue;
+            }
+            Eigen::Matrix<double, 4, 4> M_lane;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    M_lane(i, j) = M[i][j](lane);
+                }
+            }
+            const Eigen::Vector3d t = -M_lane.block<4, 3>(0, 0).colPivHouseholderQr().solve(M_lane.block<4, 1>(0, 3));
+            for (int i = 0; i < 3; ++i) {
+                eig_vecs[k][i](lane) = t(i);
+            }
+        }
+    }
+}
+
 } // namespace qep
-} // namespace pose_lib
\ No newline at end of file
+} // namespace pose_lib
@@ -27,6 +27,7 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "batch.h"
 #include <Eigen/Dense>
 
 namespace pose_lib {
@@ -37,8 +38,17 @@ namespace qep {
 // Note: The impl. assumes that fourth element of eigenvector is non-zero.
 // The return eigenvectors are only the first three elements (fourth is normalized to 1)
 
+// Eigen solver state for qep_linearize which can be reused between calls.
+struct LinearizeWorkspace {
+    Eigen::EigenSolver<Eigen::Matrix<double, 8, 8>> es;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
 // Solves the QEP by reduction to normal eigenvalue problem
-int qep_linearize(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double, 4, 4> &B, const Eigen::Matrix<double, 4, 4> &C, double eig_vals[8], Eigen::Matrix<double, 3, 8> *eig_vecs);
+// If workspace is given it is used for the eigen solver, otherwise a temporary one is used.
+int qep_linearize(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double, 4, 4> &B, const Eigen::Matrix<double, 4, 4> &C, double eig_vals[8], Eigen::Matrix<double, 3, 8> *eig_vecs,
+                  LinearizeWorkspace *workspace = nullptr);
 
 // Solves the QEP by sturm bracketing on det(lambda^2*A + lambda*B + C)
 int qep_sturm(const Eigen::Matrix<double, 4, 4> &A, const Eigen::Matrix<double, 4, 4> &B, const Eigen::Matrix<double, 4, 4> &C, double eig_vals[8], Eigen::Matrix<double, 3, 8> *eig_vecs);
@@ -54,8 +64,19 @@ int qep_sturm(const Eigen::Matrix<double, 3, 3>& A, const Eigen::Matrix<double,
 
 // Solves the QEP by solving det(lambda^2*A + lambda*B + C) where we know that (1+lambda^2) is a factor.
 // This is the case in the upright solvers from Sweeney et al.
-// The roots are found using the closed form solver for the quartic.
-int qep_div_1_q2(const Eigen::Matrix<double, 3, 3>& A, const Eigen::Matrix<double, 3, 3>& B, const Eigen::Matrix<double, 3, 3>& C, double eig_vals[4], Eigen::Matrix<double, 3, 4>* eig_vecs);
+// The roots are found using the closed form solver for the quartic. Instantiated for Real = double and Real = float.
+template <typename Real>
+int qep_div_1_q2(const Eigen::Matrix<Real, 3, 3>& A, const Eigen::Matrix<Real, 3, 3>& B, const Eigen::Matrix<Real, 3, 3>& C, Real eig_vals[4], Eigen::Matrix<Real, 3, 4>* eig_vecs);
+
+// Solves LANES instances of the above problem at once (matrices are indexed as A[row][col]).
+// Only the eigenvalues where valid[k] is set are real, eig_vecs[k] is the eigenvector for eig_vals[k].
+void qep_div_1_q2(const batch::Lanes A[3][3], const batch::Lanes B[3][3], const batch::Lanes C[3][3], batch::Lanes eig_vals[4],
+                  batch::Mask valid[4], batch::Lanes eig_vecs[4][3]);
+
+// Solves LANES instances of qep_sturm_div_1_q2 at once (matrices are indexed as A[row][col]).
+// For lane l, eig_vals[k](l) and eig_vecs[k][*](l) with k < n_roots[l] are the solutions.
+void qep_sturm_div_1_q2(const batch::Lanes A[4][4], const batch::Lanes B[4][4], const batch::Lanes C[4][4], batch::Lanes eig_vals[6],
+                        int n_roots[batch::LANES], batch::Lanes eig_vecs[6][3]);
 
 } // namespace qep
 } // namespace pose_lib
\ No newline at end of file
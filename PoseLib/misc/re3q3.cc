@@ -28,6 +28,7 @@
 
 #include "re3q3.h"
 #include "sturm.h"
+#include "dispatch.h"
 #include <Eigen/Dense>
 
 namespace pose_lib {
@@ -82,6 +83,22 @@ void cayley_param(const Eigen::Matrix<double, 3, 1> &c, Eigen::Matrix<double, 3,
     *R /= 1 + c(0) * c(0) + c(1) * c(1) + c(2) * c(2);
 }
 
+inline RandomEngine &random_engine(const Re3q3Options &options) {
+    return options.rng != nullptr ? *options.rng : thread_random_engine();
+}
+
+// Uniformly distributed unit quaternion, same construction as Eigen::Quaterniond::UnitRandom() but drawing
+// from the given generator instead of std::rand.
+inline Eigen::Quaterniond random_unit_quaternion(RandomEngine &rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double u1 = uniform(rng);
+    const double u2 = 2.0 * EIGEN_PI * uniform(rng);
+    const double u3 = 2.0 * EIGEN_PI * uniform(rng);
+    const double a = std::sqrt(1.0 - u1);
+    const double b = std::sqrt(u1);
+    return Eigen::Quaterniond(a * std::sin(u2), a * std::cos(u2), b * std::sin(u3), b * std::cos(u3));
+}
+
 inline void refine_3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions, int n_sols) {
     Eigen::Matrix3d J;
     Eigen::Vector3d r;
@@ -119,11 +136,84 @@ inline void refine_3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix
     }
 }
 
+// Given the reduced system P (see re3q3), computes the coefficients of the 3x3 polynomial matrix M(x)
+// and its determinant c, which is a degree 8 polynomial in x. Templated such that it can be used both
+// for a single system and for a batch of systems (see batch::MatrixView).
+template <typename Matrix, typename T>
+inline void elimination_polynomial(const Matrix &P, T a1[10], T a2[10], T a3[13], T c[9]) {
+    a1[0] = P(0, 1) * P(2, 1) + P(0, 2) * P(1, 1) - P(2, 1) * P(0, 1) - P(2, 2) * P(2, 1) - P(2, 0);
+    a1[1] = P(0, 1) * P(2, 4) + P(0, 4) * P(2, 1) + P(0, 2) * P(1, 4) + P(0, 5) * P(1, 1) - P(2, 1) * P(0, 4) - P(2, 4) * P(0, 1) - P(2, 2) * P(2, 4) - P(2, 5) * P(2, 1) - P(2, 3);
+    a1[2] = P(0, 4) * P(2, 4) + P(0, 5) * P(1, 4) - P(2, 4) * P(0, 4) - P(2, 5) * P(2, 4) - P(2, 6);
+    a1[3] = P(0, 1) * P(2, 2) + P(0, 2) * P(1, 2) - P(2, 1) * P(0, 2) - P(2, 2) * P(2, 2) + P(0, 0);
+    a1[4] = P(0, 1) * P(2, 5) + P(0, 4) * P(2, 2) + P(0, 2) * P(1, 5) + P(0, 5) * P(1, 2) - P(2, 1) * P(0, 5) - P(2, 4) * P(0, 2) - P(2, 2) * P(2, 5) - P(2, 5) * P(2, 2) + P(0, 3);
+    a1[5] = P(0, 4) * P(2, 5) + P(0, 5) * P(1, 5) - P(2, 4) * P(0, 5) - P(2, 5) * P(2, 5) + P(0, 6);
+    a1[6] = P(0, 1) * P(2, 0) + P(0, 2) * P(1, 0) - P(2, 1) * P(0, 0) - P(2, 2) * P(2, 0);
+    a1[7] = P(0, 1) * P(2, 3) + P(0, 4) * P(2, 0) + P(0, 2) * P(1, 3) + P(0, 5) * P(1, 0) - P(2, 1) * P(0, 3) - P(2, 4) * P(0, 0) - P(2, 2) * P(2, 3) - P(2, 5) * P(2, 0);
+    a1[8] = P(0, 1) * P(2, 6) + P(0, 4) * P(2, 3) + P(0, 2) * P(1, 6) + P(0, 5) * P(1, 3) - P(2, 1) * P(0, 6) - P(2, 4) * P(0, 3) - P(2, 2) * P(2, 6) - P(2, 5) * P(2, 3);
+    a1[9] = P(0, 4) * P(2, 6) + P(0, 5) * P(1, 6) - P(2, 4) * P(0, 6) - P(2, 5) * P(2, 6);
+
+    a2[0] = P(2, 1) * P(2, 1) + P(2, 2) * P(1, 1) - P(1, 1) * P(0, 1) - P(1, 2) * P(2, 1) - P(1, 0);
+    a2[1] = P(2, 1) * P(2, 4) + P(2, 4) * P(2, 1) + P(2, 2) * P(1, 4) + P(2, 5) * P(1, 1) - P(1, 1) * P(0, 4) - P(1, 4) * P(0, 1) - P(1, 2) * P(2, 4) - P(1, 5) * P(2, 1) - P(1, 3);
+    a2[2] = P(2, 4) * P(2, 4) + P(2, 5) * P(1, 4) - P(1, 4) * P(0, 4) - P(1, 5) * P(2, 4) - P(1, 6);
+    a2[3] = P(2, 1) * P(2, 2) + P(2, 2) * P(1, 2) - P(1, 1) * P(0, 2) - P(1, 2) * P(2, 2) + P(2, 0);
+    a2[4] = P(2, 1) * P(2, 5) + P(2, 4) * P(2, 2) + P(2, 2) * P(1, 5) + P(2, 5) * P(1, 2) - P(1, 1) * P(0, 5) - P(1, 4) * P(0, 2) - P(1, 2) * P(2, 5) - P(1, 5) * P(2, 2) + P(2, 3);
+    a2[5] = P(2, 4) * P(2, 5) + P(2, 5) * P(1, 5) - P(1, 4) * P(0, 5) - P(1, 5) * P(2, 5) + P(2, 6);
+    a2[6] = P(2, 1) * P(2, 0) + P(2, 2) * P(1, 0) - P(1, 1) * P(0, 0) - P(1, 2) * P(2, 0);
+    a2[7] = P(2, 1) * P(2, 3) + P(2, 4) * P(2, 0) + P(2, 2) * P(1, 3) + P(2, 5) * P(1, 0) - P(1, 1) * P(0, 3) - P(1, 4) * P(0, 0) - P(1, 2) * P(2, 3) - P(1, 5) * P(2, 0);
+    a2[8] = P(2, 1) * P(2, 6) + P(2, 4) * P(2, 3) + P(2, 2) * P(1, 6) + P(2, 5) * P(1, 3) - P(1, 1) * P(0, 6) - P(1, 4) * P(0, 3) - P(1, 2) * P(2, 6) - P(1, 5) * P(2, 3);
+    a2[9] = P(2, 4) * P(2, 6) + P(2, 5) * P(1, 6) - P(1, 4) * P(0, 6) - P(1, 5) * P(2, 6);
+
+    const T t2 = P(2, 1) * P(2, 1);
+    const T t3 = P(2, 2) * P(2, 2);
+    const T t4 = P(0, 1) * P(1, 4);
+    const T t5 = P(0, 4) * P(1, 1);
+    const T t6 = t4 + t5;
+    const T t7 = P(0, 2) * P(1, 5);
+    const T t8 = P(0, 5) * P(1, 2);
+    const T t9 = t7 + t8;
+    const T t10 = P(0, 1) * P(1, 5);
+    const T t11 = P(0, 4) * P(1, 2);
+    const T t12 = t10 + t11;
+    const T t13 = P(0, 2) * P(1, 4);
+    const T t14 = P(0, 5) * P(1, 1);
+    const T t15 = t13 + t14;
+    const T t16 = P(2, 1) * P(2, 5);
+    const T t17 = P(2, 2) * P(2, 4);
+    const T t18 = t16 + t17;
+    const T t19 = P(2, 4) * P(2, 4);
+    const T t20 = P(2, 5) * P(2, 5);
+    a3[0] = P(0, 0) * P(1, 1) + P(0, 1) * P(1, 0) - P(2, 0) * P(2, 1) * 2.0 - P(0, 1) * t2 - P(1, 1) * t3 - P(2, 2) * t2 * 2.0 + (P(0, 1) * P(0, 1)) * P(1, 1) + P(0, 2) * P(1, 1) * P(1, 2) + P(0, 1) * P(1, 2) * P(2, 1) + P(0, 2) * P(1, 1) * P(2, 1);
+    a3[1] = P(0, 0) * P(1, 4) + P(0, 1) * P(1, 3) + P(0, 3) * P(1, 1) + P(0, 4) * P(1, 0) - P(2, 0) * P(2, 4) * 2.0 - P(2, 1) * P(2, 3) * 2.0 - P(0, 4) * t2 + P(0, 1) * t6 - P(1, 4) * t3 + P(1, 1) * t9 + P(2, 1) * t12 + P(2, 1) * t15 - P(2, 1) * t18 * 2.0 + P(0, 1) * P(0, 4) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 4) + P(0, 1) * P(1, 2) * P(2, 4) + P(0, 2) * P(1, 1) * P(2, 4) - P(0, 1) * P(2, 1) * P(2, 4) * 2.0 - P(1, 1) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 4) * 2.0;
+    a3[2] = P(0, 1) * P(1, 6) + P(0, 3) * P(1, 4) + P(0, 4) * P(1, 3) + P(0, 6) * P(1, 1) - P(2, 1) * P(2, 6) * 2.0 - P(2, 3) * P(2, 4) * 2.0 + P(0, 4) * t6 - P(0, 1) * t19 + P(1, 4) * t9 - P(1, 1) * t20 + P(2, 4) * t12 + P(2, 4) * t15 - P(2, 4) * t18 * 2.0 + P(0, 1) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 1) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 1) + P(0, 5) * P(1, 4) * P(2, 1) - P(0, 4) * P(2, 1) * P(2, 4) * 2.0 - P(1, 4) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 4) * P(2, 5) * 2.0;
+    a3[3] = P(0, 4) * P(1, 6) + P(0, 6) * P(1, 4) - P(2, 4) * P(2, 6) * 2.0 - P(0, 4) * t19 - P(1, 4) * t20 - P(2, 5) * t19 * 2.0 + (P(0, 4) * P(0, 4)) * P(1, 4) + P(0, 5) * P(1, 4) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 4) + P(0, 5) * P(1, 4) * P(2, 4);
+    a3[4] = P(0, 0) * P(1, 2) + P(0, 2) * P(1, 0) - P(2, 0) * P(2, 2) * 2.0 - P(0, 2) * t2 - P(1, 2) * t3 - P(2, 1) * t3 * 2.0 + P(0, 2) * (P(1, 2) * P(1, 2)) + P(0, 1) * P(0, 2) * P(1, 1) + P(0, 1) * P(1, 2) * P(2, 2) + P(0, 2) * P(1, 1) * P(2, 2);
+    a3[5] = P(0, 0) * P(1, 5) + P(0, 2) * P(1, 3) + P(0, 3) * P(1, 2) + P(0, 5) * P(1, 0) - P(2, 0) * P(2, 5) * 2.0 - P(2, 2) * P(2, 3) * 2.0 - P(0, 5) * t2 + P(0, 2) * t6 - P(1, 5) * t3 + P(1, 2) * t9 + P(2, 2) * t12 + P(2, 2) * t15 - P(2, 2) * t18 * 2.0 + P(0, 1) * P(0, 5) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 5) + P(0, 1) * P(1, 2) * P(2, 5) + P(0, 2) * P(1, 1) * P(2, 5) - P(0, 2) * P(2, 1) * P(2, 4) * 2.0 - P(1, 2) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 5) * 2.0;
+    a3[6] = P(0, 2) * P(1, 6) + P(0, 3) * P(1, 5) + P(0, 5) * P(1, 3) + P(0, 6) * P(1, 2) - P(2, 2) * P(2, 6) * 2.0 - P(2, 3) * P(2, 5) * 2.0 + P(0, 5) * t6 - P(0, 2) * t19 + P(1, 5) * t9 - P(1, 2) * t20 + P(2, 5) * t12 + P(2, 5) * t15 - P(2, 5) * t18 * 2.0 + P(0, 2) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 2) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 2) + P(0, 5) * P(1, 4) * P(2, 2) - P(0, 5) * P(2, 1) * P(2, 4) * 2.0 - P(1, 5) * P(2, 2) * P(2, 5) * 2.0 - P(2, 2) * P(2, 4) * P(2, 5) * 2.0;
+    a3[7] = P(0, 5) * P(1, 6) + P(0, 6) * P(1, 5) - P(2, 5) * P(2, 6) * 2.0 - P(0, 5) * t19 - P(1, 5) * t20 - P(2, 4) * t20 * 2.0 + P(0, 5) * (P(1, 5) * P(1, 5)) + P(0, 4) * P(0, 5) * P(1, 4) + P(0, 4) * P(1, 5) * P(2, 5) + P(0, 5) * P(1, 4) * P(2, 5);
+    a3[8] = P(0, 0) * P(1, 0) - P(0, 0) * t2 - P(1, 0) * t3 - P(2, 0) * P(2, 0) + P(0, 0) * P(0, 1) * P(1, 1) + P(0, 2) * P(1, 0) * P(1, 2) + P(0, 1) * P(1, 2) * P(2, 0) + P(0, 2) * P(1, 1) * P(2, 0) - P(2, 0) * P(2, 1) * P(2, 2) * 2.0;
+    a3[9] = P(0, 0) * P(1, 3) + P(0, 3) * P(1, 0) - P(2, 0) * P(2, 3) * 2.0 - P(0, 3) * t2 + P(0, 0) * t6 - P(1, 3) * t3 + P(1, 0) * t9 + P(2, 0) * t12 + P(2, 0) * t15 - P(2, 0) * t18 * 2.0 + P(0, 1) * P(0, 3) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 3) + P(0, 1) * P(1, 2) * P(2, 3) + P(0, 2) * P(1, 1) * P(2, 3) - P(0, 0) * P(2, 1) * P(2, 4) * 2.0 - P(1, 0) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 3) * 2.0;
+    a3[10] = P(0, 0) * P(1, 6) + P(0, 3) * P(1, 3) + P(0, 6) * P(1, 0) - P(2, 0) * P(2, 6) * 2.0 - P(0, 6) * t2 + P(0, 3) * t6 - P(0, 0) * t19 - P(1, 6) * t3 + P(1, 3) * t9 - P(1, 0) * t20 + P(2, 3) * t12 + P(2, 3) * t15 - P(2, 3) * t18 * 2.0 - P(2, 3) * P(2, 3) + P(0, 0) * P(0, 4) * P(1, 4) + P(0, 1) * P(0, 6) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 6) + P(0, 5) * P(1, 0) * P(1, 5) + P(0, 1) * P(1, 2) * P(2, 6) + P(0, 2) * P(1, 1) * P(2, 6) + P(0, 4) * P(1, 5) * P(2, 0) + P(0, 5) * P(1, 4) * P(2, 0) - P(0, 3) * P(2, 1) * P(2, 4) * 2.0 - P(1, 3) * P(2, 2) * P(2, 5) * 2.0 - P(2, 0) * P(2, 4) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 6) * 2.0;
+    a3[11] = P(0, 3) * P(1, 6) + P(0, 6) * P(1, 3) - P(2, 3) * P(2, 6) * 2.0 + P(0, 6) * t6 - P(0, 3) * t19 + P(1, 6) * t9 - P(1, 3) * t20 + P(2, 6) * t12 + P(2, 6) * t15 - P(2, 6) * t18 * 2.0 + P(0, 3) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 3) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 3) + P(0, 5) * P(1, 4) * P(2, 3) - P(0, 6) * P(2, 1) * P(2, 4) * 2.0 - P(1, 6) * P(2, 2) * P(2, 5) * 2.0 - P(2, 3) * P(2, 4) * P(2, 5) * 2.0;
+    a3[12] = P(0, 6) * P(1, 6) - P(0, 6) * t19 - P(1, 6) * t20 - P(2, 6) * P(2, 6) + P(0, 4) * P(0, 6) * P(1, 4) + P(0, 5) * P(1, 5) * P(1, 6) + P(0, 4) * P(1, 5) * P(2, 6) + P(0, 5) * P(1, 4) * P(2, 6) - P(2, 4) * P(2, 5) * P(2, 6) * 2.0;
+
+    // det(M(x))
+    c[8] = a1[3] * a2[6] * a3[0] - a1[6] * a2[3] * a3[0] - a1[0] * a2[6] * a3[4] + a1[6] * a2[0] * a3[4] + a1[0] * a2[3] * a3[8] - a1[3] * a2[0] * a3[8];
+    c[7] = a1[3] * a2[6] * a3[1] + a1[3] * a2[7] * a3[0] + a1[4] * a2[6] * a3[0] - a1[6] * a2[3] * a3[1] - a1[6] * a2[4] * a3[0] - a1[7] * a2[3] * a3[0] - a1[0] * a2[6] * a3[5] - a1[0] * a2[7] * a3[4] - a1[1] * a2[6] * a3[4] + a1[6] * a2[0] * a3[5] + a1[6] * a2[1] * a3[4] + a1[7] * a2[0] * a3[4] + a1[0] * a2[4] * a3[8] + a1[1] * a2[3] * a3[8] - a1[3] * a2[1] * a3[8] - a1[4] * a2[0] * a3[8] + a1[0] * a2[3] * a3[9] - a1[3] * a2[0] * a3[9];
+    c[6] = a1[3] * a2[6] * a3[2] + a1[3] * a2[7] * a3[1] + a1[3] * a2[8] * a3[0] + a1[4] * a2[6] * a3[1] + a1[4] * a2[7] * a3[0] + a1[5] * a2[6] * a3[0] - a1[6] * a2[3] * a3[2] - a1[6] * a2[4] * a3[1] - a1[6] * a2[5] * a3[0] - a1[7] * a2[3] * a3[1] - a1[7] * a2[4] * a3[0] - a1[8] * a2[3] * a3[0] - a1[0] * a2[6] * a3[6] - a1[0] * a2[7] * a3[5] - a1[0] * a2[8] * a3[4] - a1[1] * a2[6] * a3[5] - a1[1] * a2[7] * a3[4] - a1[2] * a2[6] * a3[4] + a1[6] * a2[0] * a3[6] + a1[6] * a2[1] * a3[5] + a1[6] * a2[2] * a3[4] + a1[7] * a2[0] * a3[5] + a1[7] * a2[1] * a3[4] + a1[8] * a2[0] * a3[4] + a1[0] * a2[5] * a3[8] + a1[1] * a2[4] * a3[8] + a1[2] * a2[3] * a3[8] - a1[3] * a2[2] * a3[8] - a1[4] * a2[1] * a3[8] - a1[5] * a2[0] * a3[8] + a1[0] * a2[3] * a3[10] + a1[0] * a2[4] * a3[9] + a1[1] * a2[3] * a3[9] - a1[3] * a2[0] * a3[10] - a1[3] * a2[1] * a3[9] - a1[4] * a2[0] * a3[9];
+    c[5] = a1[3] * a2[6] * a3[3] + a1[3] * a2[7] * a3[2] + a1[3] * a2[8] * a3[1] + a1[4] * a2[6] * a3[2] + a1[4] * a2[7] * a3[1] + a1[4] * a2[8] * a3[0] + a1[5] * a2[6] * a3[1] + a1[5] * a2[7] * a3[0] - a1[6] * a2[3] * a3[3] - a1[6] * a2[4] * a3[2] - a1[6] * a2[5] * a3[1] - a1[7] * a2[3] * a3[2] - a1[7] * a2[4] * a3[1] - a1[7] * a2[5] * a3[0] - a1[8] * a2[3] * a3[1] - a1[8] * a2[4] * a3[0] - a1[0] * a2[6] * a3[7] - a1[0] * a2[7] * a3[6] - a1[0] * a2[8] * a3[5] - a1[1] * a2[6] * a3[6] - a1[1] * a2[7] * a3[5] - a1[1] * a2[8] * a3[4] - a1[2] * a2[6] * a3[5] - a1[2] * a2[7] * a3[4] + a1[6] * a2[0] * a3[7] + a1[6] * a2[1] * a3[6] + a1[6] * a2[2] * a3[5] + a1[7] * a2[0] * a3[6] + a1[7] * a2[1] * a3[5] + a1[7] * a2[2] * a3[4] + a1[8] * a2[0] * a3[5] + a1[8] * a2[1] * a3[4] + a1[1] * a2[5] * a3[8] + a1[2] * a2[4] * a3[8] - a1[4] * a2[2] * a3[8] - a1[5] * a2[1] * a3[8] - a2[3] * a3[0] * a1[9] + a2[0] * a3[4] * a1[9] + a1[3] * a3[0] * a2[9] - a1[0] * a3[4] * a2[9] + a1[0] * a2[3] * a3[11] + a1[0] * a2[4] * a3[10] + a1[0] * a2[5] * a3[9] + a1[1] * a2[3] * a3[10] + a1[1] * a2[4] * a3[9] + a1[2] * a2[3] * a3[9] - a1[3] * a2[0] * a3[11] - a1[3] * a2[1] * a3[10] - a1[3] * a2[2] * a3[9] - a1[4] * a2[0] * a3[10] - a1[4] * a2[1] * a3[9] - a1[5] * a2[0] * a3[9];
+    c[4] = a1[3] * a2[7] * a3[3] + a1[3] * a2[8] * a3[2] + a1[4] * a2[6] * a3[3] + a1[4] * a2[7] * a3[2] + a1[4] * a2[8] * a3[1] + a1[5] * a2[6] * a3[2] + a1[5] * a2[7] * a3[1] + a1[5] * a2[8] * a3[0] - a1[6] * a2[4] * a3[3] - a1[6] * a2[5] * a3[2] - a1[7] * a2[3] * a3[3] - a1[7] * a2[4] * a3[2] - a1[7] * a2[5] * a3[1] - a1[8] * a2[3] * a3[2] - a1[8] * a2[4] * a3[1] - a1[8] * a2[5] * a3[0] - a1[0] * a2[7] * a3[7] - a1[0] * a2[8] * a3[6] - a1[1] * a2[6] * a3[7] - a1[1] * a2[7] * a3[6] - a1[1] * a2[8] * a3[5] - a1[2] * a2[6] * a3[6] - a1[2] * a2[7] * a3[5] - a1[2] * a2[8] * a3[4] + a1[6] * a2[1] * a3[7] + a1[6] * a2[2] * a3[6] + a1[7] * a2[0] * a3[7] + a1[7] * a2[1] * a3[6] + a1[7] * a2[2] * a3[5] + a1[8] * a2[0] * a3[6] + a1[8] * a2[1] * a3[5] + a1[8] * a2[2] * a3[4] + a1[2] * a2[5] * a3[8] - a1[5] * a2[2] * a3[8] - a2[3] * a3[1] * a1[9] - a2[4] * a3[0] * a1[9] + a2[0] * a3[5] * a1[9] + a2[1] * a3[4] * a1[9] + a1[3] * a3[1] * a2[9] + a1[4] * a3[0] * a2[9] - a1[0] * a3[5] * a2[9] - a1[1] * a3[4] * a2[9] + a1[0] * a2[3] * a3[12] + a1[0] * a2[4] * a3[11] + a1[0] * a2[5] * a3[10] + a1[1] * a2[3] * a3[11] + a1[1] * a2[4] * a3[10] + a1[1] * a2[5] * a3[9] + a1[2] * a2[3] * a3[10] + a1[2] * a2[4] * a3[9] - a1[3] * a2[0] * a3[12] - a1[3] * a2[1] * a3[11] - a1[3] * a2[2] * a3[10] - a1[4] * a2[0] * a3[11] - a1[4] * a2[1] * a3[10] - a1[4] * a2[2] * a3[9] - a1[5] * a2[0] * a3[10] - a1[5] * a2[1] * a3[9];
+    c[3] = a1[3] * a2[8] * a3[3] + a1[4] * a2[7] * a3[3] + a1[4] * a2[8] * a3[2] + a1[5] * a2[6] * a3[3] + a1[5] * a2[7] * a3[2] + a1[5] * a2[8] * a3[1] - a1[6] * a2[5] * a3[3] - a1[7] * a2[4] * a3[3] - a1[7] * a2[5] * a3[2] - a1[8] * a2[3] * a3[3] - a1[8] * a2[4] * a3[2] - a1[8] * a2[5] * a3[1] - a1[0] * a2[8] * a3[7] - a1[1] * a2[7] * a3[7] - a1[1] * a2[8] * a3[6] - a1[2] * a2[6] * a3[7] - a1[2] * a2[7] * a3[6] - a1[2] * a2[8] * a3[5] + a1[6] * a2[2] * a3[7] + a1[7] * a2[1] * a3[7] + a1[7] * a2[2] * a3[6] + a1[8] * a2[0] * a3[7] + a1[8] * a2[1] * a3[6] + a1[8] * a2[2] * a3[5] - a2[3] * a3[2] * a1[9] - a2[4] * a3[1] * a1[9] - a2[5] * a3[0] * a1[9] + a2[0] * a3[6] * a1[9] + a2[1] * a3[5] * a1[9] + a2[2] * a3[4] * a1[9] + a1[3] * a3[2] * a2[9] + a1[4] * a3[1] * a2[9] + a1[5] * a3[0] * a2[9] - a1[0] * a3[6] * a2[9] - a1[1] * a3[5] * a2[9] - a1[2] * a3[4] * a2[9] + a1[0] * a2[4] * a3[12] + a1[0] * a2[5] * a3[11] + a1[1] * a2[3] * a3[12] + a1[1] * a2[4] * a3[11] + a1[1] * a2[5] * a3[10] + a1[2] * a2[3] * a3[11] + a1[2] * a2[4] * a3[10] + a1[2] * a2[5] * a3[9] - a1[3] * a2[1] * a3[12] - a1[3] * a2[2] * a3[11] - a1[4] * a2[0] * a3[12] - a1[4] * a2[1] * a3[11] - a1[4] * a2[2] * a3[10] - a1[5] * a2[0] * a3[11] - a1[5] * a2[1] * a3[10] - a1[5] * a2[2] * a3[9];
+    c[2] = a1[4] * a2[8] * a3[3] + a1[5] * a2[7] * a3[3] + a1[5] * a2[8] * a3[2] - a1[7] * a2[5] * a3[3] - a1[8] * a2[4] * a3[3] - a1[8] * a2[5] * a3[2] - a1[1] * a2[8] * a3[7] - a1[2] * a2[7] * a3[7] - a1[2] * a2[8] * a3[6] + a1[7] * a2[2] * a3[7] + a1[8] * a2[1] * a3[7] + a1[8] * a2[2] * a3[6] - a2[3] * a3[3] * a1[9] - a2[4] * a3[2] * a1[9] - a2[5] * a3[1] * a1[9] + a2[0] * a3[7] * a1[9] + a2[1] * a3[6] * a1[9] + a2[2] * a3[5] * a1[9] + a1[3] * a3[3] * a2[9] + a1[4] * a3[2] * a2[9] + a1[5] * a3[1] * a2[9] - a1[0] * a3[7] * a2[9] - a1[1] * a3[6] * a2[9] - a1[2] * a3[5] * a2[9] + a1[0] * a2[5] * a3[12] + a1[1] * a2[4] * a3[12] + a1[1] * a2[5] * a3[11] + a1[2] * a2[3] * a3[12] + a1[2] * a2[4] * a3[11] + a1[2] * a2[5] * a3[10] - a1[3] * a2[2] * a3[12] - a1[4] * a2[1] * a3[12] - a1[4] * a2[2] * a3[11] - a1[5] * a2[0] * a3[12] - a1[5] * a2[1] * a3[11] - a1[5] * a2[2] * a3[10];
+    c[1] = a1[5] * a2[8] * a3[3] - a1[8] * a2[5] * a3[3] - a1[2] * a2[8] * a3[7] + a1[8] * a2[2] * a3[7] - a2[4] * a3[3] * a1[9] - a2[5] * a3[2] * a1[9] + a2[1] * a3[7] * a1[9] + a2[2] * a3[6] * a1[9] + a1[4] * a3[3] * a2[9] + a1[5] * a3[2] * a2[9] - a1[1] * a3[7] * a2[9] - a1[2] * a3[6] * a2[9] + a1[1] * a2[5] * a3[12] + a1[2] * a2[4] * a3[12] + a1[2] * a2[5] * a3[11] - a1[4] * a2[2] * a3[12] - a1[5] * a2[1] * a3[12] - a1[5] * a2[2] * a3[11];
+    c[0] = -a2[5] * a3[3] * a1[9] + a2[2] * a3[7] * a1[9] + a1[5] * a3[3] * a2[9] - a1[2] * a3[7] * a2[9] + a1[2] * a2[5] * a3[12] - a1[5] * a2[2] * a3[12];
+}
+
 /*
  * Order of coefficients is:  x^2, xy, xz, y^2, yz, z^2, x, y, z, 1.0;
  *
  */
-int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions, bool try_random_var_change) {
+int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions, const Re3q3Options &options) {
+    POSELIB_DISPATCH(re3q3, (coeffs, solutions, options))
 
     Eigen::Matrix<double, 3, 3> Ax, Ay, Az;
     Ax << coeffs.col(3), coeffs.col(5), coeffs.col(4); // y^2, z^2, yz
@@ -145,10 +235,13 @@ int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8
         elim_var = 2;
     }
 
-    if (try_random_var_change && det < 1e-10) {
+    if (options.try_random_var_change && det < 1e-10) {
+        RandomEngine &rng = random_engine(options);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
         Eigen::Matrix<double, 3, 4> A;
-        A.block<3, 3>(0, 0) = Eigen::Quaternion<double>::UnitRandom().toRotationMatrix();
-        A.block<3, 1>(0, 3).setRandom().normalize();
+        A.template block<3, 3>(0, 0) = random_unit_quaternion(rng).toRotationMatrix();
+        A.template block<3, 1>(0, 3) << uniform(rng), uniform(rng), uniform(rng);
+        A.template block<3, 1>(0, 3).normalize();
 
         Eigen::Matrix<double, 10, 10> B;
         B << A(0, 0) * A(0, 0), 2 * A(0, 0) * A(0, 1), 2 * A(0, 0) * A(0, 2), A(0, 1) * A(0, 1), 2 * A(0, 1) * A(0, 2), A(0, 2) * A(0, 2), 2 * A(0, 0) * A(0, 3), 2 * A(0, 1) * A(0, 3), 2 * A(0, 2) * A(0, 3), A(0, 3) * A(0, 3),
@@ -163,11 +256,11 @@ int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8
             0, 0, 0, 0, 0, 0, 0, 0, 0, 1;
         Eigen::Matrix<double, 3, 10> coeffsB = coeffs * B;
 
-        int n_sols = re3q3(coeffsB, solutions, false);
+        int n_sols = re3q3(coeffsB, solutions, Re3q3Options(false));
 
         // Revert change of variables
         for (int k = 0; k < n_sols; k++) {
-            solutions->col(k) = A.block<3, 3>(0, 0) * solutions->col(k) + A.col(3);
+            solutions->col(k) = A.template block<3, 3>(0, 0) * solutions->col(k) + A.col(3);
         }
 
         // In some cases the numerics are quite poor after the change of variables, so we do some newton steps with the original coefficients.
@@ -192,72 +285,8 @@ int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8
         P = -Az.inverse() * P;
     }
 
-    double a11 = P(0, 1) * P(2, 1) + P(0, 2) * P(1, 1) - P(2, 1) * P(0, 1) - P(2, 2) * P(2, 1) - P(2, 0);
-    double a12 = P(0, 1) * P(2, 4) + P(0, 4) * P(2, 1) + P(0, 2) * P(1, 4) + P(0, 5) * P(1, 1) - P(2, 1) * P(0, 4) - P(2, 4) * P(0, 1) - P(2, 2) * P(2, 4) - P(2, 5) * P(2, 1) - P(2, 3);
-    double a13 = P(0, 4) * P(2, 4) + P(0, 5) * P(1, 4) - P(2, 4) * P(0, 4) - P(2, 5) * P(2, 4) - P(2, 6);
-    double a14 = P(0, 1) * P(2, 2) + P(0, 2) * P(1, 2) - P(2, 1) * P(0, 2) - P(2, 2) * P(2, 2) + P(0, 0);
-    double a15 = P(0, 1) * P(2, 5) + P(0, 4) * P(2, 2) + P(0, 2) * P(1, 5) + P(0, 5) * P(1, 2) - P(2, 1) * P(0, 5) - P(2, 4) * P(0, 2) - P(2, 2) * P(2, 5) - P(2, 5) * P(2, 2) + P(0, 3);
-    double a16 = P(0, 4) * P(2, 5) + P(0, 5) * P(1, 5) - P(2, 4) * P(0, 5) - P(2, 5) * P(2, 5) + P(0, 6);
-    double a17 = P(0, 1) * P(2, 0) + P(0, 2) * P(1, 0) - P(2, 1) * P(0, 0) - P(2, 2) * P(2, 0);
-    double a18 = P(0, 1) * P(2, 3) + P(0, 4) * P(2, 0) + P(0, 2) * P(1, 3) + P(0, 5) * P(1, 0) - P(2, 1) * P(0, 3) - P(2, 4) * P(0, 0) - P(2, 2) * P(2, 3) - P(2, 5) * P(2, 0);
-    double a19 = P(0, 1) * P(2, 6) + P(0, 4) * P(2, 3) + P(0, 2) * P(1, 6) + P(0, 5) * P(1, 3) - P(2, 1) * P(0, 6) - P(2, 4) * P(0, 3) - P(2, 2) * P(2, 6) - P(2, 5) * P(2, 3);
-    double a110 = P(0, 4) * P(2, 6) + P(0, 5) * P(1, 6) - P(2, 4) * P(0, 6) - P(2, 5) * P(2, 6);
-
-    double a21 = P(2, 1) * P(2, 1) + P(2, 2) * P(1, 1) - P(1, 1) * P(0, 1) - P(1, 2) * P(2, 1) - P(1, 0);
-    double a22 = P(2, 1) * P(2, 4) + P(2, 4) * P(2, 1) + P(2, 2) * P(1, 4) + P(2, 5) * P(1, 1) - P(1, 1) * P(0, 4) - P(1, 4) * P(0, 1) - P(1, 2) * P(2, 4) - P(1, 5) * P(2, 1) - P(1, 3);
-    double a23 = P(2, 4) * P(2, 4) + P(2, 5) * P(1, 4) - P(1, 4) * P(0, 4) - P(1, 5) * P(2, 4) - P(1, 6);
-    double a24 = P(2, 1) * P(2, 2) + P(2, 2) * P(1, 2) - P(1, 1) * P(0, 2) - P(1, 2) * P(2, 2) + P(2, 0);
-    double a25 = P(2, 1) * P(2, 5) + P(2, 4) * P(2, 2) + P(2, 2) * P(1, 5) + P(2, 5) * P(1, 2) - P(1, 1) * P(0, 5) - P(1, 4) * P(0, 2) - P(1, 2) * P(2, 5) - P(1, 5) * P(2, 2) + P(2, 3);
-    double a26 = P(2, 4) * P(2, 5) + P(2, 5) * P(1, 5) - P(1, 4) * P(0, 5) - P(1, 5) * P(2, 5) + P(2, 6);
-    double a27 = P(2, 1) * P(2, 0) + P(2, 2) * P(1, 0) - P(1, 1) * P(0, 0) - P(1, 2) * P(2, 0);
-    double a28 = P(2, 1) * P(2, 3) + P(2, 4) * P(2, 0) + P(2, 2) * P(1, 3) + P(2, 5) * P(1, 0) - P(1, 1) * P(0, 3) - P(1, 4) * P(0, 0) - P(1, 2) * P(2, 3) - P(1, 5) * P(2, 0);
-    double a29 = P(2, 1) * P(2, 6) + P(2, 4) * P(2, 3) + P(2, 2) * P(1, 6) + P(2, 5) * P(1, 3) - P(1, 1) * P(0, 6) - P(1, 4) * P(0, 3) - P(1, 2) * P(2, 6) - P(1, 5) * P(2, 3);
-    double a210 = P(2, 4) * P(2, 6) + P(2, 5) * P(1, 6) - P(1, 4) * P(0, 6) - P(1, 5) * P(2, 6);
-
-    double t2 = P(2, 1) * P(2, 1);
-    double t3 = P(2, 2) * P(2, 2);
-    double t4 = P(0, 1) * P(1, 4);
-    double t5 = P(0, 4) * P(1, 1);
-    double t6 = t4 + t5;
-    double t7 = P(0, 2) * P(1, 5);
-    double t8 = P(0, 5) * P(1, 2);
-    double t9 = t7 + t8;
-    double t10 = P(0, 1) * P(1, 5);
-    double t11 = P(0, 4) * P(1, 2);
-    double t12 = t10 + t11;
-    double t13 = P(0, 2) * P(1, 4);
-    double t14 = P(0, 5) * P(1, 1);
-    double t15 = t13 + t14;
-    double t16 = P(2, 1) * P(2, 5);
-    double t17 = P(2, 2) * P(2, 4);
-    double t18 = t16 + t17;
-    double t19 = P(2, 4) * P(2, 4);
-    double t20 = P(2, 5) * P(2, 5);
-    double a31 = P(0, 0) * P(1, 1) + P(0, 1) * P(1, 0) - P(2, 0) * P(2, 1) * 2.0 - P(0, 1) * t2 - P(1, 1) * t3 - P(2, 2) * t2 * 2.0 + (P(0, 1) * P(0, 1)) * P(1, 1) + P(0, 2) * P(1, 1) * P(1, 2) + P(0, 1) * P(1, 2) * P(2, 1) + P(0, 2) * P(1, 1) * P(2, 1);
-    double a32 = P(0, 0) * P(1, 4) + P(0, 1) * P(1, 3) + P(0, 3) * P(1, 1) + P(0, 4) * P(1, 0) - P(2, 0) * P(2, 4) * 2.0 - P(2, 1) * P(2, 3) * 2.0 - P(0, 4) * t2 + P(0, 1) * t6 - P(1, 4) * t3 + P(1, 1) * t9 + P(2, 1) * t12 + P(2, 1) * t15 - P(2, 1) * t18 * 2.0 + P(0, 1) * P(0, 4) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 4) + P(0, 1) * P(1, 2) * P(2, 4) + P(0, 2) * P(1, 1) * P(2, 4) - P(0, 1) * P(2, 1) * P(2, 4) * 2.0 - P(1, 1) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 4) * 2.0;
-    double a33 = P(0, 1) * P(1, 6) + P(0, 3) * P(1, 4) + P(0, 4) * P(1, 3) + P(0, 6) * P(1, 1) - P(2, 1) * P(2, 6) * 2.0 - P(2, 3) * P(2, 4) * 2.0 + P(0, 4) * t6 - P(0, 1) * t19 + P(1, 4) * t9 - P(1, 1) * t20 + P(2, 4) * t12 + P(2, 4) * t15 - P(2, 4) * t18 * 2.0 + P(0, 1) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 1) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 1) + P(0, 5) * P(1, 4) * P(2, 1) - P(0, 4) * P(2, 1) * P(2, 4) * 2.0 - P(1, 4) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 4) * P(2, 5) * 2.0;
-    double a34 = P(0, 4) * P(1, 6) + P(0, 6) * P(1, 4) - P(2, 4) * P(2, 6) * 2.0 - P(0, 4) * t19 - P(1, 4) * t20 - P(2, 5) * t19 * 2.0 + (P(0, 4) * P(0, 4)) * P(1, 4) + P(0, 5) * P(1, 4) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 4) + P(0, 5) * P(1, 4) * P(2, 4);
-    double a35 = P(0, 0) * P(1, 2) + P(0, 2) * P(1, 0) - P(2, 0) * P(2, 2) * 2.0 - P(0, 2) * t2 - P(1, 2) * t3 - P(2, 1) * t3 * 2.0 + P(0, 2) * (P(1, 2) * P(1, 2)) + P(0, 1) * P(0, 2) * P(1, 1) + P(0, 1) * P(1, 2) * P(2, 2) + P(0, 2) * P(1, 1) * P(2, 2);
-    double a36 = P(0, 0) * P(1, 5) + P(0, 2) * P(1, 3) + P(0, 3) * P(1, 2) + P(0, 5) * P(1, 0) - P(2, 0) * P(2, 5) * 2.0 - P(2, 2) * P(2, 3) * 2.0 - P(0, 5) * t2 + P(0, 2) * t6 - P(1, 5) * t3 + P(1, 2) * t9 + P(2, 2) * t12 + P(2, 2) * t15 - P(2, 2) * t18 * 2.0 + P(0, 1) * P(0, 5) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 5) + P(0, 1) * P(1, 2) * P(2, 5) + P(0, 2) * P(1, 1) * P(2, 5) - P(0, 2) * P(2, 1) * P(2, 4) * 2.0 - P(1, 2) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 5) * 2.0;
-    double a37 = P(0, 2) * P(1, 6) + P(0, 3) * P(1, 5) + P(0, 5) * P(1, 3) + P(0, 6) * P(1, 2) - P(2, 2) * P(2, 6) * 2.0 - P(2, 3) * P(2, 5) * 2.0 + P(0, 5) * t6 - P(0, 2) * t19 + P(1, 5) * t9 - P(1, 2) * t20 + P(2, 5) * t12 + P(2, 5) * t15 - P(2, 5) * t18 * 2.0 + P(0, 2) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 2) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 2) + P(0, 5) * P(1, 4) * P(2, 2) - P(0, 5) * P(2, 1) * P(2, 4) * 2.0 - P(1, 5) * P(2, 2) * P(2, 5) * 2.0 - P(2, 2) * P(2, 4) * P(2, 5) * 2.0;
-    double a38 = P(0, 5) * P(1, 6) + P(0, 6) * P(1, 5) - P(2, 5) * P(2, 6) * 2.0 - P(0, 5) * t19 - P(1, 5) * t20 - P(2, 4) * t20 * 2.0 + P(0, 5) * (P(1, 5) * P(1, 5)) + P(0, 4) * P(0, 5) * P(1, 4) + P(0, 4) * P(1, 5) * P(2, 5) + P(0, 5) * P(1, 4) * P(2, 5);
-    double a39 = P(0, 0) * P(1, 0) - P(0, 0) * t2 - P(1, 0) * t3 - P(2, 0) * P(2, 0) + P(0, 0) * P(0, 1) * P(1, 1) + P(0, 2) * P(1, 0) * P(1, 2) + P(0, 1) * P(1, 2) * P(2, 0) + P(0, 2) * P(1, 1) * P(2, 0) - P(2, 0) * P(2, 1) * P(2, 2) * 2.0;
-    double a310 = P(0, 0) * P(1, 3) + P(0, 3) * P(1, 0) - P(2, 0) * P(2, 3) * 2.0 - P(0, 3) * t2 + P(0, 0) * t6 - P(1, 3) * t3 + P(1, 0) * t9 + P(2, 0) * t12 + P(2, 0) * t15 - P(2, 0) * t18 * 2.0 + P(0, 1) * P(0, 3) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 3) + P(0, 1) * P(1, 2) * P(2, 3) + P(0, 2) * P(1, 1) * P(2, 3) - P(0, 0) * P(2, 1) * P(2, 4) * 2.0 - P(1, 0) * P(2, 2) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 3) * 2.0;
-    double a311 = P(0, 0) * P(1, 6) + P(0, 3) * P(1, 3) + P(0, 6) * P(1, 0) - P(2, 0) * P(2, 6) * 2.0 - P(0, 6) * t2 + P(0, 3) * t6 - P(0, 0) * t19 - P(1, 6) * t3 + P(1, 3) * t9 - P(1, 0) * t20 + P(2, 3) * t12 + P(2, 3) * t15 - P(2, 3) * t18 * 2.0 - P(2, 3) * P(2, 3) + P(0, 0) * P(0, 4) * P(1, 4) + P(0, 1) * P(0, 6) * P(1, 1) + P(0, 2) * P(1, 2) * P(1, 6) + P(0, 5) * P(1, 0) * P(1, 5) + P(0, 1) * P(1, 2) * P(2, 6) + P(0, 2) * P(1, 1) * P(2, 6) + P(0, 4) * P(1, 5) * P(2, 0) + P(0, 5) * P(1, 4) * P(2, 0) - P(0, 3) * P(2, 1) * P(2, 4) * 2.0 - P(1, 3) * P(2, 2) * P(2, 5) * 2.0 - P(2, 0) * P(2, 4) * P(2, 5) * 2.0 - P(2, 1) * P(2, 2) * P(2, 6) * 2.0;
-    double a312 = P(0, 3) * P(1, 6) + P(0, 6) * P(1, 3) - P(2, 3) * P(2, 6) * 2.0 + P(0, 6) * t6 - P(0, 3) * t19 + P(1, 6) * t9 - P(1, 3) * t20 + P(2, 6) * t12 + P(2, 6) * t15 - P(2, 6) * t18 * 2.0 + P(0, 3) * P(0, 4) * P(1, 4) + P(0, 5) * P(1, 3) * P(1, 5) + P(0, 4) * P(1, 5) * P(2, 3) + P(0, 5) * P(1, 4) * P(2, 3) - P(0, 6) * P(2, 1) * P(2, 4) * 2.0 - P(1, 6) * P(2, 2) * P(2, 5) * 2.0 - P(2, 3) * P(2, 4) * P(2, 5) * 2.0;
-    double a313 = P(0, 6) * P(1, 6) - P(0, 6) * t19 - P(1, 6) * t20 - P(2, 6) * P(2, 6) + P(0, 4) * P(0, 6) * P(1, 4) + P(0, 5) * P(1, 5) * P(1, 6) + P(0, 4) * P(1, 5) * P(2, 6) + P(0, 5) * P(1, 4) * P(2, 6) - P(2, 4) * P(2, 5) * P(2, 6) * 2.0;
-
-    // det(M(x))
-    double c[9];
-    c[8] = a14 * a27 * a31 - a17 * a24 * a31 - a11 * a27 * a35 + a17 * a21 * a35 + a11 * a24 * a39 - a14 * a21 * a39;
-    c[7] = a14 * a27 * a32 + a14 * a28 * a31 + a15 * a27 * a31 - a17 * a24 * a32 - a17 * a25 * a31 - a18 * a24 * a31 - a11 * a27 * a36 - a11 * a28 * a35 - a12 * a27 * a35 + a17 * a21 * a36 + a17 * a22 * a35 + a18 * a21 * a35 + a11 * a25 * a39 + a12 * a24 * a39 - a14 * a22 * a39 - a15 * a21 * a39 + a11 * a24 * a310 - a14 * a21 * a310;
-    c[6] = a14 * a27 * a33 + a14 * a28 * a32 + a14 * a29 * a31 + a15 * a27 * a32 + a15 * a28 * a31 + a16 * a27 * a31 - a17 * a24 * a33 - a17 * a25 * a32 - a17 * a26 * a31 - a18 * a24 * a32 - a18 * a25 * a31 - a19 * a24 * a31 - a11 * a27 * a37 - a11 * a28 * a36 - a11 * a29 * a35 - a12 * a27 * a36 - a12 * a28 * a35 - a13 * a27 * a35 + a17 * a21 * a37 + a17 * a22 * a36 + a17 * a23 * a35 + a18 * a21 * a36 + a18 * a22 * a35 + a19 * a21 * a35 + a11 * a26 * a39 + a12 * a25 * a39 + a13 * a24 * a39 - a14 * a23 * a39 - a15 * a22 * a39 - a16 * a21 * a39 + a11 * a24 * a311 + a11 * a25 * a310 + a12 * a24 * a310 - a14 * a21 * a311 - a14 * a22 * a310 - a15 * a21 * a310;
-    c[5] = a14 * a27 * a34 + a14 * a28 * a33 + a14 * a29 * a32 + a15 * a27 * a33 + a15 * a28 * a32 + a15 * a29 * a31 + a16 * a27 * a32 + a16 * a28 * a31 - a17 * a24 * a34 - a17 * a25 * a33 - a17 * a26 * a32 - a18 * a24 * a33 - a18 * a25 * a32 - a18 * a26 * a31 - a19 * a24 * a32 - a19 * a25 * a31 - a11 * a27 * a38 - a11 * a28 * a37 - a11 * a29 * a36 - a12 * a27 * a37 - a12 * a28 * a36 - a12 * a29 * a35 - a13 * a27 * a36 - a13 * a28 * a35 + a17 * a21 * a38 + a17 * a22 * a37 + a17 * a23 * a36 + a18 * a21 * a37 + a18 * a22 * a36 + a18 * a23 * a35 + a19 * a21 * a36 + a19 * a22 * a35 + a12 * a26 * a39 + a13 * a25 * a39 - a15 * a23 * a39 - a16 * a22 * a39 - a24 * a31 * a110 + a21 * a35 * a110 + a14 * a31 * a210 - a11 * a35 * a210 + a11 * a24 * a312 + a11 * a25 * a311 + a11 * a26 * a310 + a12 * a24 * a311 + a12 * a25 * a310 + a13 * a24 * a310 - a14 * a21 * a312 - a14 * a22 * a311 - a14 * a23 * a310 - a15 * a21 * a311 - a15 * a22 * a310 - a16 * a21 * a310;
-    c[4] = a14 * a28 * a34 + a14 * a29 * a33 + a15 * a27 * a34 + a15 * a28 * a33 + a15 * a29 * a32 + a16 * a27 * a33 + a16 * a28 * a32 + a16 * a29 * a31 - a17 * a25 * a34 - a17 * a26 * a33 - a18 * a24 * a34 - a18 * a25 * a33 - a18 * a26 * a32 - a19 * a24 * a33 - a19 * a25 * a32 - a19 * a26 * a31 - a11 * a28 * a38 - a11 * a29 * a37 - a12 * a27 * a38 - a12 * a28 * a37 - a12 * a29 * a36 - a13 * a27 * a37 - a13 * a28 * a36 - a13 * a29 * a35 + a17 * a22 * a38 + a17 * a23 * a37 + a18 * a21 * a38 + a18 * a22 * a37 + a18 * a23 * a36 + a19 * a21 * a37 + a19 * a22 * a36 + a19 * a23 * a35 + a13 * a26 * a39 - a16 * a23 * a39 - a24 * a32 * a110 - a25 * a31 * a110 + a21 * a36 * a110 + a22 * a35 * a110 + a14 * a32 * a210 + a15 * a31 * a210 - a11 * a36 * a210 - a12 * a35 * a210 + a11 * a24 * a313 + a11 * a25 * a312 + a11 * a26 * a311 + a12 * a24 * a312 + a12 * a25 * a311 + a12 * a26 * a310 + a13 * a24 * a311 + a13 * a25 * a310 - a14 * a21 * a313 - a14 * a22 * a312 - a14 * a23 * a311 - a15 * a21 * a312 - a15 * a22 * a311 - a15 * a23 * a310 - a16 * a21 * a311 - a16 * a22 * a310;
-    c[3] = a14 * a29 * a34 + a15 * a28 * a34 + a15 * a29 * a33 + a16 * a27 * a34 + a16 * a28 * a33 + a16 * a29 * a32 - a17 * a26 * a34 - a18 * a25 * a34 - a18 * a26 * a33 - a19 * a24 * a34 - a19 * a25 * a33 - a19 * a26 * a32 - a11 * a29 * a38 - a12 * a28 * a38 - a12 * a29 * a37 - a13 * a27 * a38 - a13 * a28 * a37 - a13 * a29 * a36 + a17 * a23 * a38 + a18 * a22 * a38 + a18 * a23 * a37 + a19 * a21 * a38 + a19 * a22 * a37 + a19 * a23 * a36 - a24 * a33 * a110 - a25 * a32 * a110 - a26 * a31 * a110 + a21 * a37 * a110 + a22 * a36 * a110 + a23 * a35 * a110 + a14 * a33 * a210 + a15 * a32 * a210 + a16 * a31 * a210 - a11 * a37 * a210 - a12 * a36 * a210 - a13 * a35 * a210 + a11 * a25 * a313 + a11 * a26 * a312 + a12 * a24 * a313 + a12 * a25 * a312 + a12 * a26 * a311 + a13 * a24 * a312 + a13 * a25 * a311 + a13 * a26 * a310 - a14 * a22 * a313 - a14 * a23 * a312 - a15 * a21 * a313 - a15 * a22 * a312 - a15 * a23 * a311 - a16 * a21 * a312 - a16 * a22 * a311 - a16 * a23 * a310;
-    c[2] = a15 * a29 * a34 + a16 * a28 * a34 + a16 * a29 * a33 - a18 * a26 * a34 - a19 * a25 * a34 - a19 * a26 * a33 - a12 * a29 * a38 - a13 * a28 * a38 - a13 * a29 * a37 + a18 * a23 * a38 + a19 * a22 * a38 + a19 * a23 * a37 - a24 * a34 * a110 - a25 * a33 * a110 - a26 * a32 * a110 + a21 * a38 * a110 + a22 * a37 * a110 + a23 * a36 * a110 + a14 * a34 * a210 + a15 * a33 * a210 + a16 * a32 * a210 - a11 * a38 * a210 - a12 * a37 * a210 - a13 * a36 * a210 + a11 * a26 * a313 + a12 * a25 * a313 + a12 * a26 * a312 + a13 * a24 * a313 + a13 * a25 * a312 + a13 * a26 * a311 - a14 * a23 * a313 - a15 * a22 * a313 - a15 * a23 * a312 - a16 * a21 * a313 - a16 * a22 * a312 - a16 * a23 * a311;
-    c[1] = a16 * a29 * a34 - a19 * a26 * a34 - a13 * a29 * a38 + a19 * a23 * a38 - a25 * a34 * a110 - a26 * a33 * a110 + a22 * a38 * a110 + a23 * a37 * a110 + a15 * a34 * a210 + a16 * a33 * a210 - a12 * a38 * a210 - a13 * a37 * a210 + a12 * a26 * a313 + a13 * a25 * a313 + a13 * a26 * a312 - a15 * a23 * a313 - a16 * a22 * a313 - a16 * a23 * a312;
-    c[0] = -a26 * a34 * a110 + a23 * a38 * a110 + a16 * a34 * a210 - a13 * a38 * a210 + a13 * a26 * a313 - a16 * a23 * a313;
+    double a1[10], a2[10], a3[13], c[9];
+    elimination_polynomial(P, a1, a2, a3, c);
 
     double roots[8];
 
@@ -270,9 +299,9 @@ int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8
         double xs3 = xs1 * xs2;
         double xs4 = xs1 * xs3;
 
-        A << a11 * xs2 + a12 * xs1 + a13, a14 * xs2 + a15 * xs1 + a16, a17 * xs3 + a18 * xs2 + a19 * xs1 + a110,
-            a21 * xs2 + a22 * xs1 + a23, a24 * xs2 + a25 * xs1 + a26, a27 * xs3 + a28 * xs2 + a29 * xs1 + a210,
-            a31 * xs3 + a32 * xs2 + a33 * xs1 + a34, a35 * xs3 + a36 * xs2 + a37 * xs1 + a38, a39 * xs4 + a310 * xs3 + a311 * xs2 + a312 * xs1 + a313;
+        A << a1[0] * xs2 + a1[1] * xs1 + a1[2], a1[3] * xs2 + a1[4] * xs1 + a1[5], a1[6] * xs3 + a1[7] * xs2 + a1[8] * xs1 + a1[9],
+            a2[0] * xs2 + a2[1] * xs1 + a2[2], a2[3] * xs2 + a2[4] * xs1 + a2[5], a2[6] * xs3 + a2[7] * xs2 + a2[8] * xs1 + a2[9],
+            a3[0] * xs3 + a3[1] * xs2 + a3[2] * xs1 + a3[3], a3[4] * xs3 + a3[5] * xs2 + a3[6] * xs1 + a3[7], a3[8] * xs4 + a3[9] * xs3 + a3[10] * xs2 + a3[11] * xs1 + a3[12];
 
         (*solutions)(0, i) = xs1;
         (*solutions)(1, i) = (A(1, 2) * A(0, 1) - A(0, 2) * A(1, 1)) / (A(0, 0) * A(1, 1) - A(1, 0) * A(0, 1));
@@ -289,8 +318,211 @@ int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8
     return n_roots;
 }
 
-inline int re3q3_rotation_impl(Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, bool try_random_var_change) {
-    Eigen::Quaterniond q0 = Eigen::Quaterniond::UnitRandom();
+namespace {
+
+using batch::Lanes;
+using batch::Mask;
+
+inline Lanes det3x3(const Lanes A[3][3]) {
+    Lanes d = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1]);
+    d -= A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0]);
+    d += A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+    return d;
+}
+
+// Lane-wise version of refine_3q3 for the k-th solution, only the lanes in active are updated.
+inline void refine_3q3_lanes(const Lanes C[3][10], Lanes sol[3], Mask active) {
+    Lanes r[3], J[3][3], Jinv[3][3];
+    const Lanes tol = Lanes::Constant(1e-8);
+    for (int iter = 0; iter < 5; ++iter) {
+        const Lanes &x = sol[0];
+        const Lanes &y = sol[1];
+        const Lanes &z = sol[2];
+        const Lanes xx = x * x, xy = x * y, xz = x * z, yy = y * y, yz = y * z, zz = z * z;
+
+        Lanes max_res = Lanes::Zero();
+        for (int i = 0; i < 3; ++i) {
+            r[i] = C[i][0] * xx;
+            r[i] += C[i][1] * xy;
+            r[i] += C[i][2] * xz;
+            r[i] += C[i][3] * yy;
+            r[i] += C[i][4] * yz;
+            r[i] += C[i][5] * zz;
+            r[i] += C[i][6] * x;
+            r[i] += C[i][7] * y;
+            r[i] += C[i][8] * z;
+            r[i] += C[i][9];
+            max_res = max_res.max(r[i].abs());
+        }
+        active = batch::logical_and(active, batch::logical_not(batch::less(max_res, tol)));
+        if (!batch::any(active)) {
+            break;
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            J[i][0] = 2.0 * C[i][0] * x + C[i][1] * y + C[i][2] * z + C[i][6];
+            J[i][1] = C[i][1] * x + 2.0 * C[i][3] * y + C[i][4] * z + C[i][7];
+            J[i][2] = C[i][2] * x + C[i][4] * y + 2.0 * C[i][5] * z + C[i][8];
+        }
+        batch::inverse3x3(J, Jinv);
+
+        for (int i = 0; i < 3; ++i) {
+            Lanes dx = Jinv[i][0] * r[0];
+            dx += Jinv[i][1] * r[1];
+            dx += Jinv[i][2] * r[2];
+            sol[i] = batch::select(active, sol[i] - dx, sol[i]);
+        }
+    }
+}
+
+// Solves LANES systems starting at row start, following re3q3 above. The lanes where the elimination is
+// poorly conditioned are marked in degenerate (these would use the random change of variables in re3q3).
+void re3q3_lanes(const Eigen::Matrix<double, Eigen::Dynamic, 30> &coeffs, int start, Lanes sols[8][3], int n_roots[batch::LANES],
+                 Mask &degenerate) {
+    Lanes C[3][10];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            C[i][j] = batch::load(coeffs, 3 * j + i, start);
+        }
+    }
+
+    // Column orders for eliminating x, y and z respectively. The first three columns form the matrices Ax, Ay and Az.
+    static const int order[3][10] = {{3, 5, 4, 0, 1, 2, 6, 7, 8, 9},
+                                     {0, 5, 2, 3, 1, 4, 7, 6, 8, 9},
+                                     {3, 0, 1, 5, 4, 2, 8, 7, 6, 9}};
+
+    Lanes Ax[3][3], Ay[3][3], Az[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Ax[i][j] = C[i][order[0][j]];
+            Ay[i][j] = C[i][order[1][j]];
+            Az[i][j] = C[i][order[2][j]];
+        }
+    }
+
+    // We check det(A) as a cheaper proxy for condition number
+    const Lanes detx = det3x3(Ax).abs();
+    const Lanes dety = det3x3(Ay).abs();
+    const Lanes detz = det3x3(Az).abs();
+    const Mask elim_y0 = batch::less(detx, dety);
+    Lanes det = batch::select(elim_y0, dety, detx);
+    const Mask elim_z = batch::less(det, detz);
+    const Mask elim_y = batch::logical_and(elim_y0, batch::logical_not(elim_z));
+    det = batch::select(elim_z, detz, det);
+    degenerate = batch::less(det, Lanes::Constant(1e-10));
+
+    Lanes A[3][3], Ainv[3][3], B[3][7];
+    batch::Value P[3][7];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            A[i][j] = batch::select(elim_z, Az[i][j], batch::select(elim_y, Ay[i][j], Ax[i][j]));
+        }
+        for (int j = 0; j < 7; ++j) {
+            B[i][j] = batch::select(elim_z, C[i][order[2][j + 3]], batch::select(elim_y, C[i][order[1][j + 3]], C[i][order[0][j + 3]]));
+        }
+    }
+    batch::inverse3x3(A, Ainv);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 7; ++j) {
+            Lanes Pij = Ainv[i][0] * B[0][j];
+            Pij += Ainv[i][1] * B[1][j];
+            Pij += Ainv[i][2] * B[2][j];
+            P[i][j] = -Pij;
+        }
+    }
+
+    batch::Value a1[10], a2[10], a3[13], c_val[9];
+    elimination_polynomial(batch::MatrixView<7, batch::Value>{P}, a1, a2, a3, c_val);
+
+    Lanes c[9], roots[8];
+    for (int k = 0; k < 9; ++k) {
+        c[k] = c_val[k];
+    }
+    for (int k = 0; k < 8; ++k) {
+        roots[k].setZero();
+    }
+    sturm::bisect_sturm_lanes<8>(c, roots, n_roots);
+
+    for (int k = 0; k < 8; ++k) {
+        const batch::Value xs1 = roots[k];
+        const batch::Value xs2 = xs1 * xs1;
+        const batch::Value xs3 = xs1 * xs2;
+
+        // Only the first two rows of M(x) are needed
+        const batch::Value m00 = a1[0] * xs2 + a1[1] * xs1 + a1[2];
+        const batch::Value m01 = a1[3] * xs2 + a1[4] * xs1 + a1[5];
+        const batch::Value m02 = a1[6] * xs3 + a1[7] * xs2 + a1[8] * xs1 + a1[9];
+        const batch::Value m10 = a2[0] * xs2 + a2[1] * xs1 + a2[2];
+        const batch::Value m11 = a2[3] * xs2 + a2[4] * xs1 + a2[5];
+        const batch::Value m12 = a2[6] * xs3 + a2[7] * xs2 + a2[8] * xs1 + a2[9];
+
+        const Lanes ys = (m12 * m01 - m02 * m11).v / (m00 * m11 - m10 * m01).v;
+        const Lanes zs = (m12 * m00 - m02 * m10).v / (m01 * m10 - m11 * m00).v;
+
+        // Undo the reordering of the variables
+        sols[k][0] = batch::select(elim_y, ys, batch::select(elim_z, zs, roots[k]));
+        sols[k][1] = batch::select(elim_y, roots[k], ys);
+        sols[k][2] = batch::select(elim_z, roots[k], zs);
+    }
+
+    for (int k = 0; k < 8; ++k) {
+        Lanes has_root;
+        for (int lane = 0; lane < batch::LANES; ++lane) {
+            has_root(lane) = k < n_roots[lane];
+        }
+        const Mask active = batch::greater(has_root, Lanes::Zero());
+        if (!batch::any(active)) {
+            break;
+        }
+        refine_3q3_lanes(C, sols[k], active);
+    }
+}
+
+} // namespace
+
+void re3q3_batch(const Eigen::Matrix<double, Eigen::Dynamic, 30> &coeffs, Eigen::Matrix<double, Eigen::Dynamic, 24> *solutions,
+                 Eigen::VectorXi *num_solutions, const Re3q3Options &options) {
+    POSELIB_DISPATCH(re3q3_batch, (coeffs, solutions, num_solutions, options))
+    const int n_instances = coeffs.rows();
+    solutions->resize(n_instances, 24);
+    num_solutions->resize(n_instances);
+
+    Lanes sols[8][3];
+    int n_roots[batch::LANES];
+    Mask degenerate;
+    for (int start = 0; start < n_instances; start += batch::LANES) {
+        re3q3_lanes(coeffs, start, sols, n_roots, degenerate);
+
+        const int n_lanes = std::min(batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            const int instance = start + lane;
+            if (options.try_random_var_change && batch::test(degenerate, lane)) {
+                // The random change of variables is rare, so we fall back to the scalar solver for these.
+                Eigen::Matrix<double, 3, 10> C;
+                for (int j = 0; j < 30; ++j) {
+                    C(j) = coeffs(instance, j);
+                }
+                Eigen::Matrix<double, 3, 8> scalar_sols;
+                const int n_sols = re3q3(C, &scalar_sols, options);
+                for (int k = 0; k < n_sols; ++k) {
+                    solutions->block<1, 3>(instance, 3 * k) = scalar_sols.col(k).transpose();
+                }
+                (*num_solutions)(instance) = n_sols;
+                continue;
+            }
+
+            for (int k = 0; k < n_roots[lane]; ++k) {
+                for (int i = 0; i < 3; ++i) {
+                    (*solutions)(instance, 3 * k + i) = sols[k][i](lane);
+                }
+            }
+            (*num_solutions)(instance) = n_roots[lane];
+        }
+    }
+}
+
+inline int re3q3_rotation_impl(Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, const Re3q3Options &options) {
+    Eigen::Quaterniond q0 = random_unit_quaternion(random_engine(options));
     Eigen::Matrix3d R0 = q0.toRotationMatrix();
     Rcoeffs.block<3, 3>(0, 0) = Rcoeffs.block<3, 3>(0, 0) * R0;
     Rcoeffs.block<3, 3>(0, 3) = Rcoeffs.block<3, 3>(0, 3) * R0;
@@ -300,7 +532,7 @@ inline int re3q3_rotation_impl(Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Mat
     rotation_to_3q3(Rcoeffs, &coeffs);
 
     Eigen::Matrix<double, 3, 8> solutions_cayley;
-    int n_sols = re3q3(coeffs, &solutions_cayley, try_random_var_change);
+    int n_sols = re3q3(coeffs, &solutions_cayley, options);
 
     for (int i = 0; i < n_sols; ++i) {
         Eigen::Quaterniond q{1.0, solutions_cayley(0,i), solutions_cayley(1,i), solutions_cayley(2,i)};
@@ -311,15 +543,15 @@ inline int re3q3_rotation_impl(Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Mat
     return n_sols;
 }
 
-int re3q3_rotation(const Eigen::Matrix<double, 3, 9>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, bool try_random_var_change) {
+int re3q3_rotation(const Eigen::Matrix<double, 3, 9>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, const Re3q3Options &options) {
     Eigen::Matrix<double, 3, 10> Rcoeffs_copy;
     Rcoeffs_copy.block<3, 9>(0, 0) = Rcoeffs;
     Rcoeffs_copy.block<3, 1>(0, 9).setZero();
-    return re3q3_rotation_impl(Rcoeffs_copy, solutions, try_random_var_change);
+    return re3q3_rotation_impl(Rcoeffs_copy, solutions, options);
 }
-int re3q3_rotation(const Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, bool try_random_var_change) {
+int re3q3_rotation(const Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, const Re3q3Options &options) {
     Eigen::Matrix<double, 3, 10> Rcoeffs_copy = Rcoeffs;
-    return re3q3_rotation_impl(Rcoeffs_copy, solutions, try_random_var_change);
+    return re3q3_rotation_impl(Rcoeffs_copy, solutions, options);
 }
 
 } // namespace re3q3
@@ -27,19 +27,51 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 #include <Eigen/Dense>
+#include <random>
 
 namespace pose_lib {
 namespace re3q3 {
 
+// Generator used for the random changes of variables in re3q3 and re3q3_rotation.
+typedef std::mt19937 RandomEngine;
+
+// Returns the generator of the calling thread. Each thread has its own generator, which is seeded with
+// RandomEngine::default_seed the first time it is used, so the solvers do not share any state between threads
+// and repeated runs of the same thread give the same results.
+RandomEngine &thread_random_engine();
+
+// Re-seeds the generator of the calling thread.
+void seed_thread_random_engine(RandomEngine::result_type seed);
+
+struct Re3q3Options {
+    // Implicit so that the former bool argument try_random_var_change can still be passed directly.
+    Re3q3Options(bool try_random_var_change = true) : try_random_var_change(try_random_var_change), rng(nullptr) {}
+
+    // Whether to do a random change of variables if the elimination is poorly conditioned.
+    bool try_random_var_change;
+    // Generator for the random changes of variables. If nullptr the generator of the calling thread is used.
+    RandomEngine *rng;
+};
+
 /*
     * Re-implementation of E3Q3. Adapted from Jan Heller's original implementation.
     * Added tricks for improving stability based on choosing the elimination variable.
     *  see Zhou et al., A Stable Algebraic Camera Pose Estimation for Minimal Configurations of 2D/3D Point and Line Correspondences, ACCV 2018
     * Additionally we do a random affine change of variables to handle further degeneracies.
+    * The random numbers are drawn from options.rng (or the generator of the calling thread).
     * 
     * Order of coefficients is:  x^2, xy, xz, y^2, yz, z^2, x, y, z, 1.0; *
     */
-int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions, bool try_random_var_change = true);
+int re3q3(const Eigen::Matrix<double, 3, 10> &coeffs, Eigen::Matrix<double, 3, 8> *solutions, const Re3q3Options &options = Re3q3Options());
+
+/*
+    * Solves many 3Q3 problems at once, processing several problems in parallel using SIMD.
+    * Row i holds the coefficients of problem i stored column-major, i.e. coeffs.row(i) = [C.col(0)' ... C.col(9)']
+    * where C is the 3x10 coefficient matrix passed to re3q3. The solutions of problem i are stored consecutively
+    * as [x y z] triplets in the first 3 * (*num_solutions)(i) entries of solutions->row(i).
+    */
+void re3q3_batch(const Eigen::Matrix<double, Eigen::Dynamic, 30> &coeffs, Eigen::Matrix<double, Eigen::Dynamic, 24> *solutions,
+                 Eigen::VectorXi *num_solutions, const Re3q3Options &options = Re3q3Options());
 
 // Helper functions for setting up 3Q3 problems
 
@@ -58,11 +90,12 @@ void cayley_param(const Eigen::Matrix<double, 3, 1> &c, Eigen::Matrix<double, 3,
 
 /*
     Helper functions which performs a random rotation to avoid the degeneracy with cayley transform.
+    The random rotation is drawn from options.rng (or the generator of the calling thread).
     The solutions matrix is 4x8 and contains quaternions. To get back rotation matrices you can use
         Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
 */
-int re3q3_rotation(const Eigen::Matrix<double, 3, 9>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, bool try_random_var_change = true);
-int re3q3_rotation(const Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, bool try_random_var_change = true);
+int re3q3_rotation(const Eigen::Matrix<double, 3, 9>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, const Re3q3Options &options = Re3q3Options());
+int re3q3_rotation(const Eigen::Matrix<double, 3, 10>& Rcoeffs, Eigen::Matrix<double, 4, 8>* solutions, const Re3q3Options &options = Re3q3Options());
 
 } // namespace re3q3
 } // namespace pose_lib
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "../types.h"
+#include <Eigen/Dense>
+#include <cmath>
+
+namespace pose_lib {
+namespace rotation {
+
+// Helpers for writing the rotation of either a CameraPoseT or a CompactPoseT, such that the solvers which support
+// both output types only need to be implemented once. For CompactPoseT the rotation matrix is never formed.
+
+// Sets the rotation from a unit quaternion given in Eigen's coefficient order (x, y, z, w), e.g. from re3q3_rotation.
+template <typename Real, typename Derived>
+inline void set_quaternion(const Eigen::MatrixBase<Derived> &q, CameraPoseT<Real> *pose) {
+    pose->R = Eigen::Quaternion<Real>(q).toRotationMatrix();
+}
+
+template <typename Real, typename Derived>
+inline void set_quaternion(const Eigen::MatrixBase<Derived> &q, CompactPoseT<Real> *pose) {
+    pose->q = q;
+}
+
+// Sets the rotation around the y-axis (as used by the upright solvers) given by q = tan(theta / 2), i.e.
+//   R = [cq 0 sq; 0 1 0; -sq 0 cq]  with  cq = (1 - q^2) / (1 + q^2), sq = 2 * q / (1 + q^2)
+template <typename Real>
+inline void set_upright(Real q, CameraPoseT<Real> *pose) {
+    const Real q2 = q * q;
+    const Real inv_norm = Real(1) / (1 + q2);
+    const Real cq = (1 - q2) * inv_norm;
+    const Real sq = 2 * q * inv_norm;
+
+    pose->R.setIdentity();
+    pose->R(0, 0) = cq;
+    pose->R(0, 2) = sq;
+    pose->R(2, 0) = -sq;
+    pose->R(2, 2) = cq;
+}
+
+template <typename Real>
+inline void set_upright(Real q, CompactPoseT<Real> *pose) {
+    // The quaternion is (0, sin(theta / 2), 0, cos(theta / 2)) = (0, q, 0, 1) / sqrt(1 + q^2)
+    const Real inv_norm = Real(1) / std::sqrt(1 + q * q);
+    pose->q << Real(0), q * inv_norm, Real(0), inv_norm;
+}
+
+// Returns R * v.
+template <typename Real, typename Derived>
+inline Eigen::Matrix<Real, 3, 1> rotate(const CameraPoseT<Real> &pose, const Eigen::MatrixBase<Derived> &v) {
+    return pose.R * v;
+}
+
+template <typename Real, typename Derived>
+inline Eigen::Matrix<Real, 3, 1> rotate(const CompactPoseT<Real> &pose, const Eigen::MatrixBase<Derived> &v) {
+    return pose.quaternion()._transformVector(v);
+}
+
+} // namespace rotation
+} // namespace pose_lib
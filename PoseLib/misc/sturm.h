@@ -26,6 +26,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
+#include "batch.h"
 #include <algorithm>
 #include <cmath>
 #include <vector>
@@ -38,32 +39,32 @@ namespace pose_lib {
 namespace sturm {
 
 // Constructs the quotients needed for evaluating the sturm sequence.
-template<int N>
-void build_sturm_seq(const double* fvec, double* svec) {
+template <int N, typename Real>
+void build_sturm_seq(const Real* fvec, Real* svec) {
 
-    double f[3 * N];
-    double* f1 = f;
-    double* f2 = f1 + N + 1;
-    double* f3 = f2 + N;
+    Real f[3 * N];
+    Real* f1 = f;
+    Real* f2 = f1 + N + 1;
+    Real* f3 = f2 + N;
 
     std::copy(fvec, fvec + (2 * N + 1), f);
 
     for (int i = 0; i < N - 1; ++i) {
-        const double q1 = f1[N - i] * f2[N - 1 - i];
-        const double q0 = f1[N - 1 - i] * f2[N - 1 - i] - f1[N - i] * f2[N - 2 - i];
+        const Real q1 = f1[N - i] * f2[N - 1 - i];
+        const Real q0 = f1[N - 1 - i] * f2[N - 1 - i] - f1[N - i] * f2[N - 2 - i];
 
         f3[0] = f1[0] - q0 * f2[0];
         for (int j = 1; j < N - 1 - i; ++j) {
             f3[j] = f1[j] - q1 * f2[j - 1] - q0 * f2[j];
         }
-        const double c = -std::abs(f3[N - 2 - i]);
-        const double ci = 1.0 / c;
+        const Real c = -std::abs(f3[N - 2 - i]);
+        const Real ci = Real(1) / c;
         for (int j = 0; j < N - 1 - i; ++j) {
             f3[j] = f3[j] * ci;
         }
 
         // juggle pointers (f1,f2,f3) -> (f2,f3,f1)
-        double* tmp = f1;
+        Real* tmp = f1;
         f1 = f2;
         f2 = f3;
         f3 = tmp;
@@ -80,9 +81,9 @@ void build_sturm_seq(const double* fvec, double* svec) {
 
 // Evaluates polynomial using Horner's method.
 // Assumes that f[N] = 1.0
-template <int N>
-inline double polyval(const double* f, double x) {
-    double fx = x + f[N - 1];
+template <int N, typename Real>
+inline Real polyval(const Real* f, Real x) {
+    Real fx = x + f[N - 1];
     for (int i = N - 2; i >= 0; --i) {
         fx = x * fx + f[i];
     }
@@ -92,19 +93,23 @@ inline double polyval(const double* f, double x) {
 
 
 // Daniel Thul is responsible for this template-trickery :)
-template <int D>
-inline unsigned int flag_negative(const double* const f) {
+template <int D, typename Real>
+inline unsigned int flag_negative(const Real* const f) {
     return ((f[D] < 0) << D) | flag_negative<D - 1>(f);
 }
 template <>
 inline unsigned int  flag_negative<0>(const double* const f) {
     return f[0] < 0;
 }
+template <>
+inline unsigned int  flag_negative<0>(const float* const f) {
+    return f[0] < 0;
+}
 // Evaluates the sturm sequence and counts the number of sign changes
-template <int N, typename std::enable_if<(N<32), void>::type* = nullptr>
-inline int signchanges(const double* svec, double x) {
+template <int N, typename Real, typename std::enable_if<(N<32), void>::type* = nullptr>
+inline int signchanges(const Real* svec, Real x) {
 
-    double f[N + 1];
+    Real f[N + 1];
     f[N] = svec[3 * N - 1];
     f[N - 1] = svec[3 * N - 3] + x * svec[3 * N - 2];
 
@@ -118,10 +123,10 @@ inline int signchanges(const double* svec, double x) {
     return __builtin_popcount((S ^ (S >> 1)) & ~(0xFFFFFFFF << N));
 }
 
-template <int N, typename std::enable_if<(N >= 32), void>::type* = nullptr>
-inline int signchanges(const double* svec, double x) {
+template <int N, typename Real, typename std::enable_if<(N >= 32), void>::type* = nullptr>
+inline int signchanges(const Real* svec, Real x) {
 
-    double f[N + 1];
+    Real f[N + 1];
     f[N] = svec[3 * N - 1];
     f[N - 1] = svec[3 * N - 3] + x * svec[3 * N - 2];
 
@@ -144,37 +149,37 @@ inline int signchanges(const double* svec, double x) {
 
 // Computes the Cauchy bound on the real roots.
 // Experiments with more complicated (expensive) bounds did not seem to have a good trade-off.
-template<int N>
-inline double get_bounds(const double *fvec) {
-    double max = 0;
+template <int N, typename Real>
+inline Real get_bounds(const Real *fvec) {
+    Real max = 0;
     for (int i = 0; i < N; ++i) {
         max = std::max(max, std::abs(fvec[i]));
     }
-    return 1.0 + max;
+    return Real(1) + max;
 }
 
 // Applies Ridder's bracketing method until we get close to root, followed by newton iterations
-template<int N>
-void ridders_method_newton(const double *fvec, double a, double b, double *roots, int &n_roots, double tol) {
-    double fa = polyval<N>(fvec, a);
-    double fb = polyval<N>(fvec, b);
+template <int N, typename Real>
+void ridders_method_newton(const Real *fvec, Real a, Real b, Real *roots, int &n_roots, Real tol) {
+    Real fa = polyval<N>(fvec, a);
+    Real fb = polyval<N>(fvec, b);
 
     if (!((fa < 0) ^ (fb < 0)))
         return;
 
-    const double tol_newton = 1e-3;
+    const Real tol_newton = 1e-3;
 
     for (int iter = 0; iter < 30; ++iter) {
         if (std::abs(a - b) < tol_newton) {
             break;
         }
-        const double c = (a + b) * 0.5;
-        const double fc = polyval<N>(fvec, c);
-        const double s = std::sqrt(fc * fc - fa * fb);
+        const Real c = (a + b) * Real(0.5);
+        const Real fc = polyval<N>(fvec, c);
+        const Real s = std::sqrt(fc * fc - fa * fb);
         if (!s)
             break;
-        const double d = (fa < fb) ? c + (a - c) * fc / s : c + (c - a) * fc / s;
-        const double fd = polyval<N>(fvec, d);
+        const Real d = (fa < fb) ? c + (a - c) * fc / s : c + (c - a) * fc / s;
+        const Real fd = polyval<N>(fvec, d);
 
         if (fd >= 0 ? (fc < 0) : (fc > 0)) {
             a = c;
@@ -191,16 +196,16 @@ void ridders_method_newton(const double *fvec, double a, double b, double *roots
     }
 
     // We switch to Newton's method once we are close to the root
-    double x = (a + b) * 0.5;
+    Real x = (a + b) * Real(0.5);
 
-    double fx, fpx, dx;
-    const double *fpvec = fvec + N+1;
+    Real fx, fpx, dx;
+    const Real *fpvec = fvec + N+1;
     for (int iter = 0; iter < 10; ++iter) {
         fx = polyval<N>(fvec, x);
         if (std::abs(fx) < tol) {
             break;
         }
-        fpx = static_cast<double>(N) * polyval<N-1>(fpvec, x);
+        fpx = static_cast<Real>(N) * polyval<N-1>(fpvec, x);
         dx = fx / fpx;
         x = x - dx;
         if (std::abs(dx) < tol) {
@@ -211,15 +216,15 @@ void ridders_method_newton(const double *fvec, double a, double b, double *roots
     roots[n_roots++] = x;
 }
 
-template<int N>
-void isolate_roots(const double *fvec, const double *svec, double a, double b, int sa, int sb, double *roots, int &n_roots, double tol, int depth) {
+template <int N, typename Real>
+void isolate_roots(const Real *fvec, const Real *svec, Real a, Real b, int sa, int sb, Real *roots, int &n_roots, Real tol, int depth) {
     if (depth > 30)
         return;
 
     int n_rts = sa - sb;
 
     if (n_rts > 1) {
-        double c = (a + b) * 0.5;
+        Real c = (a + b) * Real(0.5);
         int sc = signchanges<N>(svec, c);
         isolate_roots<N>(fvec, svec, a, c, sa, sc, roots, n_roots, tol, depth + 1);
         isolate_roots<N>(fvec, svec, c, b, sc, sb, roots, n_roots, tol, depth + 1);
@@ -228,37 +233,48 @@ void isolate_roots(const double *fvec, const double *svec, double a, double b, i
     }
 }
 
-template<int N>
-inline int bisect_sturm(const double *coeffs, double *roots, double tol = 1e-10) {
+// Default tolerance for the Newton iterations in bisect_sturm. Single precision cannot resolve the roots to 1e-10.
+template <typename Real>
+inline Real default_tolerance() {
+    return Real(1e-10);
+}
+template <>
+inline float default_tolerance<float>() {
+    return 1e-5f;
+}
+
+// Finds the real roots of the polynomial sum_i coeffs[i] * x^i of degree N. Instantiable for Real = double and Real = float.
+template <int N, typename Real>
+inline int bisect_sturm(const Real *coeffs, Real *roots, Real tol = default_tolerance<Real>()) {
     if (coeffs[N] == 0.0)
         return 0; // return bisect_sturm<N-1>(coeffs,roots,tol); // This explodes compile times...
     
 
-    double fvec[2*N+1];
-    double svec[3*N];
+    Real fvec[2*N+1];
+    Real svec[3*N];
 
     // fvec is the polynomial and its first derivative.    
     std::copy(coeffs, coeffs + N + 1, fvec);    
 
     // Normalize w.r.t. leading coeff
-    double c_inv = 1.0 / fvec[N];
+    Real c_inv = Real(1) / fvec[N];
     for (int i = 0; i < N; ++i)
         fvec[i] *= c_inv;
-    fvec[N] = 1.0;
+    fvec[N] = Real(1);
     
     // Compute the derivative with normalized coefficients    
     for (int i = 0; i < N-1; ++i) {
-        fvec[N + 1 + i] = fvec[i + 1] * ((i+1)/ static_cast<double>(N));
+        fvec[N + 1 + i] = fvec[i + 1] * ((i+1)/ static_cast<Real>(N));
     }
-    fvec[2*N] = 1.0;
+    fvec[2*N] = Real(1);
 
     // Compute sturm sequences
     build_sturm_seq<N>(fvec, svec);
 
     // All real roots are in the interval [-r0, r0]
-    double r0 = get_bounds<N>(fvec);
-    double a = -r0;
-    double b = r0;
+    Real r0 = get_bounds<N>(fvec);
+    Real a = -r0;
+    Real b = r0;
 
     int sa = signchanges<N>(svec, a);
     int sb = signchanges<N>(svec, b);
@@ -283,9 +299,307 @@ inline int bisect_sturm<1>(const double* coeffs, double* roots, double tol) {
     }
 }
 
+template<>
+inline int bisect_sturm<1>(const float* coeffs, float* roots, float tol) {
+    if (coeffs[1] == 0.0f) {
+        return 0;
+    } else {
+        roots[0] = -coeffs[0] / coeffs[1];
+        return 1;
+    }
+}
+
 template<>
 inline int bisect_sturm<0>(const double* coeffs, double* roots, double tol) {
     return 0;
 }
+
+template<>
+inline int bisect_sturm<0>(const float* coeffs, float* roots, float tol) {
+    return 0;
+}
+
+// Batched versions of the functions above. These isolate the roots of LANES polynomials (of the same degree) at once.
+// Instead of recursively splitting intervals, the roots are found one at a time in increasing order. For the j-th root
+// we bisect (masked across lanes) until the interval contains exactly that root, followed by Ridders' method and Newton.
+
+template <int N>
+void build_sturm_seq_batch(const batch::Lanes *fvec, batch::Lanes *svec) {
+    batch::Lanes f[3 * N];
+    batch::Lanes *f1 = f;
+    batch::Lanes *f2 = f1 + N + 1;
+    batch::Lanes *f3 = f2 + N;
+
+    std::copy(fvec, fvec + (2 * N + 1), f);
+
+    for (int i = 0; i < N - 1; ++i) {
+        const batch::Lanes q1 = f1[N - i] * f2[N - 1 - i];
+        const batch::Lanes q0 = f1[N - 1 - i] * f2[N - 1 - i] - f1[N - i] * f2[N - 2 - i];
+
+        f3[0] = f1[0] - q0 * f2[0];
+        for (int j = 1; j < N - 1 - i; ++j) {
+            f3[j] = f1[j] - q1 * f2[j - 1] - q0 * f2[j];
+        }
+        const batch::Lanes c = -f3[N - 2 - i].abs();
+        const batch::Lanes ci = c.inverse();
+        for (int j = 0; j < N - 1 - i; ++j) {
+            f3[j] *= ci;
+        }
+
+        // juggle pointers (f1,f2,f3) -> (f2,f3,f1)
+        batch::Lanes *tmp = f1;
+        f1 = f2;
+        f2 = f3;
+        f3 = tmp;
+
+        svec[3 * i] = q0;
+        svec[3 * i + 1] = q1;
+        svec[3 * i + 2] = c;
+    }
+
+    svec[3 * N - 3] = f1[0];
+    svec[3 * N - 2] = f1[1];
+    svec[3 * N - 1] = f2[0];
+}
+
+// Assumes that f[N] = 1.0
+template <int N>
+inline batch::Lanes polyval_batch(const batch::Lanes *f, const batch::Lanes &x) {
+    batch::Lanes fx = x + f[N - 1];
+    for (int i = N - 2; i >= 0; --i) {
+        fx = x * fx + f[i];
+    }
+    return fx;
+}
+
+// Returns the number of sign changes in the sturm sequence (as doubles)
+template <int N>
+inline batch::Lanes signchanges_batch(const batch::Lanes *svec, const batch::Lanes &x) {
+    batch::Lanes f[N + 1];
+    f[N] = svec[3 * N - 1];
+    f[N - 1] = svec[3 * N - 3] + x * svec[3 * N - 2];
+
+    for (int i = N - 2; i >= 0; --i) {
+        f[i] = (svec[3 * i] + x * svec[3 * i + 1]) * f[i + 1] + svec[3 * i + 2] * f[i + 2];
+    }
+
+    batch::Lanes count = batch::Lanes::Zero();
+    batch::Mask neg1 = batch::less(f[0], batch::Lanes::Zero());
+    for (int i = 0; i < N; ++i) {
+        const batch::Mask neg2 = batch::less(f[i + 1], batch::Lanes::Zero());
+        count += batch::select(batch::logical_xor(neg1, neg2), batch::Lanes::Ones(), batch::Lanes::Zero());
+        neg1 = neg2;
+    }
+    return count;
+}
+
+template <int N>
+inline batch::Lanes get_bounds_batch(const batch::Lanes *fvec) {
+    batch::Lanes max = batch::Lanes::Zero();
+    for (int i = 0; i < N; ++i) {
+        max = max.max(fvec[i].abs());
+    }
+    return 1.0 + max;
+}
+
+// Lane-wise version of ridders_method_newton for the lanes in active. Returns the mask of lanes where a root was found.
+template <int N>
+batch::Mask ridders_method_newton_batch(const batch::Lanes *fvec, batch::Lanes a, batch::Lanes b, batch::Mask active,
+                                        batch::Lanes &root, double tol) {
+    using batch::Lanes;
+    using batch::Mask;
+    const Lanes zero = Lanes::Zero();
+
+    Lanes fa = polyval_batch<N>(fvec, a);
+    Lanes fb = polyval_batch<N>(fvec, b);
+
+    active = batch::logical_and(active, batch::logical_xor(batch::less(fa, zero), batch::less(fb, zero)));
+    const Mask found = active;
+
+    const Lanes tol_newton = Lanes::Constant(1e-3);
+
+    for (int iter = 0; iter < 30; ++iter) {
+        active = batch::logical_and(active, batch::logical_not(batch::less((a - b).abs(), tol_newton)));
+        if (!batch::any(active))
+            break;
+
+        const Lanes c = (a + b) * 0.5;
+        const Lanes fc = polyval_batch<N>(fvec, c);
+        const Lanes s = (fc * fc - fa * fb).sqrt();
+        active = batch::logical_and(active, batch::greater(s, zero));
+
+        const Lanes d = c + batch::select(batch::less(fa, fb), a - c, c - a) * fc / s;
+        const Lanes fd = polyval_batch<N>(fvec, d);
+
+        // Same case analysis as in the scalar version
+        const Mask fd_pos = batch::logical_not(batch::less(fd, zero));
+        const Mask case1 = batch::select(fd_pos, batch::less(fc, zero), batch::greater(fc, zero));
+        const Mask case2 = batch::select(fd_pos, batch::less(fa, zero), batch::greater(fa, zero));
+
+        const Lanes new_a = batch::select(case1, c, batch::select(case2, a, d));
+        const Lanes new_fa = batch::select(case1, fc, batch::select(case2, fa, fd));
+        const Mask move_b = batch::logical_or(case1, case2);
+
+        a = batch::select(active, new_a, a);
+        fa = batch::select(active, new_fa, fa);
+        b = batch::select(batch::logical_and(active, move_b), d, b);
+        fb = batch::select(batch::logical_and(active, move_b), fd, fb);
+    }
+
+    // We switch to Newton's method once we are close to the root
+    Lanes x = (a + b) * 0.5;
+    const Lanes *fpvec = fvec + N + 1;
+    const Lanes tol_lanes = Lanes::Constant(tol);
+    active = found;
+    for (int iter = 0; iter < 10; ++iter) {
+        const Lanes fx = polyval_batch<N>(fvec, x);
+        active = batch::logical_and(active, batch::logical_not(batch::less(fx.abs(), tol_lanes)));
+        if (!batch::any(active))
+            break;
+        const Lanes fpx = static_cast<double>(N) * polyval_batch<N - 1>(fpvec, x);
+        const Lanes dx = fx / fpx;
+        x = batch::select(active, x - dx, x);
+        active = batch::logical_and(active, batch::logical_not(batch::less(dx.abs(), tol_lanes)));
+    }
+
+    root = x;
+    return found;
+}
+
+// Lane-wise version of bisect_sturm. The real roots of the polynomial in each lane are stored (in increasing order)
+// in the first n_roots[lane] entries of roots.
+template <int N>
+void bisect_sturm_lanes(const batch::Lanes *coeffs, batch::Lanes *roots, int n_roots[batch::LANES], double tol = 1e-10) {
+    using batch::Lanes;
+    using batch::Mask;
+
+    Lanes fvec[2 * N + 1];
+    Lanes svec[3 * N];
+
+    // Lanes with vanishing leading coefficient have no roots (same as in the scalar version)
+    const Mask degenerate = batch::logical_not(batch::greater(coeffs[N].abs(), Lanes::Zero()));
+
+    // fvec is the polynomial and its first derivative.
+    // Normalize w.r.t. leading coeff
+    const Lanes c_inv = batch::select(degenerate, Lanes::Ones(), coeffs[N]).inverse();
+    for (int i = 0; i < N; ++i)
+        fvec[i] = coeffs[i] * c_inv;
+    fvec[N].setOnes();
+
+    // Compute the derivative with normalized coefficients
+    for (int i = 0; i < N - 1; ++i) {
+        fvec[N + 1 + i] = fvec[i + 1] * ((i + 1) / static_cast<double>(N));
+    }
+    fvec[2 * N].setOnes();
+
+    // Compute sturm sequences
+    build_sturm_seq_batch<N>(fvec, svec);
+
+    // All real roots are in the interval [-r0, r0]
+    const Lanes r0 = get_bounds_batch<N>(fvec);
+    const Lanes sa = signchanges_batch<N>(svec, -r0);
+    const Lanes sb = signchanges_batch<N>(svec, r0);
+    const Lanes total = batch::select(degenerate, Lanes::Zero(), sa - sb);
+
+    for (int k = 0; k < batch::LANES; ++k)
+        n_roots[k] = 0;
+    const int max_roots = static_cast<int>(total.maxCoeff());
+
+    // Interval [lo, hi] such that roots 0, ..., j-1 are <= lo and root j is in (lo, hi]
+    Lanes lo = -r0, s_lo = sa;
+    Lanes next_hi = r0, s_next_hi = sb;
+    for (int j = 0; j < max_roots; ++j) {
+        const Lanes jj = Lanes::Constant(j);
+        const Lanes jj1 = Lanes::Constant(j + 1);
+        const Mask active = batch::less(jj, total);
+
+        Lanes hi = next_hi, s_hi = s_next_hi;
+        next_hi = r0;
+        s_next_hi = sb;
+
+        // Bisect until (lo, hi] contains only the j-th root
+        Mask isolated = batch::logical_and(batch::logical_not(batch::greater(jj, sa - s_lo)),
+                                           batch::logical_not(batch::greater(sa - s_hi, jj1)));
+        for (int depth = 0; depth < 30; ++depth) {
+            const Mask bisect = batch::logical_and(active, batch::logical_not(isolated));
+            if (!batch::any(bisect))
+                break;
+
+            const Lanes c = (lo + hi) * 0.5;
+            const Lanes sc = signchanges_batch<N>(svec, c);
+            const Mask left = batch::logical_and(bisect, batch::greater(sa - sc, jj));
+            const Mask right = batch::logical_and(bisect, batch::logical_not(left));
+
+            // Keep track of the tightest upper bound for the next root
+            const Mask upper = batch::logical_and(left, batch::greater(sa - sc, jj1));
+            next_hi = batch::select(upper, c, next_hi);
+            s_next_hi = batch::select(upper, sc, s_next_hi);
+
+            hi = batch::select(left, c, hi);
+            s_hi = batch::select(left, sc, s_hi);
+            lo = batch::select(right, c, lo);
+            s_lo = batch::select(right, sc, s_lo);
+
+            isolated = batch::logical_and(batch::logical_not(batch::greater(jj, sa - s_lo)),
+                                          batch::logical_not(batch::greater(sa - s_hi, jj1)));
+        }
+        isolated = batch::logical_and(active, isolated);
+
+        Lanes root;
+        const Mask found = ridders_method_newton_batch<N>(fvec, lo, hi, isolated, root, tol);
+        for (int k = 0; k < batch::LANES; ++k) {
+            if (batch::test(found, k)) {
+                roots[n_roots[k]++](k) = root(k);
+            }
+        }
+
+        // Roots 0, ..., j are now <= hi. If we failed to isolate the root we keep lo.
+        lo = batch::select(isolated, hi, lo);
+        s_lo = batch::select(isolated, s_hi, s_lo);
+    }
+}
+
+template <>
+inline void bisect_sturm_lanes<1>(const batch::Lanes *coeffs, batch::Lanes *roots, int n_roots[batch::LANES], double tol) {
+    roots[0] = -coeffs[0] / coeffs[1];
+    for (int k = 0; k < batch::LANES; ++k) {
+        n_roots[k] = (coeffs[1](k) != 0.0);
+    }
+}
+
+template <>
+inline void bisect_sturm_lanes<0>(const batch::Lanes *coeffs, batch::Lanes *roots, int n_roots[batch::LANES], double tol) {
+    for (int k = 0; k < batch::LANES; ++k) {
+        n_roots[k] = 0;
+    }
+}
+
+// Finds the real roots of many polynomials at once. Row i of coeffs holds the coefficients of polynomial i
+// (in increasing degree). Its real roots are stored in the first (*n_roots)(i) entries of roots->row(i).
+template <int N>
+void bisect_sturm_batch(const Eigen::Matrix<double, Eigen::Dynamic, N + 1> &coeffs,
+                        Eigen::Matrix<double, Eigen::Dynamic, N> *roots, Eigen::VectorXi *n_roots, double tol = 1e-10) {
+    const int n_polys = coeffs.rows();
+    roots->resize(n_polys, N);
+    n_roots->resize(n_polys);
+
+    batch::Lanes c[N + 1], r[N > 0 ? N : 1];
+    int n[batch::LANES];
+    for (int start = 0; start < n_polys; start += batch::LANES) {
+        for (int i = 0; i <= N; ++i) {
+            c[i] = batch::load(coeffs, i, start);
+        }
+
+        bisect_sturm_lanes<N>(c, r, n, tol);
+
+        const int n_lanes = std::min(batch::LANES, n_polys - start);
+        for (int k = 0; k < n_lanes; ++k) {
+            (*n_roots)(start + k) = n[k];
+            for (int i = 0; i < n[k]; ++i) {
+                (*roots)(start + k, i) = r[i](k);
+            }
+        }
+    }
+}
 } // namespace sturm
 } // namespace pose_lib
@@ -27,170 +27,135 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "univariate.h"
+#include "univariate_inl.h"
 #include <Eigen/Eigen>
 #include <complex>
 
 namespace pose_lib {
 namespace univariate {
-/* Solves the quadratic equation a*x^2 + b*x + c = 0 */
-void solve_quadratic(double a, double b, double c, std::complex<double> roots[2]) {
 
-    std::complex<double> b2m4ac = b * b - 4 * a * c;
-    std::complex<double> sq = std::sqrt(b2m4ac);
-
-    // Choose sign to avoid cancellations
-    roots[0] = (b > 0) ? (2 * c) / (-b - sq) : (2 * c) / (-b + sq);
-    roots[1] = c / (a * roots[0]);
-}
-
-/* Solves the quadratic equation a*x^2 + b*x + c = 0 */
-int solve_quadratic_real(double a, double b, double c, double roots[2]) {
-
-    double b2m4ac = b * b - 4 * a * c;
-    if (b2m4ac < 0)
-        return 0;
-
-    double sq = std::sqrt(b2m4ac);
-
-    // Choose sign to avoid cancellations
-    roots[0] = (b > 0) ? (2 * c) / (-b - sq) : (2 * c) / (-b + sq);
-    roots[1] = c / (a * roots[0]);
-
-    return 2;
-}
-
-/* Sign of component with largest magnitude */
-inline double sign2(const std::complex<double> z) {
-    if (std::abs(z.real()) > std::abs(z.imag()))
-        return z.real() < 0 ? -1.0 : 1.0;
-    else
-        return z.imag() < 0 ? -1.0 : 1.0;
+template int solve_quadratic_real<double>(double, double, double, double[2]);
+template int solve_quadratic_real<float>(float, float, float, float[2]);
+template void solve_cubic_single_real<double>(double, double, double, double &);
+template void solve_cubic_single_real<float>(float, float, float, float &);
+template int solve_quartic_real<double>(double, double, double, double, double[4]);
+template int solve_quartic_real<float>(float, float, float, float, float[4]);
+
+namespace {
+// Shared implementation of the lane-wise versions below, where L is batch::Lanes or batch::Lanesf.
+template <typename L>
+void solve_cubic_single_real_lanes(const L &c2, const L &c1, const L &c0, L &root) {
+    typedef typename L::Scalar Scalar;
+    const L a = c1 - c2 * c2 / 3.0;
+    const L b = (2.0 * c2 * c2 * c2 - 9.0 * c2 * c1) / 27.0 + c0;
+    const L c = b * b / 4.0 + a * a * a / 27.0;
+    const L one_real = batch::greater(c, L::Zero());
+
+    // Both branches are only evaluated if some lane needs them
+    root = -c2 / 3.0;
+    if (batch::any(one_real)) {
+        const L sq = c.max(0.0).sqrt();
+        const L cbrt_sum = batch::apply(L(-0.5 * b + sq), [](Scalar v) { return std::cbrt(v); }) +
+                           batch::apply(L(-0.5 * b - sq), [](Scalar v) { return std::cbrt(v); });
+        root += batch::select(one_real, cbrt_sum, L::Zero());
+    }
+    if (!batch::all(one_real)) {
+        const L neg_a = (-a).max(0.0);
+        const L cc = (3.0 * b / (2.0 * a) * (3.0 / neg_a).sqrt()).max(-1.0).min(1.0);
+        const L trig = 2.0 * (neg_a / 3.0).sqrt() * batch::apply(cc, [](Scalar v) { return std::cos(std::acos(v) / Scalar(3)); });
+        root += batch::select(one_real, L::Zero(), trig);
+    }
 }
+} // namespace
 
-/* Sign of component with largest magnitude */
-inline double sign(const double z) {
-    return z < 0 ? -1.0 : 1.0;
+void solve_cubic_single_real(const batch::Lanes &c2, const batch::Lanes &c1, const batch::Lanes &c0, batch::Lanes &root) {
+    solve_cubic_single_real_lanes(c2, c1, c0, root);
 }
 
-void solve_cubic_single_real(double c2, double c1, double c0, double &root) {
-    double a = c1 - c2 * c2 / 3.0;
-    double b = (2.0 * c2 * c2 * c2 - 9.0 * c2 * c1) / 27.0 + c0;
-    double c = b * b / 4.0 + a * a * a / 27.0;
-    if (c > 0) {
-        c = std::sqrt(c);
-        b *= -0.5;
-        root = std::cbrt(b + c) + std::cbrt(b - c) - c2 / 3.0;
-    } else {
-        c = 3.0 * b / (2.0 * a) * std::sqrt(-3.0 / a);
-        root = 2.0 * std::sqrt(-a / 3.0) * std::cos(std::acos(c) / 3.0) - c2 / 3.0;
-    }
+void solve_cubic_single_real(const batch::Lanesf &c2, const batch::Lanesf &c1, const batch::Lanesf &c0, batch::Lanesf &root) {
+    solve_cubic_single_real_lanes(c2, c1, c0, root);
 }
 
-/* Solves the quartic equation x^4 + b*x^3 + c*x^2 + d*x + e = 0 */
-void solve_quartic(double b, double c, double d, double e, std::complex<double> roots[4]) {
+void solve_quartic_real(const batch::Lanes &b, const batch::Lanes &c, const batch::Lanes &d, const batch::Lanes &e,
+                        batch::Lanes roots[4], batch::Mask valid[4]) {
+    using batch::Lanes;
+    const Lanes zero = Lanes::Zero();
 
     // Find depressed quartic
-    std::complex<double> p = c - 3.0 * b * b / 8.0;
-    std::complex<double> q = b * b * b / 8.0 - 0.5 * b * c + d;
-    std::complex<double> r = (-3.0 * b * b * b * b + 256.0 * e - 64.0 * b * d + 16.0 * b * b * c) / 256.0;
+    const Lanes p = c - 3.0 * b * b / 8.0;
+    const Lanes q = b * b * b / 8.0 - 0.5 * b * c + d;
+    const Lanes r = (-3.0 * b * b * b * b + 256.0 * e - 64.0 * b * d + 16.0 * b * b * c) / 256.0;
 
     // Resolvent cubic is now
     // U^3 + 2*p U^2 + (p^2 - 4*r) * U - q^2
-    std::complex<double> bb = 2.0 * p;
-    std::complex<double> cc = p * p - 4.0 * r;
-    std::complex<double> dd = -q * q;
+    const Lanes bb = 2.0 * p;
+    const Lanes cc = p * p - 4.0 * r;
+    const Lanes dd = -q * q;
 
     // Solve resolvent cubic
-    std::complex<double> d0 = bb * bb - 3.0 * cc;
-    std::complex<double> d1 = 2.0 * bb * bb * bb - 9.0 * bb * cc + 27.0 * dd;
-
-    std::complex<double> C3 = (d1.real() < 0) ? (d1 - sqrt(d1 * d1 - 4.0 * d0 * d0 * d0)) / 2.0 : (d1 + sqrt(d1 * d1 - 4.0 * d0 * d0 * d0)) / 2.0;
-
-    std::complex<double> C;
-    if (C3.real() < 0)
-        C = -std::pow(-C3, 1.0 / 3);
-    else
-        C = std::pow(C3, 1.0 / 3);
-
-    std::complex<double> u2 = (bb + C + d0 / C) / -3.0;
-
-    //std::complex<double> db = u2 * u2 * u2 + bb * u2 * u2 + cc * u2 + dd;
+    Lanes u2;
+    solve_cubic_single_real(bb, cc, dd, u2);
+    const batch::Mask has_roots = batch::logical_not(batch::less(u2, zero));
 
-    std::complex<double> u = sqrt(u2);
+    const Lanes u = u2.max(0.0).sqrt();
+    const Lanes s = -u;
+    const Lanes t = (p + u * u + q / u) / 2.0;
+    const Lanes v = (p + u * u - q / u) / 2.0;
 
-    std::complex<double> s = -u;
-    std::complex<double> t = (p + u * u + q / u) / 2.0;
-    std::complex<double> v = (p + u * u - q / u) / 2.0;
+    const Lanes disc1 = u * u - 4.0 * v;
+    const Lanes disc2 = s * s - 4.0 * t;
+    valid[0] = valid[1] = batch::logical_and(has_roots, batch::greater(disc1, zero));
+    valid[2] = valid[3] = batch::logical_and(has_roots, batch::greater(disc2, zero));
 
-    roots[0] = (-u - sign2(u) * sqrt(u * u - 4.0 * v)) / 2.0;
+    const Lanes sign_u = batch::select(batch::less(u, zero), -Lanes::Ones(), Lanes::Ones());
+    const Lanes sign_s = batch::select(batch::less(s, zero), -Lanes::Ones(), Lanes::Ones());
+    roots[0] = (-u - sign_u * disc1.max(0.0).sqrt()) / 2.0;
     roots[1] = v / roots[0];
-    roots[2] = (-s - sign2(s) * sqrt(s * s - 4.0 * t)) / 2.0;
+    roots[2] = (-s - sign_s * disc2.max(0.0).sqrt()) / 2.0;
     roots[3] = t / roots[2];
 
     for (int i = 0; i < 4; i++) {
-        roots[i] = roots[i] - b / 4.0;
-
         // do one step of newton refinement
-        std::complex<double> x = roots[i];
-        std::complex<double> x2 = x * x;
-        std::complex<double> x3 = x * x2;
-        std::complex<double> dx = -(x2 * x2 + b * x3 + c * x2 + d * x + e) / (4.0 * x3 + 3.0 * b * x2 + 2.0 * c * x + d);
+        const Lanes x = roots[i] - b / 4.0;
+        const Lanes x2 = x * x;
+        const Lanes x3 = x * x2;
+        const Lanes dx = -(x2 * x2 + b * x3 + c * x2 + d * x + e) / (4.0 * x3 + 3.0 * b * x2 + 2.0 * c * x + d);
         roots[i] = x + dx;
     }
 }
 
-/* Solves the quartic equation x^4 + b*x^3 + c*x^2 + d*x + e = 0 */
-int solve_quartic_real(double b, double c, double d, double e, double roots[4]) {
-
-    // Find depressed quartic
-    double p = c - 3.0 * b * b / 8.0;
-    double q = b * b * b / 8.0 - 0.5 * b * c + d;
-    double r = (-3.0 * b * b * b * b + 256.0 * e - 64.0 * b * d + 16.0 * b * b * c) / 256.0;
-
-    // Resolvent cubic is now
-    // U^3 + 2*p U^2 + (p^2 - 4*r) * U - q^2
-    double bb = 2.0 * p;
-    double cc = p * p - 4.0 * r;
-    double dd = -q * q;
-
-    // Solve resolvent cubic
-    double u2;
-    solve_cubic_single_real(bb, cc, dd, u2);
-
-    if (u2 < 0)
-        return 0;
-
-    double u = sqrt(u2);
-
-    double s = -u;
-    double t = (p + u * u + q / u) / 2.0;
-    double v = (p + u * u - q / u) / 2.0;
-
-    int sols = 0;
-    double disc = u * u - 4.0 * v;
-    if (disc > 0) {
-        roots[0] = (-u - sign(u) * std::sqrt(disc)) / 2.0;
-        roots[1] = v / roots[0];
-        sols += 2;
-    }
-    disc = s * s - 4.0 * t;
-    if (disc > 0) {
-        roots[sols] = (-s - sign(s) * std::sqrt(disc)) / 2.0;
-        roots[sols + 1] = t / roots[sols];
-        sols += 2;
+void solve_cubic_single_real_batch(const Eigen::Matrix<double, Eigen::Dynamic, 3> &coeffs, Eigen::VectorXd *roots) {
+    const int n = coeffs.rows();
+    roots->resize(n);
+    batch::Lanes root;
+    for (int start = 0; start < n; start += batch::LANES) {
+        solve_cubic_single_real(batch::load(coeffs, 0, start), batch::load(coeffs, 1, start), batch::load(coeffs, 2, start), root);
+        const int n_lanes = std::min(batch::LANES, n - start);
+        roots->segment(start, n_lanes) = root.head(n_lanes);
     }
+}
 
-    for (int i = 0; i < sols; i++) {
-        roots[i] = roots[i] - b / 4.0;
-
-        // do one step of newton refinement
-        double x = roots[i];
-        double x2 = x * x;
-        double x3 = x * x2;
-        double dx = -(x2 * x2 + b * x3 + c * x2 + d * x + e) / (4.0 * x3 + 3.0 * b * x2 + 2.0 * c * x + d);
-        roots[i] = x + dx;
+void solve_quartic_real_batch(const Eigen::Matrix<double, Eigen::Dynamic, 4> &coeffs, Eigen::Matrix<double, Eigen::Dynamic, 4> *roots,
+                              Eigen::VectorXi *n_roots) {
+    const int n = coeffs.rows();
+    roots->resize(n, 4);
+    n_roots->resize(n);
+    batch::Lanes r[4];
+    batch::Mask valid[4];
+    for (int start = 0; start < n; start += batch::LANES) {
+        solve_quartic_real(batch::load(coeffs, 0, start), batch::load(coeffs, 1, start), batch::load(coeffs, 2, start),
+                           batch::load(coeffs, 3, start), r, valid);
+        const int n_lanes = std::min(batch::LANES, n - start);
+        for (int k = 0; k < n_lanes; ++k) {
+            int sols = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (batch::test(valid[i], k)) {
+                    (*roots)(start + k, sols++) = r[i](k);
+                }
+            }
+            (*n_roots)(start + k) = sols;
+        }
     }
-    return sols;
 }
 
 }; // namespace univariate
@@ -27,28 +27,62 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "../types.h"
+#include "batch.h"
 #include <Eigen/Eigen>
 #include <complex>
 
 namespace pose_lib {
 namespace univariate {
+POSELIB_BEGIN_HEADER_ONLY
+
 /* Solves the quadratic equation a*x^2 + b*x + c = 0 */
 void solve_quadratic(double a, double b, double c, std::complex<double> roots[2]);
 
 /* Solves the quadratic equation a*x^2 + b*x + c = 0. Only returns real roots */
+template <typename Real>
+int solve_quadratic_real(Real a, Real b, Real c, Real roots[2]);
 int solve_quadratic_real(double a, double b, double c, double roots[2]);
 
 /* Sign of component with largest magnitude */
 double sign2(const std::complex<double> z);
 
 /* Finds a single real root of x^3 + b*x^2 + c*x + d = 0 */
+template <typename Real>
+void solve_cubic_single_real(Real b, Real c, Real d, Real &root);
 void solve_cubic_single_real(double b, double c, double d, double &root);
 
 /* Solves the quartic equation x^4 + b*x^3 + c*x^2 + d*x + e = 0 */
 void solve_quartic(double b, double c, double d, double e, std::complex<double> roots[4]);
 
-/* Solves the quartic equation x^4 + b*x^3 + c*x^2 + d*x + e = 0. Only returns real roots */
+/* Solves the quartic equation x^4 + b*x^3 + c*x^2 + d*x + e = 0. Only returns real roots
+   The real-valued solvers are instantiated for Real = double and Real = float. The non-template double overloads
+   are chosen for double arguments, and also accept mixed argument types such as ints. */
+template <typename Real>
+int solve_quartic_real(Real b, Real c, Real d, Real e, Real roots[4]);
 int solve_quartic_real(double b, double c, double d, double e, double roots[4]);
 
+POSELIB_END_HEADER_ONLY
+
+/* Lane-wise version of solve_cubic_single_real */
+void solve_cubic_single_real(const batch::Lanes &b, const batch::Lanes &c, const batch::Lanes &d, batch::Lanes &root);
+void solve_cubic_single_real(const batch::Lanesf &b, const batch::Lanesf &c, const batch::Lanesf &d, batch::Lanesf &root);
+
+/* Lane-wise version of solve_quartic_real. The roots are not compacted, instead valid[i] is the mask of lanes where roots[i] is real */
+void solve_quartic_real(const batch::Lanes &b, const batch::Lanes &c, const batch::Lanes &d, const batch::Lanes &e,
+                        batch::Lanes roots[4], batch::Mask valid[4]);
+
+/* Solves many cubics x^3 + b*x^2 + c*x + d = 0 at once, where coeffs.row(i) = [b c d]. Returns a single real root for each */
+void solve_cubic_single_real_batch(const Eigen::Matrix<double, Eigen::Dynamic, 3> &coeffs, Eigen::VectorXd *roots);
+
+/* Solves many quartics x^4 + b*x^3 + c*x^2 + d*x + e = 0 at once, where coeffs.row(i) = [b c d e].
+   The real roots of quartic i are stored in the first (*n_roots)(i) entries of roots->row(i), in the same order as solve_quartic_real */
+void solve_quartic_real_batch(const Eigen::Matrix<double, Eigen::Dynamic, 4> &coeffs, Eigen::Matrix<double, Eigen::Dynamic, 4> *roots,
+                              Eigen::VectorXi *n_roots);
+
 }; // namespace univariate
 }; // namespace pose_lib
+
+#ifdef POSELIB_HEADER_ONLY
+#include "univariate_inl.h"
+#endif
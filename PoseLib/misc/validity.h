@@ -0,0 +1,122 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../types.h"
+#include "rotation.h"
+
+namespace pose_lib {
+namespace validity {
+
+// Checks for inf and nan by looking at the exponent bits directly. Note that std::isfinite cannot be used
+// here since the library is compiled with -ffast-math, which lets the compiler assume that it is always true.
+inline bool is_finite(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x7ff0000000000000ULL) != 0x7ff0000000000000ULL;
+}
+
+inline bool is_finite(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x7f800000U) != 0x7f800000U;
+}
+
+template <typename Real>
+inline bool is_finite(const CameraPoseT<Real> &pose) {
+    for (int i = 0; i < 9; ++i) {
+        if (!is_finite(pose.R.data()[i]))
+            return false;
+    }
+    return is_finite(pose.t(0)) && is_finite(pose.t(1)) && is_finite(pose.t(2)) && is_finite(pose.alpha);
+}
+
+template <typename Real>
+inline bool is_finite(const CompactPoseT<Real> &pose) {
+    for (int i = 0; i < 4; ++i) {
+        if (!is_finite(pose.q(i)))
+            return false;
+    }
+    return is_finite(pose.t(0)) && is_finite(pose.t(1)) && is_finite(pose.t(2)) && is_finite(pose.alpha);
+}
+
+// Checks that the pose is finite and that all of the points are in front of the camera, i.e. lambda*x = R*X+t with lambda > 0.
+// Pose is either CameraPoseT or CompactPoseT, as are the poses of the functions below.
+template <typename Real, template <typename> class Pose>
+inline bool check_points(const Pose<Real> &pose, const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X) {
+    if (!is_finite(pose))
+        return false;
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i].dot(rotation::rotate(pose, X[i]) + pose.t) <= 0)
+            return false;
+    }
+    return true;
+}
+
+// Same as above for generalized cameras, i.e. scale*p + lambda*x = R*X+t with lambda > 0 and scale > 0.
+template <typename Pose>
+inline bool check_points_generalized(const Pose &pose, double scale, const Vector3View &p,
+                                     const Vector3View &x, const Vector3View &X) {
+    if (!is_finite(pose) || scale <= 0)
+        return false;
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (x[i].dot(rotation::rotate(pose, X[i]) + pose.t - scale * p[i]) <= 0)
+            return false;
+    }
+    return true;
+}
+
+// Checks that the pose is finite and that the points on the 3D lines are in front of the camera, i.e.
+// p + lambda*x = R*(X + mu*V) + t with lambda > 0. For central cameras p should be empty.
+template <typename Pose>
+inline bool check_point_lines(const Pose &pose, const Vector3View &p, const Vector3View &x,
+                              const Vector3View &X, const Vector3View &V) {
+    if (!is_finite(pose))
+        return false;
+    for (size_t i = 0; i < x.size(); ++i) {
+        // Least squares solution of [x, -R*V] * [lambda; mu] = R*X + t - p
+        const Eigen::Vector3d RV = rotation::rotate(pose, V[i]);
+        Eigen::Vector3d c = rotation::rotate(pose, X[i]) + pose.t;
+        if (!p.empty())
+            c -= p[i];
+        const double xx = x[i].squaredNorm(), xv = x[i].dot(RV), vv = RV.squaredNorm();
+        const double lambda = vv * x[i].dot(c) - xv * RV.dot(c);
+        const double det = xx * vv - xv * xv;
+        if (lambda * det <= 0)
+            return false;
+    }
+    return true;
+}
+
+} // namespace validity
+} // namespace pose_lib
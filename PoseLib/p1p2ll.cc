@@ -28,12 +28,17 @@
 
 #include "p1p2ll.h"
 #include "misc/re3q3.h"
+#include "misc/rotation.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p1p2ll(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-           const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X,
-           const std::vector<Eigen::Vector3d> &V, std::vector<CameraPose> *output) {
+namespace {
+
+template <typename Pose>
+int p1p2ll_impl(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+                const Vector3View &V, std::vector<Pose> *output, bool filter_invalid) {
 
     // We center coordinate system on Xp
     // Point-point equation then yield:  t = lambda*xp
@@ -64,16 +69,32 @@ int p1p2ll(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vect
 
     output->clear();
     for (int i = 0; i < n_sols; ++i) {
-        CameraPose pose;
-        pose.R = Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
+        Pose pose;
+        rotation::set_quaternion(solutions.col(i), &pose);
 
-        double lambda = -l[0].dot(pose.R * (X[0] - Xp[0])) / l1xp;
+        double lambda = -l[0].dot(rotation::rotate(pose, X[0] - Xp[0])) / l1xp;
 
-        pose.t = lambda * xp[0] - pose.R * Xp[0];
+        pose.t = lambda * xp[0] - rotation::rotate(pose, Xp[0]);
+        if (filter_invalid && !validity::check_points(pose, xp, Xp))
+            continue;
         output->push_back(pose);
     }
 
-    return n_sols;
+    return output->size();
+}
+
+} // namespace
+
+int p1p2ll(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p1p2ll, (xp, Xp, l, X, V, output, filter_invalid))
+    return p1p2ll_impl(xp, Xp, l, X, V, output, filter_invalid);
+}
+
+int p1p2ll(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CompactPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p1p2ll_compact, (xp, Xp, l, X, V, output, filter_invalid))
+    return p1p2ll_impl(xp, Xp, l, X, V, output, filter_invalid);
 }
 
 } // namespace pose_lib
@@ -28,12 +28,17 @@
 
 #include "p2p1ll.h"
 #include "misc/re3q3.h"
+#include "misc/rotation.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p2p1ll(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-           const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X,
-           const std::vector<Eigen::Vector3d> &V, std::vector<CameraPose> *output) {
+namespace {
+
+template <typename Pose>
+int p2p1ll_impl(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+                const Vector3View &V, std::vector<Pose> *output, bool filter_invalid) {
 
     // By some calculation we get that
     //   x2 ~ [(l'*x1)*kron(Xp2'-Xp1',I_3) - x1 * kron(X-Xp1,l')] * R(:)
@@ -71,16 +76,32 @@ int p2p1ll(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vect
 
     output->clear();
     for (int i = 0; i < n_sols; ++i) {
-        CameraPose pose;
-        pose.R = Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
+        Pose pose;
+        rotation::set_quaternion(solutions.col(i), &pose);
 
-        double lambda = -l[0].dot(pose.R * (X[0] - Xp[0])) / lxp1;
+        double lambda = -l[0].dot(rotation::rotate(pose, X[0] - Xp[0])) / lxp1;
 
-        pose.t = lambda * xp[0] - pose.R * Xp[0];
+        pose.t = lambda * xp[0] - rotation::rotate(pose, Xp[0]);
+        if (filter_invalid && !validity::check_points(pose, xp, Xp))
+            continue;
         output->push_back(pose);
     }
 
-    return n_sols;
+    return output->size();
+}
+
+} // namespace
+
+int p2p1ll(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p2p1ll, (xp, Xp, l, X, V, output, filter_invalid))
+    return p2p1ll_impl(xp, Xp, l, X, V, output, filter_invalid);
+}
+
+int p2p1ll(const Vector3View &xp, const Vector3View &Xp, const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CompactPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p2p1ll_compact, (xp, Xp, l, X, V, output, filter_invalid))
+    return p2p1ll_impl(xp, Xp, l, X, V, output, filter_invalid);
 }
 
 } // namespace pose_lib
@@ -37,8 +37,13 @@ namespace pose_lib {
 // Solves for camera pose such that: l'*(R*(X+mu*V)+t) = 0 and lambda*xp = R*Xp + t
 // Relies on the E3Q3 solver from
 //    Kukelova et al., Efficient Intersection of Three Quadrics and Applications in Computer Vision, CVPR 2016
-int p2p1ll(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-           const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X,
-           const std::vector<Eigen::Vector3d> &V, std::vector<CameraPose> *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points xp behind the camera are discarded.
+int p2p1ll(const Vector3View &xp, const Vector3View &Xp,
+           const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CameraPose> *output, bool filter_invalid = false);
+// Same as above but returns compact poses, see CompactPoseT in types.h.
+int p2p1ll(const Vector3View &xp, const Vector3View &Xp,
+           const Vector3View &l, const Vector3View &X,
+           const Vector3View &V, std::vector<CompactPose> *output, bool filter_invalid = false);
 
 } // namespace pose_lib
@@ -27,42 +27,205 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "p2p2pl.h"
+#include "misc/sturm.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
-void p2p2l_fast_eigenvector_solver(double *eigv, int neig, Eigen::Matrix<double, 16, 16> &AM, Eigen::Matrix<double, 2, 16> &sols) {
-    static const int ind[] = {4, 5, 7, 10, 15};
-    // Truncated action matrix containing non-trivial rows
-    Eigen::Matrix<double, 5, 16> AMs;
-    double zi[6];
+namespace {
 
-    for (int i = 0; i < 5; i++) {
-        AMs.row(i) = AM.row(ind[i]);
+// The action matrix AM has only five non-trivial rows (4, 5, 7, 10 and 15) and its eigenvectors have the form
+//    v = [v4, v3, l*v3, v2, l*v2, l^2*v2, v1, l*v1, ..., l^3*v1, v0, l*v0, ..., l^5*v0]
+// (up to the order of the elements), where l is the eigenvalue. Inserting this into AM*v = l*v gives a 5x5 matrix
+// polynomial M(l) with M(l)*[v0, ..., v4] = 0, and the eigenvalues of AM are the roots of det(M(l)). Column j of M(l)
+// has the columns M_ind[j][0], M_ind[j][1], ... of the non-trivial rows as coefficients and -l^M_deg[j] on the diagonal.
+const int M_ind[5][6] = {{4}, {3, 5}, {2, 6, 7}, {1, 8, 9, 10}, {0, 11, 12, 13, 14, 15}};
+const int M_deg[5] = {1, 2, 3, 4, 6};
+
+// Evaluates M(l) for real l.
+void p2p2pl_matrix_polynomial(const Eigen::Matrix<double, 5, 16> &AMs, double l, Eigen::Matrix<double, 5, 5> *M) {
+    for (int j = 0; j < 5; ++j) {
+        // Horner's method, the leading coefficient is -1 on the diagonal and zero elsewhere
+        M->col(j).setZero();
+        (*M)(j, j) = -1.0;
+        for (int d = M_deg[j] - 1; d >= 0; --d) {
+            M->col(j) = l * M->col(j) + AMs.col(M_ind[j][d]);
+        }
+    }
+}
+
+// Evaluates the derivative of M(l) for real l.
+void p2p2pl_matrix_polynomial_derivative(const Eigen::Matrix<double, 5, 16> &AMs, double l, Eigen::Matrix<double, 5, 5> *dM) {
+    for (int j = 0; j < 5; ++j) {
+        dM->col(j).setZero();
+        (*dM)(j, j) = -M_deg[j];
+        for (int d = M_deg[j] - 1; d >= 1; --d) {
+            dM->col(j) = l * dM->col(j) + d * AMs.col(M_ind[j][d]);
+        }
+    }
+}
+
+// Gaussian elimination with partial pivoting on the first n columns of A (the row operations are applied to all
+// columns), i.e. afterwards the first n columns of A are upper triangular.
+template <int Cols>
+void p2p2pl_eliminate(Eigen::Matrix<double, 5, Cols> *A, int n) {
+    for (int k = 0; k < n; ++k) {
+        int p;
+        A->col(k).tail(5 - k).cwiseAbs().maxCoeff(&p);
+        if (p != 0) {
+            A->row(k).swap(A->row(k + p));
+        }
+        for (int i = k + 1; i < 5; ++i) {
+            const double f = (*A)(i, k) / (*A)(k, k);
+            A->row(i).tail(Cols - k - 1) -= f * A->row(k).tail(Cols - k - 1);
+        }
+    }
+}
+
+// Evaluates det(M(l)) for complex l = l_re + i*l_im, using Gaussian elimination with partial pivoting.
+// The complex arithmetic is written out since std::complex is slow without -ffast-math (due to the NaN handling).
+void p2p2pl_determinant(const Eigen::Matrix<double, 5, 16> &AMs, double l_re, double l_im, double *det_re, double *det_im) {
+    double re[5][5], im[5][5];
+    for (int j = 0; j < 5; ++j) {
+        for (int i = 0; i < 5; ++i) {
+            re[i][j] = 0.0;
+            im[i][j] = 0.0;
+        }
+        re[j][j] = -1.0;
+        for (int d = M_deg[j] - 1; d >= 0; --d) {
+            for (int i = 0; i < 5; ++i) {
+                const double r = re[i][j] * l_re - im[i][j] * l_im + AMs(i, M_ind[j][d]);
+                im[i][j] = re[i][j] * l_im + im[i][j] * l_re;
+                re[i][j] = r;
+            }
+        }
+    }
+
+    double dr = 1.0, di = 0.0;
+    for (int k = 0; k < 5; ++k) {
+        int p = k;
+        double max_abs = std::abs(re[k][k]) + std::abs(im[k][k]);
+        for (int i = k + 1; i < 5; ++i) {
+            const double a = std::abs(re[i][k]) + std::abs(im[i][k]);
+            if (a > max_abs) {
+                max_abs = a;
+                p = i;
+            }
+        }
+        if (max_abs == 0.0) {
+            *det_re = 0.0;
+            *det_im = 0.0;
+            return;
+        }
+        if (p != k) {
+            for (int j = k; j < 5; ++j) {
+                std::swap(re[k][j], re[p][j]);
+                std::swap(im[k][j], im[p][j]);
+            }
+            dr = -dr;
+            di = -di;
+        }
+        const double pr = re[k][k], pi = im[k][k];
+        const double t = dr * pr - di * pi;
+        di = dr * pi + di * pr;
+        dr = t;
+
+        const double inv_norm = 1.0 / (pr * pr + pi * pi);
+        for (int i = k + 1; i < 5; ++i) {
+            // f = a(i,k) / a(k,k)
+            const double fr = (re[i][k] * pr + im[i][k] * pi) * inv_norm;
+            const double fi = (im[i][k] * pr - re[i][k] * pi) * inv_norm;
+            for (int j = k + 1; j < 5; ++j) {
+                re[i][j] -= fr * re[k][j] - fi * im[k][j];
+                im[i][j] -= fr * im[k][j] + fi * re[k][j];
+            }
+        }
+    }
+    *det_re = dr;
+    *det_im = di;
+}
+
+// Computes the coefficients of det(M(rho*l)) / rho^16 in l, where rho is chosen such that the roots are distributed
+// around the unit circle (the product of the roots is -det(M(0))). Since the degree is 16, the polynomial is obtained
+// exactly (up to rounding) from its values at the 16th roots of unity using the inverse discrete Fourier transform.
+// The values for k > 8 are the complex conjugates of the values for 16 - k since the coefficients are real.
+void p2p2pl_characteristic_polynomial(const Eigen::Matrix<double, 5, 16> &AMs, double c[17], double *rho) {
+    // cos(k*pi/8), and sin(k*pi/8) = cos((k+12)*pi/8)
+    static const double cos_table[16] = {1.0, 0.92387953251128674, 0.70710678118654752, 0.38268343236508977,
+                                         0.0, -0.38268343236508977, -0.70710678118654752, -0.92387953251128674,
+                                         -1.0, -0.92387953251128674, -0.70710678118654752, -0.38268343236508977,
+                                         0.0, 0.38268343236508977, 0.70710678118654752, 0.92387953251128674};
+
+    double det0_re, det0_im;
+    p2p2pl_determinant(AMs, 0.0, 0.0, &det0_re, &det0_im);
+    *rho = det0_re != 0.0 ? std::pow(std::abs(det0_re), 1.0 / 16.0) : 1.0;
+    const double rho16 = std::pow(*rho, 16);
+
+    double p_re[9], p_im[9];
+    for (int k = 0; k <= 8; ++k) {
+        p2p2pl_determinant(AMs, *rho * cos_table[k], *rho * cos_table[(k + 12) % 16], &p_re[k], &p_im[k]);
+        p_re[k] /= rho16;
+        p_im[k] /= rho16;
     }
-    for (int i = 0; i < neig; i++) {
-        zi[0] = eigv[i];
-        for (int j = 1; j < 6; j++) {
-            zi[j] = zi[j - 1] * eigv[i];
+
+    // The DFT is applied to det(M(rho*l)) / rho^16 + l^16, which has degree 15.
+    for (int j = 0; j < 16; ++j) {
+        double cj = p_re[0] + (j % 2 == 0 ? p_re[8] : -p_re[8]);
+        for (int k = 1; k < 8; ++k) {
+            const int m = (j * k) % 16;
+            cj += 2.0 * (p_re[k] * cos_table[m] + p_im[k] * cos_table[(m + 12) % 16]);
         }
-        Eigen::Matrix<double, 5, 5> AA;
-        AA.col(0) = AMs.col(4);
-        AA.col(1) = AMs.col(3) + zi[0] * AMs.col(5);
-        AA.col(2) = AMs.col(2) + zi[0] * AMs.col(6) + zi[1] * AMs.col(7);
-        AA.col(3) = AMs.col(1) + zi[0] * AMs.col(8) + zi[1] * AMs.col(9) + zi[2] * AMs.col(10);
-        AA.col(4) = AMs.col(0) + zi[0] * AMs.col(11) + zi[1] * AMs.col(12) + zi[2] * AMs.col(13) + zi[3] * AMs.col(14) + zi[4] * AMs.col(15);
-        AA(0, 0) = AA(0, 0) - zi[0];
-        AA(1, 1) = AA(1, 1) - zi[1];
-        AA(2, 2) = AA(2, 2) - zi[2];
-        AA(3, 3) = AA(3, 3) - zi[3];
-        AA(4, 4) = AA(4, 4) - zi[5];
-
-        Eigen::Matrix<double, 4, 1> s = AA.leftCols(4).colPivHouseholderQr().solve(-AA.col(4));
-        sols(0, i) = s(3);
-        sols(1, i) = zi[0];
+        c[j] = cj / 16.0;
     }
+    c[0] += 1.0;
+    c[16] = -1.0;
 }
 
-int pose_lib::p2p2pl(const std::vector<Eigen::Vector3d> &xp0, const std::vector<Eigen::Vector3d> &Xp0,
-                     const std::vector<Eigen::Vector3d> &x0, const std::vector<Eigen::Vector3d> &X0,
-                     const std::vector<Eigen::Vector3d> &V0, CameraPoseVector *output) {
+// Returns the null vector v of the (singular) matrix M normalized such that v4 = 1. This uses Gaussian elimination
+// with partial pivoting, where the last pivot is (close to) zero.
+Eigen::Matrix<double, 5, 1> p2p2pl_null_vector(Eigen::Matrix<double, 5, 5> *M) {
+    p2p2pl_eliminate(M, 4);
+    Eigen::Matrix<double, 5, 1> v;
+    v.head<4>() = M->topLeftCorner<4, 4>().triangularView<Eigen::Upper>().solve(-M->block<4, 1>(0, 4));
+    v(4) = 1.0;
+    return v;
+}
+
+// Refines a root of det(M(l)) with one step of Newton's method, using d/dl det(M(l)) = det(M(l)) * trace(M(l)^-1 * M'(l)).
+// The roots of the interpolated characteristic polynomial lose a few digits of accuracy compared to det(M(l)) itself.
+double p2p2pl_refine_root(const Eigen::Matrix<double, 5, 16> &AMs, double l) {
+    Eigen::Matrix<double, 5, 5> M, dM;
+    p2p2pl_matrix_polynomial(AMs, l, &M);
+    p2p2pl_matrix_polynomial_derivative(AMs, l, &dM);
+    Eigen::Matrix<double, 5, 10> A;
+    A << M, dM;
+    p2p2pl_eliminate(&A, 5);
+    const double tr = A.leftCols<5>().triangularView<Eigen::Upper>().solve(A.rightCols<5>()).trace();
+    if (!pose_lib::validity::is_finite(tr) || tr == 0.0) {
+        return l;
+    }
+    return l - 1.0 / tr;
+}
+
+// Computes the solutions (b, c) = (v3, l) from the real eigenvalues l of the action matrix, where v is the null vector
+// of M(l) (see above) normalized such that v4 = 1.
+void p2p2pl_eigenvectors(const Eigen::Matrix<double, 5, 16> &AMs, const double *eigv, int neig,
+                         Eigen::Matrix<double, 2, 16> *sols) {
+    for (int i = 0; i < neig; ++i) {
+        Eigen::Matrix<double, 5, 5> M;
+        p2p2pl_matrix_polynomial(AMs, eigv[i], &M);
+        const Eigen::Matrix<double, 5, 1> v = p2p2pl_null_vector(&M);
+        (*sols)(0, i) = v(3);
+        (*sols)(1, i) = eigv[i];
+    }
+}
+
+} // namespace
+
+// Output is either a std::vector or a FixedVector (with capacity of at least 16).
+template <typename Output>
+int p2p2pl_impl(const pose_lib::Vector3View &xp0, const pose_lib::Vector3View &Xp0,
+                const pose_lib::Vector3View &x0, const pose_lib::Vector3View &X0,
+                const pose_lib::Vector3View &V0, Output *output, bool filter_invalid, pose_lib::P2P2PLWorkspace *ws) {
 
     // Change world coordinate system
     Eigen::Vector3d t0 = Xp0[0];
@@ -142,10 +305,15 @@ int pose_lib::p2p2pl(const std::vector<Eigen::Vector3d> &xp0, const std::vector<
     static const int C0_ind[] = {0, 23, 24, 25, 43, 47, 48, 50, 62, 71, 72, 73, 75, 87, 91, 95, 96, 97, 98, 100, 110, 114, 115, 119, 120, 122, 125, 129, 134, 143, 144, 145, 147, 150, 154, 159, 163, 167, 168, 169, 170, 171, 172, 175, 182, 183, 185, 186, 187, 191, 192, 193, 194, 196, 197, 200, 201, 205, 206, 210, 211, 215, 218, 221, 225, 230, 240, 241, 243, 246, 250, 255, 259, 263, 264, 265, 266, 267, 268, 270, 271, 274, 275, 278, 279, 280, 281, 282, 283, 287, 288, 289, 290, 291, 292, 293, 295, 296, 297, 300, 301, 302, 303, 305, 306, 307, 308, 311, 314, 316, 317, 320, 321, 325, 326, 330, 341, 345, 361, 363, 366, 370, 375, 379, 384, 385, 386, 387, 388, 390, 391, 394, 395, 398, 399, 400, 401, 402, 403, 407, 408, 409, 410, 411, 412, 413, 414, 415, 416, 417, 418, 419, 420, 421, 422, 423, 424, 425, 426, 427, 428, 429, 430, 431, 434, 436, 437, 439, 440, 441, 444, 445, 446, 449, 450, 452, 459, 462, 466, 471, 481, 483, 484, 486, 487, 490, 491, 495, 496, 497, 498, 499, 504, 505, 506, 507, 508, 509, 510, 511, 512, 513, 514, 515, 516, 517, 518, 519, 520, 521, 522, 523, 524, 525, 526, 527, 530, 532, 533, 535, 536, 537, 539, 540, 541, 542, 544, 545, 546, 548, 549, 550, 557, 560, 561, 565};
     static const int C1_ind[] = {21, 22, 35, 40, 45, 46, 54, 58, 59, 64, 69, 70, 78, 82, 83, 88, 102, 106, 123, 126, 127, 130, 131, 135, 136, 137, 147, 150, 151, 154, 155, 156, 159, 160, 161, 164, 165, 166, 169, 171, 172, 174, 175, 176, 178, 179, 180, 181, 183, 184, 185, 186, 187, 188, 189, 190, 199, 203, 204, 208, 209, 212, 213, 214, 220, 223, 224, 227, 228, 229, 232, 233, 234, 236, 237, 238, 242, 244, 245, 247, 248, 249, 251, 252, 253, 254, 256, 257, 258, 260, 261, 262, 276, 284, 285, 286, 296, 300, 301, 308, 309, 310, 317, 320, 321, 324, 325, 332, 333, 334, 341, 344, 345, 348, 349, 356, 357, 358, 365, 368, 369, 372, 373, 380};
 
-    Eigen::Matrix<double, 24, 24> C0;
-    C0.setZero();
-    Eigen::Matrix<double, 24, 16> C1;
-    C1.setZero();
+    // The sparsity pattern of the elimination template is the same for all instances, so with a reused workspace
+    // the zeros only need to be set up once.
+    Eigen::Matrix<double, 24, 24> &C0 = ws->C0;
+    Eigen::Matrix<double, 24, 16> &C1 = ws->C1;
+    if (!ws->initialized) {
+        C0.setZero();
+        C1.setZero();
+        ws->initialized = true;
+    }
     for (int i = 0; i < 236; i++) {
         C0(C0_ind[i]) = coeffs[coeffs0_ind[i]];
     }
@@ -153,42 +321,42 @@ int pose_lib::p2p2pl(const std::vector<Eigen::Vector3d> &xp0, const std::vector<
         C1(C1_ind[i]) = coeffs[coeffs1_ind[i]];
     }
 
-    Eigen::Matrix<double, 24, 16> C12 = C0.partialPivLu().solve(C1);
-
-    // Setup action matrix
-    Eigen::Matrix<double, 16, 16> AM;
-    AM.setZero();
-    AM(0, 11) = 1.0;
-    AM(1, 8) = 1.0;
-    AM(2, 6) = 1.0;
-    AM(3, 5) = 1.0;
-    AM.row(4) = -C12.row(19);
-    AM.row(5) = -C12.row(20);
-    AM(6, 7) = 1.0;
-    AM.row(7) = -C12.row(21);
-    AM(8, 9) = 1.0;
-    AM(9, 10) = 1.0;
-    AM.row(10) = -C12.row(22);
-    AM(11, 12) = 1.0;
-    AM(12, 13) = 1.0;
-    AM(13, 14) = 1.0;
-    AM(14, 15) = 1.0;
-    AM.row(15) = -C12.row(23);
-
-    // Solve for eigenvalues
-    Eigen::EigenSolver<Eigen::Matrix<double, 16, 16>> es(AM, false);
-    Eigen::Array<std::complex<double>, 16, 1> D = es.eigenvalues();
-
-    int nroots = 0;
+    // Only the last five rows of C0^-1 * C1 are needed for the action matrix. These are obtained by eliminating the
+    // first 19 columns of [C0 C1] (with partial pivoting) and solving with the remaining 5x5 block.
+    Eigen::Matrix<double, 24, 40, Eigen::RowMajor> &A = ws->A;
+    A << C0, C1;
+    for (int k = 0; k < 19; ++k) {
+        int p;
+        A.col(k).tail(24 - k).cwiseAbs().maxCoeff(&p);
+        if (p != 0) {
+            A.row(k).swap(A.row(k + p));
+        }
+        const double inv_pivot = 1.0 / A(k, k);
+        for (int i = k + 1; i < 24; ++i) {
+            // The template is sparse, so many rows are already eliminated
+            if (A(i, k) != 0.0) {
+                A.row(i).tail(39 - k) -= (A(i, k) * inv_pivot) * A.row(k).tail(39 - k);
+            }
+        }
+    }
+    Eigen::Matrix<double, 5, 21> S = A.bottomRightCorner<5, 21>();
+    p2p2pl_eliminate(&S, 5);
+
+    // Non-trivial rows of the action matrix
+    const Eigen::Matrix<double, 5, 16> AMs = -S.leftCols<5>().triangularView<Eigen::Upper>().solve(S.rightCols<16>());
+
+    // Solve for the real eigenvalues as the real roots of the characteristic polynomial
+    double c[17], rho;
+    p2p2pl_characteristic_polynomial(AMs, c, &rho);
     double eigv[16];
-    for (int i = 0; i < 16; i++) {
-        if (std::abs(D(i).imag()) < 1e-6)
-            eigv[nroots++] = D(i).real();
+    const int nroots = pose_lib::sturm::bisect_sturm<16>(c, eigv);
+    for (int i = 0; i < nroots; i++) {
+        eigv[i] = p2p2pl_refine_root(AMs, rho * eigv[i]);
     }
 
     // Solve for the eigenvectors (exploiting their structure)
     Eigen::Matrix<double, 2, 16> sols;
-    p2p2l_fast_eigenvector_solver(eigv, nroots, AM, sols);
+    p2p2pl_eigenvectors(AMs, eigv, nroots, &sols);
 
     output->clear();
     for (int i = 0; i < nroots; ++i) {
@@ -199,7 +367,7 @@ int pose_lib::p2p2pl(const std::vector<Eigen::Vector3d> &xp0, const std::vector<
 
         Eigen::Quaternion<double> q(a, b, c, d);
 
-        CameraPose pose;
+        pose_lib::CameraPose pose;
 
         pose.t << 0.0, 0.0, u * (1.0 + b * b - c * c - d * d) - 2 * b * d + 2 * a * c;
         pose.t(2) /= q.squaredNorm();
@@ -212,8 +380,35 @@ int pose_lib::p2p2pl(const std::vector<Eigen::Vector3d> &xp0, const std::vector<
         pose.t = R1.transpose() * R2.transpose() * pose.t;
         pose.t = pose.t * s0 - pose.R * t0;
 
+        if (filter_invalid && (!pose_lib::validity::check_points(pose, xp0, Xp0) ||
+                               !pose_lib::validity::check_point_lines(pose, pose_lib::Vector3View(), x0, X0, V0)))
+            continue;
         output->push_back(pose);
     }
 
-    return nroots;
+    return output->size();
+}
+
+int pose_lib::p2p2pl(const Vector3View &xp, const Vector3View &Xp,
+                     const Vector3View &x, const Vector3View &X,
+                     const Vector3View &V, CameraPoseVector *output, bool filter_invalid,
+                     P2P2PLWorkspace *workspace) {
+    POSELIB_DISPATCH(p2p2pl, (xp, Xp, x, X, V, output, filter_invalid, workspace))
+    if (workspace == nullptr) {
+        P2P2PLWorkspace temporary;
+        return p2p2pl_impl(xp, Xp, x, X, V, output, filter_invalid, &temporary);
+    }
+    return p2p2pl_impl(xp, Xp, x, X, V, output, filter_invalid, workspace);
+}
+
+int pose_lib::p2p2pl(const Vector3View &xp, const Vector3View &Xp,
+                     const Vector3View &x, const Vector3View &X,
+                     const Vector3View &V, FixedVector<CameraPose, 16> *output, bool filter_invalid,
+                     P2P2PLWorkspace *workspace) {
+    POSELIB_DISPATCH(p2p2pl_fixed, (xp, Xp, x, X, V, output, filter_invalid, workspace))
+    if (workspace == nullptr) {
+        P2P2PLWorkspace temporary;
+        return p2p2pl_impl(xp, Xp, x, X, V, output, filter_invalid, &temporary);
+    }
+    return p2p2pl_impl(xp, Xp, x, X, V, output, filter_invalid, workspace);
 }
@@ -33,11 +33,31 @@
 
 namespace pose_lib {
 
+// Scratch memory for p2p2pl which can be reused between calls, e.g. by creating one workspace per thread.
+// This avoids re-initializing the (sparse) elimination template, and keeps the about 15 kB of matrices and
+// solver state off the stack. The members are internal to the solver.
+struct P2P2PLWorkspace {
+    Eigen::Matrix<double, 24, 24> C0;
+    Eigen::Matrix<double, 24, 16> C1;
+    Eigen::Matrix<double, 24, 40, Eigen::RowMajor> A;
+    bool initialized = false;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
 // Absolute pose from two point-point and two point-line constraints.
 //    lambda * xp = R*Xp + t    and    lambda * x = R*(X + mu*V) + t
 // This solver is based on the formulation from the paper
 //       Josephson et al., Image-Based Localization Using Hybrid Feature Correspondences, CVPR 2007
-int p2p2pl(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-           const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-           const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+// If workspace is given it is used for the scratch memory (see above), otherwise a temporary one is used.
+int p2p2pl(const Vector3View &xp, const Vector3View &Xp,
+           const Vector3View &x, const Vector3View &X,
+           const Vector3View &V, CameraPoseVector *output, bool filter_invalid = false,
+           P2P2PLWorkspace *workspace = nullptr);
+// Same as above but without any heap allocations. There are at most 16 solutions.
+int p2p2pl(const Vector3View &xp, const Vector3View &Xp,
+           const Vector3View &x, const Vector3View &X,
+           const Vector3View &V, FixedVector<CameraPose, 16> *output, bool filter_invalid = false,
+           P2P2PLWorkspace *workspace = nullptr);
 }; // namespace pose_lib
@@ -28,10 +28,13 @@
 
 #include "p3ll.h"
 #include "misc/re3q3.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p3ll(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X, const std::vector<Eigen::Vector3d> &V, std::vector<CameraPose> *output) {
+int p3ll(const Vector3View &l, const Vector3View &X, const Vector3View &V, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p3ll, (l, X, V, output, filter_invalid))
 
     Eigen::Matrix3d A;
     Eigen::Matrix<double, 3, 9> B1, B2;
@@ -61,10 +64,12 @@ int p3ll(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3
         CameraPose pose;
         pose.R = Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
         pose.t = -B2 * Eigen::Map<Eigen::Matrix<double, 9, 1>>(pose.R.data());
+        if (filter_invalid && !validity::is_finite(pose))
+            continue;
         output->push_back(pose);
     }
 
-    return n_sols;
+    return output->size();
 }
 
 } // namespace pose_lib
@@ -27,68 +27,24 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "p3p.h"
+#include "p3p_inl.h"
+#include "point_map.h"
+#include "residuals.h"
+#include "misc/batch.h"
+#include "misc/univariate.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-// Computes the eigen decomposition of a 3x3 matrix given that one eigenvalue is zero.
-void compute_eig3x3known0(const Eigen::Matrix3d &M, Eigen::Matrix3d &E, double &sig1, double &sig2) {
-
-    // In the original paper there is a missing minus sign here (for M(0,0))
-    double p1 = -M(0, 0) - M(1, 1) - M(2, 2);
-    double p0 = -M(0, 1) * M(0, 1) - M(0, 2) * M(0, 2) - M(1, 2) * M(1, 2) + M(0, 0) * (M(1, 1) + M(2, 2)) + M(1, 1) * M(2, 2);
-
-    double disc = std::sqrt(p1 * p1 / 4.0 - p0);
-    double tmp = -p1 / 2.0;
-    sig1 = tmp + disc;
-    sig2 = tmp - disc;
-
-    if (std::abs(sig1) < std::abs(sig2))
-        std::swap(sig1, sig2);
-
-    double c = sig1 * sig1 + M(0, 0) * M(1, 1) - sig1 * (M(0, 0) + M(1, 1)) - M(0, 1) * M(0, 1);
-    double a1 = (sig1 * M(0, 2) + M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1)) / c;
-    double a2 = (sig1 * M(1, 2) + M(0, 1) * M(0, 2) - M(0, 0) * M(1, 2)) / c;
-    double n = 1.0 / std::sqrt(1 + a1 * a1 + a2 * a2);
-    E.col(0) << a1 * n, a2 * n, n;
-
-    c = sig2 * sig2 + M(0, 0) * M(1, 1) - sig2 * (M(0, 0) + M(1, 1)) - M(0, 1) * M(0, 1);
-    a1 = (sig2 * M(0, 2) + M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1)) / c;
-    a2 = (sig2 * M(1, 2) + M(0, 1) * M(0, 2) - M(0, 0) * M(1, 2)) / c;
-    n = 1.0 / std::sqrt(1 + a1 * a1 + a2 * a2);
-    E.col(1) << a1 * n, a2 * n, n;
-
-    E.col(2) = M.col(1).cross(M.col(2)).normalized();
-}
-
-// Performs a few newton steps on the equations
-inline void refine_lambda(double &lambda1, double &lambda2, double &lambda3,
-                          const double a12, const double a13, const double a23,
-                          const double b12, const double b13, const double b23) {
-
-    for (int iter = 0; iter < 5; ++iter) {
-        double r1 = (lambda1 * lambda1 - 2.0 * lambda1 * lambda2 * b12 + lambda2 * lambda2 - a12);
-        double r2 = (lambda1 * lambda1 - 2.0 * lambda1 * lambda3 * b13 + lambda3 * lambda3 - a13);
-        double r3 = (lambda2 * lambda2 - 2.0 * lambda2 * lambda3 * b23 + lambda3 * lambda3 - a23);
-        if (std::abs(r1) + std::abs(r2) + std::abs(r3) < 1e-10)
-            return;
-        double x11 = lambda1 - lambda2 * b12;
-        double x12 = lambda2 - lambda1 * b12;
-        double x21 = lambda1 - lambda3 * b13;
-        double x23 = lambda3 - lambda1 * b13;
-        double x32 = lambda2 - lambda3 * b23;
-        double x33 = lambda3 - lambda2 * b23;
-        double detJ = 0.5 / (x11 * x23 * x32 + x12 * x21 * x33); // half minus inverse determinant
-        // This uses the closed form of the inverse for the jacobean.
-        // Due to the zero elements this actually becomes quite nice.
-        lambda1 += (-x23 * x32 * r1 - x12 * x33 * r2 + x12 * x23 * r3) * detJ;
-        lambda2 += (-x21 * x33 * r1 + x11 * x33 * r2 - x11 * x23 * r3) * detJ;
-        lambda3 += (x21 * x32 * r1 - x11 * x32 * r2 - x12 * x21 * r3) * detJ;
-    }
-}
-
-// Solves for camera pose such that: lambda*x = R*X+t  with positive lambda.
-int p3p(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output) {
+using detail::p3p_gamma;
+using detail::p3p_depths;
+using detail::refine_lambda;
+using detail::p3p_pose_from_depths;
 
+bool p3p_best(const Vector3View &x, const Vector3View &X,
+              const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all,
+              double threshold, CameraPose *best_pose, double *best_score) {
+    POSELIB_DISPATCH(p3p_best, (x, X, x_all, X_all, threshold, best_pose, best_score))
     Eigen::Vector3d dX12 = X[0] - X[1];
     Eigen::Vector3d dX13 = X[0] - X[2];
     Eigen::Vector3d dX23 = X[1] - X[2];
@@ -102,176 +58,361 @@ int p3p(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d
     double a23 = dX23.squaredNorm();
     double b23 = x[1].dot(x[2]);
 
-    double a23b12 = a23 * b12;
-    double a12b23 = a12 * b23;
-    double a23b13 = a23 * b13;
-    double a13b23 = a13 * b23;
-
     Eigen::Matrix3d D1, D2;
+    const double gamma = p3p_gamma(a12, a13, a23, b12, b13, b23, D1, D2);
 
-    D1 << a23, -a23b12, 0.0, -a23b12, a23 - a12, a12b23, 0.0, a12b23, -a12;
-    D2 << a23, 0.0, -a23b13, 0.0, -a13, a13b23, -a23b13, a13b23, a23 - a13;
+    double lambdas[4][3];
+    const int n_sols = p3p_depths(a12, a13, a23, b12, b13, b23, D1, D2, gamma, lambdas);
 
-    Eigen::Matrix3d DX1, DX2;
-    DX1 << D1.col(1).cross(D1.col(2)), D1.col(2).cross(D1.col(0)), D1.col(0).cross(D1.col(1));
-    DX2 << D2.col(1).cross(D2.col(2)), D2.col(2).cross(D2.col(0)), D2.col(0).cross(D2.col(1));
+    Eigen::Matrix3d XX;
+    XX << dX12, dX13, dX12.cross(dX13);
+    XX = XX.inverse().eval();
 
-    // Coefficients of p(gamma) = det(D1 + gamma*D2)
-    // In the original paper c2 and c1 are switched.
-    double c3 = D2.col(0).dot(DX2.col(0));
-    double c2 = (D1.array() * DX2.array()).sum();
-    double c1 = (D2.array() * DX1.array()).sum();
-    double c0 = D1.col(0).dot(DX1.col(0));
-
-    // closed root solver for cubic root
-    const double c3inv = 1.0 / c3;
-    c2 *= c3inv;
-    c1 *= c3inv;
-    c0 *= c3inv;
-
-    double a = c1 - c2 * c2 / 3.0;
-    double b = (2.0 * c2 * c2 * c2 - 9.0 * c2 * c1) / 27.0 + c0;
-    double c = b * b / 4.0 + a * a * a / 27.0;
-    double gamma;
-    if (c > 0) {
-        c = std::sqrt(c);
-        b *= -0.5;
-        gamma = std::cbrt(b + c) + std::cbrt(b - c) - c2 / 3.0;
-    } else {
-        c = 3.0 * b / (2.0 * a) * std::sqrt(-3.0 / a);
-        gamma = 2.0 * std::sqrt(-a / 3.0) * std::cos(std::acos(c) / 3.0) - c2 / 3.0;
+    CameraPose pose;
+    bool updated = false;
+    for (int k = 0; k < n_sols; ++k) {
+        double lambda1 = lambdas[k][0], lambda2 = lambdas[k][1], lambda3 = lambdas[k][2];
+        refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
+        p3p_pose_from_depths(x, X, XX, lambda1, lambda2, lambda3, &pose);
+
+        const double score = compute_reprojection_score(pose, x_all, X_all, threshold, *best_score);
+        if (score < *best_score) {
+            *best_score = score;
+            *best_pose = pose;
+            updated = true;
+        }
     }
+    return updated;
+}
 
-    // We do a single newton step on the cubic equation
-    double f = gamma * gamma * gamma + c2 * gamma * gamma + c1 * gamma + c0;
-    double df = 3.0 * gamma * gamma + 2.0 * c2 * gamma + c1;
-    gamma = gamma - f / df;
-
-    Eigen::Matrix3d D0 = D1 + gamma * D2;
-
-    Eigen::Matrix3d E;
-    double sig1, sig2;
-
-    compute_eig3x3known0(D0, E, sig1, sig2);
-
-    double s = std::sqrt(-sig2 / sig1);
+// The dispatched double precision specializations declared in p3p.h.
+template <>
+int p3p<double>(const Vector3View &x, const Vector3View &X, CameraPoseVector *output) {
+    POSELIB_DISPATCH(p3p, (x, X, output))
+    return detail::p3p_impl(x, X, output);
+}
 
-    double w0p = (E(1, 0) - s * E(1, 1)) / (s * E(0, 1) - E(0, 0));
-    double w1p = (-s * E(2, 1) + E(2, 0)) / (s * E(0, 1) - E(0, 0));
+template <>
+int p3p<double>(const Vector3View &x, const Vector3View &X, FixedVector<CameraPose, 4> *output) {
+    POSELIB_DISPATCH(p3p_fixed, (x, X, output))
+    return detail::p3p_impl(x, X, output);
+}
 
-    double w0n = (E(1, 0) + s * E(1, 1)) / (-s * E(0, 1) - E(0, 0));
-    double w1n = (s * E(2, 1) + E(2, 0)) / (-s * E(0, 1) - E(0, 0));
+template int p3p<float>(const Vector3Viewf &, const Vector3Viewf &, CameraPoseVectorf *);
+template int p3p<float>(const Vector3Viewf &, const Vector3Viewf &, FixedVector<CameraPosef, 4> *);
 
-    // Note that these formulas differ from what is presented in the paper.
-    double ap = (a13 - a12) * w1p * w1p + 2.0 * a12 * b13 * w1p - a12;
-    double bp = -2.0 * a13 * b12 * w1p + 2.0 * a12 * b13 * w0p - 2.0 * w0p * w1p * (a12 - a13);
-    double cp = (a13 - a12) * w0p * w0p - 2.0 * a13 * b12 * w0p + a13;
+int p3p(const Vector3View &x, const PointMap &map, const int *indices, std::vector<CameraPose> *output) {
+    const int n_sols = p3p<double>(x, map.view(indices, 3), output);
+    for (CameraPose &pose : *output) {
+        map.denormalize(&pose);
+    }
+    return n_sols;
+}
 
-    double an = (a13 - a12) * w1n * w1n + 2.0 * a12 * b13 * w1n - a12;
-    double bn = 2.0 * a12 * b13 * w0n - 2.0 * a13 * b12 * w1n - 2.0 * w0n * w1n * (a12 - a13);
-    double cn = (a13 - a12) * w0n * w0n - 2.0 * a13 * b12 * w0n + a13;
+// Batched implementation of the solver above. Each lane holds one problem instance. The lane-wise functions are
+// templated on the lanes, i.e. batch::Lanes (double) or batch::Lanesf (single precision, twice as many instances).
+namespace {
+
+using batch::Lanes;
+using batch::Lanesf;
+
+// Lane-wise version of compute_eig3x3known0. Here M is symmetric and E is stored column-wise, i.e. E[col][row].
+template <typename L>
+inline void compute_eig3x3known0_batch(const L M[3][3], L E[2][3], L &sig1, L &sig2) {
+    const L p1 = -M[0][0] - M[1][1] - M[2][2];
+    const L p0 = -M[0][1] * M[0][1] - M[0][2] * M[0][2] - M[1][2] * M[1][2] + M[0][0] * (M[1][1] + M[2][2]) + M[1][1] * M[2][2];
+
+    const L disc = (p1 * p1 / 4.0 - p0).max(0.0).sqrt();
+    const L tmp = -p1 / 2.0;
+    const L s1 = tmp + disc;
+    const L s2 = tmp - disc;
+
+    const L swap = batch::less(L(s1.abs()), L(s2.abs()));
+    sig1 = batch::select(swap, s2, s1);
+    sig2 = batch::select(swap, s1, s2);
+
+    for (int k = 0; k < 2; ++k) {
+        const L &sig = (k == 0) ? sig1 : sig2;
+        const L c = sig * sig + M[0][0] * M[1][1] - sig * (M[0][0] + M[1][1]) - M[0][1] * M[0][1];
+        const L a1 = (sig * M[0][2] + M[0][1] * M[1][2] - M[0][2] * M[1][1]) / c;
+        const L a2 = (sig * M[1][2] + M[0][1] * M[0][2] - M[0][0] * M[1][2]) / c;
+        const L n = (1.0 + a1 * a1 + a2 * a2).rsqrt();
+        E[k][0] = a1 * n;
+        E[k][1] = a2 * n;
+        E[k][2] = n;
+    }
+}
 
-    double lambda1, lambda2, lambda3;
-    CameraPose pose;
-    output->clear();
-    Eigen::Matrix3d XX;
+// Lane-wise version of refine_lambda. Lanes which have converged are left unchanged.
+template <typename L>
+inline void refine_lambda_batch(L &lambda1, L &lambda2, L &lambda3, const L &a12, const L &a13, const L &a23,
+                                const L &b12, const L &b13, const L &b23) {
 
-    XX << dX12, dX13, dX12.cross(dX13);
-    XX = XX.inverse().eval();
+    for (int iter = 0; iter < 5; ++iter) {
+        const L r1 = (lambda1 * lambda1 - 2.0 * lambda1 * lambda2 * b12 + lambda2 * lambda2 - a12);
+        const L r2 = (lambda1 * lambda1 - 2.0 * lambda1 * lambda3 * b13 + lambda3 * lambda3 - a13);
+        const L r3 = (lambda2 * lambda2 - 2.0 * lambda2 * lambda3 * b23 + lambda3 * lambda3 - a23);
+        const L active = batch::logical_not(batch::less(L(r1.abs() + r2.abs() + r3.abs()), L::Constant(1e-10)));
+        if (!batch::any(active))
+            return;
+        const L x11 = lambda1 - lambda2 * b12;
+        const L x12 = lambda2 - lambda1 * b12;
+        const L x21 = lambda1 - lambda3 * b13;
+        const L x23 = lambda3 - lambda1 * b13;
+        const L x32 = lambda2 - lambda3 * b23;
+        const L x33 = lambda3 - lambda2 * b23;
+        const L detJ = batch::select(active, L(0.5 / (x11 * x23 * x32 + x12 * x21 * x33)), L::Zero());
+        lambda1 += (-x23 * x32 * r1 - x12 * x33 * r2 + x12 * x23 * r3) * detJ;
+        lambda2 += (-x21 * x33 * r1 + x11 * x33 * r2 - x11 * x23 * r3) * detJ;
+        lambda3 += (x21 * x32 * r1 - x11 * x32 * r2 - x12 * x21 * r3) * detJ;
+    }
+}
 
-    Eigen::Vector3d v1, v2;
-    Eigen::Matrix3d YY;
+// Squared distances a_ij = |X_i - X_j|^2 and cosines b_ij = x_i'*x_j for the three point pairs.
+template <typename L>
+struct P3PCoeffsBatch {
+    L a12, a13, a23, b12, b13, b23;
+};
+
+// Computes the coefficients above together with dX12 = X[0] - X[1] and dX13 = X[0] - X[2].
+template <typename L>
+inline void p3p_coeffs_batch(const L x[3][3], const L X[3][3], P3PCoeffsBatch<L> &c, L dX12[3], L dX13[3]) {
+    L dX23[3];
+    for (int k = 0; k < 3; ++k) {
+        dX12[k] = X[0][k] - X[1][k];
+        dX13[k] = X[0][k] - X[2][k];
+        dX23[k] = X[1][k] - X[2][k];
+    }
+    c.a12 = batch::dot(dX12, dX12);
+    c.b12 = batch::dot(x[0], x[1]);
+    c.a13 = batch::dot(dX13, dX13);
+    c.b13 = batch::dot(x[0], x[2]);
+    c.a23 = batch::dot(dX23, dX23);
+    c.b23 = batch::dot(x[1], x[2]);
+}
 
-    double b2m4ac = bp * bp - 4.0 * ap * cp;
+// Loads the instances starting at row start. The matrices can be of either precision.
+template <typename Derived, typename L>
+inline void p3p_load_batch(const Eigen::MatrixBase<Derived> &xs, const Eigen::MatrixBase<Derived> &Xs, int start,
+                           L x[3][3], L X[3][3]) {
+    for (int i = 0; i < 3; ++i) {
+        batch::load3(xs, 3 * i, start, x[i]);
+        batch::load3(Xs, 3 * i, start, X[i]);
+    }
+}
 
-    if (b2m4ac > 0) {
-        double sq = std::sqrt(b2m4ac);
+// Lane-wise version of p3p_gamma, split into the coefficients of the cubic below and the newton step in
+// p3p_degenerate_conic_batch. D1 and D2 are symmetric and stored by columns, i.e. D[col][row], and c holds the
+// coefficients of the normalized cubic det(D1 + gamma*D2) = gamma^3 + c[2]*gamma^2 + c[1]*gamma + c[0].
+template <typename L>
+void p3p_cubic_batch(const P3PCoeffsBatch<L> &coeffs, L D1[3][3], L D2[3][3], L c[3]) {
+    const L &a12 = coeffs.a12, &a13 = coeffs.a13, &a23 = coeffs.a23;
+    const L &b12 = coeffs.b12, &b13 = coeffs.b13, &b23 = coeffs.b23;
+
+    const L a23b12 = a23 * b12;
+    const L a12b23 = a12 * b23;
+    const L a23b13 = a23 * b13;
+    const L a13b23 = a13 * b23;
+
+    const L zero = L::Zero();
+    const L D1_[3][3] = {{a23, -a23b12, zero}, {-a23b12, a23 - a12, a12b23}, {zero, a12b23, -a12}};
+    const L D2_[3][3] = {{a23, zero, -a23b13}, {zero, -a13, a13b23}, {-a23b13, a13b23, a23 - a13}};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            D1[i][j] = D1_[i][j];
+            D2[i][j] = D2_[i][j];
+        }
+    }
 
-        // first root
-        double tau = (bp > 0) ? (2.0 * cp) / (-bp - sq) : (2.0 * cp) / (-bp + sq);
+    L DX1[3][3], DX2[3][3];
+    for (int k = 0; k < 3; ++k) {
+        batch::cross(D1[(k + 1) % 3], D1[(k + 2) % 3], DX1[k]);
+        batch::cross(D2[(k + 1) % 3], D2[(k + 2) % 3], DX2[k]);
+    }
 
-        if (tau > 0) {
-            lambda2 = std::sqrt(a23 / (tau * (tau - 2.0 * b23) + 1.0));
-            lambda3 = tau * lambda2;
-            lambda1 = w0p * lambda2 + w1p * lambda3;
+    // Coefficients of p(gamma) = det(D1 + gamma*D2)
+    const L c3inv = batch::dot(D2[0], DX2[0]).inverse();
+    c[2] = (batch::dot(D1[0], DX2[0]) + batch::dot(D1[1], DX2[1]) + batch::dot(D1[2], DX2[2])) * c3inv;
+    c[1] = (batch::dot(D2[0], DX1[0]) + batch::dot(D2[1], DX1[1]) + batch::dot(D2[2], DX1[2])) * c3inv;
+    c[0] = batch::dot(D1[0], DX1[0]) * c3inv;
+}
 
-            if (lambda1 > 0) {
-                refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
-                v1 = lambda1 * x[0] - lambda2 * x[1];
-                v2 = lambda1 * x[0] - lambda3 * x[2];
-                YY << v1, v2, v1.cross(v2);
-                pose.R = YY * XX;
-                pose.t = lambda1 * x[0] - pose.R * X[0];
-                output->push_back(pose);
-            }
-        }
+// A newton step on the cubic equation, followed by the degenerate conic D0 = D1 + gamma*D2.
+template <typename L>
+void p3p_degenerate_conic_batch(const L D1[3][3], const L D2[3][3], const L c[3], L gamma, L D0[3][3]) {
+    const L f = gamma * gamma * gamma + c[2] * gamma * gamma + c[1] * gamma + c[0];
+    const L df = 3.0 * gamma * gamma + 2.0 * c[2] * gamma + c[1];
+    gamma = gamma - f / df;
 
-        // Second root
-        tau = cp / (ap * tau);
-
-        if (tau > 0) {
-            lambda2 = std::sqrt(a23 / (tau * (tau - 2.0 * b23) + 1.0));
-            lambda3 = tau * lambda2;
-            lambda1 = w0p * lambda2 + w1p * lambda3;
-
-            if (lambda1 > 0) {
-                refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
-                v1 = lambda1 * x[0] - lambda2 * x[1];
-                v2 = lambda1 * x[0] - lambda3 * x[2];
-                YY << v1, v2, v1.cross(v2);
-                pose.R = YY * XX;
-                pose.t = lambda1 * x[0] - pose.R * X[0];
-                output->push_back(pose);
-            }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            D0[i][j] = D1[i][j] + gamma * D2[i][j];
         }
     }
+}
 
-    // Second pair of roots
-    b2m4ac = bn * bn - 4.0 * an * cn;
+// Computes the (unrefined) depths of the candidate solutions from the degenerate conic, in the same order as the
+// scalar solver, together with a mask indicating which are valid.
+template <typename L>
+void p3p_depths_batch(const P3PCoeffsBatch<L> &c, const L D0[3][3], L lambda[4][3], L valid[4]) {
+    const L &a12 = c.a12, &a13 = c.a13, &a23 = c.a23;
+    const L &b12 = c.b12, &b13 = c.b13, &b23 = c.b23;
+    const L zero = L::Zero();
+
+    L E[2][3];
+    L sig1, sig2;
+    compute_eig3x3known0_batch(D0, E, sig1, sig2);
+
+    const L s = (-sig2 / sig1).max(0.0).sqrt();
+
+    const L w0p = (E[0][1] - s * E[1][1]) / (s * E[1][0] - E[0][0]);
+    const L w1p = (-s * E[1][2] + E[0][2]) / (s * E[1][0] - E[0][0]);
+
+    const L w0n = (E[0][1] + s * E[1][1]) / (-s * E[1][0] - E[0][0]);
+    const L w1n = (s * E[1][2] + E[0][2]) / (-s * E[1][0] - E[0][0]);
+
+    const L ap = (a13 - a12) * w1p * w1p + 2.0 * a12 * b13 * w1p - a12;
+    const L bp = -2.0 * a13 * b12 * w1p + 2.0 * a12 * b13 * w0p - 2.0 * w0p * w1p * (a12 - a13);
+    const L cp = (a13 - a12) * w0p * w0p - 2.0 * a13 * b12 * w0p + a13;
+
+    const L an = (a13 - a12) * w1n * w1n + 2.0 * a12 * b13 * w1n - a12;
+    const L bn = 2.0 * a12 * b13 * w0n - 2.0 * a13 * b12 * w1n - 2.0 * w0n * w1n * (a12 - a13);
+    const L cn = (a13 - a12) * w0n * w0n - 2.0 * a13 * b12 * w0n + a13;
+
+    // Roots of the two quadratics. Each gives two candidates for tau.
+    L tau[4];
+    L has_roots[2];
+    L w0[4], w1[4];
+    for (int k = 0; k < 2; ++k) {
+        const L &qa = (k == 0) ? ap : an;
+        const L &qb = (k == 0) ? bp : bn;
+        const L &qc = (k == 0) ? cp : cn;
+        const L b2m4ac = qb * qb - 4.0 * qa * qc;
+        has_roots[k] = batch::greater(b2m4ac, zero);
+        const L sq = b2m4ac.max(0.0).sqrt();
+        tau[2 * k] = (2.0 * qc) / (-qb - batch::select(batch::greater(qb, zero), sq, L(-sq)));
+        tau[2 * k + 1] = qc / (qa * tau[2 * k]);
+        w0[2 * k] = w0[2 * k + 1] = (k == 0) ? w0p : w0n;
+        w1[2 * k] = w1[2 * k + 1] = (k == 0) ? w1p : w1n;
+    }
 
-    if (b2m4ac > 0) {
-        double sq = std::sqrt(b2m4ac);
+    for (int k = 0; k < 4; ++k) {
+        valid[k] = batch::logical_and(has_roots[k / 2], batch::greater(tau[k], zero));
+        if (!batch::any(valid[k]))
+            continue;
 
-        // first root
-        double tau = (bn > 0) ? (2.0 * cn) / (-bn - sq) : (2.0 * cn) / (-bn + sq);
+        lambda[k][1] = (a23 / (tau[k] * (tau[k] - 2.0 * b23) + 1.0)).max(0.0).sqrt();
+        lambda[k][2] = tau[k] * lambda[k][1];
+        lambda[k][0] = w0[k] * lambda[k][1] + w1[k] * lambda[k][2];
+        valid[k] = batch::logical_and(valid[k], batch::greater(lambda[k][0], zero));
+    }
+}
 
-        if (tau > 0) {
-            lambda2 = std::sqrt(a23 / (tau * (tau - 2.0 * b23) + 1.0));
-            lambda3 = tau * lambda2;
-            lambda1 = w0n * lambda2 + w1n * lambda3;
+// Refines the depths of the valid candidates and recovers their poses.
+template <typename L>
+void p3p_poses_batch(const L x[3][3], const L X[3][3], const P3PCoeffsBatch<L> &c, const L dX12[3], const L dX13[3],
+                     L lambda[4][3], const L valid[4], L R[4][3][3], L t[4][3]) {
+    // XX = [dX12 dX13 dX12 x dX13]^-1
+    L dX12xdX13[3];
+    batch::cross(dX12, dX13, dX12xdX13);
+    L XX[3][3];
+    const L XX0[3][3] = {{dX12[0], dX13[0], dX12xdX13[0]},
+                         {dX12[1], dX13[1], dX12xdX13[1]},
+                         {dX12[2], dX13[2], dX12xdX13[2]}};
+    batch::inverse3x3(XX0, XX);
+
+    for (int k = 0; k < 4; ++k) {
+        if (!batch::any(valid[k]))
+            continue;
+
+        L &lambda1 = lambda[k][0], &lambda2 = lambda[k][1], &lambda3 = lambda[k][2];
+        refine_lambda_batch(lambda1, lambda2, lambda3, c.a12, c.a13, c.a23, c.b12, c.b13, c.b23);
+
+        L v1[3], v2[3], v3[3];
+        for (int i = 0; i < 3; ++i) {
+            v1[i] = lambda1 * x[0][i] - lambda2 * x[1][i];
+            v2[i] = lambda1 * x[0][i] - lambda3 * x[2][i];
+        }
+        batch::cross(v1, v2, v3);
 
-            if (lambda1 > 0) {
-                refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
-                v1 = lambda1 * x[0] - lambda2 * x[1];
-                v2 = lambda1 * x[0] - lambda3 * x[2];
-                YY << v1, v2, v1.cross(v2);
-                pose.R = YY * XX;
-                pose.t = lambda1 * x[0] - pose.R * X[0];
-                output->push_back(pose);
+        // R = YY * XX and t = lambda1 * x[0] - R * X[0]
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                R[k][i][j] = v1[i] * XX[0][j] + v2[i] * XX[1][j] + v3[i] * XX[2][j];
             }
+            t[k][i] = lambda1 * x[0][i] - (R[k][i][0] * X[0][0] + R[k][i][1] * X[0][1] + R[k][i][2] * X[0][2]);
         }
+    }
+}
 
-        // Second root
-        tau = cn / (an * tau);
-
-        if (tau > 0) {
-            lambda2 = std::sqrt(a23 / (tau * (tau - 2.0 * b23) + 1.0));
-            lambda3 = tau * lambda2;
-            lambda1 = w0n * lambda2 + w1n * lambda3;
-
-            if (lambda1 > 0) {
-                refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
-                v1 = lambda1 * x[0] - lambda2 * x[1];
-                v2 = lambda1 * x[0] - lambda3 * x[2];
-                YY << v1, v2, v1.cross(v2);
-                pose.R = YY * XX;
-                pose.t = lambda1 * x[0] - pose.R * X[0];
-                output->push_back(pose);
+// Appends the valid candidates of the first n_lanes lanes to output and records their number in num_solutions,
+// starting at instance start.
+template <typename L, typename Real>
+void p3p_store_batch(const L R[4][3][3], const L t[4][3], const L valid[4], int start, int n_lanes,
+                     std::vector<CameraPoseT<Real>> *output, std::vector<int> *num_solutions) {
+    CameraPoseT<Real> pose;
+    for (int lane = 0; lane < n_lanes; ++lane) {
+        int n_sols = 0;
+        for (int k = 0; k < 4; ++k) {
+            if (!batch::test(valid[k], lane))
+                continue;
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    pose.R(i, j) = R[k][i][j](lane);
+                }
+                pose.t(i) = t[k][i](lane);
             }
+            output->push_back(pose);
+            n_sols++;
         }
+        (*num_solutions)[start + lane] = n_sols;
+    }
+}
+
+template <typename L, typename Matrix, typename Real>
+int p3p_batch_impl(const Matrix &xs, const Matrix &Xs, std::vector<CameraPoseT<Real>> *output, std::vector<int> *num_solutions) {
+    const int lanes = L::SizeAtCompileTime;
+    const int n_instances = xs.rows();
+    output->clear();
+    output->reserve(2 * n_instances);
+    num_solutions->resize(n_instances);
+
+    L x[3][3], X[3][3], dX12[3], dX13[3];
+    P3PCoeffsBatch<L> c;
+    L D1[3][3], D2[3][3], cubic[3], gamma, D0[3][3];
+    L lambda[4][3], valid[4];
+    L R[4][3][3], t[4][3];
+    for (int start = 0; start < n_instances; start += lanes) {
+        p3p_load_batch(xs, Xs, start, x, X);
+        p3p_coeffs_batch(x, X, c, dX12, dX13);
+        p3p_cubic_batch(c, D1, D2, cubic);
+        univariate::solve_cubic_single_real(cubic[2], cubic[1], cubic[0], gamma);
+        p3p_degenerate_conic_batch(D1, D2, cubic, gamma, D0);
+        p3p_depths_batch(c, D0, lambda, valid);
+        p3p_poses_batch(x, X, c, dX12, dX13, lambda, valid, R, t);
+        p3p_store_batch(R, t, valid, start, std::min(lanes, n_instances - start), output, num_solutions);
     }
 
     return output->size();
 }
 
+} // namespace
+
+int p3p_batch(const Eigen::Matrix<double, Eigen::Dynamic, 9> &x, const Eigen::Matrix<double, Eigen::Dynamic, 9> &X,
+              std::vector<CameraPose> *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(p3p_batch, (x, X, output, num_solutions))
+    return p3p_batch_impl<Lanes>(x, X, output, num_solutions);
+}
+
+int p3p_batch(const BatchView<9> &x, const BatchView<9> &X, std::vector<CameraPose> *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(p3p_batch_view, (x, X, output, num_solutions))
+    return p3p_batch_impl<Lanes>(x, X, output, num_solutions);
+}
+
+int p3p_batch(const Eigen::Matrix<float, Eigen::Dynamic, 9> &x, const Eigen::Matrix<float, Eigen::Dynamic, 9> &X,
+              std::vector<CameraPosef> *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(p3p_batch_float, (x, X, output, num_solutions))
+    return p3p_batch_impl<Lanesf>(x, X, output, num_solutions);
+}
+
 } // namespace pose_lib
@@ -34,10 +34,58 @@
 
 namespace pose_lib {
 
+class PointMap;
+
+POSELIB_BEGIN_HEADER_ONLY
 // Solves for camera pose such that: lambda*x = R*X+t  with positive lambda.
 // Re-implementation of the Lambdatwist P3P solver from
 //    M. Persson, K. Nordberg, Lambda Twist: An Accurate Fast Robust Perspective Three Point (P3P) Solver, ECCV 2018
 // Note: this impl. assumes that x has been normalized.
-int p3p(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output);
+// Instantiated for Real = double and Real = float.
+template <typename Real>
+int p3p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, std::vector<CameraPoseT<Real>> *output);
+// Same as above but without any heap allocations. There are at most 4 solutions.
+template <typename Real>
+int p3p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, FixedVector<CameraPoseT<Real>, 4> *output);
+POSELIB_END_HEADER_ONLY
+
+#ifndef POSELIB_HEADER_ONLY
+// The double precision versions are explicit specializations, which can be dispatched at runtime (see misc/dispatch.h).
+template <>
+int p3p<double>(const Vector3View &x, const Vector3View &X, CameraPoseVector *output);
+template <>
+int p3p<double>(const Vector3View &x, const Vector3View &X, FixedVector<CameraPose, 4> *output);
+#endif
+
+// Same as above, but for the 3D points indices[0], indices[1], indices[2] of a preprocessed map (see point_map.h).
+// The solver works with the normalized points of the map and the poses are returned in the coordinates of the map.
+int p3p(const Vector3View &x, const PointMap &map, const int *indices, std::vector<CameraPose> *output);
+
+// Fused solve-and-score version of p3p. Instead of returning all solutions, each solution is directly scored against
+// the correspondences (x_all, X_all), where x_all are normalized image points, using compute_reprojection_score
+// (see residuals.h). A solution with a lower score than *best_score is stored in best_pose and *best_score is updated.
+// Initialize *best_score with std::numeric_limits<double>::max(), or with the best score from the previous samples
+// which allows the scoring of worse solutions to terminate early. Returns true if best_pose was updated.
+bool p3p_best(const Vector3View &x, const Vector3View &X,
+              const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all,
+              double threshold, CameraPose *best_pose, double *best_score);
+
+// Batched version of the solver above which solves many instances at once, processing several instances in parallel using SIMD.
+// The instances are given in structure-of-arrays layout where row i holds instance i, i.e.
+//    x.row(i) = [x[0]' x[1]' x[2]']  and  X.row(i) = [X[0]' X[1]' X[2]']
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// Returns the total number of solutions.
+int p3p_batch(const Eigen::Matrix<double, Eigen::Dynamic, 9> &x, const Eigen::Matrix<double, Eigen::Dynamic, 9> &X,
+              std::vector<CameraPose> *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int p3p_batch(const BatchView<9> &x, const BatchView<9> &X, std::vector<CameraPose> *output, std::vector<int> *num_solutions);
+
+// Single precision version, which processes twice as many instances in parallel. See p3p<float> for the accuracy.
+int p3p_batch(const Eigen::Matrix<float, Eigen::Dynamic, 9> &x, const Eigen::Matrix<float, Eigen::Dynamic, 9> &X,
+              std::vector<CameraPosef> *output, std::vector<int> *num_solutions);
 
 } // namespace pose_lib
+
+#ifdef POSELIB_HEADER_ONLY
+#include "p3p_inl.h"
+#endif
@@ -0,0 +1,283 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Definitions of the (non-batched) P3P solvers in p3p.h. In the header-only mode (see types.h) this file is included
+// by p3p.h, otherwise it is only included by p3p.cc.
+
+#pragma once
+
+#include "p3p.h"
+
+namespace pose_lib {
+POSELIB_BEGIN_HEADER_ONLY
+namespace detail {
+
+// Computes the eigen decomposition of a 3x3 matrix given that one eigenvalue is zero.
+template <typename Real>
+inline void compute_eig3x3known0(const Eigen::Matrix<Real, 3, 3> &M, Eigen::Matrix<Real, 3, 3> &E, Real &sig1, Real &sig2) {
+
+    // In the original paper there is a missing minus sign here (for M(0,0))
+    Real p1 = -M(0, 0) - M(1, 1) - M(2, 2);
+    Real p0 = -M(0, 1) * M(0, 1) - M(0, 2) * M(0, 2) - M(1, 2) * M(1, 2) + M(0, 0) * (M(1, 1) + M(2, 2)) + M(1, 1) * M(2, 2);
+
+    Real disc = std::sqrt(p1 * p1 / Real(4) - p0);
+    Real tmp = -p1 / Real(2);
+    sig1 = tmp + disc;
+    sig2 = tmp - disc;
+
+    if (std::abs(sig1) < std::abs(sig2))
+        std::swap(sig1, sig2);
+
+    Real c = sig1 * sig1 + M(0, 0) * M(1, 1) - sig1 * (M(0, 0) + M(1, 1)) - M(0, 1) * M(0, 1);
+    Real a1 = (sig1 * M(0, 2) + M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1)) / c;
+    Real a2 = (sig1 * M(1, 2) + M(0, 1) * M(0, 2) - M(0, 0) * M(1, 2)) / c;
+    Real n = Real(1) / std::sqrt(1 + a1 * a1 + a2 * a2);
+    E.col(0) << a1 * n, a2 * n, n;
+
+    c = sig2 * sig2 + M(0, 0) * M(1, 1) - sig2 * (M(0, 0) + M(1, 1)) - M(0, 1) * M(0, 1);
+    a1 = (sig2 * M(0, 2) + M(0, 1) * M(1, 2) - M(0, 2) * M(1, 1)) / c;
+    a2 = (sig2 * M(1, 2) + M(0, 1) * M(0, 2) - M(0, 0) * M(1, 2)) / c;
+    n = Real(1) / std::sqrt(1 + a1 * a1 + a2 * a2);
+    E.col(1) << a1 * n, a2 * n, n;
+
+    E.col(2) = M.col(1).cross(M.col(2)).normalized();
+}
+
+// Performs a few newton steps on the equations
+template <typename Real>
+inline void refine_lambda(Real &lambda1, Real &lambda2, Real &lambda3,
+                          const Real a12, const Real a13, const Real a23,
+                          const Real b12, const Real b13, const Real b23) {
+
+    for (int iter = 0; iter < 5; ++iter) {
+        Real r1 = (lambda1 * lambda1 - Real(2) * lambda1 * lambda2 * b12 + lambda2 * lambda2 - a12);
+        Real r2 = (lambda1 * lambda1 - Real(2) * lambda1 * lambda3 * b13 + lambda3 * lambda3 - a13);
+        Real r3 = (lambda2 * lambda2 - Real(2) * lambda2 * lambda3 * b23 + lambda3 * lambda3 - a23);
+        if (std::abs(r1) + std::abs(r2) + std::abs(r3) < Real(1e-10))
+            return;
+        Real x11 = lambda1 - lambda2 * b12;
+        Real x12 = lambda2 - lambda1 * b12;
+        Real x21 = lambda1 - lambda3 * b13;
+        Real x23 = lambda3 - lambda1 * b13;
+        Real x32 = lambda2 - lambda3 * b23;
+        Real x33 = lambda3 - lambda2 * b23;
+        Real detJ = Real(0.5) / (x11 * x23 * x32 + x12 * x21 * x33); // half minus inverse determinant
+        // This uses the closed form of the inverse for the jacobean.
+        // Due to the zero elements this actually becomes quite nice.
+        lambda1 += (-x23 * x32 * r1 - x12 * x33 * r2 + x12 * x23 * r3) * detJ;
+        lambda2 += (-x21 * x33 * r1 + x11 * x33 * r2 - x11 * x23 * r3) * detJ;
+        lambda3 += (x21 * x32 * r1 - x11 * x32 * r2 - x12 * x21 * r3) * detJ;
+    }
+}
+
+// Computes the root gamma of the cubic det(D1 + gamma*D2) from the squared distances a_ij = |X_i - X_j|^2 and the
+// cosines b_ij = x_i'*x_j.
+template <typename Real>
+inline Real p3p_gamma(Real a12, Real a13, Real a23, Real b12, Real b13, Real b23, Eigen::Matrix<Real, 3, 3> &D1, Eigen::Matrix<Real, 3, 3> &D2) {
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+
+    Real a23b12 = a23 * b12;
+    Real a12b23 = a12 * b23;
+    Real a23b13 = a23 * b13;
+    Real a13b23 = a13 * b23;
+
+    D1 << a23, -a23b12, Real(0), -a23b12, a23 - a12, a12b23, Real(0), a12b23, -a12;
+    D2 << a23, Real(0), -a23b13, Real(0), -a13, a13b23, -a23b13, a13b23, a23 - a13;
+
+    Matrix3 DX1, DX2;
+    DX1 << D1.col(1).cross(D1.col(2)), D1.col(2).cross(D1.col(0)), D1.col(0).cross(D1.col(1));
+    DX2 << D2.col(1).cross(D2.col(2)), D2.col(2).cross(D2.col(0)), D2.col(0).cross(D2.col(1));
+
+    // Coefficients of p(gamma) = det(D1 + gamma*D2)
+    // In the original paper c2 and c1 are switched.
+    Real c3 = D2.col(0).dot(DX2.col(0));
+    Real c2 = (D1.array() * DX2.array()).sum();
+    Real c1 = (D2.array() * DX1.array()).sum();
+    Real c0 = D1.col(0).dot(DX1.col(0));
+
+    // closed root solver for cubic root
+    const Real c3inv = Real(1) / c3;
+    c2 *= c3inv;
+    c1 *= c3inv;
+    c0 *= c3inv;
+
+    Real a = c1 - c2 * c2 / Real(3);
+    Real b = (Real(2) * c2 * c2 * c2 - Real(9) * c2 * c1) / Real(27) + c0;
+    Real c = b * b / Real(4) + a * a * a / Real(27);
+    Real gamma;
+    if (c > 0) {
+        c = std::sqrt(c);
+        b *= -Real(0.5);
+        gamma = std::cbrt(b + c) + std::cbrt(b - c) - c2 / Real(3);
+    } else {
+        c = Real(3) * b / (Real(2) * a) * std::sqrt(-Real(3) / a);
+        gamma = Real(2) * std::sqrt(-a / Real(3)) * std::cos(std::acos(c) / Real(3)) - c2 / Real(3);
+    }
+
+    // We do a single newton step on the cubic equation
+    Real f = gamma * gamma * gamma + c2 * gamma * gamma + c1 * gamma + c0;
+    Real df = Real(3) * gamma * gamma + Real(2) * c2 * gamma + c1;
+    return gamma - f / df;
+}
+
+// Computes the (unrefined) depths lambda_i of the three points given the root gamma from p3p_gamma. Returns the
+// number of candidates, where lambdas[k] = [lambda1 lambda2 lambda3].
+template <typename Real>
+inline int p3p_depths(Real a12, Real a13, Real a23, Real b12, Real b13, Real b23, const Eigen::Matrix<Real, 3, 3> &D1,
+               const Eigen::Matrix<Real, 3, 3> &D2, Real gamma, Real lambdas[4][3]) {
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+
+    Matrix3 D0 = D1 + gamma * D2;
+
+    Matrix3 E;
+    Real sig1, sig2;
+
+    compute_eig3x3known0(D0, E, sig1, sig2);
+
+    Real s = std::sqrt(-sig2 / sig1);
+
+    Real w0p = (E(1, 0) - s * E(1, 1)) / (s * E(0, 1) - E(0, 0));
+    Real w1p = (-s * E(2, 1) + E(2, 0)) / (s * E(0, 1) - E(0, 0));
+
+    Real w0n = (E(1, 0) + s * E(1, 1)) / (-s * E(0, 1) - E(0, 0));
+    Real w1n = (s * E(2, 1) + E(2, 0)) / (-s * E(0, 1) - E(0, 0));
+
+    // Note that these formulas differ from what is presented in the paper.
+    Real ap = (a13 - a12) * w1p * w1p + Real(2) * a12 * b13 * w1p - a12;
+    Real bp = -Real(2) * a13 * b12 * w1p + Real(2) * a12 * b13 * w0p - Real(2) * w0p * w1p * (a12 - a13);
+    Real cp = (a13 - a12) * w0p * w0p - Real(2) * a13 * b12 * w0p + a13;
+
+    Real an = (a13 - a12) * w1n * w1n + Real(2) * a12 * b13 * w1n - a12;
+    Real bn = Real(2) * a12 * b13 * w0n - Real(2) * a13 * b12 * w1n - Real(2) * w0n * w1n * (a12 - a13);
+    Real cn = (a13 - a12) * w0n * w0n - Real(2) * a13 * b12 * w0n + a13;
+
+    // Each of the two quadratics gives (at most) two positive ratios tau = lambda3 / lambda2
+    const Real w0[2] = {w0p, w0n};
+    const Real w1[2] = {w1p, w1n};
+    const Real qa[2] = {ap, an};
+    const Real qb[2] = {bp, bn};
+    const Real qc[2] = {cp, cn};
+
+    int n_sols = 0;
+    for (int k = 0; k < 2; ++k) {
+        const Real b2m4ac = qb[k] * qb[k] - Real(4) * qa[k] * qc[k];
+        if (b2m4ac <= 0) {
+            continue;
+        }
+        const Real sq = std::sqrt(b2m4ac);
+
+        // first root, the second root is then given by tau2 = c / (a * tau1)
+        Real tau[2];
+        tau[0] = (qb[k] > 0) ? (Real(2) * qc[k]) / (-qb[k] - sq) : (Real(2) * qc[k]) / (-qb[k] + sq);
+        tau[1] = qc[k] / (qa[k] * tau[0]);
+
+        for (int j = 0; j < 2; ++j) {
+            if (tau[j] > 0) {
+                const Real lambda2 = std::sqrt(a23 / (tau[j] * (tau[j] - Real(2) * b23) + Real(1)));
+                const Real lambda3 = tau[j] * lambda2;
+                const Real lambda1 = w0[k] * lambda2 + w1[k] * lambda3;
+                if (lambda1 > 0) {
+                    lambdas[n_sols][0] = lambda1;
+                    lambdas[n_sols][1] = lambda2;
+                    lambdas[n_sols][2] = lambda3;
+                    ++n_sols;
+                }
+            }
+        }
+    }
+    return n_sols;
+}
+
+// Recovers the pose from the depths of the three points, where XX is the inverse of [dX12 dX13 dX12 x dX13].
+template <typename Real>
+inline void p3p_pose_from_depths(const Vector3ViewT<Real> &x, const Vector3ViewT<Real> &X,
+                                 const Eigen::Matrix<Real, 3, 3> &XX, Real lambda1, Real lambda2, Real lambda3, CameraPoseT<Real> *pose) {
+    const Eigen::Matrix<Real, 3, 1> v1 = lambda1 * x[0] - lambda2 * x[1];
+    const Eigen::Matrix<Real, 3, 1> v2 = lambda1 * x[0] - lambda3 * x[2];
+    Eigen::Matrix<Real, 3, 3> YY;
+    YY << v1, v2, v1.cross(v2);
+    pose->R = YY * XX;
+    pose->t = lambda1 * x[0] - pose->R * X[0];
+}
+
+// Solves for camera pose such that: lambda*x = R*X+t  with positive lambda.
+// Output is either a std::vector or a FixedVector (with capacity of at least 4).
+template <typename Real, typename Output>
+inline int p3p_impl(const Vector3ViewT<Real> &x, const Vector3ViewT<Real> &X, Output *output) {
+    typedef Eigen::Matrix<Real, 3, 3> Matrix3;
+    typedef Eigen::Matrix<Real, 3, 1> Vector3;
+
+    Vector3 dX12 = X[0] - X[1];
+    Vector3 dX13 = X[0] - X[2];
+    Vector3 dX23 = X[1] - X[2];
+
+    Real a12 = dX12.squaredNorm();
+    Real b12 = x[0].dot(x[1]);
+
+    Real a13 = dX13.squaredNorm();
+    Real b13 = x[0].dot(x[2]);
+
+    Real a23 = dX23.squaredNorm();
+    Real b23 = x[1].dot(x[2]);
+
+    Matrix3 D1, D2;
+    const Real gamma = p3p_gamma(a12, a13, a23, b12, b13, b23, D1, D2);
+
+    Real lambdas[4][3];
+    const int n_sols = p3p_depths(a12, a13, a23, b12, b13, b23, D1, D2, gamma, lambdas);
+
+    Matrix3 XX;
+    XX << dX12, dX13, dX12.cross(dX13);
+    XX = XX.inverse().eval();
+
+    CameraPoseT<Real> pose;
+    output->clear();
+    for (int k = 0; k < n_sols; ++k) {
+        Real lambda1 = lambdas[k][0], lambda2 = lambdas[k][1], lambda3 = lambdas[k][2];
+        refine_lambda(lambda1, lambda2, lambda3, a12, a13, a23, b12, b13, b23);
+        p3p_pose_from_depths(x, X, XX, lambda1, lambda2, lambda3, &pose);
+        output->push_back(pose);
+    }
+
+    return output->size();
+}
+
+} // namespace detail
+
+template <typename Real>
+POSELIB_INLINE int p3p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, std::vector<CameraPoseT<Real>> *output) {
+    return detail::p3p_impl(x, X, output);
+}
+
+template <typename Real>
+POSELIB_INLINE int p3p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, FixedVector<CameraPoseT<Real>, 4> *output) {
+    return detail::p3p_impl(x, X, output);
+}
+
+POSELIB_END_HEADER_ONLY
+} // namespace pose_lib
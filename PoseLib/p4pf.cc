@@ -28,11 +28,31 @@
 
 #include "p4pf.h"
 #include "misc/re3q3.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p4pf(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-         std::vector<CameraPose> *output, bool filter_solutions) {
+namespace {
+
+// Checks that the solution is finite, that the focal length is positive and that the points are in front of the camera,
+// i.e. lambda*diag(1,1,alpha)*x = R*X+t with lambda > 0.
+bool valid_p4pf_solution(const CameraPose &pose, const Vector3View &x, const Vector3View &X) {
+    if (!validity::is_finite(pose) || pose.alpha <= 0)
+        return false;
+    for (int i = 0; i < 4; ++i) {
+        const double z = pose.R.row(2).dot(X[i]) + pose.t(2);
+        if (z * x[i](2) <= 0)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int p4pf(const Vector3View &x, const Vector3View &X,
+         std::vector<CameraPose> *output, bool filter_solutions, bool filter_invalid) {
+    POSELIB_DISPATCH(p4pf, (x, X, output, filter_solutions, filter_invalid))
 
     Eigen::Matrix<double, 2, 4> points2d;
     for (int i = 0; i < 4; ++i) {
@@ -89,7 +109,8 @@ int p4pf(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3
     }
 
     // [p31,p32,p33,p34] = B * [alpha; 1]
-    B = A.inverse() * B;
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    B = A.partialPivLu().solve(B);
 
     Eigen::Matrix<double, 3, 10> coeffs;
     Eigen::Matrix<double, 3, 8> solutions;
@@ -130,6 +151,9 @@ int p4pf(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3
         pose.t = P.block<3, 1>(0, 3);
         pose.alpha = focal * f0;
 
+        if (filter_invalid && !valid_p4pf_solution(pose, x, X))
+            continue;
+
         if (filter_solutions) {
             double res = std::abs(pose.R.row(0).squaredNorm() - 1.0) + std::abs(pose.R.row(1).squaredNorm() - 1.0);
             if (res < best_res) {
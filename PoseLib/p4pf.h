@@ -40,7 +40,9 @@ namespace pose_lib {
 // Note that this solver does not enforce that the rows of the rotation are consistent. This also be interpreted as
 // having non-unit aspect ratio, i.e. fx = f * R.row(0).norm() and fy = f * R.row(1).norm();
 // If filter_solutions is true, only the solution with aspect ratio closest to 1 is returned.
-int p4pf(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-         std::vector<CameraPose> *output, bool filter_solutions = true);
+// If filter_invalid is true, solutions with non-finite values, non-positive focal length or with any of the points
+// behind the camera are discarded.
+int p4pf(const Vector3View &x, const Vector3View &X,
+         std::vector<CameraPose> *output, bool filter_solutions = true, bool filter_invalid = false);
 
 } // namespace pose_lib
@@ -28,10 +28,13 @@
 
 #include "p5lp_radial.h"
 #include "misc/univariate.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p5lp_radial(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output) {
+int p5lp_radial(const Vector3View &l, const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p5lp_radial, (l, X, output, filter_invalid))
 
     // Setup nullspace
     Eigen::Matrix<double, 8, 5> cc;
@@ -123,9 +126,11 @@ int p5lp_radial(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::
         pose.t /= scale;
         pose.R.row(2) = pose.R.row(0).cross(pose.R.row(1));
 
+        if (filter_invalid && !validity::is_finite(pose))
+            continue;
         output->push_back(pose);
     }
-    return n_roots;
+    return output->size();
 }
 
 } // namespace pose_lib
\ No newline at end of file
@@ -40,6 +40,7 @@ namespace pose_lib {
 //   Kukelova et al., Real-Time Solution to the Absolute Pose Problem with Unknown Radial Distortion and Focal Length, ICCV 2013
 // Converting the 2D points to lines l = [-y,x,0]
 // Note that this solver always returns tz = 0 since it is not observable from these constraints.
-int p5lp_radial(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output);
+// If filter_invalid is true, solutions with non-finite values are discarded.
+int p5lp_radial(const Vector3View &l, const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid = false);
 
 } // namespace pose_lib
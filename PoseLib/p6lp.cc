@@ -28,10 +28,13 @@
 
 #include "p6lp.h"
 #include "misc/re3q3.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
 namespace pose_lib {
 
-int p6lp(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output) {
+int p6lp(const Vector3View &l, const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid) {
+    POSELIB_DISPATCH(p6lp, (l, X, output, filter_invalid))
 
     Eigen::Matrix3d A1, A2;
     Eigen::Matrix<double, 3, 9> B1, B2;
@@ -61,10 +64,12 @@ int p6lp(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3
         CameraPose pose;
         pose.R = Eigen::Quaterniond(solutions.col(i)).toRotationMatrix();
         pose.t = -B1 * Eigen::Map<Eigen::Matrix<double, 9, 1>>(pose.R.data());
+        if (filter_invalid && !validity::is_finite(pose))
+            continue;
         output->push_back(pose);
     }
 
-    return n_sols;
+    return output->size();
 }
 
 } // namespace pose_lib
@@ -37,6 +37,8 @@ namespace pose_lib {
 // Solves for camera pose such that: l'*(R*X+t) = 0
 // Relies on the E3Q3 solver from
 //    Kukelova et al., Efficient Intersection of Three Quadrics and Applications in Computer Vision, CVPR 2016
-int p6lp(const std::vector<Eigen::Vector3d> &l, const std::vector<Eigen::Vector3d> &X, std::vector<CameraPose> *output);
+// If filter_invalid is true, solutions with non-finite values are discarded. Note that the depth cannot be
+// checked from the line constraints alone.
+int p6lp(const Vector3View &l, const Vector3View &X, std::vector<CameraPose> *output, bool filter_invalid = false);
 
 } // namespace pose_lib
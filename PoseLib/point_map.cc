@@ -0,0 +1,109 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "point_map.h"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+namespace pose_lib {
+
+namespace {
+
+// Cell of the uniform grid used for finding the duplicated points.
+struct GridCell {
+    int64_t x, y, z;
+    bool operator==(const GridCell &other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct GridCellHash {
+    size_t operator()(const GridCell &c) const {
+        return static_cast<size_t>(c.x * 73856093LL) ^ static_cast<size_t>(c.y * 19349663LL) ^ static_cast<size_t>(c.z * 83492791LL);
+    }
+};
+
+} // namespace
+
+PointMap::PointMap() : center_(Eigen::Vector3d::Zero()), scale_(1.0) {}
+
+PointMap::PointMap(const std::vector<Eigen::Vector3d> &X, double duplicate_threshold) : PointMap() {
+    const size_t n = X.size();
+
+    if (n > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            center_ += X[i];
+        }
+        center_ /= static_cast<double>(n);
+
+        double sum_sq = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum_sq += (X[i] - center_).squaredNorm();
+        }
+        const double rms = std::sqrt(sum_sq / n);
+        if (rms > 0.0) {
+            scale_ = rms;
+        }
+    }
+
+    points.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        points[i] = (X[i] - center_) / scale_;
+    }
+
+    // Duplicated points are found by hashing the points into a grid with cell size duplicate_threshold,
+    // such that each point only needs to be compared with the points in the neighbouring cells.
+    ids.resize(n);
+    if (duplicate_threshold <= 0.0) {
+        for (size_t i = 0; i < n; ++i) {
+            ids[i] = i;
+        }
+        return;
+    }
+    const double threshold_sq = duplicate_threshold * duplicate_threshold;
+    std::unordered_multimap<GridCell, int, GridCellHash> grid;
+    grid.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const GridCell cell = {static_cast<int64_t>(std::floor(X[i](0) / duplicate_threshold)),
+                               static_cast<int64_t>(std::floor(X[i](1) / duplicate_threshold)),
+                               static_cast<int64_t>(std::floor(X[i](2) / duplicate_threshold))};
+        ids[i] = i;
+        for (int d = 0; d < 27 && ids[i] == static_cast<int>(i); ++d) {
+            const GridCell neighbour = {cell.x + d % 3 - 1, cell.y + (d / 3) % 3 - 1, cell.z + d / 9 - 1};
+            const auto range = grid.equal_range(neighbour);
+            for (auto it = range.first; it != range.second; ++it) {
+                if ((X[it->second] - X[i]).squaredNorm() < threshold_sq) {
+                    ids[i] = ids[it->second];
+                    break;
+                }
+            }
+        }
+        grid.emplace(cell, static_cast<int>(i));
+    }
+}
+
+} // namespace pose_lib
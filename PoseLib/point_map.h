@@ -0,0 +1,75 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "types.h"
+#include <Eigen/Dense>
+#include <vector>
+
+namespace pose_lib {
+
+// Preprocessed 3D points of a fixed map, for solving many minimal problems against the same map (e.g. localizing
+// many queries). The preprocessing is done once when the map is constructed:
+//   - the points are centered and scaled, such that the solvers work with well-conditioned coordinates also for maps
+//     in large (e.g. geo-referenced) coordinate systems,
+//   - points closer than duplicate_threshold are given the same point_id, which replaces the pairwise checks for
+//     duplicated points in the solvers (see gp4ps).
+// The solver overloads taking a PointMap (see p3p.h and gp4ps.h) take the indices of the sampled points in the map,
+// and return the poses in the original coordinate system of the map.
+class PointMap {
+  public:
+    PointMap();
+    explicit PointMap(const std::vector<Eigen::Vector3d> &X, double duplicate_threshold = 1e-5);
+
+    size_t size() const { return points.size(); }
+
+    // The points are stored as (X[i] - center()) / scale().
+    const std::vector<Eigen::Vector3d> &normalized_points() const { return points; }
+    const Eigen::Vector3d &center() const { return center_; }
+    double scale() const { return scale_; }
+
+    // Points with the same id are closer than duplicate_threshold. The id is the index of one of these points.
+    int point_id(int i) const { return ids[i]; }
+
+    // View of the normalized points indices[0], ..., indices[n - 1] without copying them.
+    Vector3View view(const int *indices, size_t n) const { return Vector3View(points.data(), n, indices); }
+
+    // Transforms a pose estimated from the normalized points into the original coordinate system,
+    // i.e. lambda*x = R*(X - center) / scale + t  becomes  lambda'*x = R*X + t'.
+    // For solvers estimating a scale (alpha) this has to be multiplied by scale() as well.
+    void denormalize(CameraPose *pose) const { pose->t = scale_ * pose->t - pose->R * center_; }
+
+  private:
+    std::vector<Eigen::Vector3d> points;
+    std::vector<int> ids;
+    Eigen::Vector3d center_;
+    double scale_;
+};
+
+} // namespace pose_lib
@@ -1,6 +1,9 @@
 #include "relpose_5pt.h"
+#include "misc/batch.h"
+#include "misc/dispatch.h"
 #include "misc/essential.h"
 #include "misc/sturm.h"
+#include "residuals.h"
 #include <Eigen/Dense>
 
 namespace pose_lib {
@@ -8,7 +11,8 @@ namespace pose_lib {
 // a, b are first order polys [x,y,z,1]
 // c is degree 2 poly with order
 // [ x^2, x*y, x*z, x, y^2, y*z, y, z^2, z, 1]
-inline void o1(const double a[4], const double b[4], double c[10]) {
+template <typename T>
+inline void o1(const T a[4], const T b[4], T c[10]) {
     c[0] = a[0] * b[0];
     c[1] = a[0] * b[1] + a[1] * b[0];
     c[2] = a[0] * b[2] + a[2] * b[0];
@@ -20,7 +24,8 @@ inline void o1(const double a[4], const double b[4], double c[10]) {
     c[8] = a[2] * b[3] + a[3] * b[2];
     c[9] = a[3] * b[3];
 }
-inline void o1p(const double a[4], const double b[4], double c[10]) {
+template <typename T>
+inline void o1p(const T a[4], const T b[4], T c[10]) {
     c[0] += a[0] * b[0];
     c[1] += a[0] * b[1] + a[1] * b[0];
     c[2] += a[0] * b[2] + a[2] * b[0];
@@ -32,7 +37,8 @@ inline void o1p(const double a[4], const double b[4], double c[10]) {
     c[8] += a[2] * b[3] + a[3] * b[2];
     c[9] += a[3] * b[3];
 }
-inline void o1m(const double a[4], const double b[4], double c[10]) {
+template <typename T>
+inline void o1m(const T a[4], const T b[4], T c[10]) {
     c[0] -= a[0] * b[0];
     c[1] -= a[0] * b[1] + a[1] * b[0];
     c[2] -= a[0] * b[2] + a[2] * b[0];
@@ -51,7 +57,8 @@ inline void o1m(const double a[4], const double b[4], double c[10]) {
 // [x y z 1]
 // c is third degree with order (same as nister's paper)
 // [ x^3, y^3, x^2*y, x*y^2, x^2*z, x^2, y^2*z, y^2, x*y*z, x*y, x*z^2, x*z, x, y*z^2, y*z, y, z^3, z^2, z, 1]
-inline void o2(const double a[10], const double b[4], double c[20]) {
+template <typename T>
+inline void o2(const T a[10], const T b[4], T c[20]) {
     c[0] = a[0] * b[0];
     c[1] = a[4] * b[1];
     c[2] = a[0] * b[1] + a[1] * b[0];
@@ -73,7 +80,8 @@ inline void o2(const double a[10], const double b[4], double c[20]) {
     c[18] = a[8] * b[3] + a[9] * b[2];
     c[19] = a[9] * b[3];
 }
-inline void o2p(const double a[10], const double b[4], double c[20]) {
+template <typename T>
+inline void o2p(const T a[10], const T b[4], T c[20]) {
     c[0] += a[0] * b[0];
     c[1] += a[4] * b[1];
     c[2] += a[0] * b[1] + a[1] * b[0];
@@ -96,17 +104,18 @@ inline void o2p(const double a[10], const double b[4], double c[20]) {
     c[19] += a[9] * b[3];
 }
 
-void compute_trace_constraints(const Eigen::Matrix<double, 4, 9> &N, Eigen::Matrix<double, 10, 20> &coeffs) {
-
-    double const *N_ptr = N.data();
+// Computes the coefficients of the trace constraints and the determinant constraint.
+// N is the 4x9 nullspace basis and coeffs the 10x20 coefficient matrix (both stored column-major).
+template <typename T>
+void compute_trace_constraints(const T *N_ptr, T *coeffs) {
 
 #define EE(i, j) N_ptr + 4 * (3 * j + i)
 
-    double d[60];
+    T d[60];
 
     // Determinant constraint
-    Eigen::Matrix<double, 1, 20> row;
-    double *c_data = row.data();
+    T row[20];
+    T *c_data = row;
 
     o1(EE(0, 1), EE(1, 2), d);
     o1m(EE(0, 2), EE(1, 1), d);
@@ -120,11 +129,12 @@ void compute_trace_constraints(const Eigen::Matrix<double, 4, 9> &N, Eigen::Matr
     o1m(EE(0, 1), EE(1, 0), d);
     o2p(d, EE(2, 2), c_data);
 
-    coeffs.row(9) = row;
+    for (int k = 0; k < 20; ++k)
+        coeffs[9 + 10 * k] = row[k];
 
-    double *EET[3][3] = {{d, d + 10, d + 20},
-                         {d + 10, d + 40, d + 30},
-                         {d + 20, d + 30, d + 50}};
+    T *EET[3][3] = {{d, d + 10, d + 20},
+                    {d + 10, d + 40, d + 30},
+                    {d + 20, d + 30, d + 50}};
 
     // Compute EE^T (equation 20 in paper)
     for (int i = 0; i < 3; ++i) {
@@ -137,7 +147,7 @@ void compute_trace_constraints(const Eigen::Matrix<double, 4, 9> &N, Eigen::Matr
 
     // Subtract trace (equation 22 in paper)
     for (int i = 0; i < 10; ++i) {
-        double t = 0.5 * (EET[0][0][i] + EET[1][1][i] + EET[2][2][i]);
+        T t = 0.5 * (EET[0][0][i] + EET[1][1][i] + EET[2][2][i]);
         EET[0][0][i] -= t;
         EET[1][1][i] -= t;
         EET[2][2][i] -= t;
@@ -149,42 +159,61 @@ void compute_trace_constraints(const Eigen::Matrix<double, 4, 9> &N, Eigen::Matr
             o2(EET[i][0], EE(0, j), c_data);
             o2p(EET[i][1], EE(1, j), c_data);
             o2p(EET[i][2], EE(2, j), c_data);
-            coeffs.row(cnt++) = row;
+            for (int k = 0; k < 20; ++k)
+                coeffs[cnt + 10 * k] = row[k];
+            cnt++;
         }
     }
 
 #undef EE
 }
 
-int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, std::vector<Eigen::Matrix3d> *essential_matrices) {
+template <typename Real>
+void compute_trace_constraints(const Eigen::Matrix<Real, 4, 9> &N, Eigen::Matrix<Real, 10, 20> &coeffs) {
+    compute_trace_constraints(N.data(), coeffs.data());
+}
+
+// Output is either a std::vector or a FixedVector (with capacity of at least 10).
+template <typename Real, typename Output>
+int relpose_5pt_impl(const Vector3ViewT<Real> &x1, const Vector3ViewT<Real> &x2,
+                     Output *essential_matrices, Relpose5ptWorkspace *ws) {
 
     // Compute nullspace to epipolar constraints
+    // The essential matrices are always computed in double precision, also for Real = float. The elimination and the
+    // degree 10 polynomial are too ill-conditioned for single precision, which loses about a quarter of the solutions.
+    // Only the conversion to poses (see below) is done in Real.
     Eigen::Matrix<double, 9, 5> epipolar_constraints;
     for (int i = 0; i < 5; ++i) {
-        epipolar_constraints.col(i) << x1[i](0) * x2[i], x1[i](1) * x2[i], x1[i](2) * x2[i];
+        for (int j = 0; j < 3; ++j) {
+            for (int k = 0; k < 3; ++k) {
+                epipolar_constraints(3 * j + k, i) = static_cast<double>(x1[i](j)) * static_cast<double>(x2[i](k));
+            }
+        }
     }
-    Eigen::Matrix<double, 9, 9> Q = epipolar_constraints.fullPivHouseholderQr().matrixQ();
+    ws->qr.compute(epipolar_constraints);
+    Eigen::Matrix<double, 9, 9> Q = ws->qr.matrixQ();
     Eigen::Matrix<double, 4, 9> N = Q.rightCols(4).transpose();
 
     // Compute equation coefficients for the trace constraints + determinant
-    Eigen::Matrix<double, 10, 20> coeffs;
+    Eigen::Matrix<double, 10, 20> &coeffs = ws->coeffs;
     compute_trace_constraints(N, coeffs);
-    coeffs.block<10, 10>(0, 10) = coeffs.block<10, 10>(0, 0).partialPivLu().solve(coeffs.block<10, 10>(0, 10));
+    ws->lu.compute(coeffs.template block<10, 10>(0, 0));
+    coeffs.template block<10, 10>(0, 10) = ws->lu.solve(coeffs.template block<10, 10>(0, 10));
 
     // Perform eliminations using the 6 bottom rows
     Eigen::Matrix<double, 3, 13> A;
     for (int i = 0; i < 3; ++i) {
         A(i, 0) = 0.0;
-        A.block<1, 3>(i, 1) = coeffs.block<1, 3>(4 + 2 * i, 10);
-        A.block<1, 3>(i, 0) -= coeffs.block<1, 3>(5 + 2 * i, 10);
+        A.template block<1, 3>(i, 1) = coeffs.template block<1, 3>(4 + 2 * i, 10);
+        A.template block<1, 3>(i, 0) -= coeffs.template block<1, 3>(5 + 2 * i, 10);
 
         A(i, 4) = 0.0;
-        A.block<1, 3>(i, 5) = coeffs.block<1, 3>(4 + 2 * i, 13);
-        A.block<1, 3>(i, 4) -= coeffs.block<1, 3>(5 + 2 * i, 13);
+        A.template block<1, 3>(i, 5) = coeffs.template block<1, 3>(4 + 2 * i, 13);
+        A.template block<1, 3>(i, 4) -= coeffs.template block<1, 3>(5 + 2 * i, 13);
 
         A(i, 8) = 0.0;
-        A.block<1, 4>(i, 9) = coeffs.block<1, 4>(4 + 2 * i, 16);
-        A.block<1, 4>(i, 8) -= coeffs.block<1, 4>(5 + 2 * i, 16);
+        A.template block<1, 4>(i, 9) = coeffs.template block<1, 4>(4 + 2 * i, 16);
+        A.template block<1, 4>(i, 8) -= coeffs.template block<1, 4>(5 + 2 * i, 16);
     }
 
     // Compute degree 10 poly representing determinant (equation 14 in the paper)
@@ -218,12 +247,12 @@ int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen:
         const double z3 = z2 * z;
         const double z4 = z2 * z2;
 
-        B.col(0) = A.block<3, 1>(0, 0) * z3 + A.block<3, 1>(0, 1) * z2 + A.block<3, 1>(0, 2) * z + A.block<3, 1>(0, 3);
-        B.col(1) = A.block<3, 1>(0, 4) * z3 + A.block<3, 1>(0, 5) * z2 + A.block<3, 1>(0, 6) * z + A.block<3, 1>(0, 7);
-        b = A.block<3, 1>(0, 8) * z4 + A.block<3, 1>(0, 9) * z3 + A.block<3, 1>(0, 10) * z2 + A.block<3, 1>(0, 11) * z + A.block<3, 1>(0, 12);
+        B.col(0) = A.template block<3, 1>(0, 0) * z3 + A.template block<3, 1>(0, 1) * z2 + A.template block<3, 1>(0, 2) * z + A.template block<3, 1>(0, 3);
+        B.col(1) = A.template block<3, 1>(0, 4) * z3 + A.template block<3, 1>(0, 5) * z2 + A.template block<3, 1>(0, 6) * z + A.template block<3, 1>(0, 7);
+        b = A.template block<3, 1>(0, 8) * z4 + A.template block<3, 1>(0, 9) * z3 + A.template block<3, 1>(0, 10) * z2 + A.template block<3, 1>(0, 11) * z + A.template block<3, 1>(0, 12);
 
         // We try to solve using top two rows
-        xz = B.block<2, 2>(0, 0).inverse() * b.block<2, 1>(0, 0);
+        xz = B.template block<2, 2>(0, 0).inverse() * b.template block<2, 1>(0, 0);
 
         // If this fails we revert to more expensive QR solver using all three rows
         if (std::abs(B.row(2) * xz - b(2)) > 1e-6) {
@@ -237,23 +266,450 @@ int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen:
         const double inv_norm = 1.0 / std::sqrt(x * x + y * y + z * z + 1.0);
         e *= inv_norm;
 
-        essential_matrices->push_back(E);
+        essential_matrices->push_back(E.template cast<Real>());
     }
 
     return n_sols;
 }
 
-int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, std::vector<CameraPose> *output) {
-    std::vector<Eigen::Matrix3d> essential_matrices;
-    int n_sols = relpose_5pt(x1, x2, &essential_matrices);
+// Each essential matrix gives at most one pose, so Output needs a capacity of at least 10 as well.
+template <typename Real, typename Output>
+int relpose_5pt_pose_impl(const Vector3ViewT<Real> &x1, const Vector3ViewT<Real> &x2,
+                          Output *output, Relpose5ptWorkspace *ws) {
+    FixedVector<Eigen::Matrix<Real, 3, 3>, 10> essential_matrices;
+    int n_sols = relpose_5pt_impl(x1, x2, &essential_matrices, ws);
 
     output->clear();
     output->reserve(n_sols);
-    for (int i = 0; i < n_sols; ++i) {        
-        motion_from_essential(essential_matrices[i], x1[0], x2[0], output);
+    CameraPoseT<Real> pose;
+    for (int i = 0; i < n_sols; ++i) {
+        if (motion_from_essential(essential_matrices[i], x1, x2, &pose)) {
+            output->push_back(pose);
+        }
+    }
+
+    return output->size();
+}
+
+// Runs the solver with the given workspace, or with a temporary one if workspace is nullptr.
+template <typename Real, typename Output>
+int relpose_5pt_essential(const Vector3ViewT<Real> &x1, const Vector3ViewT<Real> &x2,
+                          Output *essential_matrices, Relpose5ptWorkspace *workspace) {
+    if (workspace == nullptr) {
+        Relpose5ptWorkspace temporary;
+        return relpose_5pt_impl(x1, x2, essential_matrices, &temporary);
+    }
+    return relpose_5pt_impl(x1, x2, essential_matrices, workspace);
+}
+
+template <typename Real, typename Output>
+int relpose_5pt_pose(const Vector3ViewT<Real> &x1, const Vector3ViewT<Real> &x2,
+                     Output *output, Relpose5ptWorkspace *workspace) {
+    if (workspace == nullptr) {
+        Relpose5ptWorkspace temporary;
+        return relpose_5pt_pose_impl(x1, x2, output, &temporary);
+    }
+    return relpose_5pt_pose_impl(x1, x2, output, workspace);
+}
+
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                std::vector<Eigen::Matrix<Real, 3, 3>> *essential_matrices, Relpose5ptWorkspace *workspace) {
+    return relpose_5pt_essential(x1, x2, essential_matrices, workspace);
+}
+
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                FixedVector<Eigen::Matrix<Real, 3, 3>, 10> *essential_matrices, Relpose5ptWorkspace *workspace) {
+    return relpose_5pt_essential(x1, x2, essential_matrices, workspace);
+}
+
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                std::vector<CameraPoseT<Real>> *output, Relpose5ptWorkspace *workspace) {
+    return relpose_5pt_pose(x1, x2, output, workspace);
+}
+
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                FixedVector<CameraPoseT<Real>, 10> *output, Relpose5ptWorkspace *workspace) {
+    return relpose_5pt_pose(x1, x2, output, workspace);
+}
+
+// The dispatched double precision specializations declared in relpose_5pt.h.
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2,
+                        std::vector<Eigen::Matrix3d> *essential_matrices, Relpose5ptWorkspace *workspace) {
+    POSELIB_DISPATCH(relpose_5pt_essential, (x1, x2, essential_matrices, workspace))
+    return relpose_5pt_essential(x1, x2, essential_matrices, workspace);
+}
+
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2,
+                        FixedVector<Eigen::Matrix3d, 10> *essential_matrices, Relpose5ptWorkspace *workspace) {
+    POSELIB_DISPATCH(relpose_5pt_essential_fixed, (x1, x2, essential_matrices, workspace))
+    return relpose_5pt_essential(x1, x2, essential_matrices, workspace);
+}
+
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2,
+                        CameraPoseVector *output, Relpose5ptWorkspace *workspace) {
+    POSELIB_DISPATCH(relpose_5pt, (x1, x2, output, workspace))
+    return relpose_5pt_pose(x1, x2, output, workspace);
+}
+
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2,
+                        FixedVector<CameraPose, 10> *output, Relpose5ptWorkspace *workspace) {
+    POSELIB_DISPATCH(relpose_5pt_fixed, (x1, x2, output, workspace))
+    return relpose_5pt_pose(x1, x2, output, workspace);
+}
+
+bool relpose_5pt_best(const Vector3View &x1, const Vector3View &x2,
+                      const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all,
+                      double threshold, CameraPose *best_pose, double *best_score) {
+    POSELIB_DISPATCH(relpose_5pt_best, (x1, x2, x1_all, x2_all, threshold, best_pose, best_score))
+    FixedVector<Eigen::Matrix3d, 10> essential_matrices;
+    int n_sols = relpose_5pt(x1, x2, &essential_matrices);
+
+    // The Sampson error only depends on the essential matrix, so the pose is only recovered for the
+    // essential matrices which improve on the best score.
+    bool updated = false;
+    for (int i = 0; i < n_sols; ++i) {
+        const double score = compute_sampson_score(essential_matrices[i], x1_all, x2_all, threshold, *best_score);
+        if (score >= *best_score) {
+            continue;
+        }
+        if (!motion_from_essential(essential_matrices[i], x1, x2, best_pose)) {
+            continue;
+        }
+        *best_score = score;
+        updated = true;
+    }
+    return updated;
+}
+
+template int relpose_5pt<float>(const Vector3Viewf &, const Vector3Viewf &, std::vector<Eigen::Matrix3f> *, Relpose5ptWorkspacef *);
+template int relpose_5pt<float>(const Vector3Viewf &, const Vector3Viewf &, CameraPoseVectorf *, Relpose5ptWorkspacef *);
+template int relpose_5pt<float>(const Vector3Viewf &, const Vector3Viewf &, FixedVector<Eigen::Matrix3f, 10> *, Relpose5ptWorkspacef *);
+template int relpose_5pt<float>(const Vector3Viewf &, const Vector3Viewf &, FixedVector<CameraPosef, 10> *, Relpose5ptWorkspacef *);
+
+// Batched implementation of the solver above. Each lane holds one problem instance.
+namespace {
+
+using batch::Lanes;
+using batch::Mask;
+
+// Multiplies the polynomials a and b (coefficients in increasing degree) and adds (or subtracts) the result to c
+template <int Na, int Nb>
+inline void polymul_add(const Lanes a[Na], const Lanes b[Nb], Lanes c[Na + Nb - 1], double sign = 1.0) {
+    for (int i = 0; i < Na; ++i) {
+        for (int j = 0; j < Nb; ++j) {
+            c[i + j] += sign * a[i] * b[j];
+        }
+    }
+}
+
+// Computes the nullspace of the 9x5 epipolar constraints using Householder QR (without pivoting).
+// The nullspace basis is stored column-major in N, i.e. N[4 * k + i] is the k-th entry of the i-th basis vector.
+void nullspace_lanes(Lanes M[9][5], Lanes N[36]) {
+    Lanes v[5][9], beta[5];
+    for (int k = 0; k < 5; ++k) {
+        Lanes norm2 = M[k][k] * M[k][k];
+        for (int r = k + 1; r < 9; ++r)
+            norm2 += M[r][k] * M[r][k];
+        const Lanes norm = norm2.sqrt();
+        const Lanes alpha = batch::select(batch::less(M[k][k], Lanes::Zero()), norm, -norm);
+
+        v[k][k] = M[k][k] - alpha;
+        for (int r = k + 1; r < 9; ++r)
+            v[k][r] = M[r][k];
+        const Lanes vtv = norm2 - M[k][k] * M[k][k] + v[k][k] * v[k][k];
+        beta[k] = batch::select(batch::greater(vtv, Lanes::Zero()), 2.0 / vtv, Lanes::Zero());
+
+        for (int j = k + 1; j < 5; ++j) {
+            Lanes s = v[k][k] * M[k][j];
+            for (int r = k + 1; r < 9; ++r)
+                s += v[k][r] * M[r][j];
+            s *= beta[k];
+            for (int r = k; r < 9; ++r)
+                M[r][j] -= s * v[k][r];
+        }
+    }
+
+    // The nullspace is spanned by the last four columns of Q = H_0 * ... * H_4
+    for (int i = 0; i < 4; ++i) {
+        Lanes q[9];
+        for (int r = 0; r < 9; ++r)
+            q[r].setZero();
+        q[5 + i].setOnes();
+        for (int k = 4; k >= 0; --k) {
+            Lanes s = v[k][k] * q[k];
+            for (int r = k + 1; r < 9; ++r)
+                s += v[k][r] * q[r];
+            s *= beta[k];
+            for (int r = k; r < 9; ++r)
+                q[r] -= s * v[k][r];
+        }
+        for (int r = 0; r < 9; ++r)
+            N[4 * r + i] = q[r];
+    }
+}
+
+// Computes rows 4 to 9 of C1^-1 * C2 where coeffs = [C1 C2] (column-major 10x20) using LU with partial pivoting.
+void eliminate_lanes(const Lanes coeffs[200], Lanes X[10][10]) {
+    Lanes W[10][20];
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            W[i][j] = coeffs[i + 10 * j];
+        }
+    }
+
+    for (int k = 0; k < 10; ++k) {
+        // Find the pivot for each lane and swap it into row k
+        Lanes best = W[k][k].abs();
+        Lanes pivot = Lanes::Constant(k);
+        for (int i = k + 1; i < 10; ++i) {
+            const Mask m = batch::greater(W[i][k].abs(), best);
+            best = batch::select(m, W[i][k].abs(), best);
+            pivot = batch::select(m, Lanes::Constant(i), pivot);
+        }
+        for (int i = k + 1; i < 10; ++i) {
+            const Mask m = batch::equal(pivot, Lanes::Constant(i));
+            if (!batch::any(m))
+                continue;
+            for (int j = k; j < 20; ++j) {
+                const Lanes tmp = W[k][j];
+                W[k][j] = batch::select(m, W[i][j], W[k][j]);
+                W[i][j] = batch::select(m, tmp, W[i][j]);
+            }
+        }
+
+        const Lanes inv_pivot = W[k][k].inverse();
+        for (int i = k + 1; i < 10; ++i) {
+            const Lanes f = W[i][k] * inv_pivot;
+            for (int j = k + 1; j < 20; ++j) {
+                W[i][j] -= f * W[k][j];
+            }
+        }
+    }
+
+    // Back substitution. Only the bottom six rows are needed.
+    for (int i = 9; i >= 4; --i) {
+        const Lanes inv_diag = W[i][i].inverse();
+        for (int j = 0; j < 10; ++j) {
+            Lanes s = W[i][10 + j];
+            for (int k = i + 1; k < 10; ++k) {
+                s -= W[i][k] * X[k][j];
+            }
+            X[i][j] = s * inv_diag;
+        }
+    }
+}
+
+// Solves for LANES instances starting at row start. The (up to 10) essential matrices are stored column-major in E.
+template <typename Matrix>
+void relpose_5pt_lanes(const Matrix &x1s, const Matrix &x2s, int start, Lanes E[10][9], int n_sols[batch::LANES]) {
+    // Compute nullspace to epipolar constraints
+    Lanes M[9][5];
+    for (int i = 0; i < 5; ++i) {
+        Lanes x1[3], x2[3];
+        batch::load3(x1s, 3 * i, start, x1);
+        batch::load3(x2s, 3 * i, start, x2);
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) {
+                M[3 * a + b][i] = x1[a] * x2[b];
+            }
+        }
+    }
+    Lanes N[36];
+    nullspace_lanes(M, N);
+
+    // Compute equation coefficients for the trace constraints + determinant
+    Lanes coeffs[200];
+    compute_trace_constraints(N, coeffs);
+    Lanes X[10][10];
+    eliminate_lanes(coeffs, X);
+
+    // Perform eliminations using the 6 bottom rows
+    Lanes A[3][13];
+    for (int i = 0; i < 3; ++i) {
+        const Lanes *r0 = X[4 + 2 * i];
+        const Lanes *r1 = X[5 + 2 * i];
+        const int blocks[3][3] = {{0, 0, 3}, {4, 3, 3}, {8, 6, 4}}; // (first column in A, first column in X, length)
+        for (int k = 0; k < 3; ++k) {
+            const int a = blocks[k][0], s = blocks[k][1], len = blocks[k][2];
+            A[i][a] = -r1[s];
+            for (int m = 1; m < len; ++m)
+                A[i][a + m] = r0[s + m - 1] - r1[s + m];
+            A[i][a + len] = r0[s + len - 1];
+        }
+    }
+
+    // Compute degree 10 poly representing determinant (equation 14 in the paper).
+    // Instead of the expanded expression used above, we multiply out the 3x3 polynomial determinant.
+    Lanes P[3][3][5];
+    for (int i = 0; i < 3; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            P[i][0][k] = A[i][3 - k];
+            P[i][1][k] = A[i][7 - k];
+        }
+        for (int k = 0; k < 5; ++k) {
+            P[i][2][k] = A[i][12 - k];
+        }
+    }
+    Lanes m0[8], m1[8], m2[7], c[11];
+    for (int k = 0; k < 8; ++k) {
+        m0[k].setZero();
+        m1[k].setZero();
+    }
+    for (int k = 0; k < 7; ++k)
+        m2[k].setZero();
+    for (int k = 0; k < 11; ++k)
+        c[k].setZero();
+    polymul_add<4, 5>(P[1][1], P[2][2], m0);
+    polymul_add<5, 4>(P[1][2], P[2][1], m0, -1.0);
+    polymul_add<4, 5>(P[1][0], P[2][2], m1);
+    polymul_add<5, 4>(P[1][2], P[2][0], m1, -1.0);
+    polymul_add<4, 4>(P[1][0], P[2][1], m2);
+    polymul_add<4, 4>(P[1][1], P[2][0], m2, -1.0);
+    polymul_add<4, 8>(P[0][0], m0, c);
+    polymul_add<4, 8>(P[0][1], m1, c, -1.0);
+    polymul_add<5, 7>(P[0][2], m2, c);
+
+    // Solve for the roots using sturm bracketing
+    Lanes roots[10];
+    sturm::bisect_sturm_lanes<10>(c, roots, n_sols);
+    const int max_sols = *std::max_element(n_sols, n_sols + batch::LANES);
+
+    // Back substitution to recover essential matrices
+    for (int j = 0; j < max_sols; ++j) {
+        const Lanes &z = roots[j];
+        const Lanes z2 = z * z;
+        const Lanes z3 = z2 * z;
+        const Lanes z4 = z2 * z2;
+
+        Lanes B[3][2], b[3];
+        for (int i = 0; i < 3; ++i) {
+            B[i][0] = A[i][0] * z3 + A[i][1] * z2 + A[i][2] * z + A[i][3];
+            B[i][1] = A[i][4] * z3 + A[i][5] * z2 + A[i][6] * z + A[i][7];
+            b[i] = A[i][8] * z4 + A[i][9] * z3 + A[i][10] * z2 + A[i][11] * z + A[i][12];
+        }
+
+        // We try to solve using top two rows
+        const Lanes inv_det = (B[0][0] * B[1][1] - B[0][1] * B[1][0]).inverse();
+        Lanes xz0 = (B[1][1] * b[0] - B[0][1] * b[1]) * inv_det;
+        Lanes xz1 = (B[0][0] * b[1] - B[1][0] * b[0]) * inv_det;
+
+        // If this fails we revert to more expensive QR solver using all three rows
+        const Mask failed = batch::greater((B[2][0] * xz0 + B[2][1] * xz1 - b[2]).abs(), Lanes::Constant(1e-6));
+        if (batch::any(failed)) {
+            for (int k = 0; k < batch::LANES; ++k) {
+                if (j >= n_sols[k] || !batch::test(failed, k))
+                    continue;
+                Eigen::Matrix<double, 3, 2> Bk;
+                Eigen::Matrix<double, 3, 1> bk;
+                for (int i = 0; i < 3; ++i) {
+                    Bk(i, 0) = B[i][0](k);
+                    Bk(i, 1) = B[i][1](k);
+                    bk(i) = b[i](k);
+                }
+                const Eigen::Vector2d xz = Bk.colPivHouseholderQr().solve(bk);
+                xz0(k) = xz(0);
+                xz1(k) = xz(1);
+            }
+        }
+
+        const Lanes x = -xz0, y = -xz1;
+
+        // Since the rows of N are orthogonal unit vectors, we can normalize the coefficients instead
+        const Lanes inv_norm = (x * x + y * y + z * z + 1.0).rsqrt();
+        for (int k = 0; k < 9; ++k) {
+            E[j][k] = (N[4 * k] * x + N[4 * k + 1] * y + N[4 * k + 2] * z + N[4 * k + 3]) * inv_norm;
+        }
+    }
+}
+
+template <typename Matrix>
+int relpose_5pt_batch_impl(const Matrix &x1, const Matrix &x2, std::vector<Eigen::Matrix3d> *essential_matrices,
+                           std::vector<int> *num_solutions) {
+    const int n_instances = x1.rows();
+    essential_matrices->clear();
+    essential_matrices->reserve(4 * n_instances);
+    num_solutions->resize(n_instances);
+
+    Lanes E[10][9];
+    int n_sols[batch::LANES];
+    Eigen::Matrix3d Ek;
+    for (int start = 0; start < n_instances; start += batch::LANES) {
+        relpose_5pt_lanes(x1, x2, start, E, n_sols);
+
+        const int n_lanes = std::min(batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            for (int j = 0; j < n_sols[lane]; ++j) {
+                for (int k = 0; k < 9; ++k) {
+                    Ek(k) = E[j][k](lane);
+                }
+                essential_matrices->push_back(Ek);
+            }
+            (*num_solutions)[start + lane] = n_sols[lane];
+        }
     }
+    return essential_matrices->size();
+}
 
+template <typename Matrix>
+int relpose_5pt_batch_impl(const Matrix &x1, const Matrix &x2, std::vector<CameraPose> *output, std::vector<int> *num_solutions) {
+    std::vector<Eigen::Matrix3d> essential_matrices;
+    std::vector<int> num_essentials;
+    relpose_5pt_batch_impl(x1, x2, &essential_matrices, &num_essentials);
+
+    const int n_instances = x1.rows();
+    output->clear();
+    output->reserve(essential_matrices.size());
+    num_solutions->resize(n_instances);
+
+    std::array<Eigen::Vector3d, 5> x1_i, x2_i;
+    int offset = 0;
+    for (int i = 0; i < n_instances; ++i) {
+        const size_t n_before = output->size();
+        for (int k = 0; k < 5; ++k) {
+            x1_i[k] = x1.template block<1, 3>(i, 3 * k).transpose();
+            x2_i[k] = x2.template block<1, 3>(i, 3 * k).transpose();
+        }
+        for (int j = 0; j < num_essentials[i]; ++j) {
+            motion_from_essential(essential_matrices[offset + j], x1_i, x2_i, output);
+        }
+        offset += num_essentials[i];
+        (*num_solutions)[i] = output->size() - n_before;
+    }
     return output->size();
 }
 
+} // namespace
+
+int relpose_5pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2,
+                      std::vector<Eigen::Matrix3d> *essential_matrices, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_5pt_batch_essential, (x1, x2, essential_matrices, num_solutions))
+    return relpose_5pt_batch_impl(x1, x2, essential_matrices, num_solutions);
+}
+
+int relpose_5pt_batch(const BatchView<15> &x1, const BatchView<15> &x2, std::vector<Eigen::Matrix3d> *essential_matrices,
+                      std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_5pt_batch_essential_view, (x1, x2, essential_matrices, num_solutions))
+    return relpose_5pt_batch_impl(x1, x2, essential_matrices, num_solutions);
+}
+
+int relpose_5pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2,
+                      std::vector<CameraPose> *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_5pt_batch, (x1, x2, output, num_solutions))
+    return relpose_5pt_batch_impl(x1, x2, output, num_solutions);
+}
+
+int relpose_5pt_batch(const BatchView<15> &x1, const BatchView<15> &x2, std::vector<CameraPose> *output,
+                      std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_5pt_batch_view, (x1, x2, output, num_solutions))
+    return relpose_5pt_batch_impl(x1, x2, output, num_solutions);
+}
+
 } // namespace pose_lib
\ No newline at end of file
@@ -33,9 +33,72 @@
 
 namespace pose_lib {
 
+// Scratch memory and decompositions for relpose_5pt which can be reused between calls, e.g. by creating one
+// workspace per thread. The members are internal to the solver. They are double precision, since the float
+// version also computes the essential matrices in double precision, so the same workspace is used for both.
+struct Relpose5ptWorkspace {
+    Eigen::FullPivHouseholderQR<Eigen::Matrix<double, 9, 5>> qr;
+    Eigen::Matrix<double, 10, 20> coeffs;
+    Eigen::PartialPivLU<Eigen::Matrix<double, 10, 10>> lu;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+typedef Relpose5ptWorkspace Relpose5ptWorkspacef;
+
 // Computes the essential matrix from five point correspondences.
 //    Nister, An Efficient Solution to the Five-Point Relative Pose Problem, PAMI 2004
-int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, std::vector<Eigen::Matrix3d> *essential_matrices);
-int relpose_5pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, std::vector<CameraPose> *output);
+// If workspace is given it is used for the scratch memory (see above), otherwise a temporary one is used.
+// Instantiated for Real = double and Real = float. The float version is only a float interface and not faster: it
+// converts the input and computes the essential matrices in double precision (single precision loses about a quarter
+// of the solutions), and returns them and the poses in float.
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                std::vector<Eigen::Matrix<Real, 3, 3>> *essential_matrices, Relpose5ptWorkspace *workspace = nullptr);
+// Each essential matrix gives (at most) one pose, chosen by cheirality voting over all five correspondences.
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                std::vector<CameraPoseT<Real>> *output, Relpose5ptWorkspace *workspace = nullptr);
+
+// Same as above but without any heap allocations. There are at most 10 essential matrices, and thus at most 10 poses.
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                FixedVector<Eigen::Matrix<Real, 3, 3>, 10> *essential_matrices, Relpose5ptWorkspace *workspace = nullptr);
+template <typename Real>
+int relpose_5pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                FixedVector<CameraPoseT<Real>, 10> *output, Relpose5ptWorkspace *workspace = nullptr);
+
+// The double precision versions are explicit specializations, which can be dispatched at runtime (see misc/dispatch.h).
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2, std::vector<Eigen::Matrix3d> *essential_matrices,
+                        Relpose5ptWorkspace *workspace);
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output, Relpose5ptWorkspace *workspace);
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2, FixedVector<Eigen::Matrix3d, 10> *essential_matrices,
+                        Relpose5ptWorkspace *workspace);
+template <>
+int relpose_5pt<double>(const Vector3View &x1, const Vector3View &x2, FixedVector<CameraPose, 10> *output,
+                        Relpose5ptWorkspace *workspace);
+
+// Fused solve-and-score version of relpose_5pt (see p3p_best in p3p.h) using compute_sampson_score, where x1_all and
+// x2_all are normalized image points. The essential matrices are scored directly and the pose is only recovered for
+// those that improve on *best_score.
+bool relpose_5pt_best(const Vector3View &x1, const Vector3View &x2,
+                      const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all,
+                      double threshold, CameraPose *best_pose, double *best_score);
+
+// Batched versions of the solvers above which solve many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. x1.row(i) = [x1[0]' ... x1[4]'] and x2.row(i) = [x2[0]' ... x2[4]'].
+// The solutions for all instances are stored consecutively and num_solutions[i] is the number of solutions for instance i.
+// Note that the solutions for an instance are not necessarily returned in the same order as by relpose_5pt.
+int relpose_5pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2,
+                      std::vector<Eigen::Matrix3d> *essential_matrices, std::vector<int> *num_solutions);
+int relpose_5pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 15> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 15> &x2,
+                      std::vector<CameraPose> *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int relpose_5pt_batch(const BatchView<15> &x1, const BatchView<15> &x2, std::vector<Eigen::Matrix3d> *essential_matrices,
+                      std::vector<int> *num_solutions);
+int relpose_5pt_batch(const BatchView<15> &x1, const BatchView<15> &x2, std::vector<CameraPose> *output,
+                      std::vector<int> *num_solutions);
 
 }; // namespace pose_lib
@@ -28,6 +28,7 @@
 
 #include "relpose_8pt.h"
 #include "misc/essential.h"
+#include "misc/dispatch.h"
 #include <array>
 
 /**
@@ -37,7 +38,7 @@
  * Note that this does not resize the matrix A; it is expected to have the
  * appropriate size already (n x 9).
  */
-void encode_epipolar_equation(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, Eigen::Matrix<double, Eigen::Dynamic, 9> *A) {
+void encode_epipolar_equation(const pose_lib::Vector3View &x1, const pose_lib::Vector3View &x2, Eigen::Matrix<double, Eigen::Dynamic, 9> *A) {
     assert(x1.size() == x2.size());
     assert(A->cols() == 9);
     assert(A->rows() == x1.size());
@@ -48,7 +49,7 @@ void encode_epipolar_equation(const std::vector<Eigen::Vector3d> &x1, const std:
     }
 }
 
-void pose_lib::essential_matrix_8pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, Eigen::Matrix3d *essential_matrix) {
+void pose_lib::essential_matrix_8pt(const Vector3View &x1, const Vector3View &x2, Eigen::Matrix3d *essential_matrix) {
     assert(8 <= x1.size());
 
     using MatX9 = Eigen::Matrix<double, Eigen::Dynamic, 9>;
@@ -79,12 +80,13 @@ void pose_lib::essential_matrix_8pt(const std::vector<Eigen::Vector3d> &x1, cons
     (*essential_matrix) = E;
 }
 
-int pose_lib::relpose_8pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output) {
+int pose_lib::relpose_8pt(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output) {
+    POSELIB_DISPATCH(relpose_8pt, (x1, x2, output))
 
     Eigen::Matrix3d essential_matrix;
     essential_matrix_8pt(x1, x2, &essential_matrix);
-    // Generate plausible relative motion from E
+    // Generate the relative motion from E, using all correspondences to resolve the cheirality
     output->clear();
-    pose_lib::motion_from_essential(essential_matrix, x1[0], x2[0], output);
+    pose_lib::motion_from_essential(essential_matrix, x1, x2, output);
     return output->size();
 }
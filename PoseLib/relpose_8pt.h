@@ -34,12 +34,12 @@ namespace pose_lib {
 
 // Relative pose from eight to n bearing vector correspondences.
 // Port from OpenMVG (Essential_matrix computation then decomposition in 4 pose [R|t]).
-int relpose_8pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output);
+int relpose_8pt(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output);
 
 // Computation of essential matrix from eight to n bearing vector correspondences.
 // See page 294 in [HZ] Result 11.1.
 // [HZ] Multiple View Geometry - Richard Hartley, Andrew Zisserman - second edition
 // Port from OpenMVG
-void essential_matrix_8pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, Eigen::Matrix3d *essential_matrix);
+void essential_matrix_8pt(const Vector3View &x1, const Vector3View &x2, Eigen::Matrix3d *essential_matrix);
 
 }; // namespace pose_lib
@@ -29,10 +29,18 @@
 #include "relpose_upright_3pt.h"
 #include "misc/qep.h"
 #include "misc/essential.h"
+#include "misc/batch.h"
+#include "residuals.h"
+#include "misc/dispatch.h"
 
-int pose_lib::relpose_upright_3pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output) {
+namespace {
 
-    Eigen::Matrix<double, 3, 3> M, C, K;
+// Solves the quadratic eigenvalue problem for the rotations q = tan(theta / 2) and the translations (up to sign).
+template <typename Real>
+int relpose_upright_3pt_qep(const pose_lib::Vector3ViewT<Real> &x1, const pose_lib::Vector3ViewT<Real> &x2,
+                            Real eig_vals[4], Eigen::Matrix<Real, 3, 4> *eig_vecs) {
+
+    Eigen::Matrix<Real, 3, 3> M, C, K;
 
     M(0, 0) = x2[0](1) * x1[0](2) + x2[0](2) * x1[0](1);
     M(0, 1) = x2[0](2) * x1[0](0) - x2[0](0) * x1[0](2);
@@ -71,36 +79,223 @@ int pose_lib::relpose_upright_3pt(const std::vector<Eigen::Vector3d> &x1, const
     */
 
     // We know that (1+q^2) is a factor. Dividing by this gives degree 6 poly.
-    Eigen::Matrix<double, 3, 4> eig_vecs;
-    double eig_vals[4];
-    const int n_roots = qep::qep_div_1_q2(M, C, K, eig_vals, &eig_vecs);
+    return pose_lib::qep::qep_div_1_q2(M, C, K, eig_vals, eig_vecs);
+}
+
+
+template <typename Real>
+inline void relpose_upright_3pt_pose(Real q, const Eigen::Matrix<Real, 3, 1> &t, pose_lib::CameraPoseT<Real> *pose) {
+    const Real q2 = q * q;
+    const Real inv_norm = Real(1) / (1 + q2);
+    const Real cq = (1 - q2) * inv_norm;
+    const Real sq = 2 * q * inv_norm;
+
+    pose->R.setIdentity();
+    pose->R(0, 0) = cq;
+    pose->R(0, 2) = sq;
+    pose->R(2, 0) = -sq;
+    pose->R(2, 2) = cq;
+    pose->t = t;
+    pose->alpha = Real(1);
+}
+
+template <typename Real>
+int relpose_upright_3pt_impl(const pose_lib::Vector3ViewT<Real> &x1, const pose_lib::Vector3ViewT<Real> &x2,
+                             std::vector<pose_lib::CameraPoseT<Real>> *output) {
+    Eigen::Matrix<Real, 3, 4> eig_vecs;
+    Real eig_vals[4];
+    const int n_roots = relpose_upright_3pt_qep(x1, x2, eig_vals, &eig_vecs);
 
     output->clear();
     for (int i = 0; i < n_roots; ++i) {
-        pose_lib::CameraPose pose;
-        const double q = eig_vals[i];
-        const double q2 = q * q;
-        const double inv_norm = 1.0 / (1 + q2);
-        const double cq = (1 - q2) * inv_norm;
-        const double sq = 2 * q * inv_norm;
-
-        pose.R.setIdentity();
-        pose.R(0, 0) = cq;
-        pose.R(0, 2) = sq;
-        pose.R(2, 0) = -sq;
-        pose.R(2, 2) = cq;
-        pose.t = eig_vecs.col(i);
-        pose.alpha = 1.0;
-
-        if (check_cheirality(pose, x1[0], x2[0])) {
+        pose_lib::CameraPoseT<Real> pose;
+        relpose_upright_3pt_pose<Real>(eig_vals[i], eig_vecs.col(i), &pose);
+
+        if (pose_lib::check_cheirality(pose, x1[0], x2[0])) {
             output->push_back(pose);
         }
 
         // Solution with opposite sign for t
         pose.t = -pose.t;
-        if (check_cheirality(pose, x1[0], x2[0])) {
+        if (pose_lib::check_cheirality(pose, x1[0], x2[0])) {
             output->push_back(pose);
         }
     }
     return output->size();
 }
+
+} // namespace
+
+template <typename Real>
+int pose_lib::relpose_upright_3pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                                  std::vector<CameraPoseT<Real>> *output) {
+    return relpose_upright_3pt_impl(x1, x2, output);
+}
+
+// The dispatched double precision specialization declared in relpose_upright_3pt.h.
+template <>
+int pose_lib::relpose_upright_3pt<double>(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output) {
+    POSELIB_DISPATCH(relpose_upright_3pt, (x1, x2, output))
+    return relpose_upright_3pt_impl(x1, x2, output);
+}
+
+bool pose_lib::relpose_upright_3pt_best(const Vector3View &x1, const Vector3View &x2,
+                                        const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all,
+                                        double threshold, CameraPose *best_pose, double *best_score) {
+    POSELIB_DISPATCH(relpose_upright_3pt_best, (x1, x2, x1_all, x2_all, threshold, best_pose, best_score))
+    Eigen::Matrix<double, 3, 4> eig_vecs;
+    double eig_vals[4];
+    const int n_roots = relpose_upright_3pt_qep(x1, x2, eig_vals, &eig_vecs);
+
+    CameraPose pose;
+    bool updated = false;
+    for (int i = 0; i < n_roots; ++i) {
+        relpose_upright_3pt_pose<double>(eig_vals[i], eig_vecs.col(i), &pose);
+
+        // The Sampson error does not depend on the sign of t, so each rotation is scored once using whichever
+        // sign satisfies the cheirality constraint.
+        if (!check_cheirality(pose, x1[0], x2[0])) {
+            pose.t = -pose.t;
+            if (!check_cheirality(pose, x1[0], x2[0])) {
+                continue;
+            }
+        }
+
+        const double score = compute_sampson_score(pose, x1_all, x2_all, threshold, *best_score);
+        if (score < *best_score) {
+            *best_score = score;
+            *best_pose = pose;
+            updated = true;
+        }
+    }
+    return updated;
+}
+
+template int pose_lib::relpose_upright_3pt<float>(const Vector3Viewf &, const Vector3Viewf &, CameraPoseVectorf *);
+
+namespace {
+
+using pose_lib::batch::Lanes;
+using pose_lib::batch::Mask;
+
+// Solves for LANES instances starting at row start. For each of the (at most four) rotations q[k] the translation is
+// t[k] up to sign, and pos[k] / neg[k] indicate whether t[k] / -t[k] satisfies the cheirality constraint for the first
+// point correspondence.
+template <typename Matrix>
+void relpose_upright_3pt_lanes(const Matrix &x1s, const Matrix &x2s,
+                               int start, Lanes q[4], Lanes t[4][3], Mask pos[4], Mask neg[4]) {
+    Lanes M[3][3], C[3][3], K[3][3];
+    Lanes x1[3][3], x2[3][3];
+    for (int i = 0; i < 3; ++i) {
+        pose_lib::batch::load3(x1s, 3 * i, start, x1[i]);
+        pose_lib::batch::load3(x2s, 3 * i, start, x2[i]);
+
+        M[i][0] = x2[i][1] * x1[i][2] + x2[i][2] * x1[i][1];
+        M[i][1] = x2[i][2] * x1[i][0] - x2[i][0] * x1[i][2];
+        M[i][2] = -x2[i][0] * x1[i][1] - x2[i][1] * x1[i][0];
+
+        C[i][0] = 2.0 * x2[i][1] * x1[i][0];
+        C[i][1] = -2.0 * x2[i][0] * x1[i][0] - 2.0 * x2[i][2] * x1[i][2];
+        C[i][2] = 2.0 * x2[i][1] * x1[i][2];
+
+        K[i][0] = x2[i][2] * x1[i][1] - x2[i][1] * x1[i][2];
+        K[i][1] = x2[i][0] * x1[i][2] - x2[i][2] * x1[i][0];
+        K[i][2] = x2[i][1] * x1[i][0] - x2[i][0] * x1[i][1];
+    }
+
+    Mask valid[4];
+    pose_lib::qep::qep_div_1_q2(M, C, K, q, valid, t);
+
+    // Cheirality check (see check_cheirality) for the first correspondence. Flipping the sign of t flips the
+    // sign of both depths, so the check for -t comes for free.
+    const Lanes zero = Lanes::Zero();
+    for (int k = 0; k < 4; ++k) {
+        const Lanes q2 = q[k] * q[k];
+        const Lanes inv_norm = (1.0 + q2).inverse();
+        const Lanes cq = (1.0 - q2) * inv_norm;
+        const Lanes sq = 2.0 * q[k] * inv_norm;
+
+        Lanes Rx1[3];
+        Rx1[0] = cq * x1[0][0] + sq * x1[0][2];
+        Rx1[1] = x1[0][1];
+        Rx1[2] = cq * x1[0][2] - sq * x1[0][0];
+
+        const Lanes a = -pose_lib::batch::dot(Rx1, x2[0]);
+        const Lanes b1 = -pose_lib::batch::dot(Rx1, t[k]);
+        const Lanes b2 = pose_lib::batch::dot(x2[0], t[k]);
+        const Lanes lambda1 = b1 - a * b2;
+        const Lanes lambda2 = b2 - a * b1;
+
+        pos[k] = pose_lib::batch::logical_and(valid[k], pose_lib::batch::logical_and(pose_lib::batch::greater(lambda1, zero),
+                                                                                   pose_lib::batch::greater(lambda2, zero)));
+        neg[k] = pose_lib::batch::logical_and(valid[k], pose_lib::batch::logical_and(pose_lib::batch::less(lambda1, zero),
+                                                                                   pose_lib::batch::less(lambda2, zero)));
+    }
+}
+
+template <typename Matrix>
+int relpose_upright_3pt_batch_impl(const Matrix &x1, const Matrix &x2,
+                                   pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    const int n_instances = x1.rows();
+    output->clear();
+    output->reserve(4 * n_instances);
+    num_solutions->resize(n_instances);
+
+    Lanes q[4], t[4][3];
+    Mask pos[4], neg[4];
+    pose_lib::CameraPose pose;
+    pose.alpha = 1.0;
+    for (int start = 0; start < n_instances; start += pose_lib::batch::LANES) {
+        relpose_upright_3pt_lanes(x1, x2, start, q, t, pos, neg);
+
+        const int n_lanes = std::min(pose_lib::batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            int n_sols = 0;
+            for (int k = 0; k < 4; ++k) {
+                const bool use_pos = pose_lib::batch::test(pos[k], lane);
+                const bool use_neg = pose_lib::batch::test(neg[k], lane);
+                if (!use_pos && !use_neg) {
+                    continue;
+                }
+                const double qk = q[k](lane);
+                const double q2 = qk * qk;
+                const double inv_norm = 1.0 / (1 + q2);
+                const double cq = (1 - q2) * inv_norm;
+                const double sq = 2 * qk * inv_norm;
+
+                pose.R.setIdentity();
+                pose.R(0, 0) = cq;
+                pose.R(0, 2) = sq;
+                pose.R(2, 0) = -sq;
+                pose.R(2, 2) = cq;
+                pose.t << t[k][0](lane), t[k][1](lane), t[k][2](lane);
+
+                if (use_pos) {
+                    output->push_back(pose);
+                    n_sols++;
+                }
+                if (use_neg) {
+                    pose.t = -pose.t;
+                    output->push_back(pose);
+                    n_sols++;
+                }
+            }
+            (*num_solutions)[start + lane] = n_sols;
+        }
+    }
+    return output->size();
+}
+
+} // namespace
+
+int pose_lib::relpose_upright_3pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 9> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 9> &x2,
+                                        CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_upright_3pt_batch, (x1, x2, output, num_solutions))
+    return relpose_upright_3pt_batch_impl(x1, x2, output, num_solutions);
+}
+
+int pose_lib::relpose_upright_3pt_batch(const pose_lib::BatchView<9> &x1, const pose_lib::BatchView<9> &x2,
+                                        CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_upright_3pt_batch_view, (x1, x2, output, num_solutions))
+    return relpose_upright_3pt_batch_impl(x1, x2, output, num_solutions);
+}
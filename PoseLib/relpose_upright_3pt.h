@@ -29,11 +29,34 @@
 #pragma once
 #include "types.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace pose_lib {
 
 // Upright relative pose from three point correspondences, i.e.
 //   R * (p1 + lambda1 * x1) + t = p2 + lambda2 * x2
 //    Sweeney et al., Solving for Relative Pose with a Partially Known Rotation is a Quadratic Eigenvalue Problem, 3DV 2014
-int relpose_upright_3pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output);
+// Instantiated for Real = double and Real = float.
+template <typename Real>
+int relpose_upright_3pt(const Vector3ViewArgT<Real> &x1, const Vector3ViewArgT<Real> &x2,
+                        std::vector<CameraPoseT<Real>> *output);
+// The double precision version is an explicit specialization, which can be dispatched at runtime (see misc/dispatch.h).
+template <>
+int relpose_upright_3pt<double>(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output);
+
+// Fused solve-and-score version of relpose_upright_3pt (see p3p_best in p3p.h) using compute_sampson_score,
+// where x1_all and x2_all are normalized image points.
+bool relpose_upright_3pt_best(const Vector3View &x1, const Vector3View &x2,
+                              const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1_all, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2_all,
+                              double threshold, CameraPose *best_pose, double *best_score);
+
+// Batched version of relpose_upright_3pt which solves many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. x1.row(i) = [x1[0]' x1[1]' x1[2]'] and similarly for x2.
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// Returns the total number of solutions.
+int relpose_upright_3pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 9> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 9> &x2,
+                              CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int relpose_upright_3pt_batch(const BatchView<9> &x1, const BatchView<9> &x2, CameraPoseVector *output,
+                              std::vector<int> *num_solutions);
 }; // namespace pose_lib
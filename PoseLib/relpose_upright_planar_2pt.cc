@@ -27,68 +27,156 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "relpose_upright_planar_2pt.h"
+#include "relpose_upright_planar_2pt_inl.h"
 #include "misc/essential.h"
+#include "misc/batch.h"
+#include "misc/dispatch.h"
+
+namespace {
+
+using pose_lib::batch::Lanes;
+using pose_lib::batch::Mask;
+
+// Solves for LANES instances starting at row start. Each lane has up to two candidate essential matrices which are
+// factorized as in motion_from_essential_planar, i.e. R = [z0 0 -z1; 0 1 0; z1 0 z0] and t = +-[t0 0 t2].
+// pos[k] / neg[k] indicate whether the positive / negative translation satisfies the cheirality constraint
+// for the first point correspondence.
+template <typename Matrix>
+void relpose_upright_planar_2pt_lanes(const Matrix &x1s, const Matrix &x2s,
+                                      int start, Lanes z[2][2], Lanes t[2][2], Mask pos[2], Mask neg[2]) {
+    Lanes A[2][2], B[2][2], x1_0[3], x2_0[3];
+    for (int i = 0; i < 2; ++i) {
+        Lanes x1[3], x2[3];
+        pose_lib::batch::load3(x1s, 3 * i, start, x1);
+        pose_lib::batch::load3(x2s, 3 * i, start, x2);
+        A[i][0] = x2[1] * x1[0];
+        A[i][1] = -x2[1] * x1[2];
+        B[i][0] = x2[0] * x1[1];
+        B[i][1] = x2[2] * x1[1];
+        if (i == 0) {
+            std::copy(x1, x1 + 3, x1_0);
+            std::copy(x2, x2 + 3, x2_0);
+        }
+    }
 
-inline bool recover_a_b(const Eigen::Matrix<double, 2, 2> &C, double cos2phi, double sin2phi, Eigen::Vector2d &a, Eigen::Vector2d &b) {
-
-    if (std::abs(cos2phi) >= 1.0)
-        return false;
-
-    const double inv_sq2 = 1.0 / std::sqrt(2.0);
-    a << std::sqrt(1 + cos2phi) * inv_sq2, std::sqrt(1 - cos2phi) * inv_sq2;
-
-    if (sin2phi < 0)
-        a(1) = -a(1);
-
-    b = C * a;
+    // C = B^-1 * A
+    const Lanes inv_det = (B[0][0] * B[1][1] - B[0][1] * B[1][0]).inverse();
+    Lanes C[2][2];
+    for (int j = 0; j < 2; ++j) {
+        C[0][j] = (B[1][1] * A[0][j] - B[0][1] * A[1][j]) * inv_det;
+        C[1][j] = (B[0][0] * A[1][j] - B[1][0] * A[0][j]) * inv_det;
+    }
 
-    return true;
+    const Lanes alpha = C[0][0] * C[0][0] + C[1][0] * C[1][0];
+    const Lanes beta = 2.0 * (C[0][0] * C[0][1] + C[1][0] * C[1][1]);
+    const Lanes gamma = C[0][1] * C[0][1] + C[1][1] * C[1][1];
+    const Lanes alphap = alpha - gamma;
+    const Lanes gammap = alpha + gamma - 2.0;
+    const Lanes norm2 = alphap * alphap + beta * beta;
+    const Lanes inv_norm = norm2.inverse();
+    const Lanes disc2 = norm2 - gammap * gammap;
+
+    // In the degenerate case (disc2 < 0) we only have the closest non-degenerate solution, see the scalar version.
+    const Mask degenerate = pose_lib::batch::less(disc2, Lanes::Zero());
+    const Lanes inv_norm_degen = pose_lib::batch::select(pose_lib::batch::less(gammap, Lanes::Zero()), -inv_norm.sqrt(), inv_norm.sqrt());
+    const Lanes disc = pose_lib::batch::select(degenerate, Lanes::Zero(), disc2).sqrt();
+
+    Lanes cos2phi[2], sin2phi[2];
+    cos2phi[0] = pose_lib::batch::select(degenerate, -alphap * inv_norm_degen, (-alphap * gammap + beta * disc) * inv_norm);
+    sin2phi[0] = pose_lib::batch::select(degenerate, -beta * inv_norm_degen, (-beta * gammap - alphap * disc) * inv_norm);
+    cos2phi[1] = (-alphap * gammap - beta * disc) * inv_norm;
+    sin2phi[1] = (-beta * gammap + alphap * disc) * inv_norm;
+
+    const Lanes inv_sq2 = Lanes::Constant(1.0 / std::sqrt(2.0));
+    const Lanes zero = Lanes::Zero();
+    for (int k = 0; k < 2; ++k) {
+        // See recover_a_b in relpose_upright_planar_2pt_inl.h. Normalizing b in the degenerate case is not needed since t is normalized below.
+        Mask valid = pose_lib::batch::less(cos2phi[k].abs(), Lanes::Ones());
+        if (k == 1) {
+            valid = pose_lib::batch::logical_and(valid, pose_lib::batch::logical_not(degenerate));
+        }
+        const Lanes a0 = (1.0 + cos2phi[k]).max(0.0).sqrt() * inv_sq2;
+        Lanes a1 = (1.0 - cos2phi[k]).max(0.0).sqrt() * inv_sq2;
+        a1 = pose_lib::batch::select(pose_lib::batch::less(sin2phi[k], zero), -a1, a1);
+        const Lanes b0 = C[0][0] * a0 + C[0][1] * a1;
+        const Lanes b1 = C[1][0] * a0 + C[1][1] * a1;
+
+        // See motion_from_essential_planar with (e01, e21, e10, e12) = (b0, b1, -a0, a1)
+        const Lanes z0 = b0 * a0 - b1 * a1;
+        const Lanes z1 = b1 * a0 + b0 * a1;
+        const Lanes inv_norm_z = (z0 * z0 + z1 * z1).rsqrt();
+        z[k][0] = z0 * inv_norm_z;
+        z[k][1] = z1 * inv_norm_z;
+        const Lanes inv_norm_t = (b0 * b0 + b1 * b1).rsqrt();
+        t[k][0] = b1 * inv_norm_t;
+        t[k][1] = -b0 * inv_norm_t;
+
+        // Cheirality check (see check_cheirality). Flipping the sign of t flips the sign of both depths.
+        Lanes Rx1[3];
+        Rx1[0] = z[k][0] * x1_0[0] - z[k][1] * x1_0[2];
+        Rx1[1] = x1_0[1];
+        Rx1[2] = z[k][1] * x1_0[0] + z[k][0] * x1_0[2];
+        const Lanes a = -pose_lib::batch::dot(Rx1, x2_0);
+        const Lanes b1_t = -(Rx1[0] * t[k][0] + Rx1[2] * t[k][1]);
+        const Lanes b2_t = x2_0[0] * t[k][0] + x2_0[2] * t[k][1];
+        const Lanes lambda1 = b1_t - a * b2_t;
+        const Lanes lambda2 = b2_t - a * b1_t;
+
+        pos[k] = pose_lib::batch::logical_and(valid, pose_lib::batch::logical_and(pose_lib::batch::greater(lambda1, zero),
+                                                                                pose_lib::batch::greater(lambda2, zero)));
+        neg[k] = pose_lib::batch::logical_and(valid, pose_lib::batch::logical_and(pose_lib::batch::less(lambda1, zero),
+                                                                                pose_lib::batch::less(lambda2, zero)));
+    }
 }
 
-int pose_lib::relpose_upright_planar_2pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output) {
-
-    Eigen::Matrix<double, 2, 2> A, B, C;
-    Eigen::Vector2d a, b;
-
-    A << x2[0](1) * x1[0](0), -x2[0](1) * x1[0](2), x2[1](1) * x1[1](0), -x2[1](1) * x1[1](2);
-    B << x2[0](0) * x1[0](1), x2[0](2) * x1[0](1), x2[1](0) * x1[1](1), x2[1](2) * x1[1](1);
-    C = B.inverse() * A;
-
-    // There is a bug in the paper here where the factor 2 is missing from beta;
-    const double alpha = C.col(0).dot(C.col(0));
-    const double beta = 2.0 * C.col(0).dot(C.col(1));
-    const double gamma = C.col(1).dot(C.col(1));
-    const double alphap = alpha - gamma;
-    const double gammap = alpha + gamma - 2.0;
-    double inv_norm = 1.0 / (alphap * alphap + beta * beta);
-    const double disc2 = alphap * alphap + beta * beta - gammap * gammap;
-
+template <typename Matrix>
+int relpose_upright_planar_2pt_batch_impl(const Matrix &x1, const Matrix &x2,
+                                          pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    const int n_instances = x1.rows();
     output->clear();
-    if (disc2 < 0) {
-        // Degenerate situation. In this case we return the closest non-degen solution
-        // See equation (27) in the paper
-        inv_norm = std::sqrt(inv_norm);
-        if (gammap < 0)
-            inv_norm = -inv_norm;
-
-        if (recover_a_b(C, -alphap * inv_norm, -beta * inv_norm, a, b)) {
-            b.normalize();
-            motion_from_essential_planar(b(0), b(1), -a(0), a(1), x1[0], x2[0], output);
+    output->reserve(4 * n_instances);
+    num_solutions->resize(n_instances);
+
+    Lanes z[2][2], t[2][2];
+    Mask pos[2], neg[2];
+    pose_lib::CameraPose pose;
+    for (int start = 0; start < n_instances; start += pose_lib::batch::LANES) {
+        relpose_upright_planar_2pt_lanes(x1, x2, start, z, t, pos, neg);
+
+        const int n_lanes = std::min(pose_lib::batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            int n_sols = 0;
+            for (int k = 0; k < 2; ++k) {
+                const double z0 = z[k][0](lane);
+                const double z1 = z[k][1](lane);
+                pose.R << z0, 0.0, -z1, 0.0, 1.0, 0.0, z1, 0.0, z0;
+                pose.t << t[k][0](lane), 0.0, t[k][1](lane);
+                if (pose_lib::batch::test(pos[k], lane)) {
+                    output->push_back(pose);
+                    n_sols++;
+                }
+                if (pose_lib::batch::test(neg[k], lane)) {
+                    pose.t = -pose.t;
+                    output->push_back(pose);
+                    n_sols++;
+                }
+            }
+            (*num_solutions)[start + lane] = n_sols;
         }
-        return output->size();
     }
+    return output->size();
+}
 
-    const double disc = std::sqrt(disc2);
-
-    // First set of solutions
-    if (recover_a_b(C, (-alphap * gammap + beta * disc) * inv_norm, (-beta * gammap - alphap * disc) * inv_norm, a, b)) {
-        motion_from_essential_planar(b(0), b(1), -a(0), a(1), x1[0], x2[0], output);
-    }
+} // namespace
 
-    // Second set of solutions
-    if (recover_a_b(C, (-alphap * gammap - beta * disc) * inv_norm, (-beta * gammap + alphap * disc) * inv_norm, a, b)) {
-        motion_from_essential_planar(b(0), b(1), -a(0), a(1), x1[0], x2[0], output);
-    }
+int pose_lib::relpose_upright_planar_2pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 6> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 6> &x2,
+                                               CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_upright_planar_2pt_batch, (x1, x2, output, num_solutions))
+    return relpose_upright_planar_2pt_batch_impl(x1, x2, output, num_solutions);
+}
 
-    return output->size();
+int pose_lib::relpose_upright_planar_2pt_batch(const pose_lib::BatchView<6> &x1, const pose_lib::BatchView<6> &x2,
+                                               CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(relpose_upright_planar_2pt_batch_view, (x1, x2, output, num_solutions))
+    return relpose_upright_planar_2pt_batch_impl(x1, x2, output, num_solutions);
 }
@@ -29,9 +29,11 @@
 #pragma once
 #include "types.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace pose_lib {
 
+POSELIB_BEGIN_HEADER_ONLY
 /**
  * Two-point algorithm for solving for the essential matrix from bearing
  * vector correspondences assuming upright images.
@@ -41,6 +43,21 @@ namespace pose_lib {
  * Sunglok Choi, Jong-Hwan Kim, 2018
  *
  */
-int relpose_upright_planar_2pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output);
+int relpose_upright_planar_2pt(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output);
+POSELIB_END_HEADER_ONLY
+
+// Batched version of relpose_upright_planar_2pt which solves many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. x1.row(i) = [x1[0]' x1[1]'] and similarly for x2.
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// Returns the total number of solutions.
+int relpose_upright_planar_2pt_batch(const Eigen::Matrix<double, Eigen::Dynamic, 6> &x1, const Eigen::Matrix<double, Eigen::Dynamic, 6> &x2,
+                                     CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int relpose_upright_planar_2pt_batch(const BatchView<6> &x1, const BatchView<6> &x2, CameraPoseVector *output,
+                                     std::vector<int> *num_solutions);
 
 }; // namespace pose_lib
+
+#ifdef POSELIB_HEADER_ONLY
+#include "relpose_upright_planar_2pt_inl.h"
+#endif
@@ -28,8 +28,10 @@
 
 #include "relpose_upright_planar_3pt.h"
 #include "misc/essential.h"
+#include "misc/dispatch.h"
 
-int pose_lib::relpose_upright_planar_3pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output) {
+int pose_lib::relpose_upright_planar_3pt(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output) {
+    POSELIB_DISPATCH(relpose_upright_planar_3pt, (x1, x2, output))
 
     // Build the action matrix -> see (6,7) in the paper
     Eigen::Matrix<double, 4, 3> A;
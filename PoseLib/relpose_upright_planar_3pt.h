@@ -52,6 +52,6 @@ namespace pose_lib {
  *
  * Reimplementation from OpenMVG to PoseLib
  */
-int relpose_upright_planar_3pt(const std::vector<Eigen::Vector3d> &x1, const std::vector<Eigen::Vector3d> &x2, CameraPoseVector *output);
+int relpose_upright_planar_3pt(const Vector3View &x1, const Vector3View &x2, CameraPoseVector *output);
 
 }; // namespace pose_lib
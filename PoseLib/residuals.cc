@@ -0,0 +1,297 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "residuals.h"
+#include "misc/dispatch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pose_lib {
+
+// The correspondences are processed in blocks to keep the intermediate values on the stack (and in cache)
+static const int RESIDUAL_BLOCK_SIZE = 64;
+typedef Eigen::Array<double, Eigen::Dynamic, 1, 0, RESIDUAL_BLOCK_SIZE, 1> BlockArray;
+
+void compute_reprojection_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,
+                                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X,
+                                    Eigen::Matrix<double, Eigen::Dynamic, 2> *residuals,
+                                    Eigen::Matrix<double, Eigen::Dynamic, 12> *jacobian) {
+    POSELIB_DISPATCH(compute_reprojection_residuals, (pose, x, X, residuals, jacobian))
+    const Eigen::Matrix3d &R = pose.R;
+    const Eigen::Vector3d &t = pose.t;
+    const int n = X.rows();
+
+    residuals->resize(n, 2);
+    if (jacobian) {
+        jacobian->resize(n, 12);
+    }
+
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto X0 = X.col(0).segment(i, m).array();
+        const auto X1 = X.col(1).segment(i, m).array();
+        const auto X2 = X.col(2).segment(i, m).array();
+
+        const BlockArray Z0 = R(0, 0) * X0 + R(0, 1) * X1 + R(0, 2) * X2 + t(0);
+        const BlockArray Z1 = R(1, 0) * X0 + R(1, 1) * X1 + R(1, 2) * X2 + t(1);
+        const BlockArray inv_z = (R(2, 0) * X0 + R(2, 1) * X1 + R(2, 2) * X2 + t(2)).inverse();
+        const BlockArray p0 = Z0 * inv_z;
+        const BlockArray p1 = Z1 * inv_z;
+
+        residuals->col(0).segment(i, m).array() = p0 - x.col(0).segment(i, m).array();
+        residuals->col(1).segment(i, m).array() = p1 - x.col(1).segment(i, m).array();
+
+        if (!jacobian)
+            continue;
+
+        // For each residual r_k we have dr_k/dZ = a, and dZ/dw = -R*[X]_x which gives
+        //   dr_k/dw = X x (R'*a),  dr_k/dt = a
+        for (int k = 0; k < 2; ++k) {
+            const BlockArray &pk = (k == 0) ? p0 : p1;
+            const BlockArray a2 = -pk * inv_z;
+            const BlockArray u0 = R(k, 0) * inv_z + R(2, 0) * a2;
+            const BlockArray u1 = R(k, 1) * inv_z + R(2, 1) * a2;
+            const BlockArray u2 = R(k, 2) * inv_z + R(2, 2) * a2;
+
+            auto J = jacobian->block(i, 6 * k, m, 6).array();
+            J.col(0) = X1 * u2 - X2 * u1;
+            J.col(1) = X2 * u0 - X0 * u2;
+            J.col(2) = X0 * u1 - X1 * u0;
+            J.col(k + 3) = inv_z;
+            J.col(4 - k).setZero();
+            J.col(5) = a2;
+        }
+    }
+}
+
+void compute_angular_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,
+                               const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, Eigen::VectorXd *residuals) {
+    POSELIB_DISPATCH(compute_angular_residuals, (pose, x, X, residuals))
+    const Eigen::Matrix3d &R = pose.R;
+    const Eigen::Vector3d &t = pose.t;
+    const int n = X.rows();
+
+    residuals->resize(n);
+
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto X0 = X.col(0).segment(i, m).array();
+        const auto X1 = X.col(1).segment(i, m).array();
+        const auto X2 = X.col(2).segment(i, m).array();
+
+        const BlockArray Z0 = R(0, 0) * X0 + R(0, 1) * X1 + R(0, 2) * X2 + t(0);
+        const BlockArray Z1 = R(1, 0) * X0 + R(1, 1) * X1 + R(1, 2) * X2 + t(1);
+        const BlockArray Z2 = R(2, 0) * X0 + R(2, 1) * X1 + R(2, 2) * X2 + t(2);
+
+        const BlockArray xZ = x.col(0).segment(i, m).array() * Z0 + x.col(1).segment(i, m).array() * Z1 +
+                              x.col(2).segment(i, m).array() * Z2;
+
+        residuals->segment(i, m).array() = 1.0 - xZ * (Z0 * Z0 + Z1 * Z1 + Z2 * Z2).rsqrt();
+    }
+}
+
+void compute_sampson_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                               const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, Eigen::VectorXd *residuals,
+                               Eigen::Matrix<double, Eigen::Dynamic, 6> *jacobian) {
+    POSELIB_DISPATCH(compute_sampson_residuals, (pose, x1, x2, residuals, jacobian))
+    Eigen::Matrix3d tx;
+    tx << 0.0, -pose.t(2), pose.t(1),
+        pose.t(2), 0.0, -pose.t(0),
+        -pose.t(1), pose.t(0), 0.0;
+    const Eigen::Matrix3d E = tx * pose.R;
+    const int n = x1.rows();
+
+    // Derivatives of E w.r.t. the local update, i.e. dE/dw_k = [t]_x * R * [e_k]_x and dE/dt_k = [e_k]_x * R
+    Eigen::Matrix3d dE[6];
+    if (jacobian) {
+        jacobian->resize(n, 6);
+        for (int k = 0; k < 3; ++k) {
+            Eigen::Matrix3d ek = Eigen::Matrix3d::Zero();
+            ek((k + 2) % 3, (k + 1) % 3) = 1.0;
+            ek((k + 1) % 3, (k + 2) % 3) = -1.0;
+            dE[k] = E * ek;
+            dE[k + 3] = ek * pose.R;
+        }
+    }
+
+    residuals->resize(n);
+
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto x10 = x1.col(0).segment(i, m).array();
+        const auto x11 = x1.col(1).segment(i, m).array();
+        const auto x20 = x2.col(0).segment(i, m).array();
+        const auto x21 = x2.col(1).segment(i, m).array();
+
+        // E * x1 and E' * x2
+        const BlockArray Ex1_0 = E(0, 0) * x10 + E(0, 1) * x11 + E(0, 2);
+        const BlockArray Ex1_1 = E(1, 0) * x10 + E(1, 1) * x11 + E(1, 2);
+        const BlockArray Ex1_2 = E(2, 0) * x10 + E(2, 1) * x11 + E(2, 2);
+        const BlockArray Etx2_0 = E(0, 0) * x20 + E(1, 0) * x21 + E(2, 0);
+        const BlockArray Etx2_1 = E(0, 1) * x20 + E(1, 1) * x21 + E(2, 1);
+
+        const BlockArray C = x20 * Ex1_0 + x21 * Ex1_1 + Ex1_2;
+        const BlockArray inv_nJ = (Ex1_0 * Ex1_0 + Ex1_1 * Ex1_1 + Etx2_0 * Etx2_0 + Etx2_1 * Etx2_1).rsqrt();
+        const BlockArray r = C * inv_nJ;
+
+        residuals->segment(i, m).array() = r;
+
+        if (!jacobian)
+            continue;
+
+        // dr/dE_ij = (x2_i * x1_j - r / nJ * (Ex1_i * x1_j * [i<2] + Etx2_j * x2_i * [j<2])) / nJ
+        const BlockArray s = r * inv_nJ;
+        const BlockArray v0 = x20 - s * Ex1_0;
+        const BlockArray v1 = x21 - s * Ex1_1;
+        const BlockArray w0 = s * Etx2_0;
+        const BlockArray w1 = s * Etx2_1;
+
+        BlockArray dr[9];
+        dr[0] = (v0 * x10 - w0 * x20) * inv_nJ;
+        dr[1] = (v1 * x10 - w0 * x21) * inv_nJ;
+        dr[2] = (x10 - w0) * inv_nJ;
+        dr[3] = (v0 * x11 - w1 * x20) * inv_nJ;
+        dr[4] = (v1 * x11 - w1 * x21) * inv_nJ;
+        dr[5] = (x11 - w1) * inv_nJ;
+        dr[6] = v0 * inv_nJ;
+        dr[7] = v1 * inv_nJ;
+        dr[8] = inv_nJ;
+
+        for (int k = 0; k < 6; ++k) {
+            const double *G = dE[k].data();
+            jacobian->col(k).segment(i, m).array() = G[0] * dr[0] + G[1] * dr[1] + G[2] * dr[2] + G[3] * dr[3] +
+                                                     G[4] * dr[4] + G[5] * dr[5] + G[6] * dr[6] + G[7] * dr[7] +
+                                                     G[8] * dr[8];
+        }
+    }
+}
+
+double compute_reprojection_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,
+                                  const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold, double bound) {
+    POSELIB_DISPATCH(compute_reprojection_score, (pose, x, X, threshold, bound))
+    const Eigen::Matrix3d &R = pose.R;
+    const Eigen::Vector3d &t = pose.t;
+    const int n = X.rows();
+    const double sq_threshold = threshold * threshold;
+
+    double score = 0.0;
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto X0 = X.col(0).segment(i, m).array();
+        const auto X1 = X.col(1).segment(i, m).array();
+        const auto X2 = X.col(2).segment(i, m).array();
+
+        const BlockArray Z0 = R(0, 0) * X0 + R(0, 1) * X1 + R(0, 2) * X2 + t(0);
+        const BlockArray Z1 = R(1, 0) * X0 + R(1, 1) * X1 + R(1, 2) * X2 + t(1);
+        const BlockArray Z2 = R(2, 0) * X0 + R(2, 1) * X1 + R(2, 2) * X2 + t(2);
+        const BlockArray inv_z = Z2.inverse();
+        const BlockArray r0 = Z0 * inv_z - x.col(0).segment(i, m).array();
+        const BlockArray r1 = Z1 * inv_z - x.col(1).segment(i, m).array();
+
+        score += (Z2 > 0.0).select((r0 * r0 + r1 * r1).min(sq_threshold), sq_threshold).sum();
+        if (score > bound) {
+            break;
+        }
+    }
+    return score;
+}
+
+double compute_generalized_angular_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &p,
+                                         const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,
+                                         const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold,
+                                         double bound) {
+    POSELIB_DISPATCH(compute_generalized_angular_score, (pose, p, x, X, threshold, bound))
+    const Eigen::Matrix3d &R = pose.R;
+    const Eigen::Vector3d &t = pose.t;
+    const int n = X.rows();
+    const double sq_threshold = 1.0 - std::cos(threshold);
+
+    double score = 0.0;
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto X0 = X.col(0).segment(i, m).array();
+        const auto X1 = X.col(1).segment(i, m).array();
+        const auto X2 = X.col(2).segment(i, m).array();
+
+        const BlockArray Z0 = R(0, 0) * X0 + R(0, 1) * X1 + R(0, 2) * X2 + t(0) - p.col(0).segment(i, m).array();
+        const BlockArray Z1 = R(1, 0) * X0 + R(1, 1) * X1 + R(1, 2) * X2 + t(1) - p.col(1).segment(i, m).array();
+        const BlockArray Z2 = R(2, 0) * X0 + R(2, 1) * X1 + R(2, 2) * X2 + t(2) - p.col(2).segment(i, m).array();
+
+        const BlockArray xZ = x.col(0).segment(i, m).array() * Z0 + x.col(1).segment(i, m).array() * Z1 +
+                              x.col(2).segment(i, m).array() * Z2;
+
+        score += (1.0 - xZ * (Z0 * Z0 + Z1 * Z1 + Z2 * Z2).rsqrt()).min(sq_threshold).sum();
+        if (score > bound) {
+            break;
+        }
+    }
+    return score;
+}
+
+double compute_sampson_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                             const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold, double bound) {
+    POSELIB_DISPATCH(compute_sampson_score, (pose, x1, x2, threshold, bound))
+    Eigen::Matrix3d tx;
+    tx << 0.0, -pose.t(2), pose.t(1),
+        pose.t(2), 0.0, -pose.t(0),
+        -pose.t(1), pose.t(0), 0.0;
+    return compute_sampson_score(Eigen::Matrix3d(tx * pose.R), x1, x2, threshold, bound);
+}
+
+double compute_sampson_score(const Eigen::Matrix3d &E, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                             const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold, double bound) {
+    POSELIB_DISPATCH(compute_sampson_score_essential, (E, x1, x2, threshold, bound))
+    const int n = x1.rows();
+    const double sq_threshold = threshold * threshold;
+
+    double score = 0.0;
+    for (int i = 0; i < n; i += RESIDUAL_BLOCK_SIZE) {
+        const int m = std::min(RESIDUAL_BLOCK_SIZE, n - i);
+        const auto x10 = x1.col(0).segment(i, m).array();
+        const auto x11 = x1.col(1).segment(i, m).array();
+        const auto x20 = x2.col(0).segment(i, m).array();
+        const auto x21 = x2.col(1).segment(i, m).array();
+
+        const BlockArray Ex1_0 = E(0, 0) * x10 + E(0, 1) * x11 + E(0, 2);
+        const BlockArray Ex1_1 = E(1, 0) * x10 + E(1, 1) * x11 + E(1, 2);
+        const BlockArray Ex1_2 = E(2, 0) * x10 + E(2, 1) * x11 + E(2, 2);
+        const BlockArray Etx2_0 = E(0, 0) * x20 + E(1, 0) * x21 + E(2, 0);
+        const BlockArray Etx2_1 = E(0, 1) * x20 + E(1, 1) * x21 + E(2, 1);
+
+        const BlockArray C = x20 * Ex1_0 + x21 * Ex1_1 + Ex1_2;
+        const BlockArray nJ2 = Ex1_0 * Ex1_0 + Ex1_1 * Ex1_1 + Etx2_0 * Etx2_0 + Etx2_1 * Etx2_1;
+
+        score += (C * C / nJ2).min(sq_threshold).sum();
+        if (score > bound) {
+            break;
+        }
+    }
+    return score;
+}
+
+} // namespace pose_lib
@@ -0,0 +1,97 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "types.h"
+#include <Eigen/Dense>
+#include <limits>
+
+namespace pose_lib {
+
+// Residual kernels for evaluating a pose against many correspondences.
+// The correspondences are stored in structure-of-arrays layout, i.e. as N x 2 or N x 3 (column-major) matrices
+// where each column holds one coordinate for all of the N correspondences. This allows the kernels
+// to vectorize across the correspondences (using whichever SIMD instructions Eigen is compiled with).
+//
+// The optional Jacobians are w.r.t. the local update (w, t) where the pose is updated as
+//     R <- R * exp([w]_x),  t <- t + dt
+// and are returned in the same layout, with one row per correspondence.
+
+// Computes the reprojection residuals
+//     r_i = (R * X_i + t).hnormalized() - x_i
+// where x_i are normalized image points. The Jacobian is N x 12 where the first six columns are the
+// derivatives of the first coordinate of r_i and the last six columns the derivatives of the second.
+void compute_reprojection_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,
+                                    const Eigen::Matrix<double, Eigen::Dynamic, 3> &X,
+                                    Eigen::Matrix<double, Eigen::Dynamic, 2> *residuals,
+                                    Eigen::Matrix<double, Eigen::Dynamic, 12> *jacobian = nullptr);
+
+// Computes the angular residuals
+//     r_i = 1 - cos(angle(x_i, R * X_i + t))
+// where x_i are unit-length bearing vectors.
+void compute_angular_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,
+                               const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, Eigen::VectorXd *residuals);
+
+// Computes the (signed) Sampson residuals for the relative pose, i.e. r_i^2 is the Sampson error of
+//     x2_i' * E * x1_i = 0,   with E = [t]_x * R
+// where x1_i and x2_i are normalized image points. The Jacobian is N x 6.
+void compute_sampson_residuals(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                               const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, Eigen::VectorXd *residuals,
+                               Eigen::Matrix<double, Eigen::Dynamic, 6> *jacobian = nullptr);
+
+// Scoring kernels which evaluate a pose against many correspondences without storing the residuals.
+// They return the MSAC score sum_i min(r_i^2, threshold^2), i.e. lower is better. The correspondences are
+// processed in blocks and the evaluation stops early (returning a value larger than bound) as soon as the
+// partial score exceeds bound, which allows a hypothesis to be rejected as soon as it is worse than the
+// best one found so far.
+
+// Score using the reprojection residuals above. Points behind the camera are counted as outliers.
+double compute_reprojection_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x,
+                                  const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold,
+                                  double bound = std::numeric_limits<double>::max());
+
+// Score for generalized cameras, i.e. p_i + lambda * x_i = R * X_i + t, using the angular residual
+//     r_i^2 = 1 - cos(angle(x_i, R * X_i + t - p_i))
+// where x_i are unit-length bearing vectors. Here threshold is the maximum angle (in radians) for an inlier,
+// i.e. the residuals are truncated at 1 - cos(threshold).
+double compute_generalized_angular_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 3> &p,
+                                         const Eigen::Matrix<double, Eigen::Dynamic, 3> &x,
+                                         const Eigen::Matrix<double, Eigen::Dynamic, 3> &X, double threshold,
+                                         double bound = std::numeric_limits<double>::max());
+
+// Score using the Sampson residuals above.
+double compute_sampson_score(const CameraPose &pose, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                             const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold,
+                             double bound = std::numeric_limits<double>::max());
+// Same as above but for an essential (or fundamental) matrix E.
+double compute_sampson_score(const Eigen::Matrix3d &E, const Eigen::Matrix<double, Eigen::Dynamic, 2> &x1,
+                             const Eigen::Matrix<double, Eigen::Dynamic, 2> &x2, double threshold,
+                             double bound = std::numeric_limits<double>::max());
+
+} // namespace pose_lib
@@ -0,0 +1,92 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "solver_traits.h"
+#include <algorithm>
+
+namespace pose_lib {
+
+const std::vector<SolverInfo> &solver_registry() {
+    static const std::vector<SolverInfo> registry = [] {
+        std::vector<SolverInfo> list = {
+            make_solver_info<solvers::P3P>(),
+            make_solver_info<solvers::GP3P>(),
+            make_solver_info<solvers::GP4PS>(),
+            make_solver_info<solvers::P4PF>(),
+            make_solver_info<solvers::P2P2PL>(),
+            make_solver_info<solvers::P6LP>(),
+            make_solver_info<solvers::P5LP_Radial>(),
+            make_solver_info<solvers::P2P1LL>(),
+            make_solver_info<solvers::P1P2LL>(),
+            make_solver_info<solvers::P3LL>(),
+            make_solver_info<solvers::UP2P>(),
+            make_solver_info<solvers::UGP2P>(),
+            make_solver_info<solvers::UGP3PS>(),
+            make_solver_info<solvers::UP1P2PL>(),
+            make_solver_info<solvers::UP4PL>(),
+            make_solver_info<solvers::UGP4PL>(),
+            make_solver_info<solvers::Relpose5pt>(),
+            make_solver_info<solvers::Relpose8pt>(),
+            make_solver_info<solvers::RelposeUpright3pt>(),
+            make_solver_info<solvers::GenRelposeUpright4pt>(),
+            make_solver_info<solvers::RelposeUprightPlanar2pt>(),
+            make_solver_info<solvers::RelposeUprightPlanar3pt>(),
+        };
+        std::stable_sort(list.begin(), list.end(), [](const SolverInfo &a, const SolverInfo &b) {
+            return a.approx_runtime_ns < b.approx_runtime_ns;
+        });
+        return list;
+    }();
+    return registry;
+}
+
+const SolverInfo *find_solver(const std::string &name) {
+    for (const SolverInfo &solver : solver_registry()) {
+        if (name == solver.name)
+            return &solver;
+    }
+    return nullptr;
+}
+
+std::vector<const SolverInfo *> find_solvers(const SolverQuery &query) {
+    // Upright and planar solvers can be used if the query is upright (planar), all other flags must match.
+    const unsigned optional_flags = query.flags & (SOLVER_UPRIGHT | SOLVER_PLANAR);
+
+    std::vector<const SolverInfo *> result;
+    for (const SolverInfo &solver : solver_registry()) {
+        if (solver.problem != query.problem || (solver.flags & ~optional_flags) != (query.flags & ~optional_flags))
+            continue;
+        if (solver.num_point_point > query.num_point_point || solver.num_point_line > query.num_point_line ||
+            solver.num_line_point > query.num_line_point || solver.num_line_line > query.num_line_line)
+            continue;
+        result.push_back(&solver);
+    }
+    return result;
+}
+
+} // namespace pose_lib
@@ -0,0 +1,315 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "gen_relpose_upright_4pt.h"
+#include "gp3p.h"
+#include "gp4ps.h"
+#include "p1p2ll.h"
+#include "p2p1ll.h"
+#include "p2p2pl.h"
+#include "p3ll.h"
+#include "p3p.h"
+#include "p4pf.h"
+#include "p5lp_radial.h"
+#include "p6lp.h"
+#include "relpose_5pt.h"
+#include "relpose_8pt.h"
+#include "relpose_upright_3pt.h"
+#include "relpose_upright_planar_2pt.h"
+#include "relpose_upright_planar_3pt.h"
+#include "types.h"
+#include "ugp2p.h"
+#include "ugp3ps.h"
+#include "ugp4pl.h"
+#include "up1p2pl.h"
+#include "up2p.h"
+#include "up4pl.h"
+#include <string>
+#include <vector>
+
+namespace pose_lib {
+
+// Compile-time description of the minimal solvers, e.g. for sizing buffers in generic RANSAC code
+//    FixedVector<CameraPose, SolverTraits<solvers::P3P>::max_solutions> poses;
+// The solvers are identified by the tag types in pose_lib::solvers below. The number of correspondences of each type
+// follows the naming convention, i.e. point_point = 2D point to 3D point (2D point to 2D point for relative pose),
+// point_line = 2D point to 3D line, line_point = 2D line to 3D point and line_line = 2D line to 3D line.
+
+enum class ProblemType { ABSOLUTE_POSE, RELATIVE_POSE };
+
+// Assumptions made by the solver (UPRIGHT, PLANAR, GENERALIZED, RADIAL) and additional unknowns (SCALE, FOCAL).
+enum SolverFlags : unsigned {
+    SOLVER_UPRIGHT = 1,
+    SOLVER_PLANAR = 2,
+    SOLVER_GENERALIZED = 4,
+    SOLVER_RADIAL = 8,
+    SOLVER_SCALE = 16,
+    SOLVER_FOCAL = 32
+};
+
+// Input of SolverTraits<Solver>::solve and of the type-erased solvers in the registry. The fields are named as in
+// the naming convention and only the ones used by the solver need to be set.
+struct SolverInput {
+    // 2D point to 3D point, where p are the camera centers for generalized cameras
+    Vector3View x_point, X_point, p_point;
+    // 2D point to 3D line, where the 3D line passes through X_line with direction V_line
+    Vector3View x_line, X_line, V_line, p_line;
+    // 2D line to 3D point
+    Vector3View l_line_point, X_line_point;
+    // 2D line to 3D line
+    Vector3View l_line_line, X_line_line, V_line_line;
+    // Relative pose, 2D point to 2D point where p1 and p2 are the camera centers for generalized cameras
+    Vector3View x1, x2, p1, p2;
+};
+
+template <ProblemType Problem, int PointPoint, int PointLine, int LinePoint, int LineLine, int MaxSolutions,
+          int ApproxRuntimeNs, unsigned Flags = 0>
+struct SolverTraitsBase {
+    static constexpr ProblemType problem = Problem;
+    static constexpr int num_point_point = PointPoint;
+    static constexpr int num_point_line = PointLine;
+    static constexpr int num_line_point = LinePoint;
+    static constexpr int num_line_line = LineLine;
+    // Minimal number of correspondences
+    static constexpr int sample_size = PointPoint + PointLine + LinePoint + LineLine;
+    static constexpr int max_solutions = MaxSolutions;
+    // Runtime from the tables in the README, only meant for ranking the solvers.
+    static constexpr int approx_runtime_ns = ApproxRuntimeNs;
+    static constexpr unsigned flags = Flags;
+    static constexpr bool upright = (Flags & SOLVER_UPRIGHT) != 0;
+    static constexpr bool planar = (Flags & SOLVER_PLANAR) != 0;
+    static constexpr bool generalized = (Flags & SOLVER_GENERALIZED) != 0;
+    static constexpr bool radial = (Flags & SOLVER_RADIAL) != 0;
+    static constexpr bool scale = (Flags & SOLVER_SCALE) != 0;
+    static constexpr bool focal = (Flags & SOLVER_FOCAL) != 0;
+};
+
+#define POSELIB_TRAITS_TEMPLATE                                                                                       \
+    template <ProblemType Problem, int PointPoint, int PointLine, int LinePoint, int LineLine, int MaxSolutions,       \
+              int ApproxRuntimeNs, unsigned Flags>
+#define POSELIB_TRAITS_BASE \
+    SolverTraitsBase<Problem, PointPoint, PointLine, LinePoint, LineLine, MaxSolutions, ApproxRuntimeNs, Flags>
+POSELIB_TRAITS_TEMPLATE constexpr ProblemType POSELIB_TRAITS_BASE::problem;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::num_point_point;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::num_point_line;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::num_line_point;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::num_line_line;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::sample_size;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::max_solutions;
+POSELIB_TRAITS_TEMPLATE constexpr int POSELIB_TRAITS_BASE::approx_runtime_ns;
+POSELIB_TRAITS_TEMPLATE constexpr unsigned POSELIB_TRAITS_BASE::flags;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::upright;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::planar;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::generalized;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::radial;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::scale;
+POSELIB_TRAITS_TEMPLATE constexpr bool POSELIB_TRAITS_BASE::focal;
+#undef POSELIB_TRAITS_TEMPLATE
+#undef POSELIB_TRAITS_BASE
+
+// Specialized for each of the tags below. Besides the members of SolverTraitsBase, each specialization has
+//    static const char *name();
+//    static int solve(const SolverInput &input, CameraPoseVector *output);
+// where solve calls the solver with its default options.
+template <typename Solver>
+struct SolverTraits;
+
+namespace solvers {
+// Absolute pose
+struct P3P {};
+struct GP3P {};
+struct GP4PS {};
+struct P4PF {};
+struct P2P2PL {};
+struct P6LP {};
+struct P5LP_Radial {};
+struct P2P1LL {};
+struct P1P2LL {};
+struct P3LL {};
+struct UP2P {};
+struct UGP2P {};
+struct UGP3PS {};
+struct UP1P2PL {};
+struct UP4PL {};
+struct UGP4PL {};
+// Relative pose
+struct Relpose5pt {};
+struct Relpose8pt {};
+struct RelposeUpright3pt {};
+struct GenRelposeUpright4pt {};
+struct RelposeUprightPlanar2pt {};
+struct RelposeUprightPlanar3pt {};
+} // namespace solvers
+
+#define POSELIB_SOLVER_TRAITS(Solver, function_name, ...)                                                             \
+    template <>                                                                                                        \
+    struct SolverTraits<solvers::Solver> : SolverTraitsBase<__VA_ARGS__> {                                           \
+        static const char *name() { return function_name; }                                                          \
+        static int solve(const SolverInput &input, CameraPoseVector *output);                                         \
+    };
+
+// Tag, name, problem, point_point, point_line, line_point, line_line, max_solutions, approx_runtime_ns, flags
+POSELIB_SOLVER_TRAITS(P3P, "p3p", ProblemType::ABSOLUTE_POSE, 3, 0, 0, 0, 4, 250)
+POSELIB_SOLVER_TRAITS(GP3P, "gp3p", ProblemType::ABSOLUTE_POSE, 3, 0, 0, 0, 8, 1600, SOLVER_GENERALIZED)
+POSELIB_SOLVER_TRAITS(GP4PS, "gp4ps", ProblemType::ABSOLUTE_POSE, 4, 0, 0, 0, 8, 1800, SOLVER_GENERALIZED | SOLVER_SCALE)
+POSELIB_SOLVER_TRAITS(P4PF, "p4pf", ProblemType::ABSOLUTE_POSE, 4, 0, 0, 0, 8, 2300, SOLVER_FOCAL)
+POSELIB_SOLVER_TRAITS(P2P2PL, "p2p2pl", ProblemType::ABSOLUTE_POSE, 2, 2, 0, 0, 16, 12000)
+POSELIB_SOLVER_TRAITS(P6LP, "p6lp", ProblemType::ABSOLUTE_POSE, 0, 0, 6, 0, 8, 1800)
+POSELIB_SOLVER_TRAITS(P5LP_Radial, "p5lp_radial", ProblemType::ABSOLUTE_POSE, 0, 0, 5, 0, 4, 1000, SOLVER_RADIAL)
+POSELIB_SOLVER_TRAITS(P2P1LL, "p2p1ll", ProblemType::ABSOLUTE_POSE, 2, 0, 0, 1, 8, 1600)
+POSELIB_SOLVER_TRAITS(P1P2LL, "p1p2ll", ProblemType::ABSOLUTE_POSE, 1, 0, 0, 2, 8, 1700)
+POSELIB_SOLVER_TRAITS(P3LL, "p3ll", ProblemType::ABSOLUTE_POSE, 0, 0, 0, 3, 8, 1800)
+POSELIB_SOLVER_TRAITS(UP2P, "up2p", ProblemType::ABSOLUTE_POSE, 2, 0, 0, 0, 2, 65, SOLVER_UPRIGHT)
+POSELIB_SOLVER_TRAITS(UGP2P, "ugp2p", ProblemType::ABSOLUTE_POSE, 2, 0, 0, 0, 2, 65, SOLVER_UPRIGHT | SOLVER_GENERALIZED)
+POSELIB_SOLVER_TRAITS(UGP3PS, "ugp3ps", ProblemType::ABSOLUTE_POSE, 3, 0, 0, 0, 2, 390, SOLVER_UPRIGHT | SOLVER_GENERALIZED | SOLVER_SCALE)
+POSELIB_SOLVER_TRAITS(UP1P2PL, "up1p2pl", ProblemType::ABSOLUTE_POSE, 1, 2, 0, 0, 4, 370, SOLVER_UPRIGHT)
+POSELIB_SOLVER_TRAITS(UP4PL, "up4pl", ProblemType::ABSOLUTE_POSE, 0, 4, 0, 0, 6, 1400, SOLVER_UPRIGHT)
+POSELIB_SOLVER_TRAITS(UGP4PL, "ugp4pl", ProblemType::ABSOLUTE_POSE, 0, 4, 0, 0, 6, 1400, SOLVER_UPRIGHT | SOLVER_GENERALIZED)
+POSELIB_SOLVER_TRAITS(Relpose5pt, "relpose_5pt", ProblemType::RELATIVE_POSE, 5, 0, 0, 0, 10, 5500)
+POSELIB_SOLVER_TRAITS(Relpose8pt, "relpose_8pt", ProblemType::RELATIVE_POSE, 8, 0, 0, 0, 1, 2200)
+POSELIB_SOLVER_TRAITS(RelposeUpright3pt, "relpose_upright_3pt", ProblemType::RELATIVE_POSE, 3, 0, 0, 0, 4, 210, SOLVER_UPRIGHT)
+POSELIB_SOLVER_TRAITS(GenRelposeUpright4pt, "gen_relpose_upright_4pt", ProblemType::RELATIVE_POSE, 4, 0, 0, 0, 6, 1200, SOLVER_UPRIGHT | SOLVER_GENERALIZED)
+POSELIB_SOLVER_TRAITS(RelposeUprightPlanar2pt, "relpose_upright_planar_2pt", ProblemType::RELATIVE_POSE, 2, 0, 0, 0, 2, 120, SOLVER_UPRIGHT | SOLVER_PLANAR)
+POSELIB_SOLVER_TRAITS(RelposeUprightPlanar3pt, "relpose_upright_planar_3pt", ProblemType::RELATIVE_POSE, 3, 0, 0, 0, 1, 300, SOLVER_UPRIGHT | SOLVER_PLANAR)
+
+#undef POSELIB_SOLVER_TRAITS
+
+inline int SolverTraits<solvers::P3P>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p3p(in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::GP3P>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return gp3p(in.p_point, in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::GP4PS>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return gp4ps(in.p_point, in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::P4PF>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p4pf(in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::P2P2PL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p2p2pl(in.x_point, in.X_point, in.x_line, in.X_line, in.V_line, output);
+}
+inline int SolverTraits<solvers::P6LP>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p6lp(in.l_line_point, in.X_line_point, output);
+}
+inline int SolverTraits<solvers::P5LP_Radial>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p5lp_radial(in.l_line_point, in.X_line_point, output);
+}
+inline int SolverTraits<solvers::P2P1LL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p2p1ll(in.x_point, in.X_point, in.l_line_line, in.X_line_line, in.V_line_line, output);
+}
+inline int SolverTraits<solvers::P1P2LL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p1p2ll(in.x_point, in.X_point, in.l_line_line, in.X_line_line, in.V_line_line, output);
+}
+inline int SolverTraits<solvers::P3LL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return p3ll(in.l_line_line, in.X_line_line, in.V_line_line, output);
+}
+inline int SolverTraits<solvers::UP2P>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return up2p(in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::UGP2P>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return ugp2p(in.p_point, in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::UGP3PS>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return ugp3ps(in.p_point, in.x_point, in.X_point, output);
+}
+inline int SolverTraits<solvers::UP1P2PL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return up1p2pl(in.x_point, in.X_point, in.x_line, in.X_line, in.V_line, output);
+}
+inline int SolverTraits<solvers::UP4PL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return up4pl(in.x_line, in.X_line, in.V_line, output);
+}
+inline int SolverTraits<solvers::UGP4PL>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return ugp4pl(in.p_line, in.x_line, in.X_line, in.V_line, output);
+}
+inline int SolverTraits<solvers::Relpose5pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return relpose_5pt(in.x1, in.x2, output);
+}
+inline int SolverTraits<solvers::Relpose8pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return relpose_8pt(in.x1, in.x2, output);
+}
+inline int SolverTraits<solvers::RelposeUpright3pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return relpose_upright_3pt(in.x1, in.x2, output);
+}
+inline int SolverTraits<solvers::GenRelposeUpright4pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return gen_relpose_upright_4pt(in.p1, in.x1, in.p2, in.x2, output);
+}
+inline int SolverTraits<solvers::RelposeUprightPlanar2pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return relpose_upright_planar_2pt(in.x1, in.x2, output);
+}
+inline int SolverTraits<solvers::RelposeUprightPlanar3pt>::solve(const SolverInput &in, CameraPoseVector *output) {
+    return relpose_upright_planar_3pt(in.x1, in.x2, output);
+}
+
+// Runtime registry of the solvers, e.g. for selecting a solver by name or by the available correspondences.
+typedef int (*SolverFunction)(const SolverInput &input, CameraPoseVector *output);
+
+// Runtime version of SolverTraits<Solver>.
+struct SolverInfo {
+    const char *name;
+    ProblemType problem;
+    int num_point_point, num_point_line, num_line_point, num_line_line;
+    int sample_size, max_solutions, approx_runtime_ns;
+    unsigned flags;
+    SolverFunction solve;
+};
+
+template <typename Solver>
+SolverInfo make_solver_info() {
+    typedef SolverTraits<Solver> Traits;
+    return SolverInfo{Traits::name(), Traits::problem, Traits::num_point_point, Traits::num_point_line,
+                      Traits::num_line_point, Traits::num_line_line, Traits::sample_size, Traits::max_solutions,
+                      Traits::approx_runtime_ns, Traits::flags, &Traits::solve};
+}
+
+// All solvers, ordered by approx_runtime_ns.
+const std::vector<SolverInfo> &solver_registry();
+
+// Returns the solver with the given name (as in SolverTraits<Solver>::name()), or nullptr if there is none.
+const SolverInfo *find_solver(const std::string &name);
+
+// Describes the problem to solve in find_solvers.
+struct SolverQuery {
+    ProblemType problem = ProblemType::ABSOLUTE_POSE;
+    // Number of available correspondences of each type
+    int num_point_point = 0;
+    int num_point_line = 0;
+    int num_line_point = 0;
+    int num_line_line = 0;
+    // Solvers with the flag SOLVER_UPRIGHT (SOLVER_PLANAR) are only returned if upright (planar) is set,
+    // while the other flags must match exactly.
+    unsigned flags = 0;
+};
+
+// Returns the solvers which are applicable to the query, ordered by approx_runtime_ns, i.e. the first one is the
+// cheapest. Returns an empty vector if there is none.
+std::vector<const SolverInfo *> find_solvers(const SolverQuery &query);
+
+} // namespace pose_lib
@@ -29,15 +29,166 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
+// Header-only mode. If POSELIB_HEADER_ONLY is defined before including PoseLib, the small solvers (p3p, up2p, ugp2p,
+// relpose_upright_planar_2pt) and the scalar root finders in misc/univariate.h are defined inline in their headers,
+// so that they can be inlined into the calling code (e.g. a RANSAC loop). These are then declared in the inline
+// namespace pose_lib::header_only, which keeps them apart from the functions compiled into the library, i.e. the
+// program may still link PoseLib for the other solvers and mix translation units with and without the define.
+#ifdef POSELIB_HEADER_ONLY
+#define POSELIB_INLINE inline
+#define POSELIB_BEGIN_HEADER_ONLY inline namespace header_only {
+#define POSELIB_END_HEADER_ONLY }
+#else
+#define POSELIB_INLINE
+#define POSELIB_BEGIN_HEADER_ONLY
+#define POSELIB_END_HEADER_ONLY
+#endif
+
 namespace pose_lib {
 
-struct CameraPose {
-    Eigen::Matrix3d R;
-    Eigen::Vector3d t;
-    double alpha = 1.0; // either focal length or scale
+template <typename Real>
+struct CameraPoseT {
+    Eigen::Matrix<Real, 3, 3> R;
+    Eigen::Matrix<Real, 3, 1> t;
+    Real alpha = 1.0; // either focal length or scale
 };
 
+typedef CameraPoseT<double> CameraPose;
 typedef std::vector<CameraPose> CameraPoseVector;
+
+// Single-precision poses, returned by the float instantiations of the templated solvers.
+typedef CameraPoseT<float> CameraPosef;
+typedef std::vector<CameraPosef> CameraPoseVectorf;
+
+// Compact pose where the rotation is stored as a unit quaternion, 8 instead of 13 scalars (64 bytes for double).
+// Returned by the overloads of the solvers which internally parameterize the rotation by a quaternion or by the
+// rotation angle (gp3p, p1p2ll, p2p1ll, up2p and ugp2p), without forming the rotation matrix.
+template <typename Real>
+struct CompactPoseT {
+    // Unit quaternion in Eigen's coefficient order (x, y, z, w).
+    Eigen::Matrix<Real, 4, 1, Eigen::DontAlign> q;
+    Eigen::Matrix<Real, 3, 1> t;
+    Real alpha = 1.0; // either focal length or scale
+
+    Eigen::Quaternion<Real> quaternion() const { return Eigen::Quaternion<Real>(q(3), q(0), q(1), q(2)); }
+    Eigen::Matrix<Real, 3, 3> rotation_matrix() const { return quaternion().toRotationMatrix(); }
+    CameraPoseT<Real> to_pose() const {
+        CameraPoseT<Real> pose;
+        pose.R = rotation_matrix();
+        pose.t = t;
+        pose.alpha = alpha;
+        return pose;
+    }
+};
+
+typedef CompactPoseT<double> CompactPose;
+typedef std::vector<CompactPose> CompactPoseVector;
+typedef CompactPoseT<float> CompactPosef;
+typedef std::vector<CompactPosef> CompactPoseVectorf;
+
+// Container with a fixed capacity which stores its elements inline (e.g. on the stack), implementing the parts of the
+// std::vector interface used by the solvers. The solvers which have overloads taking a FixedVector use the maximum
+// number of solutions as capacity, so that solving does not require any heap allocations.
+template <typename T, int Capacity>
+class FixedVector {
+  public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    FixedVector() : n(0) {}
+
+    static constexpr size_t capacity() { return Capacity; }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    void clear() { n = 0; }
+    // The capacity is fixed, this only exists for compatibility with std::vector.
+    void reserve(size_t new_capacity) { assert(new_capacity <= Capacity); }
+
+    void push_back(const T &value) {
+        assert(n < Capacity);
+        elements[n++] = value;
+    }
+    template <typename... Args>
+    void emplace_back(Args &&... args) {
+        assert(n < Capacity);
+        elements[n++] = T(std::forward<Args>(args)...);
+    }
+    void pop_back() { --n; }
+
+    T &operator[](size_t i) { return elements[i]; }
+    const T &operator[](size_t i) const { return elements[i]; }
+    T &back() { return elements[n - 1]; }
+    const T &back() const { return elements[n - 1]; }
+    T *data() { return elements; }
+    const T *data() const { return elements; }
+
+    iterator begin() { return elements; }
+    iterator end() { return elements + n; }
+    const_iterator begin() const { return elements; }
+    const_iterator end() const { return elements + n; }
+
+  private:
+    T elements[Capacity];
+    size_t n;
+};
+// Read-only view of a sequence of 3-vectors (bearing vectors, points, line directions, ...) which does not copy them.
+// The solvers take their inputs as views, which can be constructed implicitly from
+//   - a std::vector or std::array of vectors,
+//   - a 3xN matrix with contiguous columns, e.g. an Eigen::Matrix3Xd or an Eigen::Map over a double buffer,
+//   - a pointer to the vectors together with an array of indices, e.g. selecting the minimal sample from all
+//     correspondences in RANSAC without gathering them into new vectors.
+// The viewed data (and the indices) must outlive the view.
+template <typename Real>
+class Vector3ViewT {
+  public:
+    typedef Eigen::Matrix<Real, 3, 1> Vector3;
+
+    Vector3ViewT() : elements(nullptr), indices(nullptr), n(0) {}
+    // The i-th element of the view is data[indices[i]], or data[i] if indices is nullptr.
+    Vector3ViewT(const Vector3 *data, size_t size, const int *indices = nullptr) : elements(data), indices(indices), n(size) {}
+    Vector3ViewT(const std::vector<Vector3> &v) : elements(v.data()), indices(nullptr), n(v.size()) {}
+    template <size_t N>
+    Vector3ViewT(const std::array<Vector3, N> &v) : elements(v.data()), indices(nullptr), n(N) {}
+    template <typename Derived>
+    Vector3ViewT(const Eigen::MatrixBase<Derived> &M)
+        : elements(reinterpret_cast<const Vector3 *>(M.derived().data())), indices(nullptr), n(M.cols()) {
+        static_assert(Derived::RowsAtCompileTime == 3 && !(Derived::Flags & Eigen::RowMajorBit),
+                      "Only column-major matrices with three rows can be viewed as vectors.");
+        assert(M.innerStride() == 1 && (M.cols() <= 1 || M.outerStride() == 3));
+    }
+
+    const Vector3 &operator[](size_t i) const { return indices == nullptr ? elements[i] : elements[indices[i]]; }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+  private:
+    const Vector3 *elements;
+    const int *indices;
+    size_t n;
+};
+
+typedef Vector3ViewT<double> Vector3View;
+typedef Vector3ViewT<float> Vector3Viewf;
+
+// Same as Vector3ViewT<Real> but in a non-deduced context. Used by the templated solvers so that Real is deduced
+// from the output argument only, and any input convertible to a view can be passed.
+template <typename Real>
+struct Vector3ViewNonDeduced {
+    typedef Vector3ViewT<Real> type;
+};
+template <typename Real>
+using Vector3ViewArgT = typename Vector3ViewNonDeduced<Real>::type;
+
+// Row-major view of the instances of a batched solver (e.g. p3p_batch), where row i holds the vectors of instance i.
+// This is the memory layout of a C-contiguous (batch, n, 3) array, which can therefore be passed without a copy.
+template <int Cols>
+using BatchView = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Cols, Eigen::RowMajor>>;
+
 } // namespace pose_lib
@@ -34,5 +34,25 @@
 
 namespace pose_lib {
 
-int ugp2p(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, CameraPoseVector *output);
+POSELIB_BEGIN_HEADER_ONLY
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+int ugp2p(const Vector3View &p, const Vector3View &x, const Vector3View &X, CameraPoseVector *output, bool filter_invalid = false);
+// Same as above but returns compact poses, see CompactPoseT in types.h.
+int ugp2p(const Vector3View &p, const Vector3View &x, const Vector3View &X, CompactPoseVector *output, bool filter_invalid = false);
+POSELIB_END_HEADER_ONLY
+
+// Batched version of ugp2p which solves many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. p.row(i) = [p[0]' p[1]'], x.row(i) = [x[0]' x[1]'] and X.row(i) = [X[0]' X[1]'].
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// The output vectors are reused, so passing the same vectors for repeated calls avoids reallocation.
+// Returns the total number of solutions.
+int ugp2p_batch(const Eigen::Matrix<double, Eigen::Dynamic, 6> &p, const Eigen::Matrix<double, Eigen::Dynamic, 6> &x,
+                const Eigen::Matrix<double, Eigen::Dynamic, 6> &X, CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int ugp2p_batch(const BatchView<6> &p, const BatchView<6> &x, const BatchView<6> &X, CameraPoseVector *output,
+                std::vector<int> *num_solutions);
 };
+
+#ifdef POSELIB_HEADER_ONLY
+#include "ugp2p_inl.h"
+#endif
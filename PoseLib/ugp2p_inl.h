@@ -0,0 +1,90 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Definitions of ugp2p in ugp2p.h. In the header-only mode (see types.h) this file is included by ugp2p.h,
+// otherwise it is only included by ugp2p.cc.
+
+#pragma once
+
+#include "ugp2p.h"
+#include "misc/rotation.h"
+#include "misc/univariate.h"
+#include "misc/validity.h"
+
+namespace pose_lib {
+POSELIB_BEGIN_HEADER_ONLY
+namespace detail {
+
+template <typename Pose>
+inline int ugp2p_impl(const Vector3View &p, const Vector3View &x, const Vector3View &X,
+                      std::vector<Pose> *output, bool filter_invalid) {
+    Eigen::Matrix<double, 4, 4> A;
+    Eigen::Matrix<double, 4, 2> b;
+
+    A << -x[0](2), 0, x[0](0), x[0](2) * (X[0](0) + p[0](0)) - x[0](0) * (X[0](2) + p[0](2)), 0, -x[0](2), x[0](1), -x[0](2) * (X[0](1) - p[0](1)) - x[0](1) * (X[0](2) + p[0](2)), -x[1](2), 0, x[1](0), x[1](2) * (X[1](0) + p[1](0)) - x[1](0) * (X[1](2) + p[1](2)), 0, -x[1](2), x[1](1), -x[1](2) * (X[1](1) - p[1](1)) - x[1](1) * (X[1](2) + p[1](2));
+    b << -2 * X[0](0) * x[0](0) - 2 * X[0](2) * x[0](2), x[0](0) * (X[0](2) - p[0](2)) - x[0](2) * (X[0](0) - p[0](0)), -2 * X[0](0) * x[0](1), x[0](1) * (X[0](2) - p[0](2)) - x[0](2) * (X[0](1) - p[0](1)), -2 * X[1](0) * x[1](0) - 2 * X[1](2) * x[1](2), x[1](0) * (X[1](2) - p[1](2)) - x[1](2) * (X[1](0) - p[1](0)), -2 * X[1](0) * x[1](1), x[1](1) * (X[1](2) - p[1](2)) - x[1](2) * (X[1](1) - p[1](1));
+
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    b = A.partialPivLu().solve(b);
+
+    const double c2 = b(3, 0);
+    const double c3 = b(3, 1);
+
+    double qq[2];
+    const int sols = univariate::solve_quadratic_real(1.0, c2, c3, qq);
+
+    output->clear();
+    for (int i = 0; i < sols; ++i) {
+        Pose pose;
+
+        const double q = qq[i];
+        const double inv_norm = 1.0 / (1 + q * q);
+        rotation::set_upright(q, &pose);
+
+        pose.t = b.block<3, 1>(0, 0) * q + b.block<3, 1>(0, 1);
+        pose.t *= -inv_norm;
+
+        if (filter_invalid && !validity::check_points_generalized(pose, 1.0, p, x, X))
+            continue;
+        output->push_back(pose);
+    }
+    return output->size();
+}
+
+} // namespace detail
+
+POSELIB_INLINE int ugp2p(const Vector3View &p, const Vector3View &x, const Vector3View &X, CameraPoseVector *output, bool filter_invalid) {
+    return detail::ugp2p_impl(p, x, X, output, filter_invalid);
+}
+
+POSELIB_INLINE int ugp2p(const Vector3View &p, const Vector3View &x, const Vector3View &X, CompactPoseVector *output, bool filter_invalid) {
+    return detail::ugp2p_impl(p, x, X, output, filter_invalid);
+}
+
+POSELIB_END_HEADER_ONLY
+} // namespace pose_lib
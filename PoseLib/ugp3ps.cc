@@ -28,10 +28,13 @@
 
 #include "ugp3ps.h"
 #include "misc/univariate.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
-int pose_lib::ugp3ps(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                     const std::vector<Eigen::Vector3d> &X, pose_lib::CameraPoseVector *output,
-                     bool filter_solutions) {
+int pose_lib::ugp3ps(const Vector3View &p, const Vector3View &x,
+                     const Vector3View &X, pose_lib::CameraPoseVector *output,
+                     bool filter_solutions, bool filter_invalid) {
+    POSELIB_DISPATCH(ugp3ps, (p, x, X, output, filter_solutions, filter_invalid))
     Eigen::Matrix<double, 5, 5> A;
     Eigen::Matrix<double, 5, 2> b;
 
@@ -71,6 +74,9 @@ int pose_lib::ugp3ps(const std::vector<Eigen::Vector3d> &p, const std::vector<Ei
         pose.alpha = b(3, 0) * q + b(3, 1);
         pose.alpha *= -inv_norm;
 
+        if (filter_invalid && !validity::check_points_generalized(pose, pose.alpha, p, x, X))
+            continue;
+
         if (filter_solutions) {
             double res = std::abs(x[2].dot((pose.R * X[2] + pose.t - pose.alpha * p[2]).normalized()));
             if (res > best_res) {
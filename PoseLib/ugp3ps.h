@@ -38,7 +38,9 @@ namespace pose_lib {
 // This is similar to the gp4ps problem but for upright cameras.
 // Note: this impl. assumes that x has been normalized.
 // If filter_solutions is true, only the best solution is returned.
-int ugp3ps(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-           const std::vector<Eigen::Vector3d> &X, CameraPoseVector *output,
-           bool filter_solutions = true);
+// If filter_invalid is true, solutions with non-finite values, non-positive scale or with any of the points behind
+// the camera are discarded.
+int ugp3ps(const Vector3View &p, const Vector3View &x,
+           const Vector3View &X, CameraPoseVector *output,
+           bool filter_solutions = true, bool filter_invalid = false);
 }; // namespace pose_lib
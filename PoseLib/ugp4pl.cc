@@ -27,10 +27,14 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ugp4pl.h"
+#include "misc/batch.h"
+#include "misc/dispatch.h"
 #include "misc/qep.h"
+#include "misc/validity.h"
 
-int pose_lib::ugp4pl(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-                     const std::vector<Eigen::Vector3d> &X, const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output) {
+int pose_lib::ugp4pl(const Vector3View &p, const Vector3View &x,
+                     const Vector3View &X, const Vector3View &V, CameraPoseVector *output, bool filter_invalid) {
+    POSELIB_DISPATCH(ugp4pl, (p, x, X, V, output, filter_invalid))
 
     Eigen::Matrix<double, 4, 4> M, C, K;
     Eigen::Matrix<double, 3, 4> VX;
@@ -116,7 +120,110 @@ int pose_lib::ugp4pl(const std::vector<Eigen::Vector3d> &p, const std::vector<Ei
         pose.t = eig_vecs.col(i);
         pose.alpha = 1.0;
 
+        if (filter_invalid && !validity::check_point_lines(pose, p, x, X, V))
+            continue;
         output->push_back(pose);
     }
-    return n_roots;
+    return output->size();
+}
+
+namespace {
+
+using pose_lib::batch::Lanes;
+
+// Sets up the QEP (M, C, K) for LANES instances starting at row start. Same as above, where the terms involving p
+// are grouped as the cross product p x x.
+template <typename Matrix>
+void ugp4pl_lanes(const Matrix &ps, const Matrix &xs, const Matrix &Xs, const Matrix &Vs,
+                  int start, Lanes M[4][4], Lanes C[4][4], Lanes K[4][4]) {
+    Lanes p[3], x[3], X[3], V[3], VX[3], px[3];
+    for (int i = 0; i < 4; ++i) {
+        pose_lib::batch::load3(ps, 3 * i, start, p);
+        pose_lib::batch::load3(xs, 3 * i, start, x);
+        pose_lib::batch::load3(Xs, 3 * i, start, X);
+        pose_lib::batch::load3(Vs, 3 * i, start, V);
+        pose_lib::batch::cross(V, X, VX);
+        pose_lib::batch::cross(p, x, px);
+
+        M[i][0] = -V[1] * x[2] - V[2] * x[1];
+        M[i][1] = V[2] * x[0] - V[0] * x[2];
+        M[i][2] = V[0] * x[1] + V[1] * x[0];
+        M[i][3] = VX[1] * x[1];
+        M[i][3] -= VX[0] * x[0];
+        M[i][3] -= VX[2] * x[2];
+        M[i][3] += V[0] * px[0];
+        M[i][3] -= V[1] * px[1];
+        M[i][3] += V[2] * px[2];
+
+        C[i][0] = -2.0 * V[0] * x[1];
+        C[i][1] = 2.0 * V[0] * x[0] + 2.0 * V[2] * x[2];
+        C[i][2] = -2.0 * V[2] * x[1];
+        C[i][3] = VX[2] * x[0];
+        C[i][3] -= VX[0] * x[2];
+        C[i][3] += V[0] * px[2];
+        C[i][3] -= V[2] * px[0];
+        C[i][3] *= 2.0;
+
+        K[i][0] = V[2] * x[1] - V[1] * x[2];
+        K[i][1] = V[0] * x[2] - V[2] * x[0];
+        K[i][2] = V[1] * x[0] - V[0] * x[1];
+        K[i][3] = pose_lib::batch::dot(VX, x);
+        K[i][3] -= pose_lib::batch::dot(V, px);
+    }
+}
+
+template <typename Matrix>
+int ugp4pl_batch_impl(const Matrix &p, const Matrix &x, const Matrix &X, const Matrix &V,
+                      pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    const int n_instances = x.rows();
+    output->clear();
+    output->reserve(6 * n_instances);
+    num_solutions->resize(n_instances);
+
+    Lanes M[4][4], C[4][4], K[4][4];
+    Lanes q[6], t[6][3];
+    int n_roots[pose_lib::batch::LANES];
+    pose_lib::CameraPose pose;
+    pose.alpha = 1.0;
+    for (int start = 0; start < n_instances; start += pose_lib::batch::LANES) {
+        ugp4pl_lanes(p, x, X, V, start, M, C, K);
+        pose_lib::qep::qep_sturm_div_1_q2(M, C, K, q, n_roots, t);
+
+        const int n_lanes = std::min(pose_lib::batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            for (int k = 0; k < n_roots[lane]; ++k) {
+                const double qk = q[k](lane);
+                const double q2 = qk * qk;
+                const double inv_norm = 1.0 / (1 + q2);
+                const double cq = (1 - q2) * inv_norm;
+                const double sq = 2 * qk * inv_norm;
+
+                pose.R.setIdentity();
+                pose.R(0, 0) = cq;
+                pose.R(0, 2) = sq;
+                pose.R(2, 0) = -sq;
+                pose.R(2, 2) = cq;
+                pose.t << t[k][0](lane), t[k][1](lane), t[k][2](lane);
+                output->push_back(pose);
+            }
+            (*num_solutions)[start + lane] = n_roots[lane];
+        }
+    }
+    return output->size();
+}
+
+} // namespace
+
+int pose_lib::ugp4pl_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &p, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x,
+                           const Eigen::Matrix<double, Eigen::Dynamic, 12> &X, const Eigen::Matrix<double, Eigen::Dynamic, 12> &V,
+                           CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(ugp4pl_batch, (p, x, X, V, output, num_solutions))
+    return ugp4pl_batch_impl(p, x, X, V, output, num_solutions);
+}
+
+int pose_lib::ugp4pl_batch(const pose_lib::BatchView<12> &p, const pose_lib::BatchView<12> &x,
+                           const pose_lib::BatchView<12> &X, const pose_lib::BatchView<12> &V,
+                           CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(ugp4pl_batch_view, (p, x, X, V, output, num_solutions))
+    return ugp4pl_batch_impl(p, x, X, V, output, num_solutions);
 }
@@ -29,6 +29,7 @@
 #pragma once
 #include "types.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace pose_lib {
 
@@ -36,6 +37,18 @@ namespace pose_lib {
 //   p + lambda * x = R * (X + mu * V) + t
 // This problem is equivalent to upright generalized relative pose estimation
 //    Sweeney et al., Solving for Relative Pose with a Partially Known Rotation is a Quadratic Eigenvalue Problem, 3DV 2014
-int ugp4pl(const std::vector<Eigen::Vector3d> &p, const std::vector<Eigen::Vector3d> &x,
-           const std::vector<Eigen::Vector3d> &X, const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+int ugp4pl(const Vector3View &p, const Vector3View &x,
+           const Vector3View &X, const Vector3View &V, CameraPoseVector *output, bool filter_invalid = false);
+
+// Batched version of ugp4pl which solves many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. p.row(i) = [p[0]' p[1]' p[2]' p[3]'] and similarly for x, X and V.
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// Returns the total number of solutions.
+int ugp4pl_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &p, const Eigen::Matrix<double, Eigen::Dynamic, 12> &x,
+                 const Eigen::Matrix<double, Eigen::Dynamic, 12> &X, const Eigen::Matrix<double, Eigen::Dynamic, 12> &V,
+                 CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int ugp4pl_batch(const BatchView<12> &p, const BatchView<12> &x, const BatchView<12> &X, const BatchView<12> &V,
+                 CameraPoseVector *output, std::vector<int> *num_solutions);
 }; // namespace pose_lib
@@ -28,10 +28,13 @@
 
 #include "up1p2pl.h"
 #include "misc/univariate.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
-int pose_lib::up1p2pl(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-                      const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X0,
-                      const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output) {
+int pose_lib::up1p2pl(const Vector3View &xp, const Vector3View &Xp,
+                      const Vector3View &x, const Vector3View &X0,
+                      const Vector3View &V, CameraPoseVector *output, bool filter_invalid) {
+    POSELIB_DISPATCH(up1p2pl, (xp, Xp, x, X0, V, output, filter_invalid))
 
     Eigen::Matrix<double, 3, 2> X;
     X << X0[0] - Xp[0], X0[1] - Xp[0];
@@ -67,8 +70,11 @@ int pose_lib::up1p2pl(const std::vector<Eigen::Vector3d> &xp, const std::vector<
 
         double alpha = -a.dot(b) / a.dot(xp[0]);
         pose.t = alpha * xp[0] - pose.R * Xp[0];
+        if (filter_invalid && (!validity::check_points(pose, xp, Xp) ||
+                               !validity::check_point_lines(pose, Vector3View(), x, X0, V)))
+            continue;
         output->push_back(pose);
     }
 
-    return sols;
+    return output->size();
 }
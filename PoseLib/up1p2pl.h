@@ -34,7 +34,8 @@
 
 namespace pose_lib {
 
-int up1p2pl(const std::vector<Eigen::Vector3d> &xp, const std::vector<Eigen::Vector3d> &Xp,
-            const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-            const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+int up1p2pl(const Vector3View &xp, const Vector3View &Xp,
+            const Vector3View &x, const Vector3View &X,
+            const Vector3View &V, CameraPoseVector *output, bool filter_invalid = false);
 }; // namespace pose_lib
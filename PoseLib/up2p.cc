@@ -27,44 +27,148 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "up2p.h"
+#include "up2p_inl.h"
+#include "residuals.h"
+#include "misc/batch.h"
 #include "misc/univariate.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
+#include "misc/rotation.h"
 
-int pose_lib::up2p(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, pose_lib::CameraPoseVector *output) {
-    Eigen::Matrix<double, 4, 4> A;
+bool pose_lib::up2p_best(const Vector3View &x, const Vector3View &X,
+                         const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all,
+                         double threshold, CameraPose *best_pose, double *best_score) {
+    POSELIB_DISPATCH(up2p_best, (x, X, x_all, X_all, threshold, best_pose, best_score))
     Eigen::Matrix<double, 4, 2> b;
+    double qq[2];
+    const int sols = pose_lib::detail::up2p_roots(x, X, b, qq);
+
+    CameraPose pose;
+    bool updated = false;
+    for (int i = 0; i < sols; ++i) {
+        pose_lib::detail::up2p_pose(b, qq[i], &pose);
 
-    A << -x[0](2), 0, x[0](0), X[0](0) * x[0](2) - X[0](2) * x[0](0), 0, -x[0](2), x[0](1), -X[0](1) * x[0](2) - X[0](2) * x[0](1), -x[1](2), 0, x[1](0), X[1](0) * x[1](2) - X[1](2) * x[1](0), 0, -x[1](2), x[1](1), -X[1](1) * x[1](2) - X[1](2) * x[1](1);
-    b << -2 * X[0](0) * x[0](0) - 2 * X[0](2) * x[0](2), X[0](2) * x[0](0) - X[0](0) * x[0](2), -2 * X[0](0) * x[0](1), X[0](2) * x[0](1) - X[0](1) * x[0](2), -2 * X[1](0) * x[1](0) - 2 * X[1](2) * x[1](2), X[1](2) * x[1](0) - X[1](0) * x[1](2), -2 * X[1](0) * x[1](1), X[1](2) * x[1](1) - X[1](1) * x[1](2);
+        const double score = compute_reprojection_score(pose, x_all, X_all, threshold, *best_score);
+        if (score < *best_score) {
+            *best_score = score;
+            *best_pose = pose;
+            updated = true;
+        }
+    }
+    return updated;
+}
 
-    //b = A.partialPivLu().solve(b);
-    b = A.inverse() * b;
+template int pose_lib::up2p<double>(const Vector3View &, const Vector3View &, pose_lib::CameraPoseVector *, bool);
+template int pose_lib::up2p<float>(const Vector3Viewf &, const Vector3Viewf &, pose_lib::CameraPoseVectorf *, bool);
+template int pose_lib::up2p<double>(const Vector3View &, const Vector3View &, pose_lib::CompactPoseVector *, bool);
+template int pose_lib::up2p<float>(const Vector3Viewf &, const Vector3Viewf &, pose_lib::CompactPoseVectorf *, bool);
 
-    const double c2 = b(3, 0);
-    const double c3 = b(3, 1);
+namespace {
 
-    double qq[2];
-    const int sols = univariate::solve_quadratic_real(1.0, c2, c3, qq);
+using pose_lib::batch::Lanes;
+using pose_lib::batch::Mask;
 
+// Solves for LANES instances starting at row start. Each lane has either zero or two solutions (given by valid),
+// parameterized by q (see up2p_roots in up2p_inl.h) and the corresponding translation.
+template <typename Matrix>
+void up2p_lanes(const Matrix &xs, const Matrix &Xs, int start, Lanes q[2], Lanes t[2][3], Mask &valid) {
+    Lanes A[4][4], b[4][2];
+    for (int i = 0; i < 2; ++i) {
+        Lanes x[3], X[3];
+        pose_lib::batch::load3(xs, 3 * i, start, x);
+        pose_lib::batch::load3(Xs, 3 * i, start, X);
+
+        A[2 * i][0] = -x[2];
+        A[2 * i][1].setZero();
+        A[2 * i][2] = x[0];
+        A[2 * i][3] = X[0] * x[2] - X[2] * x[0];
+        A[2 * i + 1][0].setZero();
+        A[2 * i + 1][1] = -x[2];
+        A[2 * i + 1][2] = x[1];
+        A[2 * i + 1][3] = -X[1] * x[2] - X[2] * x[1];
+
+        b[2 * i][0] = -2.0 * X[0] * x[0] - 2.0 * X[2] * x[2];
+        b[2 * i][1] = X[2] * x[0] - X[0] * x[2];
+        b[2 * i + 1][0] = -2.0 * X[0] * x[1];
+        b[2 * i + 1][1] = X[2] * x[1] - X[1] * x[2];
+    }
+
+    Lanes Ainv[4][4];
+    pose_lib::batch::inverse4x4(A, Ainv);
+
+    // Only the fourth row of A^-1 * b is needed for the quadratic, the others give the translation.
+    Lanes sol[4][2];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            sol[i][j] = Ainv[i][0] * b[0][j];
+            for (int k = 1; k < 4; ++k) {
+                sol[i][j] += Ainv[i][k] * b[k][j];
+            }
+        }
+    }
+
+    valid = pose_lib::batch::solve_quadratic_real(Lanes::Ones(), sol[3][0], sol[3][1], q);
+
+    for (int k = 0; k < 2; ++k) {
+        const Lanes inv_norm = (1.0 + q[k] * q[k]).inverse();
+        for (int i = 0; i < 3; ++i) {
+            t[k][i] = -(sol[i][0] * q[k] + sol[i][1]) * inv_norm;
+        }
+    }
+}
+
+template <typename Matrix>
+int up2p_batch_impl(const Matrix &x, const Matrix &X,
+                    pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    const int n_instances = x.rows();
     output->clear();
-    for (int i = 0; i < sols; ++i) {
-        CameraPose pose;
+    output->reserve(2 * n_instances);
+    num_solutions->resize(n_instances);
 
-        const double q = qq[i];
-        const double q2 = q * q;
-        const double inv_norm = 1.0 / (1 + q2);
-        const double cq = (1 - q2) * inv_norm;
-        const double sq = 2 * q * inv_norm;
+    Lanes q[2], t[2][3];
+    Mask valid;
+    pose_lib::CameraPose pose;
+    for (int start = 0; start < n_instances; start += pose_lib::batch::LANES) {
+        up2p_lanes(x, X, start, q, t, valid);
 
-        pose.R.setIdentity();
-        pose.R(0, 0) = cq;
-        pose.R(0, 2) = sq;
-        pose.R(2, 0) = -sq;
-        pose.R(2, 2) = cq;
+        const int n_lanes = std::min(pose_lib::batch::LANES, n_instances - start);
+        for (int lane = 0; lane < n_lanes; ++lane) {
+            if (!pose_lib::batch::test(valid, lane)) {
+                (*num_solutions)[start + lane] = 0;
+                continue;
+            }
+            for (int k = 0; k < 2; ++k) {
+                const double qk = q[k](lane);
+                const double q2 = qk * qk;
+                const double inv_norm = 1.0 / (1 + q2);
+                const double cq = (1 - q2) * inv_norm;
+                const double sq = 2 * qk * inv_norm;
 
-        pose.t = b.block<3, 1>(0, 0) * q + b.block<3, 1>(0, 1);
-        pose.t *= -inv_norm;
+                pose.R.setIdentity();
+                pose.R(0, 0) = cq;
+                pose.R(0, 2) = sq;
+                pose.R(2, 0) = -sq;
+                pose.R(2, 2) = cq;
+                pose.t << t[k][0](lane), t[k][1](lane), t[k][2](lane);
 
-        output->push_back(pose);
+                output->push_back(pose);
+            }
+            (*num_solutions)[start + lane] = 2;
+        }
     }
-    return sols;
+    return output->size();
+}
+
+} // namespace
+
+int pose_lib::up2p_batch(const Eigen::Matrix<double, Eigen::Dynamic, 6> &x, const Eigen::Matrix<double, Eigen::Dynamic, 6> &X,
+                         pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(up2p_batch, (x, X, output, num_solutions))
+    return up2p_batch_impl(x, X, output, num_solutions);
+}
+
+int pose_lib::up2p_batch(const pose_lib::BatchView<6> &x, const pose_lib::BatchView<6> &X,
+                         pose_lib::CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(up2p_batch_view, (x, X, output, num_solutions))
+    return up2p_batch_impl(x, X, output, num_solutions);
 }
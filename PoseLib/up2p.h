@@ -34,5 +34,34 @@
 
 namespace pose_lib {
 
-int up2p(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X, CameraPoseVector *output);
+POSELIB_BEGIN_HEADER_ONLY
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+// Instantiated for Real = double and Real = float.
+template <typename Real>
+int up2p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, std::vector<CameraPoseT<Real>> *output,
+         bool filter_invalid = false);
+// Same as above but returns compact poses, see CompactPoseT in types.h.
+template <typename Real>
+int up2p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X, std::vector<CompactPoseT<Real>> *output,
+         bool filter_invalid = false);
+POSELIB_END_HEADER_ONLY
+
+// Fused solve-and-score version of up2p, see p3p_best in p3p.h.
+bool up2p_best(const Vector3View &x, const Vector3View &X,
+               const Eigen::Matrix<double, Eigen::Dynamic, 2> &x_all, const Eigen::Matrix<double, Eigen::Dynamic, 3> &X_all,
+               double threshold, CameraPose *best_pose, double *best_score);
+
+// Batched version of up2p which solves many instances at once, processing several instances in parallel using SIMD.
+// Row i holds instance i, i.e. x.row(i) = [x[0]' x[1]'] and X.row(i) = [X[0]' X[1]'].
+// The solutions for all instances are stored consecutively in output and num_solutions[i] is the number of solutions for instance i.
+// The output vectors are reused, so passing the same vectors for repeated calls avoids reallocation.
+// Returns the total number of solutions.
+int up2p_batch(const Eigen::Matrix<double, Eigen::Dynamic, 6> &x, const Eigen::Matrix<double, Eigen::Dynamic, 6> &X,
+               CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int up2p_batch(const BatchView<6> &x, const BatchView<6> &X, CameraPoseVector *output, std::vector<int> *num_solutions);
 }; // namespace pose_lib
+
+#ifdef POSELIB_HEADER_ONLY
+#include "up2p_inl.h"
+#endif
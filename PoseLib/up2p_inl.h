@@ -0,0 +1,104 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Definitions of up2p in up2p.h. In the header-only mode (see types.h) this file is included by up2p.h,
+// otherwise it is only included by up2p.cc.
+
+#pragma once
+
+#include "up2p.h"
+#include "misc/rotation.h"
+#include "misc/univariate.h"
+#include "misc/validity.h"
+
+namespace pose_lib {
+POSELIB_BEGIN_HEADER_ONLY
+namespace detail {
+
+// Computes the (at most two) roots q = tan(theta / 2) of the rotation angle. The translation for each root is
+// then given by up2p_pose below.
+template <typename Real>
+inline int up2p_roots(const Vector3ViewT<Real> &x, const Vector3ViewT<Real> &X,
+                      Eigen::Matrix<Real, 4, 2> &b, Real qq[2]) {
+    Eigen::Matrix<Real, 4, 4> A;
+
+    A << -x[0](2), 0, x[0](0), X[0](0) * x[0](2) - X[0](2) * x[0](0), 0, -x[0](2), x[0](1), -X[0](1) * x[0](2) - X[0](2) * x[0](1), -x[1](2), 0, x[1](0), X[1](0) * x[1](2) - X[1](2) * x[1](0), 0, -x[1](2), x[1](1), -X[1](1) * x[1](2) - X[1](2) * x[1](1);
+    b << -2 * X[0](0) * x[0](0) - 2 * X[0](2) * x[0](2), X[0](2) * x[0](0) - X[0](0) * x[0](2), -2 * X[0](0) * x[0](1), X[0](2) * x[0](1) - X[0](1) * x[0](2), -2 * X[1](0) * x[1](0) - 2 * X[1](2) * x[1](2), X[1](2) * x[1](0) - X[1](0) * x[1](2), -2 * X[1](0) * x[1](1), X[1](2) * x[1](1) - X[1](1) * x[1](2);
+
+    // Not inverse(): Eigen's vectorized 4x4 inverse flips signs by xor-ing with -0.0, which -ffast-math optimizes away.
+    b = A.partialPivLu().solve(b);
+
+    const Real c2 = b(3, 0);
+    const Real c3 = b(3, 1);
+
+    return univariate::solve_quadratic_real(Real(1), c2, c3, qq);
+}
+
+// Pose is either CameraPoseT<Real> or CompactPoseT<Real>.
+template <typename Real, typename Pose>
+inline void up2p_pose(const Eigen::Matrix<Real, 4, 2> &b, Real q, Pose *pose) {
+    const Real inv_norm = Real(1) / (1 + q * q);
+    rotation::set_upright(q, pose);
+    pose->t = b.template block<3, 1>(0, 0) * q + b.template block<3, 1>(0, 1);
+    pose->t *= -inv_norm;
+}
+
+template <typename Real, typename Pose>
+inline int up2p_impl(const Vector3ViewT<Real> &x, const Vector3ViewT<Real> &X, std::vector<Pose> *output,
+                     bool filter_invalid) {
+    Eigen::Matrix<Real, 4, 2> b;
+    Real qq[2];
+    const int sols = up2p_roots(x, X, b, qq);
+
+    output->clear();
+    for (int i = 0; i < sols; ++i) {
+        Pose pose;
+        up2p_pose(b, qq[i], &pose);
+        if (filter_invalid && !validity::check_points(pose, x, X))
+            continue;
+        output->push_back(pose);
+    }
+    return output->size();
+}
+
+} // namespace detail
+
+template <typename Real>
+POSELIB_INLINE int up2p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X,
+                        std::vector<CameraPoseT<Real>> *output, bool filter_invalid) {
+    return detail::up2p_impl(x, X, output, filter_invalid);
+}
+
+template <typename Real>
+POSELIB_INLINE int up2p(const Vector3ViewArgT<Real> &x, const Vector3ViewArgT<Real> &X,
+                        std::vector<CompactPoseT<Real>> *output, bool filter_invalid) {
+    return detail::up2p_impl(x, X, output, filter_invalid);
+}
+
+POSELIB_END_HEADER_ONLY
+} // namespace pose_lib
@@ -27,10 +27,14 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "up4pl.h"
+#include "ugp4pl.h"
 #include "misc/qep.h"
+#include "misc/validity.h"
+#include "misc/dispatch.h"
 
-int pose_lib::up4pl(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-                    const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output) {
+int pose_lib::up4pl(const Vector3View &x, const Vector3View &X,
+                    const Vector3View &V, CameraPoseVector *output, bool filter_invalid) {
+    POSELIB_DISPATCH(up4pl, (x, X, V, output, filter_invalid))
 
     Eigen::Matrix<double, 4, 4> M, C, K;
     Eigen::Matrix<double, 3, 4> VX;
@@ -115,7 +119,25 @@ int pose_lib::up4pl(const std::vector<Eigen::Vector3d> &x, const std::vector<Eig
         pose.R(2, 2) = cq;
         pose.t = eig_vecs.col(i);
 
+        if (filter_invalid && !validity::check_point_lines(pose, Vector3View(), x, X, V))
+            continue;
         output->push_back(pose);
     }
-    return n_roots;
+    return output->size();
+}
+
+int pose_lib::up4pl_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &x, const Eigen::Matrix<double, Eigen::Dynamic, 12> &X,
+                          const Eigen::Matrix<double, Eigen::Dynamic, 12> &V, CameraPoseVector *output, std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(up4pl_batch, (x, X, V, output, num_solutions))
+    // Same as ugp4pl with all camera centers at the origin.
+    const Eigen::Matrix<double, Eigen::Dynamic, 12> p = Eigen::Matrix<double, Eigen::Dynamic, 12>::Zero(x.rows(), 12);
+    return ugp4pl_batch(p, x, X, V, output, num_solutions);
+}
+
+int pose_lib::up4pl_batch(const BatchView<12> &x, const BatchView<12> &X, const BatchView<12> &V, CameraPoseVector *output,
+                          std::vector<int> *num_solutions) {
+    POSELIB_DISPATCH(up4pl_batch_view, (x, X, V, output, num_solutions))
+    const Eigen::Matrix<double, Eigen::Dynamic, 12, Eigen::RowMajor> p =
+        Eigen::Matrix<double, Eigen::Dynamic, 12, Eigen::RowMajor>::Zero(x.rows(), 12);
+    return ugp4pl_batch(BatchView<12>(p.data(), p.rows(), 12), x, X, V, output, num_solutions);
 }
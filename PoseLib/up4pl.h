@@ -29,6 +29,7 @@
 #pragma once
 #include "types.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace pose_lib {
 
@@ -37,6 +38,15 @@ namespace pose_lib {
 // This problem is equivalent to upright generalized relative pose estimation
 // (where only one camera is generalized)
 //    Sweeney et al., Solving for Relative Pose with a Partially Known Rotation is a Quadratic Eigenvalue Problem, 3DV 2014
-int up4pl(const std::vector<Eigen::Vector3d> &x, const std::vector<Eigen::Vector3d> &X,
-          const std::vector<Eigen::Vector3d> &V, CameraPoseVector *output);
+// If filter_invalid is true, solutions with non-finite values or with any of the points behind the camera are discarded.
+int up4pl(const Vector3View &x, const Vector3View &X,
+          const Vector3View &V, CameraPoseVector *output, bool filter_invalid = false);
+
+// Batched version of up4pl, see ugp4pl_batch. Row i holds instance i, i.e. x.row(i) = [x[0]' x[1]' x[2]' x[3]'] and
+// similarly for X and V.
+int up4pl_batch(const Eigen::Matrix<double, Eigen::Dynamic, 12> &x, const Eigen::Matrix<double, Eigen::Dynamic, 12> &X,
+                const Eigen::Matrix<double, Eigen::Dynamic, 12> &V, CameraPoseVector *output, std::vector<int> *num_solutions);
+// Same as above but for row-major views of the instances, e.g. of NumPy arrays, which are not copied.
+int up4pl_batch(const BatchView<12> &x, const BatchView<12> &X, const BatchView<12> &V, CameraPoseVector *output,
+                std::vector<int> *num_solutions);
 }; // namespace pose_lib
@@ -23,7 +23,7 @@ BenchmarkResult benchmark(int n_problems, const ProblemOptions &options, double
 
     // Run benchmark where we check solution quality
     for (const AbsolutePoseProblemInstance &instance : problem_instances) {
-        CameraPoseVector solutions;
+        typename SolutionsOf<Solver>::type solutions;
 
         int sols = Solver::solve(instance, &solutions);
 
@@ -43,7 +43,7 @@ BenchmarkResult benchmark(int n_problems, const ProblemOptions &options, double
     }
 
     std::vector<long> runtimes;
-    CameraPoseVector solutions;
+    typename SolutionsOf<Solver>::type solutions;
     for (int iter = 0; iter < 10; ++iter) {
         int total_sols = 0;
         auto start_time = std::chrono::high_resolution_clock::now();
@@ -82,7 +82,7 @@ BenchmarkResult benchmark_relative(int n_problems, const ProblemOptions &options
 
     // Run benchmark where we check solution quality
     for (const RelativePoseProblemInstance &instance : problem_instances) {
-        CameraPoseVector solutions;
+        typename SolutionsOf<Solver>::type solutions;
 
         int sols = Solver::solve(instance, &solutions);
 
@@ -102,7 +102,7 @@ BenchmarkResult benchmark_relative(int n_problems, const ProblemOptions &options
     }
 
     std::vector<long> runtimes;
-    CameraPoseVector solutions;
+    typename SolutionsOf<Solver>::type solutions;
     for (int iter = 0; iter < 10; ++iter) {
         int total_sols = 0;
         auto start_time = std::chrono::high_resolution_clock::now();
@@ -125,6 +125,69 @@ BenchmarkResult benchmark_relative(int n_problems, const ProblemOptions &options
     return result;
 }
 
+inline void generate_problems(int n_problems, std::vector<AbsolutePoseProblemInstance> *problem_instances,
+                              const ProblemOptions &options) {
+    generate_abspose_problems(n_problems, problem_instances, options);
+}
+
+inline void generate_problems(int n_problems, std::vector<RelativePoseProblemInstance> *problem_instances,
+                              const ProblemOptions &options) {
+    generate_relpose_problems(n_problems, problem_instances, options);
+}
+
+// Benchmark for the batched solvers. All instances are packed once and then solved in a single call.
+template <typename Solver>
+BenchmarkResult benchmark_batch(int n_problems, const ProblemOptions &options, double tol = 1e-6) {
+
+    std::vector<typename Solver::Instance> problem_instances;
+    generate_problems(n_problems, &problem_instances, options);
+
+    typename Solver::Data data;
+    Solver::pack(problem_instances, &data);
+
+    BenchmarkResult result;
+    result.instances_ = n_problems;
+    result.name_ = Solver::name();
+    if (options.additional_name_ != "") {
+        result.name_ += options.additional_name_;
+    }
+    result.options_ = options;
+    std::cout << "Running benchmark: " << result.name_ << std::flush;
+
+    // Run benchmark where we check solution quality
+    CameraPoseVector solutions;
+    std::vector<int> num_solutions;
+    result.solutions_ = Solver::solve(data, &solutions, &num_solutions);
+
+    int offset = 0;
+    for (int i = 0; i < n_problems; ++i) {
+        double pose_error = std::numeric_limits<double>::max();
+        for (int k = 0; k < num_solutions[i]; ++k) {
+            const CameraPose &pose = solutions[offset + k];
+            if (Solver::validator::is_valid(problem_instances[i], pose, tol))
+                result.valid_solutions_++;
+            pose_error = std::min(pose_error, Solver::validator::compute_pose_error(problem_instances[i], pose));
+        }
+        offset += num_solutions[i];
+
+        if (pose_error < tol)
+            result.found_gt_pose_++;
+    }
+
+    std::vector<long> runtimes;
+    for (int iter = 0; iter < 10; ++iter) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        Solver::solve(data, &solutions, &num_solutions);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        runtimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+    }
+
+    std::sort(runtimes.begin(), runtimes.end());
+    result.runtime_ns_ = runtimes[runtimes.size() / 2];
+    std::cout << "\r                                                                                \r";
+    return result;
+}
+
 } // namespace pose_lib
 
 void print_runtime(double runtime_ns) {
@@ -184,12 +247,18 @@ int main() {
     options.camera_fov_ = 120; // Wide
 
     double tol = 1e-6;
+    // The single precision solvers can not reach the tolerance above, see the README for their accuracy.
+    double float_tol = 1e-3;
 
     // P3P
     pose_lib::ProblemOptions p3p_opt = options;
     p3p_opt.n_point_point_ = 3;
     p3p_opt.n_point_line_ = 0;
     results.push_back(pose_lib::benchmark<pose_lib::SolverP3P>(1e5, p3p_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverP3PBatch>(1e5, p3p_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverP3PBatchFloat>(1e5, p3p_opt, float_tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverP3PFloat>(1e5, p3p_opt, float_tol));
+    results.push_back(pose_lib::benchmark<pose_lib::SolverP3PFixed>(1e5, p3p_opt, tol));
 
     // gP3P
     pose_lib::ProblemOptions gp3p_opt = options;
@@ -197,6 +266,7 @@ int main() {
     gp3p_opt.n_point_line_ = 0;
     gp3p_opt.generalized_ = true;
     results.push_back(pose_lib::benchmark<pose_lib::SolverGP3P>(1e4, gp3p_opt, tol));
+    results.push_back(pose_lib::benchmark<pose_lib::SolverGP3PCompact>(1e4, gp3p_opt, tol));
 
     // gP4Ps
     pose_lib::ProblemOptions gp4p_opt = options;
@@ -223,6 +293,8 @@ int main() {
     p2p2pl_opt.n_point_point_ = 2;
     p2p2pl_opt.n_point_line_ = 2;
     results.push_back(pose_lib::benchmark<pose_lib::SolverP2P2PL>(1e3, p2p2pl_opt, tol));
+    results.push_back(pose_lib::benchmark<pose_lib::SolverP2P2PLFixed>(1e3, p2p2pl_opt, tol));
+    results.push_back(pose_lib::benchmark<pose_lib::SolverP2P2PLWorkspace>(1e3, p2p2pl_opt, tol));
 
     // P6LP
     pose_lib::ProblemOptions p6lp_opt = options;
@@ -257,6 +329,9 @@ int main() {
     up2p_opt.n_point_line_ = 0;
     up2p_opt.upright_ = true;
     results.push_back(pose_lib::benchmark<pose_lib::SolverUP2P>(1e6, up2p_opt, tol));
+    results.push_back(pose_lib::benchmark<pose_lib::SolverUP2PCompact>(1e6, up2p_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverUP2PBatch>(1e6, up2p_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverUP2PFloat>(1e6, up2p_opt, float_tol));
 
     // uGP2P
     pose_lib::ProblemOptions ugp2p_opt = options;
@@ -265,6 +340,7 @@ int main() {
     ugp2p_opt.upright_ = true;
     ugp2p_opt.generalized_ = true;
     results.push_back(pose_lib::benchmark<pose_lib::SolverUGP2P>(1e6, ugp2p_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverUGP2PBatch>(1e6, ugp2p_opt, tol));
 
     // uGP3Ps
     pose_lib::ProblemOptions ugp3ps_opt = options;
@@ -288,6 +364,7 @@ int main() {
     up4pl_opt.n_point_line_ = 4;
     up4pl_opt.upright_ = true;
     results.push_back(pose_lib::benchmark<pose_lib::SolverUP4PL>(1e4, up4pl_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverUP4PLBatch>(1e4, up4pl_opt, tol));
 
     // ugP4PL
     pose_lib::ProblemOptions ugp4pl_opt = options;
@@ -296,12 +373,15 @@ int main() {
     ugp4pl_opt.upright_ = true;
     ugp4pl_opt.generalized_ = true;
     results.push_back(pose_lib::benchmark<pose_lib::SolverUGP4PL>(1e4, ugp4pl_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverUGP4PLBatch>(1e4, ugp4pl_opt, tol));
 
     // Relative Pose Upright
     pose_lib::ProblemOptions relupright3pt_opt = options;
     relupright3pt_opt.n_point_point_ = 3;
     relupright3pt_opt.upright_ = true;
     results.push_back(pose_lib::benchmark_relative<pose_lib::SolverRelUpright3pt>(1e4, relupright3pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverRelUpright3ptBatch>(1e4, relupright3pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverRelUpright3ptFloat>(1e4, relupright3pt_opt, float_tol));
 
     // Generalized Relative Pose Upright
     pose_lib::ProblemOptions genrelupright4pt_opt = options;
@@ -309,6 +389,7 @@ int main() {
     genrelupright4pt_opt.upright_ = true;
     genrelupright4pt_opt.generalized_ = true;
     results.push_back(pose_lib::benchmark_relative<pose_lib::SolverGenRelUpright4pt>(1e4, genrelupright4pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverGenRelUpright4ptBatch>(1e4, genrelupright4pt_opt, tol));
 
     // Relative Pose 8pt
     pose_lib::ProblemOptions rel8pt_opt = options;
@@ -323,6 +404,10 @@ int main() {
     pose_lib::ProblemOptions rel5pt_opt = options;
     rel5pt_opt.n_point_point_ = 5;
     results.push_back(pose_lib::benchmark_relative<pose_lib::SolverRel5pt>(1e4, rel5pt_opt, tol));
+    results.push_back(pose_lib::benchmark_relative<pose_lib::SolverRel5ptFixed>(1e4, rel5pt_opt, tol));
+    results.push_back(pose_lib::benchmark_relative<pose_lib::SolverRel5ptWorkspace>(1e4, rel5pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverRel5ptBatch>(1e4, rel5pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverRel5ptFloat>(1e4, rel5pt_opt, float_tol));
 
 
     // Relative Pose Upright Planar 2pt
@@ -331,6 +416,7 @@ int main() {
     reluprightplanar2pt_opt.upright_ = true;
     reluprightplanar2pt_opt.planar_ = true;
     results.push_back(pose_lib::benchmark_relative<pose_lib::SolverRelUprightPlanar2pt>(1e4, reluprightplanar2pt_opt, tol));
+    results.push_back(pose_lib::benchmark_batch<pose_lib::SolverRelUprightPlanar2ptBatch>(1e4, reluprightplanar2pt_opt, tol));
 
     // Relative Pose Upright Planar 3pt
     pose_lib::ProblemOptions reluprightplanar3pt_opt = options;
@@ -6,6 +6,7 @@
 #include <Eigen/Dense>
 #include <stdint.h>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace pose_lib {
@@ -22,6 +23,17 @@ struct BenchmarkResult {
 
 // Wrappers for the Benchmarking code
 
+// The container which the solutions are returned in. Wrappers which solve into a FixedVector (i.e. without heap
+// allocations) declare it as Solutions, such that the solutions are validated and timed without being copied.
+template <typename Solver, typename = void>
+struct SolutionsOf {
+  typedef CameraPoseVector type;
+};
+template <typename Solver>
+struct SolutionsOf<Solver, typename std::conditional<true, void, typename Solver::Solutions>::type> {
+  typedef typename Solver::Solutions type;
+};
+
 struct SolverP3P {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return p3p(instance.x_point_, instance.X_point_, solutions);
@@ -30,6 +42,125 @@ struct SolverP3P {
   static std::string name() { return "p3p"; }
 };
 
+// Batched solvers process all instances in a single call. pack() converts the instances to the batch layout.
+
+// Stores the vectors in the given field of each instance as the rows of M, i.e. M.row(i) = [v[0]' v[1]' ...]
+template <typename Instance, int Cols>
+inline void pack_rows(const std::vector<Instance> &instances, std::vector<Eigen::Vector3d> Instance::*field,
+                      Eigen::Matrix<double, Eigen::Dynamic, Cols> *M) {
+  M->resize(instances.size(), Cols);
+  for (size_t i = 0; i < instances.size(); ++i) {
+    for (int k = 0; k < Cols / 3; ++k) {
+      M->template block<1, 3>(i, 3 * k) = (instances[i].*field)[k].transpose();
+    }
+  }
+}
+
+// Single precision solvers are benchmarked through the batch interface as well. pack() converts the instances
+// to float and solve() converts the solutions back to double for validation.
+typedef std::vector<Eigen::Vector3f> Points3f;
+
+template <typename Instance>
+inline void pack_float(const std::vector<Instance> &instances, std::vector<Eigen::Vector3d> Instance::*field, std::vector<Points3f> *v) {
+  v->resize(instances.size());
+  for (size_t i = 0; i < instances.size(); ++i) {
+    (*v)[i].clear();
+    for (const Eigen::Vector3d &p : instances[i].*field) {
+      (*v)[i].push_back(p.cast<float>());
+    }
+  }
+}
+
+template <typename SolverFn>
+inline int solve_float(const std::vector<Points3f> &a, const std::vector<Points3f> &b, SolverFn solver,
+                       pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+  solutions->clear();
+  num_solutions->resize(a.size());
+  CameraPoseVectorf poses;
+  for (size_t i = 0; i < a.size(); ++i) {
+    (*num_solutions)[i] = solver(a[i], b[i], &poses);
+    for (const CameraPosef &pose : poses) {
+      CameraPose p;
+      p.R = pose.R.cast<double>();
+      p.t = pose.t.cast<double>();
+      p.alpha = pose.alpha;
+      solutions->push_back(p);
+    }
+  }
+  return solutions->size();
+}
+
+struct SolverP3PBatch {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 9> x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x_point_, &data->x);
+    pack_rows(instances, &Instance::X_point_, &data->X);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return p3p_batch(data.x, data.X, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p3p(batch)"; }
+};
+
+// The conversion of the solutions back to double is included in the timing.
+struct SolverP3PBatchFloat {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<float, Eigen::Dynamic, 9> x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    Eigen::Matrix<double, Eigen::Dynamic, 9> M;
+    pack_rows(instances, &Instance::x_point_, &M);
+    data->x = M.cast<float>();
+    pack_rows(instances, &Instance::X_point_, &M);
+    data->X = M.cast<float>();
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    std::vector<CameraPosef> poses;
+    p3p_batch(data.x, data.X, &poses, num_solutions);
+    solutions->resize(poses.size());
+    for (size_t i = 0; i < poses.size(); ++i) {
+      (*solutions)[i].R = poses[i].R.cast<double>();
+      (*solutions)[i].t = poses[i].t.cast<double>();
+      (*solutions)[i].alpha = poses[i].alpha;
+    }
+    return solutions->size();
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p3p(batch, float)"; }
+};
+
+struct SolverP3PFloat {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    std::vector<Points3f> x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_float(instances, &Instance::x_point_, &data->x);
+    pack_float(instances, &Instance::X_point_, &data->X);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return solve_float(data.x, data.X, [](const Points3f &a, const Points3f &b, CameraPoseVectorf *out) { return p3p(a, b, out); },
+                       solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p3p(float)"; }
+};
+
+// Solves into a FixedVector, i.e. without heap allocations.
+struct SolverP3PFixed {
+  typedef pose_lib::FixedVector<pose_lib::CameraPose, 4> Solutions;
+  static inline int solve(const AbsolutePoseProblemInstance &instance, Solutions *solutions) {
+    return p3p(instance.x_point_, instance.X_point_, solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p3p(fixed)"; }
+};
+
 struct SolverP4PF {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return p4pf(instance.x_point_, instance.X_point_, solutions);
@@ -46,6 +177,21 @@ struct SolverGP3P {
   static std::string name() { return "gp3p"; }
 };
 
+// Solves into compact poses and then converts them back for validation (included in the runtime). The compact
+// vector is reused between the calls, like the output vector of the other solvers.
+struct SolverGP3PCompact {
+  static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
+    static pose_lib::CompactPoseVector compact;
+    int n = gp3p(instance.p_point_, instance.x_point_, instance.X_point_, &compact);
+    solutions->clear();
+    for (const pose_lib::CompactPose &pose : compact)
+      solutions->push_back(pose.to_pose());
+    return n;
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "gp3p(compact)"; }
+};
+
 struct SolverGP4PS {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return gp4ps(instance.p_point_, instance.x_point_, instance.X_point_, solutions);
@@ -62,6 +208,25 @@ struct SolverP2P2PL {
   static std::string name() { return "p2p2pl"; }
 };
 
+struct SolverP2P2PLFixed {
+  typedef pose_lib::FixedVector<pose_lib::CameraPose, 16> Solutions;
+  static inline int solve(const AbsolutePoseProblemInstance &instance, Solutions *solutions) {
+    return p2p2pl(instance.x_point_, instance.X_point_, instance.x_line_, instance.X_line_, instance.V_line_, solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p2p2pl(fixed)"; }
+};
+
+// Reuses the same workspace for all instances.
+struct SolverP2P2PLWorkspace {
+  static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
+    static pose_lib::P2P2PLWorkspace workspace;
+    return p2p2pl(instance.x_point_, instance.X_point_, instance.x_line_, instance.X_line_, instance.V_line_, solutions, false, &workspace);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "p2p2pl(workspace)"; }
+};
+
 struct SolverP6LP {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return p6lp(instance.l_line_point_, instance.X_line_point_, solutions);
@@ -109,6 +274,19 @@ struct SolverUP2P {
   static std::string name() { return "up2p"; }
 };
 
+struct SolverUP2PCompact {
+  static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
+    static pose_lib::CompactPoseVector compact;
+    int n = up2p(instance.x_point_, instance.X_point_, &compact);
+    solutions->clear();
+    for (const pose_lib::CompactPose &pose : compact)
+      solutions->push_back(pose.to_pose());
+    return n;
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "up2p(compact)"; }
+};
+
 struct SolverUGP2P {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return ugp2p(instance.p_point_, instance.x_point_, instance.X_point_, solutions);
@@ -117,6 +295,56 @@ struct SolverUGP2P {
   static std::string name() { return "ugp2p"; }
 };
 
+struct SolverUP2PBatch {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 6> x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x_point_, &data->x);
+    pack_rows(instances, &Instance::X_point_, &data->X);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return up2p_batch(data.x, data.X, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "up2p(batch)"; }
+};
+
+struct SolverUP2PFloat {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    std::vector<Points3f> x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_float(instances, &Instance::x_point_, &data->x);
+    pack_float(instances, &Instance::X_point_, &data->X);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return solve_float(data.x, data.X, [](const Points3f &a, const Points3f &b, CameraPoseVectorf *out) { return up2p(a, b, out); },
+                       solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "up2p(float)"; }
+};
+
+struct SolverUGP2PBatch {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 6> p, x, X;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::p_point_, &data->p);
+    pack_rows(instances, &Instance::x_point_, &data->x);
+    pack_rows(instances, &Instance::X_point_, &data->X);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return ugp2p_batch(data.p, data.x, data.X, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "ugp2p(batch)"; }
+};
+
 struct SolverUGP3PS {
   static inline int solve(const AbsolutePoseProblemInstance &instance, pose_lib::CameraPoseVector *solutions) {
     return ugp3ps(instance.p_point_, instance.x_point_, instance.X_point_, solutions);
@@ -149,6 +377,41 @@ struct SolverUGP4PL {
   static std::string name() { return "ugp4pl"; }
 };
 
+struct SolverUP4PLBatch {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 12> x, X, V;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x_line_, &data->x);
+    pack_rows(instances, &Instance::X_line_, &data->X);
+    pack_rows(instances, &Instance::V_line_, &data->V);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return up4pl_batch(data.x, data.X, data.V, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "up4pl(batch)"; }
+};
+
+struct SolverUGP4PLBatch {
+  typedef AbsolutePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 12> p, x, X, V;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::p_line_, &data->p);
+    pack_rows(instances, &Instance::x_line_, &data->x);
+    pack_rows(instances, &Instance::X_line_, &data->X);
+    pack_rows(instances, &Instance::V_line_, &data->V);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return ugp4pl_batch(data.p, data.x, data.X, data.V, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "ugp4pl(batch)"; }
+};
+
 
 struct SolverRelUpright3pt {
   static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
@@ -158,6 +421,39 @@ struct SolverRelUpright3pt {
   static std::string name() { return "RelUpright3pt"; }
 };
 
+struct SolverRelUpright3ptBatch {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 9> x1, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x1_, &data->x1);
+    pack_rows(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return relpose_upright_3pt_batch(data.x1, data.x2, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "RelUpright3pt(batch)"; }
+};
+
+struct SolverRelUpright3ptFloat {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    std::vector<Points3f> x1, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_float(instances, &Instance::x1_, &data->x1);
+    pack_float(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return solve_float(data.x1, data.x2, [](const Points3f &a, const Points3f &b, CameraPoseVectorf *out) { return relpose_upright_3pt(a, b, out); },
+                       solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "RelUpright3pt(float)"; }
+};
+
 struct SolverGenRelUpright4pt {
   static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
     return gen_relpose_upright_4pt(instance.p1_, instance.x1_, instance.p2_, instance.x2_, solutions);
@@ -166,6 +462,24 @@ struct SolverGenRelUpright4pt {
   static std::string name() { return "GenRelUpright4pt"; }
 };
 
+struct SolverGenRelUpright4ptBatch {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 12> p1, x1, p2, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::p1_, &data->p1);
+    pack_rows(instances, &Instance::x1_, &data->x1);
+    pack_rows(instances, &Instance::p2_, &data->p2);
+    pack_rows(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return gen_relpose_upright_4pt_batch(data.p1, data.x1, data.p2, data.x2, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "GenRelUpright4pt(batch)"; }
+};
+
 struct SolverRel8pt {
   static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
     return relpose_8pt(instance.x1_, instance.x2_, solutions);
@@ -182,6 +496,58 @@ struct SolverRel5pt {
   static std::string name() { return "Rel5pt"; }
 };
 
+struct SolverRel5ptFixed {
+  typedef pose_lib::FixedVector<pose_lib::CameraPose, 10> Solutions;
+  static inline int solve(const RelativePoseProblemInstance& instance, Solutions* solutions) {
+    return relpose_5pt(instance.x1_, instance.x2_, solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "Rel5pt(fixed)"; }
+};
+
+struct SolverRel5ptWorkspace {
+  static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
+    static pose_lib::Relpose5ptWorkspace workspace;
+    return relpose_5pt(instance.x1_, instance.x2_, solutions, &workspace);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "Rel5pt(workspace)"; }
+};
+
+
+struct SolverRel5ptBatch {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 15> x1, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x1_, &data->x1);
+    pack_rows(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return relpose_5pt_batch(data.x1, data.x2, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "Rel5pt(batch)"; }
+};
+
+struct SolverRel5ptFloat {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    std::vector<Points3f> x1, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_float(instances, &Instance::x1_, &data->x1);
+    pack_float(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return solve_float(data.x1, data.x2, [](const Points3f &a, const Points3f &b, CameraPoseVectorf *out) { return relpose_5pt(a, b, out); },
+                       solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "Rel5pt(float)"; }
+};
+
 
 struct SolverRelUprightPlanar2pt {
     static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
@@ -191,6 +557,22 @@ struct SolverRelUprightPlanar2pt {
     static std::string name() { return "RelUprightPlanar2pt"; }
 };
 
+struct SolverRelUprightPlanar2ptBatch {
+  typedef RelativePoseProblemInstance Instance;
+  struct Data {
+    Eigen::Matrix<double, Eigen::Dynamic, 6> x1, x2;
+  };
+  static void pack(const std::vector<Instance> &instances, Data *data) {
+    pack_rows(instances, &Instance::x1_, &data->x1);
+    pack_rows(instances, &Instance::x2_, &data->x2);
+  }
+  static inline int solve(const Data &data, pose_lib::CameraPoseVector *solutions, std::vector<int> *num_solutions) {
+    return relpose_upright_planar_2pt_batch(data.x1, data.x2, solutions, num_solutions);
+  }
+  typedef CalibPoseValidator validator;
+  static std::string name() { return "RelUprightPlanar2pt(batch)"; }
+};
+
 struct SolverRelUprightPlanar3pt {
   static inline int solve(const RelativePoseProblemInstance& instance, pose_lib::CameraPoseVector* solutions) {
     return relpose_upright_planar_3pt(instance.x1_, instance.x2_, solutions);
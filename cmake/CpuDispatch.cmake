@@ -0,0 +1,77 @@
+# Runtime CPU dispatch (POSELIB_CPU_DISPATCH)
+#
+# The library is compiled for the portable baseline in POSELIB_ARCH_FLAGS. In addition, the sources of the
+# dispatched kernels (see PoseLib/misc/dispatch.h) are compiled for each of the instruction sets below.
+# The objects of each variant are partially linked into a single object and all symbols except the entry points
+# poselib_<isa>_* are made local. Otherwise the linker could merge e.g. the Eigen template instantiations of the
+# variants with those of the baseline, and the baseline code would end up executing AVX-512 instructions.
+#
+# Input variables:
+#   - DISPATCH_SOURCES: sources compiled for each variant
+#   - DISPATCH_FLAGS  : compile flags shared by all variants (warnings, -ffast-math, etc.)
+
+if(MSVC OR NOT CMAKE_SYSTEM_PROCESSOR MATCHES "x86_64|AMD64|amd64")
+  message(FATAL_ERROR "POSELIB_CPU_DISPATCH requires GCC or Clang on x86-64.")
+endif()
+if(NOT CMAKE_LINKER OR NOT CMAKE_OBJCOPY)
+  message(FATAL_ERROR "POSELIB_CPU_DISPATCH requires ld and objcopy.")
+endif()
+
+set(DISPATCH_ISA_avx2   -mavx2 -mfma -mf16c -mbmi -mbmi2 -mlzcnt -mpopcnt)
+set(DISPATCH_ISA_avx512 ${DISPATCH_ISA_avx2} -mavx512f -mavx512dq -mavx512vl -mavx512bw -mavx512cd)
+if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+  # False positives with the AVX/AVX-512 intrinsics (e.g. GCC bug 105593).
+  list(APPEND DISPATCH_FLAGS -Wno-uninitialized -Wno-maybe-uninitialized)
+  # Static locals of inline functions are otherwise emitted as STB_GNU_UNIQUE, which objcopy cannot make local.
+  list(APPEND DISPATCH_FLAGS -fno-gnu-unique)
+endif()
+
+if(BUILD_SHARED_LIBS OR CMAKE_POSITION_INDEPENDENT_CODE)
+  set(DISPATCH_PIC ON)
+else()
+  set(DISPATCH_PIC OFF)
+endif()
+
+foreach(isa avx2 avx512)
+  set(variant ${LIBRARY_NAME}_${isa})
+
+  add_library(${variant} OBJECT ${DISPATCH_SOURCES})
+  target_link_libraries(${variant} PRIVATE Eigen3::Eigen)
+  target_include_directories(${variant} PRIVATE
+    "${PROJECT_SOURCE_DIR}"
+    "${GENERATED_HEADERS_DIR}"
+  )
+  target_compile_definitions(${variant} PRIVATE
+    POSELIB_CPU_DISPATCH
+    POSELIB_DISPATCH_VARIANT=${isa}
+    EIGEN_MAX_ALIGN_BYTES=16
+    "${PROJECT_NAME_UPPERCASE}_DEBUG=$<CONFIG:Debug>"
+  )
+  target_compile_options(${variant} PRIVATE ${DISPATCH_ISA_${isa}} ${DISPATCH_FLAGS})
+  set_target_properties(${variant} PROPERTIES
+    CXX_STANDARD 11
+    CXX_STANDARD_REQUIRED YES
+    POSITION_INDEPENDENT_CODE ${DISPATCH_PIC}
+  )
+
+  # Partial link. --force-group-allocation resolves the COMDAT groups (inline functions, template instantiations)
+  # within the variant, so that they are no longer merged with the ones of the baseline in the final link.
+  set(variant_object "${CMAKE_CURRENT_BINARY_DIR}/${variant}${CMAKE_CXX_OUTPUT_EXTENSION}")
+  add_custom_command(
+    OUTPUT  "${variant_object}"
+    COMMAND "${CMAKE_LINKER}" -r --force-group-allocation -o "${variant_object}" "$<TARGET_OBJECTS:${variant}>"
+    COMMAND "${CMAKE_OBJCOPY}" --wildcard --keep-global-symbol=poselib_${isa}_* "${variant_object}"
+    DEPENDS "$<TARGET_OBJECTS:${variant}>"
+    COMMAND_EXPAND_LISTS
+    COMMENT "Linking ${isa} variant of the dispatched kernels"
+  )
+  target_sources(${LIBRARY_NAME} PRIVATE "${variant_object}")
+  add_dependencies(${LIBRARY_NAME} ${variant})
+endforeach()
+
+target_compile_definitions(${LIBRARY_NAME}
+  PRIVATE POSELIB_CPU_DISPATCH
+  # The variants and the baseline (as well as any code using the library) must agree on the alignment
+  # of the Eigen types they exchange, otherwise the wider variants may assume 32 or 64 byte aligned data.
+  PUBLIC  EIGEN_MAX_ALIGN_BYTES=16
+)
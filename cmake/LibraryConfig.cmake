@@ -3,6 +3,7 @@ add_library(${LIBRARY_NAME}
   ${SOURCES}
   ${HEADERS_PUBLIC}
   ${HEADERS_PRIVATE}
+  ${HEADERS_INLINE}
   )
 
 # Alias:
@@ -67,6 +68,18 @@ install(
     DESTINATION "${CMAKE_INSTALL_INCLUDEDIR}/${LIBRARY_FOLDER}"
 )
 
+# Headers (header-only mode, see types.h):
+#   - HEADERS_INLINE      -> <prefix>/include/PoseLib/*_inl.h
+#   - HEADERS_INLINE_MISC -> <prefix>/include/PoseLib/misc/*.h
+install(
+    FILES ${HEADERS_INLINE}
+    DESTINATION "${CMAKE_INSTALL_INCLUDEDIR}/${LIBRARY_FOLDER}"
+)
+install(
+    FILES ${HEADERS_INLINE_MISC}
+    DESTINATION "${CMAKE_INSTALL_INCLUDEDIR}/${LIBRARY_FOLDER}/misc"
+)
+
 # Headers:
 #   - generated_headers/PoseLib/version.h -> <prefix>/include/PoseLib/version.h
 install(
@@ -0,0 +1,370 @@
+// Copyright (c) 2020, Viktor Larsson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of the copyright holder nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <PoseLib/poselib.h>
+#include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace pose_lib {
+namespace {
+
+// C-contiguous float64 arrays are passed to the solvers without copying. Other arrays (e.g. float32 or transposed)
+// are converted to a contiguous float64 copy by pybind11 when the function is called.
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> DoubleArray;
+
+// Field of SolverInput, with the number of correspondences of the solver stored in it.
+struct InputField {
+    const char *name;
+    Vector3View SolverInput::*view;
+    int SolverInfo::*count;
+};
+
+const InputField input_fields[] = {
+    {"x_point", &SolverInput::x_point, &SolverInfo::num_point_point},
+    {"X_point", &SolverInput::X_point, &SolverInfo::num_point_point},
+    {"p_point", &SolverInput::p_point, &SolverInfo::num_point_point},
+    {"x_line", &SolverInput::x_line, &SolverInfo::num_point_line},
+    {"X_line", &SolverInput::X_line, &SolverInfo::num_point_line},
+    {"V_line", &SolverInput::V_line, &SolverInfo::num_point_line},
+    {"p_line", &SolverInput::p_line, &SolverInfo::num_point_line},
+    {"l_line_point", &SolverInput::l_line_point, &SolverInfo::num_line_point},
+    {"X_line_point", &SolverInput::X_line_point, &SolverInfo::num_line_point},
+    {"l_line_line", &SolverInput::l_line_line, &SolverInfo::num_line_line},
+    {"X_line_line", &SolverInput::X_line_line, &SolverInfo::num_line_line},
+    {"V_line_line", &SolverInput::V_line_line, &SolverInfo::num_line_line},
+    {"x1", &SolverInput::x1, &SolverInfo::num_point_point},
+    {"x2", &SolverInput::x2, &SolverInfo::num_point_point},
+    {"p1", &SolverInput::p1, &SolverInfo::num_point_point},
+    {"p2", &SolverInput::p2, &SolverInfo::num_point_point},
+};
+
+const InputField &find_input_field(const char *name) {
+    for (const InputField &field : input_fields) {
+        if (std::string(field.name) == name) {
+            return field;
+        }
+    }
+    throw std::logic_error(std::string("Unknown solver input ") + name);
+}
+
+// One argument for all problems of a batch, problem i uses the vectors data[i * size], ..., data[(i + 1) * size - 1].
+struct BatchArgument {
+    const InputField *field;
+    const Eigen::Vector3d *data;
+    size_t size;
+};
+
+// Batched (SIMD) version of a solver, e.g. p3p_batch. Solves the problems 0, ..., n_problems - 1 and stores their poses
+// consecutively in poses, and the number of poses of each problem in num_solutions.
+typedef void (*BatchSolver)(const std::vector<BatchArgument> &arguments, size_t n_problems, CameraPoseVector *poses,
+                            std::vector<int> *num_solutions);
+
+// Row-major view of the first N vectors of each problem, i.e. row i is [v[0]' ... v[N-1]'] of problem i. This is the
+// layout of the batched solvers, so they read the NumPy arrays directly. Only valid if each problem has N vectors.
+template <int N>
+BatchView<3 * N> batch_view(const BatchArgument &argument, size_t n_problems) {
+    return BatchView<3 * N>(argument.data->data(), n_problems, 3 * N);
+}
+
+template <int N, int (*Solver)(const BatchView<3 * N> &, const BatchView<3 * N> &, CameraPoseVector *, std::vector<int> *)>
+void batch_solver(const std::vector<BatchArgument> &a, size_t n, CameraPoseVector *poses, std::vector<int> *num_solutions) {
+    Solver(batch_view<N>(a[0], n), batch_view<N>(a[1], n), poses, num_solutions);
+}
+
+template <int N, int (*Solver)(const BatchView<3 * N> &, const BatchView<3 * N> &, const BatchView<3 * N> &,
+                               CameraPoseVector *, std::vector<int> *)>
+void batch_solver(const std::vector<BatchArgument> &a, size_t n, CameraPoseVector *poses, std::vector<int> *num_solutions) {
+    Solver(batch_view<N>(a[0], n), batch_view<N>(a[1], n), batch_view<N>(a[2], n), poses, num_solutions);
+}
+
+template <int N, int (*Solver)(const BatchView<3 * N> &, const BatchView<3 * N> &, const BatchView<3 * N> &,
+                               const BatchView<3 * N> &, CameraPoseVector *, std::vector<int> *)>
+void batch_solver(const std::vector<BatchArgument> &a, size_t n, CameraPoseVector *poses, std::vector<int> *num_solutions) {
+    Solver(batch_view<N>(a[0], n), batch_view<N>(a[1], n), batch_view<N>(a[2], n), batch_view<N>(a[3], n), poses,
+           num_solutions);
+}
+
+// Arguments of the Python functions, in the same order as for the C++ solvers, and the batched version of the solver
+// (if there is one) which is used by <solver>_batch.
+struct SolverArguments {
+    const char *solver;
+    std::vector<const char *> arguments;
+    BatchSolver batch;
+};
+
+const std::vector<SolverArguments> solver_arguments = {
+    {"p3p", {"x_point", "X_point"}, batch_solver<3, p3p_batch>},
+    {"gp3p", {"p_point", "x_point", "X_point"}, nullptr},
+    {"gp4ps", {"p_point", "x_point", "X_point"}, nullptr},
+    {"p4pf", {"x_point", "X_point"}, nullptr},
+    {"p2p2pl", {"x_point", "X_point", "x_line", "X_line", "V_line"}, nullptr},
+    {"p6lp", {"l_line_point", "X_line_point"}, nullptr},
+    {"p5lp_radial", {"l_line_point", "X_line_point"}, nullptr},
+    {"p2p1ll", {"x_point", "X_point", "l_line_line", "X_line_line", "V_line_line"}, nullptr},
+    {"p1p2ll", {"x_point", "X_point", "l_line_line", "X_line_line", "V_line_line"}, nullptr},
+    {"p3ll", {"l_line_line", "X_line_line", "V_line_line"}, nullptr},
+    {"up2p", {"x_point", "X_point"}, batch_solver<2, up2p_batch>},
+    {"ugp2p", {"p_point", "x_point", "X_point"}, batch_solver<2, ugp2p_batch>},
+    {"ugp3ps", {"p_point", "x_point", "X_point"}, nullptr},
+    {"up1p2pl", {"x_point", "X_point", "x_line", "X_line", "V_line"}, nullptr},
+    {"up4pl", {"x_line", "X_line", "V_line"}, batch_solver<4, up4pl_batch>},
+    {"ugp4pl", {"p_line", "x_line", "X_line", "V_line"}, batch_solver<4, ugp4pl_batch>},
+    {"relpose_5pt", {"x1", "x2"}, batch_solver<5, relpose_5pt_batch>},
+    {"relpose_8pt", {"x1", "x2"}, nullptr},
+    {"relpose_upright_3pt", {"x1", "x2"}, batch_solver<3, relpose_upright_3pt_batch>},
+    {"gen_relpose_upright_4pt", {"p1", "x1", "p2", "x2"}, batch_solver<4, gen_relpose_upright_4pt_batch>},
+    {"relpose_upright_planar_2pt", {"x1", "x2"}, batch_solver<2, relpose_upright_planar_2pt_batch>},
+    {"relpose_upright_planar_3pt", {"x1", "x2"}, nullptr},
+};
+
+// Checks the shapes of the arrays, which are (n, 3) or (batch, n, 3) if batched, and returns views of them.
+std::vector<BatchArgument> batch_arguments(const SolverInfo &solver, const SolverArguments &signature,
+                                           const std::vector<DoubleArray> &arrays, bool batched, size_t *n_problems) {
+    const int ndim = batched ? 3 : 2;
+    std::vector<BatchArgument> arguments;
+    *n_problems = 1;
+    for (size_t k = 0; k < arrays.size(); ++k) {
+        const DoubleArray &array = arrays[k];
+        const InputField &field = find_input_field(signature.arguments[k]);
+        if (array.ndim() != ndim || array.shape(ndim - 1) != 3) {
+            throw std::invalid_argument(std::string(field.name) + " must have shape " + (batched ? "(batch, n, 3)" : "(n, 3)"));
+        }
+        if (batched) {
+            if (k == 0) {
+                *n_problems = array.shape(0);
+            } else if (static_cast<size_t>(array.shape(0)) != *n_problems) {
+                throw std::invalid_argument("All arguments must have the same batch size");
+            }
+        }
+        const size_t size = array.shape(ndim - 2);
+        const int required = solver.*(field.count);
+        if (size < static_cast<size_t>(required)) {
+            throw std::invalid_argument(std::string(field.name) + " must have at least " + std::to_string(required) + " vectors");
+        }
+        arguments.push_back({&field, reinterpret_cast<const Eigen::Vector3d *>(array.data()), size});
+    }
+    return arguments;
+}
+
+// Solves the problems 0, ..., n_problems - 1 and appends their poses to poses. This does not touch any Python objects,
+// so it is called with the GIL released.
+void solve_problems(const SolverInfo &solver, const std::vector<BatchArgument> &arguments, size_t n_problems,
+                    CameraPoseVector *poses, int *num_solutions) {
+    SolverInput input;
+    CameraPoseVector output;
+    output.reserve(solver.max_solutions);
+    for (size_t i = 0; i < n_problems; ++i) {
+        for (const BatchArgument &argument : arguments) {
+            input.*(argument.field->view) = Vector3View(argument.data + i * argument.size, argument.size);
+        }
+        output.clear();
+        solver.solve(input, &output);
+        num_solutions[i] = static_cast<int>(output.size());
+        poses->insert(poses->end(), output.begin(), output.end());
+    }
+}
+
+CameraPoseVector solve(const SolverInfo &solver, const SolverArguments &signature, const std::vector<DoubleArray> &arrays) {
+    size_t n_problems;
+    const std::vector<BatchArgument> arguments = batch_arguments(solver, signature, arrays, false, &n_problems);
+    CameraPoseVector poses;
+    int num_solutions;
+    {
+        py::gil_scoped_release release;
+        solve_problems(solver, arguments, 1, &poses, &num_solutions);
+    }
+    return poses;
+}
+
+// Returns the tuple (R, t, alpha) of the arrays R (m, 3, 3), t (m, 3) and alpha (m), which are strided views of the
+// m poses. The poses are moved into a capsule which owns them and is the base of the arrays, so they are not copied.
+py::tuple pose_arrays(CameraPoseVector &&poses) {
+    const py::ssize_t n_poses = poses.size();
+    if (n_poses == 0) {
+        return py::make_tuple(py::array_t<double>(std::vector<py::ssize_t>{0, 3, 3}),
+                              py::array_t<double>(std::vector<py::ssize_t>{0, 3}), py::array_t<double>(0));
+    }
+    CameraPoseVector *owner = new CameraPoseVector(std::move(poses));
+    py::capsule base(owner, [](void *p) { delete static_cast<CameraPoseVector *>(p); });
+    const CameraPose &pose = owner->front();
+    const py::ssize_t stride = sizeof(CameraPose);
+    const py::ssize_t d = sizeof(double);
+    // R is column-major, i.e. R(i, j) is at offset (i + 3 * j) * sizeof(double).
+    py::array_t<double> R(std::vector<py::ssize_t>{n_poses, 3, 3}, std::vector<py::ssize_t>{stride, d, 3 * d}, pose.R.data(),
+                          base);
+    py::array_t<double> t(std::vector<py::ssize_t>{n_poses, 3}, std::vector<py::ssize_t>{stride, d}, pose.t.data(), base);
+    py::array_t<double> alpha(std::vector<py::ssize_t>{n_poses}, std::vector<py::ssize_t>{stride}, &pose.alpha, base);
+    return py::make_tuple(R, t, alpha);
+}
+
+// Returns the tuple (R, t, alpha, num_solutions) with the arrays R (m, 3, 3), t (m, 3) and alpha (m) of all poses,
+// and num_solutions (batch) holding the number of poses of each problem.
+py::tuple solve_batch(const SolverInfo &solver, const SolverArguments &signature, const std::vector<DoubleArray> &arrays) {
+    size_t n_problems;
+    const std::vector<BatchArgument> arguments = batch_arguments(solver, signature, arrays, true, &n_problems);
+    py::array_t<int> num_solutions(static_cast<py::ssize_t>(n_problems));
+    int *num_solutions_data = num_solutions.mutable_data();
+    CameraPoseVector poses;
+    {
+        py::gil_scoped_release release;
+        // The batched solvers only use the minimal number of vectors, so they are only used if no more are given.
+        bool minimal = true;
+        for (const BatchArgument &argument : arguments) {
+            minimal = minimal && argument.size == static_cast<size_t>(solver.*(argument.field->count));
+        }
+        if (signature.batch != nullptr && minimal) {
+            std::vector<int> counts;
+            signature.batch(arguments, n_problems, &poses, &counts);
+            std::copy(counts.begin(), counts.end(), num_solutions_data);
+        } else {
+            poses.reserve(n_problems);
+            solve_problems(solver, arguments, n_problems, &poses, num_solutions_data);
+        }
+    }
+
+    const py::tuple R_t_alpha = pose_arrays(std::move(poses));
+    return py::make_tuple(R_t_alpha[0], R_t_alpha[1], R_t_alpha[2], num_solutions);
+}
+
+// Defines the functions <solver>(...) and <solver>_batch(...) taking the arguments in signature.
+void def_solver(py::module &m, const SolverInfo &solver, const SolverArguments &signature) {
+    const SolverInfo *s = &solver;
+    const SolverArguments *sig = &signature;
+    const std::vector<const char *> &a = signature.arguments;
+    const std::string batch_name = std::string(solver.name) + "_batch";
+    const std::string doc = "Solves one minimal problem, the arguments are arrays of shape (n, 3). Returns a list of CameraPose.";
+    const std::string batch_doc = "Solves a batch of minimal problems, the arguments are arrays of shape (batch, n, 3). "
+                                  "Returns the tuple (R, t, alpha, num_solutions) where R (m, 3, 3), t (m, 3) and alpha (m) "
+                                  "hold the poses of all problems, ordered by problem, and num_solutions (batch) holds the "
+                                  "number of poses of each problem.";
+    switch (a.size()) {
+    case 2:
+        m.def(solver.name, [s, sig](DoubleArray a0, DoubleArray a1) { return solve(*s, *sig, {a0, a1}); },
+              py::arg(a[0]), py::arg(a[1]), doc.c_str());
+        m.def(batch_name.c_str(), [s, sig](DoubleArray a0, DoubleArray a1) { return solve_batch(*s, *sig, {a0, a1}); },
+              py::arg(a[0]), py::arg(a[1]), batch_doc.c_str());
+        break;
+    case 3:
+        m.def(solver.name,
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2) { return solve(*s, *sig, {a0, a1, a2}); },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), doc.c_str());
+        m.def(batch_name.c_str(),
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2) { return solve_batch(*s, *sig, {a0, a1, a2}); },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), batch_doc.c_str());
+        break;
+    case 4:
+        m.def(solver.name,
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2, DoubleArray a3) {
+                  return solve(*s, *sig, {a0, a1, a2, a3});
+              },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), py::arg(a[3]), doc.c_str());
+        m.def(batch_name.c_str(),
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2, DoubleArray a3) {
+                  return solve_batch(*s, *sig, {a0, a1, a2, a3});
+              },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), py::arg(a[3]), batch_doc.c_str());
+        break;
+    case 5:
+        m.def(solver.name,
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2, DoubleArray a3, DoubleArray a4) {
+                  return solve(*s, *sig, {a0, a1, a2, a3, a4});
+              },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), py::arg(a[3]), py::arg(a[4]), doc.c_str());
+        m.def(batch_name.c_str(),
+              [s, sig](DoubleArray a0, DoubleArray a1, DoubleArray a2, DoubleArray a3, DoubleArray a4) {
+                  return solve_batch(*s, *sig, {a0, a1, a2, a3, a4});
+              },
+              py::arg(a[0]), py::arg(a[1]), py::arg(a[2]), py::arg(a[3]), py::arg(a[4]), batch_doc.c_str());
+        break;
+    default:
+        throw std::logic_error(std::string("Unsupported number of arguments for ") + solver.name);
+    }
+}
+
+py::dict solver_description(const SolverInfo &solver, const SolverArguments &signature) {
+    py::dict d;
+    d["name"] = solver.name;
+    d["problem"] = solver.problem == ProblemType::ABSOLUTE_POSE ? "absolute" : "relative";
+    d["arguments"] = signature.arguments;
+    d["num_point_point"] = solver.num_point_point;
+    d["num_point_line"] = solver.num_point_line;
+    d["num_line_point"] = solver.num_line_point;
+    d["num_line_line"] = solver.num_line_line;
+    d["sample_size"] = solver.sample_size;
+    d["max_solutions"] = solver.max_solutions;
+    d["upright"] = (solver.flags & SOLVER_UPRIGHT) != 0;
+    d["planar"] = (solver.flags & SOLVER_PLANAR) != 0;
+    d["generalized"] = (solver.flags & SOLVER_GENERALIZED) != 0;
+    d["radial"] = (solver.flags & SOLVER_RADIAL) != 0;
+    d["scale"] = (solver.flags & SOLVER_SCALE) != 0;
+    d["focal"] = (solver.flags & SOLVER_FOCAL) != 0;
+    return d;
+}
+
+} // namespace
+} // namespace pose_lib
+
+PYBIND11_MODULE(poselib, m) {
+    using namespace pose_lib;
+    m.doc() = "Python bindings of PoseLib, a collection of minimal solvers for camera pose estimation.";
+
+    py::class_<CameraPose>(m, "CameraPose")
+        .def(py::init<>())
+        .def_readwrite("R", &CameraPose::R)
+        .def_readwrite("t", &CameraPose::t)
+        .def_readwrite("alpha", &CameraPose::alpha);
+
+    for (const SolverArguments &signature : solver_arguments) {
+        const SolverInfo *solver = find_solver(signature.solver);
+        if (solver == nullptr) {
+            throw std::logic_error(std::string("Unknown solver ") + signature.solver);
+        }
+        def_solver(m, *solver, signature);
+    }
+
+    m.def("solvers", [] {
+        py::list list;
+        for (const SolverInfo &solver : solver_registry()) {
+            for (const SolverArguments &signature : solver_arguments) {
+                if (std::string(signature.solver) == solver.name) {
+                    list.append(solver_description(solver, signature));
+                }
+            }
+        }
+        return list;
+    }, "Returns a description (name, arguments, number of correspondences, ...) of each solver, cheapest first.");
+}
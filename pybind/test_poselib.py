@@ -0,0 +1,186 @@
+# Smoke test of the Python bindings: solves problems with a known pose, both one at a time and batched, and checks
+# that the batched solvers (used by <solver>_batch) agree with the scalar solvers.
+import sys
+
+import numpy as np
+
+import poselib
+
+
+def random_rotation(rng):
+    q = rng.standard_normal(4)
+    w, x, y, z = q / np.linalg.norm(q)
+    return np.array([[1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)],
+                     [2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)],
+                     [2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)]])
+
+
+def upright_rotation(rng):
+    # Rotation around the y-axis, as assumed by the upright solvers
+    theta = rng.uniform(-np.pi, np.pi)
+    c, s = np.cos(theta), np.sin(theta)
+    return np.array([[c, 0.0, s], [0.0, 1.0, 0.0], [-s, 0.0, c]])
+
+
+def normalized(v):
+    return v / np.linalg.norm(v, axis=1, keepdims=True)
+
+
+def random_problem(rng):
+    # Points in front of the camera, and their bearing vectors x such that lambda * x = R * X + t
+    R = random_rotation(rng)
+    t = rng.standard_normal(3)
+    Z = rng.uniform(-1.0, 1.0, (3, 3)) + np.array([0.0, 0.0, 5.0])
+    X = (Z - t) @ R
+    x = Z / np.linalg.norm(Z, axis=1, keepdims=True)
+    return R, t, x, X
+
+
+def absolute_problem(rng, n, generalized=False, lines=False):
+    # Upright absolute pose, p + lambda * x = R * X + t where p = 0 unless generalized. For lines, X is moved along
+    # the random direction V such that the point lies on the 3D line (X, V).
+    R = upright_rotation(rng)
+    t = rng.standard_normal(3)
+    Z = rng.uniform(-1.0, 1.0, (n, 3)) + np.array([0.0, 0.0, 5.0])
+    p = 0.5 * rng.standard_normal((n, 3)) if generalized else np.zeros((n, 3))
+    x = normalized(Z - p)
+    X = (Z - t) @ R
+    if not lines:
+        return R, t, {"p": p, "x": x, "X": X}
+    V = normalized(rng.standard_normal((n, 3)))
+    return R, t, {"p": p, "x": x, "X": X + rng.uniform(-1.0, 1.0, (n, 1)) * V, "V": V}
+
+
+def relative_problem(rng, n, upright=False, planar=False, generalized=False):
+    # Relative pose, R * (p1 + lambda1 * x1) + t = p2 + lambda2 * x2 where p1 = p2 = 0 unless generalized.
+    # Without the camera centers the scale is unknown, so then t has unit length.
+    R = upright_rotation(rng) if upright else random_rotation(rng)
+    t = rng.standard_normal(3)
+    if planar:
+        t[1] = 0.0
+    if not generalized:
+        t /= np.linalg.norm(t)
+    Z = rng.uniform(-1.0, 1.0, (n, 3)) + np.array([0.0, 0.0, 5.0])
+    p1 = 0.5 * rng.standard_normal((n, 3)) if generalized else np.zeros((n, 3))
+    p2 = 0.5 * rng.standard_normal((n, 3)) if generalized else np.zeros((n, 3))
+    x1 = normalized(Z - p1)
+    x2 = normalized(Z @ R.T + t - p2)
+    return R, t, {"p1": p1, "x1": x1, "p2": p2, "x2": x2}
+
+
+def pose_error(R, t, R_gt, t_gt):
+    return np.linalg.norm(R - R_gt) + np.linalg.norm(t - t_gt)
+
+
+def relative_pose_error(R, t, R_ref, t_ref):
+    # Spurious solutions can have large translations, which are only accurate relative to their length
+    return np.linalg.norm(R - R_ref) + np.linalg.norm(t - t_ref) / max(1.0, np.linalg.norm(t_ref))
+
+
+# Solvers with a batched version: name, arguments, problem generator, whether the translation is only known up to
+# scale, and whether all poses are compared with the scalar solver. The other solvers find the roots of a higher
+# degree polynomial differently in the batched version, and spurious roots close to a double root are ill-conditioned,
+# which can also change the number of solutions, so only the true pose is compared for them.
+BATCH_SOLVERS = [
+    ("up2p", ["x", "X"], lambda rng, n: absolute_problem(rng, n), False, True),
+    ("ugp2p", ["p", "x", "X"], lambda rng, n: absolute_problem(rng, n, generalized=True), False, True),
+    ("up4pl", ["x", "X", "V"], lambda rng, n: absolute_problem(rng, n, lines=True), False, False),
+    ("ugp4pl", ["p", "x", "X", "V"], lambda rng, n: absolute_problem(rng, n, generalized=True, lines=True),
+     False, False),
+    ("relpose_5pt", ["x1", "x2"], lambda rng, n: relative_problem(rng, n), True, False),
+    ("relpose_upright_3pt", ["x1", "x2"], lambda rng, n: relative_problem(rng, n, upright=True), True, True),
+    ("gen_relpose_upright_4pt", ["p1", "x1", "p2", "x2"],
+     lambda rng, n: relative_problem(rng, n, upright=True, generalized=True), False, False),
+    ("relpose_upright_planar_2pt", ["x1", "x2"], lambda rng, n: relative_problem(rng, n, upright=True, planar=True),
+     True, True),
+]
+
+
+def scaled(t, up_to_scale):
+    return t / np.linalg.norm(t) if up_to_scale else t
+
+
+def check_batch_solver(rng, name, arguments, generate, up_to_scale, same_solutions, n_problems=20, tol=1e-5):
+    sample_size = next(s["sample_size"] for s in poselib.solvers() if s["name"] == name)
+    problems = [generate(rng, sample_size) for _ in range(n_problems)]
+    arrays = [np.stack([p[2][a] for p in problems]) for a in arguments]
+    R, t, alpha, num_solutions = getattr(poselib, name + "_batch")(*arrays)
+    assert num_solutions.shape == (n_problems,), name
+    assert R.shape == (num_solutions.sum(), 3, 3) and t.shape == (num_solutions.sum(), 3), name
+    offsets = np.concatenate([[0], np.cumsum(num_solutions)])
+
+    found_batch, found_scalar = 0, 0
+    for i, (R_gt, t_gt, args) in enumerate(problems):
+        poses = getattr(poselib, name)(*[args[a] for a in arguments])
+        batch = range(offsets[i], offsets[i + 1])
+        if same_solutions:
+            assert len(poses) == num_solutions[i], "%s_batch returned %d poses for problem %d, %s %d" % (
+                name, num_solutions[i], i, name, len(poses))
+            for k in batch:
+                errors = [relative_pose_error(R[k], scaled(t[k], up_to_scale), p.R, scaled(p.t, up_to_scale))
+                          for p in poses]
+                assert min(errors) < tol, "pose %d of %s_batch is not returned by %s" % (k, name, name)
+        found_batch += any(pose_error(R[k], scaled(t[k], up_to_scale), R_gt, t_gt) < tol for k in batch)
+        found_scalar += any(pose_error(p.R, scaled(p.t, up_to_scale), R_gt, t_gt) < tol for p in poses)
+    # Allow for a few ill-conditioned problems where the true pose is not found to the tolerance
+    assert found_batch >= 0.9 * n_problems, "%s_batch found the true pose of %d problems" % (name, found_batch)
+    assert found_scalar >= 0.9 * n_problems, "%s found the true pose of %d problems" % (name, found_scalar)
+
+
+def check_non_minimal_batch(rng):
+    # With more than the minimal number of correspondences, p3p_batch solves the problems one at a time,
+    # which uses the first three correspondences of each problem.
+    problems = [random_problem(rng) for _ in range(10)]
+    extra = rng.standard_normal((len(problems), 2, 3))
+    xs = np.concatenate([np.stack([p[2] for p in problems]), extra], axis=1)
+    Xs = np.concatenate([np.stack([p[3] for p in problems]), extra], axis=1)
+    R, t, alpha, num_solutions = poselib.p3p_batch(xs, Xs)
+    R_min, t_min, alpha_min, num_solutions_min = poselib.p3p_batch(xs[:, :3], Xs[:, :3])
+    assert np.array_equal(num_solutions, num_solutions_min)
+    offsets = np.concatenate([[0], np.cumsum(num_solutions)])
+    for i in range(len(problems)):
+        poses = poselib.p3p(xs[i], Xs[i])
+        assert len(poses) == num_solutions[i]
+        for k, p in zip(range(offsets[i], offsets[i + 1]), poses):
+            assert np.array_equal(R[k], p.R) and np.array_equal(t[k], p.t), "p3p_batch does not match p3p"
+        for k in range(offsets[i], offsets[i + 1]):
+            errors = [pose_error(R[k], t[k], R_min[j], t_min[j]) for j in range(offsets[i], offsets[i + 1])]
+            assert min(errors) < 1e-6, "p3p_batch with extra correspondences does not match the minimal problem"
+
+
+def main():
+    rng = np.random.default_rng(0)
+    tol = 1e-6
+
+    R_gt, t_gt, x, X = random_problem(rng)
+    poses = poselib.p3p(x, X)
+    assert len(poses) > 0, "p3p returned no poses"
+    assert min(pose_error(p.R, p.t, R_gt, t_gt) for p in poses) < tol, "p3p did not find the pose"
+
+    problems = [random_problem(rng) for _ in range(20)]
+    xs = np.stack([p[2] for p in problems])
+    Xs = np.stack([p[3] for p in problems])
+    R, t, alpha, num_solutions = poselib.p3p_batch(xs, Xs)
+    assert num_solutions.shape == (len(problems),)
+    assert R.shape == (num_solutions.sum(), 3, 3) and t.shape == (num_solutions.sum(), 3)
+    assert np.allclose(alpha, 1.0)
+    offsets = np.concatenate([[0], np.cumsum(num_solutions)])
+    for i, (R_gt, t_gt, _, _) in enumerate(problems):
+        errors = [pose_error(R[k], t[k], R_gt, t_gt) for k in range(offsets[i], offsets[i + 1])]
+        assert errors and min(errors) < tol, "p3p_batch did not find the pose of problem %d" % i
+
+    # Non-contiguous arrays are copied before calling the solver, with the same result
+    R_copy, t_copy, _, num_solutions_copy = poselib.p3p_batch(np.asfortranarray(xs), np.asfortranarray(Xs))
+    assert np.array_equal(num_solutions, num_solutions_copy) and np.array_equal(R, R_copy) and np.array_equal(t, t_copy)
+
+    for name, arguments, generate, up_to_scale, same_solutions in BATCH_SOLVERS:
+        check_batch_solver(rng, name, arguments, generate, up_to_scale, same_solutions)
+
+    check_non_minimal_batch(rng)
+
+    print("OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())